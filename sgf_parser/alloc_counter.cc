@@ -0,0 +1,100 @@
+#include "sgf_parser/alloc_counter.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+
+#include <cstddef>
+#include <new>
+
+namespace {
+
+// Per thread, so other threads don't disturb a measurement. Plain integers
+// need no construction, which matters since operator new may run before
+// anything else in a thread.
+thread_local int64_t allocations = 0;
+thread_local int64_t allocated_bytes = 0;
+
+void* Allocate(size_t size, size_t alignment) {
+  ++allocations;
+  allocated_bytes += size;
+  if (size == 0) size = 1;
+  void* p = nullptr;
+  if (alignment <= alignof(std::max_align_t)) {
+    p = malloc(size);
+  } else if (posix_memalign(&p, alignment, size) != 0) {
+    p = nullptr;
+  }
+  return p;
+}
+
+void* AllocateOrThrow(size_t size, size_t alignment) {
+  void* p = Allocate(size, alignment);
+  if (p == nullptr) throw std::bad_alloc();
+  return p;
+}
+
+}  // namespace
+
+namespace sgf_parser {
+
+AllocationCounter::AllocationCounter() { Reset(); }
+
+int64_t AllocationCounter::allocations() const {
+  return ::allocations - start_allocations_;
+}
+
+int64_t AllocationCounter::bytes() const {
+  return allocated_bytes - start_bytes_;
+}
+
+void AllocationCounter::Reset() {
+  start_allocations_ = ::allocations;
+  start_bytes_ = allocated_bytes;
+}
+
+}  // namespace sgf_parser
+
+void* operator new(size_t size) {
+  return AllocateOrThrow(size, 0);
+}
+
+void* operator new[](size_t size) {
+  return AllocateOrThrow(size, 0);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size, 0);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+  return Allocate(size, 0);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+  return AllocateOrThrow(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+  return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t&) noexcept {
+  return Allocate(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
@@ -0,0 +1,35 @@
+#ifndef SGF_PARSER_ALLOC_COUNTER_H_
+#define SGF_PARSER_ALLOC_COUNTER_H_
+
+#include <stdint.h>
+
+namespace sgf_parser {
+
+// Counts the heap allocations made by the current thread while it is alive,
+// for tests and benchmarks which check that code doesn't allocate. Counters
+// may be nested.
+//
+// Linking this library replaces the global operator new and delete, so only
+// link it into tests, benchmarks and fuzzers. Memory allocated with malloc()
+// directly isn't counted.
+class AllocationCounter {
+ public:
+  AllocationCounter();
+
+  AllocationCounter(const AllocationCounter&) = delete;
+  AllocationCounter& operator=(const AllocationCounter&) = delete;
+
+  // Allocations and bytes requested since construction or the last Reset().
+  int64_t allocations() const;
+  int64_t bytes() const;
+
+  void Reset();
+
+ private:
+  int64_t start_allocations_;
+  int64_t start_bytes_;
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_ALLOC_COUNTER_H_
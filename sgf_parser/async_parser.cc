@@ -0,0 +1,53 @@
+#include "sgf_parser/async_parser.h"
+
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+Task<std::string> ReadFileAsync(std::string filename, Executor* io,
+                                Executor* resume_on) {
+  co_await ScheduleOn(io);
+  std::string contents = ReadFileToString(filename);
+  co_await ScheduleOn(resume_on);
+  co_return contents;
+}
+
+Task<ParseResult> ParseSgfAsync(std::string filename, Executor* io,
+                                Executor* cpu) {
+  ParseResult result;
+  const std::string sgf = co_await ReadFileAsync(filename, io, cpu);
+  result.filename = std::move(filename);
+  result.ok = SimpleParseSgf(sgf, &result.record, nullptr, &result.errors);
+  co_return result;
+}
+
+AsyncGenerator<ParseResult> ReadGamesAsync(std::vector<std::string> filenames,
+                                           Executor* io, Executor* cpu) {
+  ParseResult result;
+  for (auto& filename : filenames) {
+    const std::string sgf = co_await ReadFileAsync(filename, io, cpu);
+    result.filename = std::move(filename);
+    result.errors.clear();
+    internal::GameTree root(nullptr);
+    if (!internal::ParseToRoot(sgf, &root, &result.errors) ||
+        root.children.empty()) {
+      if (result.errors.empty()) result.errors = "An empty tree collection.";
+      VLOG(1) << "Failed to parse " << result.filename;
+      result.ok = false;
+      result.record.Reset();
+      co_yield result;
+      continue;
+    }
+    for (const auto& game : root.children) {
+      result.record.Reset();
+      result.errors.clear();
+      result.ok = FillGameRecord(*game, &result.record, nullptr,
+                                 &result.errors);
+      co_yield result;
+    }
+  }
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,242 @@
+#ifndef SGF_PARSER_ASYNC_PARSER_H_
+#define SGF_PARSER_ASYNC_PARSER_H_
+
+// Coroutine based parsing APIs. Requires C++20.
+
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sgf_parser/parser.h"
+#include "sgf_parser/thread_pool.h"
+
+namespace sgf_parser {
+
+// Where coroutines resume. Implement it to plug the parser into an event loop.
+class Executor {
+ public:
+  virtual ~Executor() = default;
+  virtual void Post(std::function<void()> fn) = 0;
+};
+
+// Runs everything immediately on the posting thread.
+class InlineExecutor : public Executor {
+ public:
+  void Post(std::function<void()> fn) override { fn(); }
+};
+
+// Runs on a ThreadPool.
+class ThreadPoolExecutor : public Executor {
+ public:
+  explicit ThreadPoolExecutor(ThreadPool* pool) : pool_(pool) {}
+  void Post(std::function<void()> fn) override {
+    pool_->Schedule(std::move(fn));
+  }
+
+ private:
+  ThreadPool* pool_;
+};
+
+// `co_await ScheduleOn(executor)` moves the coroutine onto `executor`.
+inline auto ScheduleOn(Executor* executor) {
+  struct Awaiter {
+    Executor* executor;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const {
+      executor->Post([h] { h.resume(); });
+    }
+    void await_resume() const noexcept {}
+  };
+  return Awaiter{executor};
+}
+
+namespace internal {
+
+// Resumes `target` when the awaiting coroutine suspends.
+struct TransferTo {
+  std::coroutine_handle<> target;
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<>) noexcept {
+    return target ? target : std::noop_coroutine();
+  }
+  void await_resume() const noexcept {}
+};
+
+}  // namespace internal
+
+// A lazily started coroutine producing a T. It starts when awaited and resumes
+// the awaiting coroutine when done, on whatever thread it finished on.
+template <typename T>
+class Task {
+ public:
+  struct promise_type {
+    std::optional<T> value;
+    std::coroutine_handle<> continuation;
+
+    Task get_return_object() {
+      return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    internal::TransferTo final_suspend() noexcept {
+      return internal::TransferTo{continuation};
+    }
+    void return_value(T v) { value.emplace(std::move(v)); }
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task(const Task&) = delete;
+  Task& operator=(const Task&) = delete;
+  ~Task() {
+    if (handle_) handle_.destroy();
+  }
+
+  bool await_ready() const noexcept { return false; }
+  std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) {
+    handle_.promise().continuation = awaiting;
+    return handle_;
+  }
+  T await_resume() { return std::move(*handle_.promise().value); }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> h) : handle_(h) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// A coroutine which produces a sequence of values with co_yield and may
+// co_await in between. Consumers pull values with `co_await generator.Next()`,
+// which returns a pointer to the value, valid until the next call, or null
+// at the end.
+template <typename T>
+class AsyncGenerator {
+ public:
+  struct promise_type {
+    T* current = nullptr;
+    std::coroutine_handle<> consumer;
+
+    AsyncGenerator get_return_object() {
+      return AsyncGenerator(
+          std::coroutine_handle<promise_type>::from_promise(*this));
+    }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    internal::TransferTo final_suspend() noexcept {
+      current = nullptr;
+      return internal::TransferTo{consumer};
+    }
+    internal::TransferTo yield_value(T& value) noexcept {
+      current = std::addressof(value);
+      return internal::TransferTo{consumer};
+    }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  AsyncGenerator(AsyncGenerator&& other) noexcept
+      : handle_(std::exchange(other.handle_, {})) {}
+  AsyncGenerator(const AsyncGenerator&) = delete;
+  AsyncGenerator& operator=(const AsyncGenerator&) = delete;
+  ~AsyncGenerator() {
+    if (handle_) handle_.destroy();
+  }
+
+  auto Next() {
+    struct Awaiter {
+      std::coroutine_handle<promise_type> handle;
+      bool await_ready() const noexcept { return handle.done(); }
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> h) {
+        handle.promise().consumer = h;
+        return handle;
+      }
+      T* await_resume() const noexcept {
+        return handle.done() ? nullptr : handle.promise().current;
+      }
+    };
+    return Awaiter{handle_};
+  }
+
+ private:
+  explicit AsyncGenerator(std::coroutine_handle<promise_type> h)
+      : handle_(h) {}
+
+  std::coroutine_handle<promise_type> handle_;
+};
+
+namespace internal {
+
+// A coroutine which starts immediately and frees itself when done.
+struct Detached {
+  struct promise_type {
+    Detached get_return_object() { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+};
+
+template <typename T>
+Detached RunTask(Task<T> task, std::function<void(T)> on_done) {
+  on_done(co_await task);
+}
+
+}  // namespace internal
+
+// Starts `task` and calls `on_done` with its result. Returns immediately once
+// the task first suspends.
+template <typename T>
+void Spawn(Task<T> task, std::function<void(T)> on_done) {
+  internal::RunTask(std::move(task), std::move(on_done));
+}
+
+// Runs `task` and blocks until its result is ready. Mainly for tests and
+// callers without an event loop.
+template <typename T>
+T SyncWait(Task<T> task) {
+  std::mutex mu;
+  std::condition_variable cv;
+  std::optional<T> result;
+  Spawn<T>(std::move(task), [&](T value) {
+    std::lock_guard<std::mutex> lock(mu);
+    result.emplace(std::move(value));
+    cv.notify_all();
+  });
+  std::unique_lock<std::mutex> lock(mu);
+  cv.wait(lock, [&] { return result.has_value(); });
+  return std::move(*result);
+}
+
+// The result of parsing one game.
+struct ParseResult {
+  std::string filename;
+  bool ok = false;
+  GameRecord record;
+  std::string errors;
+};
+
+// Reads a file on `io`, then resumes on `resume_on`. The blocking read runs on
+// `io`, so event loop threads never wait for the disk.
+Task<std::string> ReadFileAsync(std::string filename, Executor* io,
+                                Executor* resume_on);
+
+// Reads the file on `io` and parses it with SimpleParseSgf on `cpu`.
+Task<ParseResult> ParseSgfAsync(std::string filename, Executor* io,
+                                Executor* cpu);
+
+// Yields one result per game of every file, so collections with several games
+// give several results. Files are read on `io` and parsed on `cpu`; the
+// generator suspends while a file is read and after every game. A file which
+// fails to parse gives one result with ok == false.
+AsyncGenerator<ParseResult> ReadGamesAsync(std::vector<std::string> filenames,
+                                           Executor* io, Executor* cpu);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_ASYNC_PARSER_H_
@@ -0,0 +1,63 @@
+#include "sgf_parser/async_parser.h"
+
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+// Drains a generator into "filename:moves" strings.
+Task<std::vector<string>> Collect(AsyncGenerator<ParseResult> games) {
+  std::vector<string> out;
+  while (ParseResult* result = co_await games.Next()) {
+    out.push_back(result->filename + ":" +
+                  (result->ok ? std::to_string(result->record.moves.size())
+                              : "error"));
+  }
+  co_return out;
+}
+
+TEST(AsyncParserTest, ParseInline) {
+  InlineExecutor inline_executor;
+  ParseResult result = SyncWait(ParseSgfAsync(
+      "testdata/resigned.sgf", &inline_executor, &inline_executor));
+  EXPECT_TRUE(result.ok) << result.errors;
+  EXPECT_EQ(result.record.moves.size(), 20);
+}
+
+TEST(AsyncParserTest, ParseOnPools) {
+  ThreadPool io_pool(1);
+  ThreadPool cpu_pool(2);
+  ThreadPoolExecutor io(&io_pool);
+  ThreadPoolExecutor cpu(&cpu_pool);
+  ParseResult result =
+      SyncWait(ParseSgfAsync("testdata/handicapped.sgf", &io, &cpu));
+  EXPECT_TRUE(result.ok) << result.errors;
+  EXPECT_EQ(result.record.handicap, 4);
+}
+
+TEST(AsyncParserTest, GamesOfCollections) {
+  ThreadPool io_pool(1);
+  ThreadPool cpu_pool(2);
+  ThreadPoolExecutor io(&io_pool);
+  ThreadPoolExecutor cpu(&cpu_pool);
+  const std::vector<string> games = SyncWait(Collect(ReadGamesAsync(
+      {"testdata/collection.sgf", "testdata/does_not_exist.sgf",
+       "testdata/resigned.sgf"},
+      &io, &cpu)));
+  EXPECT_EQ(games, std::vector<string>({
+      "testdata/collection.sgf:6",
+      "testdata/collection.sgf:5",
+      "testdata/collection.sgf:5",
+      "testdata/does_not_exist.sgf:error",
+      "testdata/resigned.sgf:20",
+  }));
+}
+
+}  // namespace
+}  // namespace sgf_parser
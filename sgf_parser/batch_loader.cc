@@ -0,0 +1,417 @@
+#include "sgf_parser/batch_loader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#include "glog/logging.h"
+#include "sgf_parser/numa.h"
+#include "sgf_parser/page_buffer.h"
+
+namespace sgf_parser {
+
+namespace {
+
+// A minimal io_uring wrapper, enough for batches of openat, read and close.
+// We talk to the kernel directly instead of depending on liburing.
+class Ring {
+ public:
+  Ring() = default;
+  Ring(const Ring&) = delete;
+  Ring& operator=(const Ring&) = delete;
+
+  ~Ring() {
+    if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_size_);
+    if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_size_);
+    if (sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_size_);
+    if (fd_ >= 0) close(fd_);
+  }
+
+  bool Init(unsigned entries) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    fd_ = syscall(__NR_io_uring_setup, entries, &params);
+    if (fd_ < 0) return false;
+    // IORING_OP_OPENAT and IORING_OP_CLOSE came with Linux 5.6, as did this
+    // feature flag.
+    if (!(params.features & IORING_FEAT_RW_CUR_POS)) return false;
+
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+    sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) return false;
+    if (single_mmap) {
+      cq_ptr_ = sq_ptr_;
+    } else {
+      cq_ptr_ = mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+      if (cq_ptr_ == MAP_FAILED) return false;
+    }
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED) return false;
+
+    char* sq = static_cast<char*>(sq_ptr_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+    local_tail_ = *sq_tail_;
+    char* cq = static_cast<char*>(cq_ptr_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    return true;
+  }
+
+  // Returns a cleared submission entry, or null if the queue is full.
+  io_uring_sqe* NextSqe() {
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (local_tail_ - head >= sq_entries_) return nullptr;
+    const unsigned index = local_tail_ & sq_mask_;
+    sq_array_[index] = index;
+    ++local_tail_;
+    ++to_submit_;
+    io_uring_sqe* sqe = static_cast<io_uring_sqe*>(sqes_) + index;
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+  }
+
+  // Submits the queued entries and waits for at least `wait` completions.
+  // Returns false on an unexpected error.
+  bool Submit(unsigned wait) {
+    __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+    while (to_submit_ > 0 || wait > 0) {
+      const int ret = syscall(__NR_io_uring_enter, fd_, to_submit_, wait,
+                              wait > 0 ? IORING_ENTER_GETEVENTS : 0,
+                              nullptr, 0);
+      if (ret < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+        PLOG(ERROR) << "io_uring_enter failed";
+        return false;
+      }
+      to_submit_ -= ret;
+      wait = 0;
+    }
+    return true;
+  }
+
+  // Calls `fn` for every available completion.
+  template <typename Fn>
+  void Reap(Fn fn) {
+    unsigned head = *cq_head_;
+    const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    for (; head != tail; ++head) {
+      fn(cqes_[head & cq_mask_]);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+
+ private:
+  int fd_ = -1;
+  void* sq_ptr_ = MAP_FAILED;
+  void* cq_ptr_ = MAP_FAILED;
+  void* sqes_ = MAP_FAILED;
+  size_t sq_size_ = 0;
+  size_t cq_size_ = 0;
+  size_t sqes_size_ = 0;
+
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned sq_entries_ = 0;
+  unsigned local_tail_ = 0;
+  unsigned to_submit_ = 0;
+
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned cq_mask_ = 0;
+  io_uring_cqe* cqes_ = nullptr;
+};
+
+// State shared by the loader threads.
+struct Shared {
+  const std::vector<std::string>* filenames;
+  const BatchLoaderOptions* options;
+  const std::function<void(const LoadedFile&)>* callback;
+  std::atomic<size_t> next{0};
+  // The CPU of every thread, if they are pinned.
+  std::vector<CpuPlacement> placements;
+
+  // Returns false when all files have been handed out.
+  bool NextFile(size_t* index) {
+    *index = next.fetch_add(1, std::memory_order_relaxed);
+    return *index < filenames->size();
+  }
+};
+
+// Reads what did not fit into the first buffer. Returns 0 or an errno value.
+int ReadRest(int fd, absl::string_view head, std::string* overflow) {
+  overflow->assign(head.data(), head.size());
+  char chunk[64 << 10];
+  while (true) {
+    const ssize_t n = pread(fd, chunk, sizeof(chunk), overflow->size());
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return errno;
+    }
+    if (n == 0) return 0;
+    overflow->append(chunk, n);
+  }
+}
+
+// Blocking loader, also the fallback when io_uring is not available.
+void LoadWithSyscalls(Shared* shared, int worker, char* buffer) {
+  const size_t buffer_size = shared->options->buffer_size;
+  std::string overflow;
+  size_t index;
+  while (shared->NextFile(&index)) {
+    const std::string& filename = (*shared->filenames)[index];
+    LoadedFile file{index, &filename, absl::string_view(), 0, worker};
+    const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      file.error = errno;
+      (*shared->callback)(file);
+      continue;
+    }
+    ssize_t n;
+    do {
+      n = pread(fd, buffer, buffer_size, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+      file.error = errno;
+    } else if (static_cast<size_t>(n) == buffer_size) {
+      file.error = ReadRest(fd, absl::string_view(buffer, n), &overflow);
+      file.contents = overflow;
+    } else {
+      file.contents = absl::string_view(buffer, n);
+    }
+    close(fd);
+    (*shared->callback)(file);
+  }
+}
+
+// Keeps `queue_depth` files in flight. Each file goes through three requests,
+// openat -> read -> close, and a slot of the arena is bound to the file until
+// its close has completed.
+bool LoadWithIoUring(Shared* shared, int worker, char* arena) {
+  const BatchLoaderOptions& options = *shared->options;
+  const unsigned depth = std::max(1, options.queue_depth);
+  Ring ring;
+  if (!ring.Init(depth)) return false;
+
+  enum State { FREE, OPENING, READING, CLOSING };
+  struct Slot {
+    State state = FREE;
+    size_t file = 0;
+    int fd = -1;
+    char* buffer = nullptr;
+  };
+  std::vector<Slot> slots(depth);
+  std::vector<unsigned> free_slots;
+  for (unsigned i = 0; i < depth; ++i) {
+    slots[i].buffer = arena + i * options.buffer_size;
+    free_slots.push_back(depth - 1 - i);
+  }
+
+  std::string overflow;
+  unsigned in_flight = 0;
+  bool more_files = true;
+  while (more_files || in_flight > 0) {
+    // Refill free slots with new files.
+    while (more_files && !free_slots.empty()) {
+      size_t index;
+      if (!shared->NextFile(&index)) {
+        more_files = false;
+        break;
+      }
+      io_uring_sqe* sqe = ring.NextSqe();
+      CHECK(sqe != nullptr);   // One request per slot at most.
+      const unsigned s = free_slots.back();
+      free_slots.pop_back();
+      slots[s].state = OPENING;
+      slots[s].file = index;
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = reinterpret_cast<uint64_t>(
+          (*shared->filenames)[index].c_str());
+      sqe->open_flags = O_RDONLY | O_CLOEXEC;
+      sqe->user_data = s;
+      ++in_flight;
+    }
+    if (!ring.Submit(in_flight > 0 ? 1 : 0)) {
+      // Fail the files in flight. The caller loads the rest without io_uring.
+      for (Slot& slot : slots) {
+        if (slot.state == OPENING || slot.state == READING) {
+          const std::string& filename = (*shared->filenames)[slot.file];
+          (*shared->callback)(
+              LoadedFile{slot.file, &filename, absl::string_view(), EIO,
+                         worker});
+        }
+        if (slot.state == READING) close(slot.fd);
+      }
+      return false;
+    }
+
+    ring.Reap([&](const io_uring_cqe& cqe) {
+      const unsigned s = cqe.user_data;
+      Slot& slot = slots[s];
+      const std::string& filename = (*shared->filenames)[slot.file];
+      LoadedFile file{slot.file, &filename, absl::string_view(), 0, worker};
+      switch (slot.state) {
+        case OPENING: {
+          if (cqe.res < 0) {
+            file.error = -cqe.res;
+            (*shared->callback)(file);
+            break;
+          }
+          slot.fd = cqe.res;
+          io_uring_sqe* sqe = ring.NextSqe();
+          CHECK(sqe != nullptr);
+          sqe->opcode = IORING_OP_READ;
+          sqe->fd = slot.fd;
+          sqe->addr = reinterpret_cast<uint64_t>(slot.buffer);
+          sqe->len = options.buffer_size;
+          sqe->off = 0;
+          sqe->user_data = s;
+          slot.state = READING;
+          return;
+        }
+        case READING: {
+          if (cqe.res < 0) {
+            file.error = -cqe.res;
+          } else if (static_cast<size_t>(cqe.res) == options.buffer_size) {
+            file.error = ReadRest(
+                slot.fd, absl::string_view(slot.buffer, cqe.res), &overflow);
+            file.contents = overflow;
+          } else {
+            file.contents = absl::string_view(slot.buffer, cqe.res);
+          }
+          (*shared->callback)(file);
+          io_uring_sqe* sqe = ring.NextSqe();
+          CHECK(sqe != nullptr);
+          sqe->opcode = IORING_OP_CLOSE;
+          sqe->fd = slot.fd;
+          sqe->user_data = s;
+          slot.state = CLOSING;
+          return;
+        }
+        case CLOSING:
+          if (cqe.res < 0) {
+            LOG(WARNING) << "Failed to close " << filename << ": "
+                         << strerror(-cqe.res);
+          }
+          break;
+        case FREE:
+          LOG(FATAL) << "Completion for a free slot.";
+      }
+      slot.state = FREE;
+      slot.fd = -1;
+      free_slots.push_back(s);
+      --in_flight;
+    });
+  }
+  return true;
+}
+
+void RunWorker(Shared* shared, int worker) {
+  const BatchLoaderOptions& options = *shared->options;
+  const size_t slots = options.use_io_uring ? std::max(1, options.queue_depth)
+                                            : 1;
+  std::unique_ptr<ScopedCpuPin> pin;
+  PageBufferOptions arena_options;
+  arena_options.huge_pages = options.huge_pages;
+  if (!shared->placements.empty()) {
+    // Pin before allocating, so the arena is first touched on its node.
+    const CpuPlacement& placement = shared->placements[worker];
+    pin.reset(new ScopedCpuPin(placement.cpu));
+    if (pin->ok()) arena_options.node = placement.node;
+  }
+  PageBuffer arena(slots * options.buffer_size, arena_options);
+  if (options.use_io_uring && LoadWithIoUring(shared, worker, arena.data())) {
+    return;
+  }
+  // Either io_uring is off or unavailable, or the ring failed. Load the rest
+  // with plain system calls.
+  LoadWithSyscalls(shared, worker, arena.data());
+}
+
+}  // namespace
+
+bool IoUringAvailable() {
+  Ring ring;
+  return ring.Init(1);
+}
+
+void LoadFiles(const std::vector<std::string>& filenames,
+               const BatchLoaderOptions& options,
+               const std::function<void(const LoadedFile&)>& callback) {
+  CHECK_GT(options.buffer_size, 0);
+  Shared shared;
+  shared.filenames = &filenames;
+  shared.options = &options;
+  shared.callback = &callback;
+  const int threads = std::max(1, options.threads);
+  if (options.pin_threads) {
+    shared.placements = PlaceThreads(ReadNumaTopology(), threads);
+  }
+  std::vector<std::thread> workers;
+  for (int i = 1; i < threads; ++i) {
+    workers.emplace_back(RunWorker, &shared, i);
+  }
+  RunWorker(&shared, 0);
+  for (auto& worker : workers) {
+    worker.join();
+  }
+}
+
+void LoadAndParseFiles(
+    const std::vector<std::string>& filenames,
+    const BatchLoaderOptions& options,
+    const std::function<void(const LoadedFile& file, bool ok,
+                             const GameRecord& record,
+                             const std::string& errors)>& callback) {
+  struct PerWorker {
+    GameRecord record;
+    std::string errors;
+  };
+  // Created by their thread on its first file, so each is on the thread's
+  // node and on cache lines of its own.
+  std::vector<std::unique_ptr<PerWorker>> workers(
+      std::max(1, options.threads));
+  LoadFiles(filenames, options, [&](const LoadedFile& file) {
+    if (workers[file.worker] == nullptr) {
+      workers[file.worker].reset(new PerWorker);
+    }
+    PerWorker& w = *workers[file.worker];
+    w.record.Reset();
+    w.errors.clear();
+    bool ok = false;
+    if (file.error != 0) {
+      w.errors = strerror(file.error);
+    } else {
+      ok = SimpleParseSgf(file.contents, &w.record, nullptr, &w.errors);
+    }
+    callback(file, ok, w.record, w.errors);
+  });
+}
+
+}  // namespace sgf_parser
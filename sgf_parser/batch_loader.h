@@ -0,0 +1,80 @@
+#ifndef SGF_PARSER_BATCH_LOADER_H_
+#define SGF_PARSER_BATCH_LOADER_H_
+
+#include <stddef.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// A file loaded by LoadFiles().
+struct LoadedFile {
+  size_t index;                  // Index in the list of file names.
+  const std::string* filename;
+  absl::string_view contents;    // Only valid during the callback.
+  int error;                     // 0, or the errno of a failed open or read.
+  int worker;                    // The loader thread, in [0, threads).
+};
+
+struct BatchLoaderOptions {
+  // Loader threads. Each has its own io_uring and buffers, and calls the
+  // callback for the files it loads, so callbacks run concurrently.
+  int threads = 1;
+
+  // Files in flight per thread.
+  int queue_depth = 128;
+
+  // Size of a buffer in the arena. Each file in flight gets one. Larger files
+  // are completed with extra synchronous reads into a heap buffer.
+  size_t buffer_size = 16 << 10;
+
+  // Use io_uring if the kernel supports it. Otherwise, or if false, every
+  // thread does blocking open(), read() and close() calls.
+  bool use_io_uring = true;
+
+  // Pin every thread to a CPU, spreading the threads over the NUMA nodes, and
+  // put its arena on the node of its CPU. A thread reads, parses and calls the
+  // callback for its files, so whatever the callback does with a file, e.g.
+  // replay it, also stays on that core and node. Thread 0 is the calling
+  // thread, whose affinity is restored on return.
+  bool pin_threads = false;
+
+  // Back the arenas with 2 MB pages, see PageBufferOptions::huge_pages. Worth
+  // it once queue_depth * buffer_size is a few MB.
+  bool huge_pages = false;
+};
+
+// Returns true if io_uring can be used on this machine.
+bool IoUringAvailable();
+
+// Loads many small files with few system calls. With io_uring, every thread
+// keeps `queue_depth` files in flight: it submits the opens, reads and closes
+// of many files with one io_uring_enter() call and reaps their completions
+// with the next. File contents land in a per-thread arena of fixed size
+// buffers which are reused, so steady state loading doesn't allocate.
+//
+// `callback` is called once per file, in completion order. Blocks until all
+// files have been loaded.
+void LoadFiles(const std::vector<std::string>& filenames,
+               const BatchLoaderOptions& options,
+               const std::function<void(const LoadedFile&)>& callback);
+
+// Loads and parses the files with SimpleParseSgf(), as a bulk replacement of
+// ReadFileToString() plus SimpleParseSgf(). `callback` gets the parsed game as
+// files complete. The record is reused for the next file of the thread, and
+// allocated by that thread, so with `pin_threads` it is local to its node.
+void LoadAndParseFiles(
+    const std::vector<std::string>& filenames,
+    const BatchLoaderOptions& options,
+    const std::function<void(const LoadedFile& file, bool ok,
+                             const GameRecord& record,
+                             const std::string& errors)>& callback);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_BATCH_LOADER_H_
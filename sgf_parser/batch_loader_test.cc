@@ -0,0 +1,137 @@
+#include "sgf_parser/batch_loader.h"
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+class BatchLoaderTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+    const char* tmp = getenv("TEST_TMPDIR");
+    dir_ = tmp != nullptr ? tmp : "/tmp";
+    // Sizes around the buffer size of 100 bytes, and an empty file.
+    for (int size : {0, 1, 99, 100, 101, 250, 5000}) {
+      const string name = dir_ + "/batch_loader_" + std::to_string(size);
+      string contents;
+      for (int i = 0; i < size; ++i) contents.push_back('a' + i % 26);
+      std::ofstream(name) << contents;
+      files_.push_back(name);
+      expected_[name] = contents;
+    }
+    files_.push_back(dir_ + "/batch_loader_does_not_exist");
+  }
+
+  BatchLoaderOptions Options() const {
+    BatchLoaderOptions options;
+    options.use_io_uring = GetParam();
+    options.buffer_size = 100;
+    options.queue_depth = 3;
+    options.threads = 2;
+    return options;
+  }
+
+  string dir_;
+  std::vector<string> files_;
+  std::map<string, string> expected_;
+};
+
+TEST_P(BatchLoaderTest, LoadFiles) {
+  std::mutex mu;
+  std::map<string, string> loaded;
+  std::vector<int> seen(files_.size());
+  int errors = 0;
+  LoadFiles(files_, Options(), [&](const LoadedFile& file) {
+    std::lock_guard<std::mutex> lock(mu);
+    ++seen[file.index];
+    EXPECT_EQ(*file.filename, files_[file.index]);
+    EXPECT_GE(file.worker, 0);
+    EXPECT_LT(file.worker, 2);
+    if (file.error != 0) {
+      EXPECT_EQ(file.error, ENOENT);
+      ++errors;
+    } else {
+      loaded[*file.filename] = string(file.contents);
+    }
+  });
+  EXPECT_EQ(errors, 1);
+  EXPECT_EQ(loaded, expected_);
+  for (int count : seen) EXPECT_EQ(count, 1);
+}
+
+TEST_P(BatchLoaderTest, LoadAndParseFiles) {
+  std::vector<string> files;
+  for (int i = 0; i < 20; ++i) {
+    files.push_back("testdata/handicapped.sgf");
+    files.push_back("testdata/resigned.sgf");
+  }
+  files.push_back(files_.back());   // Does not exist.
+  std::mutex mu;
+  int parsed = 0;
+  int failed = 0;
+  BatchLoaderOptions options = Options();
+  options.buffer_size = 256;
+  LoadAndParseFiles(files, options,
+                    [&](const LoadedFile& file, bool ok,
+                        const GameRecord& record, const string& errors) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (!ok) {
+      ++failed;
+      EXPECT_FALSE(errors.empty());
+      return;
+    }
+    ++parsed;
+    if (*file.filename == "testdata/resigned.sgf") {
+      EXPECT_EQ(record.moves.size(), 20);
+      EXPECT_TRUE(record.resigned);
+    } else {
+      EXPECT_EQ(record.moves.size(), 15);
+      EXPECT_EQ(record.handicap, 4);
+    }
+  });
+  EXPECT_EQ(parsed, 40);
+  EXPECT_EQ(failed, 1);
+}
+
+TEST_P(BatchLoaderTest, PinThreads) {
+  cpu_set_t before;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(before), &before), 0);
+  BatchLoaderOptions options = Options();
+  options.pin_threads = true;
+  options.huge_pages = true;
+  options.threads = 3;
+  std::mutex mu;
+  std::map<string, string> loaded;
+  LoadFiles(files_, options, [&](const LoadedFile& file) {
+    // Every thread runs on one CPU while it loads.
+    cpu_set_t mask;
+    ASSERT_EQ(sched_getaffinity(0, sizeof(mask), &mask), 0);
+    EXPECT_EQ(CPU_COUNT(&mask), 1);
+    std::lock_guard<std::mutex> lock(mu);
+    if (file.error == 0) loaded[*file.filename] = string(file.contents);
+  });
+  EXPECT_EQ(loaded, expected_);
+  cpu_set_t after;
+  ASSERT_EQ(sched_getaffinity(0, sizeof(after), &after), 0);
+  EXPECT_TRUE(CPU_EQUAL(&before, &after));
+}
+
+INSTANTIATE_TEST_SUITE_P(IoUringAndSyscalls, BatchLoaderTest,
+                         ::testing::Bool());
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,391 @@
+#include "sgf_parser/batch_replay.h"
+
+#include <string.h>
+
+namespace sgf_parser {
+
+namespace {
+
+constexpr int kStride = BitPosition::kStride;
+constexpr int kWords = BitPosition::kWords;
+constexpr int kLanes = kReplayLanes;
+
+// A bitboard per lane, word-major so that a word of every lane is contiguous
+// and the loops over lanes vectorize. Words 0 and kWords + 1 stay zero, so
+// shifts across words need no bounds checks.
+struct Planes {
+  uint64_t words[kWords + 2][kLanes];
+
+  void Clear() { memset(words, 0, sizeof(words)); }
+
+  void SetBit(int lane, int bit) {
+    words[1 + bit / 64][lane] |= uint64_t{1} << (bit % 64);
+  }
+
+  void ClearBit(int lane, int bit) {
+    words[1 + bit / 64][lane] &= ~(uint64_t{1} << (bit % 64));
+  }
+
+  bool Test(int lane, int bit) const {
+    return words[1 + bit / 64][lane] >> (bit % 64) & 1;
+  }
+
+  bool IsEmpty() const {
+    uint64_t any = 0;
+    for (int w = 1; w <= kWords; ++w) {
+      for (int l = 0; l < kLanes; ++l) any |= words[w][l];
+    }
+    return any == 0;
+  }
+};
+
+// Bits of column 0 and of column kStride - 1, which shifting by one must not
+// wrap into.
+struct ColumnMasks {
+  uint64_t not_first[kWords + 2] = {};
+  uint64_t not_last[kWords + 2] = {};
+};
+
+constexpr ColumnMasks MakeColumnMasks() {
+  ColumnMasks masks;
+  for (int w = 0; w < kWords + 2; ++w) {
+    masks.not_first[w] = masks.not_last[w] = ~0ULL;
+  }
+  for (int y = 0; y < BitPosition::kMaxBoardSize; ++y) {
+    const int first = y * kStride;
+    const int last = first + kStride - 1;
+    masks.not_first[1 + first / 64] &= ~(uint64_t{1} << (first % 64));
+    masks.not_last[1 + last / 64] &= ~(uint64_t{1} << (last % 64));
+  }
+  return masks;
+}
+
+constexpr ColumnMasks kColumns = MakeColumnMasks();
+
+// A word of a bitboard and its four neighbors, given the words around it.
+inline uint64_t Spread(uint64_t prev, uint64_t g, uint64_t next,
+                       uint64_t not_first, uint64_t not_last) {
+  const uint64_t right = ((g << 1) | (prev >> 63)) & not_first;
+  const uint64_t left = ((g >> 1) | (next << 63)) & not_last;
+  const uint64_t down = (g << kStride) | (prev >> (64 - kStride));
+  const uint64_t up = (g >> kStride) | (next << (64 - kStride));
+  return g | right | left | down | up;
+}
+
+// Sets `out` to `in` and its four neighbors, in every lane. `out` must not be
+// `in`; saying so lets the compiler vectorize the loop over lanes.
+void Dilate(const Planes& in, Planes* __restrict out) {
+  for (int w = 1; w <= kWords; ++w) {
+    const uint64_t not_first = kColumns.not_first[w];
+    const uint64_t not_last = kColumns.not_last[w];
+    for (int l = 0; l < kLanes; ++l) {
+      out->words[w][l] = Spread(in.words[w - 1][l], in.words[w][l],
+                                in.words[w + 1][l], not_first, not_last);
+    }
+  }
+}
+
+class BatchReplayer {
+ public:
+  BatchReplayer(absl::Span<const GameRecord> games,
+                const PositionVisitor& visit, std::vector<size_t>* skipped)
+      : games_(games), visit_(visit), skipped_(skipped) {
+    black_.Clear();
+    white_.Clear();
+    board_.Clear();
+    move_.Clear();
+    color_.Clear();
+    empty_.Clear();
+    seed_.Clear();
+    candidates_.Clear();
+    suicides_.Clear();
+    group_.Clear();
+    grown_.Clear();
+  }
+
+  int Run() {
+    int active = 0;
+    for (int l = 0; l < kLanes; ++l) {
+      if (Load(l)) ++active;
+    }
+    while (active > 0) {
+      Step();
+      for (int l = 0; l < kLanes; ++l) {
+        Lane& lane = lanes_[l];
+        if (lane.game < 0) continue;
+        Emit(l);
+        if (lane.next_move == games_[lane.game].moves.size() && !Load(l)) {
+          --active;
+        }
+      }
+    }
+    return failures_;
+  }
+
+ private:
+  struct Lane {
+    int64_t game = -1;         // -1 if the lane is idle.
+    size_t next_move = 0;
+    GoCoord size = 0;
+    int point = -1;            // Where this step's move goes, or -1.
+    bool black = false;        // Whether this step's move is black's.
+  };
+
+  // Puts the next game which fits into lane `l` and emits its first position.
+  // Games without moves have no other position and are done right away.
+  // Returns false, leaving the lane idle, if there are no more games.
+  bool Load(int l) {
+    Lane& lane = lanes_[l];
+    while (true) {
+      for (; next_game_ < games_.size(); ++next_game_) {
+        if (GetBoardSize(games_[next_game_]) <= BitPosition::kMaxBoardSize) {
+          break;
+        }
+        if (skipped_ != nullptr) skipped_->push_back(next_game_);
+      }
+      for (int w = 0; w < kWords + 2; ++w) {
+        black_.words[w][l] = white_.words[w][l] = board_.words[w][l] = 0;
+      }
+      if (next_game_ == games_.size()) {
+        lane.game = -1;
+        return false;
+      }
+
+      const GameRecord& record = games_[next_game_];
+      lane.game = next_game_++;
+      lane.next_move = 0;
+      lane.size = GetBoardSize(record);
+      for (int y = 0; y < lane.size; ++y) {
+        for (int x = 0; x < lane.size; ++x) board_.SetBit(l, y * kStride + x);
+      }
+      for (const auto& pos : record.black_stones) {
+        Setup(l, pos, &black_, &white_);
+      }
+      for (const auto& pos : record.white_stones) {
+        Setup(l, pos, &white_, &black_);
+      }
+      Emit(l);
+      if (!record.moves.empty()) return true;
+    }
+  }
+
+  void Setup(int l, GoPos pos, Planes* own, Planes* other) {
+    const GoCoord size = lanes_[l].size;
+    if (pos.first < 0 || pos.first >= size || pos.second < 0 ||
+        pos.second >= size) {
+      ++failures_;
+      return;
+    }
+    const int bit = pos.second * kStride + pos.first;
+    other->ClearBit(l, bit);
+    own->SetBit(l, bit);
+  }
+
+  void Emit(int l) {
+    const Lane& lane = lanes_[l];
+    position_.size = lane.size;
+    for (int w = 0; w < kWords; ++w) {
+      position_.black[w] = black_.words[1 + w][l];
+      position_.white[w] = white_.words[1 + w][l];
+    }
+    visit_(lane.game, lane.next_move, position_);
+  }
+
+  // Plays the next move of every lane.
+  void Step() {
+    bool any = false;
+    for (int l = 0; l < kLanes; ++l) {
+      Lane& lane = lanes_[l];
+      if (lane.point >= 0) move_.ClearBit(l, lane.point);
+      lane.point = -1;
+      if (lane.game < 0) continue;
+      const GoMove& move = games_[lane.game].moves[lane.next_move++];
+      const GoPos& pos = move.move;
+      // Off-board moves, e.g. "tt", are passes.
+      if (move.pass || pos.first < 0 || pos.first >= lane.size ||
+          pos.second < 0 || pos.second >= lane.size) {
+        continue;
+      }
+      const int bit = pos.second * kStride + pos.first;
+      if (black_.Test(l, bit) || white_.Test(l, bit)) {
+        ++failures_;
+        continue;
+      }
+      lane.point = bit;
+      lane.black = move.player == GoMove::BLACK;
+      (lane.black ? black_ : white_).SetBit(l, bit);
+      move_.SetBit(l, bit);
+      any = true;
+    }
+    if (!any) return;
+
+    // Usually no stone has lost its last liberty, which one pass over the
+    // planes shows. Otherwise grow the groups in question.
+    int found = FindCandidates();
+    if (found & kCaptures) {
+      // Stones next to a move may belong to different groups, which live or
+      // die on their own, so take them one at a time.
+      SelectColor(/*own=*/false);
+      do {
+        TakeLowestSeeds();
+        RemoveDeadGroups(seed_);
+        SelectColor(/*own=*/false);
+      } while (!candidates_.IsEmpty());
+      // Captures free points next to the moves. Only the suicides matter now.
+      found = FindCandidates();
+    }
+    if (found & kSuicides) {
+      SelectColor(/*own=*/true);
+      RemoveDeadGroups(suicides_);
+    }
+  }
+
+  static constexpr int kCaptures = 1;
+  static constexpr int kSuicides = 2;
+
+  // Finds the stones which may have lost their last liberty to this step's
+  // moves, as they have no empty point next to them: opponent stones next to a
+  // move, into `candidates_`, and the moves themselves, into `suicides_`.
+  // Returns which of kCaptures and kSuicides it found.
+  int FindCandidates() {
+    uint64_t mover_black[kLanes];
+    for (int l = 0; l < kLanes; ++l) {
+      mover_black[l] = lanes_[l].black ? ~0ULL : 0;
+    }
+    uint64_t any_capture = 0;
+    uint64_t any_suicide = 0;
+    for (int w = 1; w <= kWords; ++w) {
+      const uint64_t not_first = kColumns.not_first[w];
+      const uint64_t not_last = kColumns.not_last[w];
+      for (int l = 0; l < kLanes; ++l) {
+        const uint64_t black = black_.words[w][l];
+        const uint64_t white = white_.words[w][l];
+        const uint64_t empty_prev = board_.words[w - 1][l] &
+            ~(black_.words[w - 1][l] | white_.words[w - 1][l]);
+        const uint64_t empty = board_.words[w][l] & ~(black | white);
+        const uint64_t empty_next = board_.words[w + 1][l] &
+            ~(black_.words[w + 1][l] | white_.words[w + 1][l]);
+        const uint64_t near_empty =
+            Spread(empty_prev, empty, empty_next, not_first, not_last);
+        const uint64_t move = move_.words[w][l];
+        const uint64_t suicides = move & ~near_empty;
+        suicides_.words[w][l] = suicides;
+        any_suicide |= suicides;
+        const uint64_t near_move =
+            Spread(move_.words[w - 1][l], move, move_.words[w + 1][l],
+                   not_first, not_last);
+        const uint64_t opponent =
+            (white & mover_black[l]) | (black & ~mover_black[l]);
+        const uint64_t candidates = near_move & opponent & ~near_empty;
+        candidates_.words[w][l] = candidates;
+        any_capture |= candidates;
+      }
+    }
+    return (any_capture != 0 ? kCaptures : 0) |
+           (any_suicide != 0 ? kSuicides : 0);
+  }
+
+  // Selects the stones of the mover's color in every lane if `own`, and of the
+  // opponent's otherwise, into `color_`, and the empty points into `empty_`.
+  void SelectColor(bool own) {
+    // Selected per lane without branches.
+    uint64_t black_lane[kLanes];
+    for (int l = 0; l < kLanes; ++l) {
+      black_lane[l] = lanes_[l].black == own ? ~0ULL : 0;
+    }
+    for (int w = 1; w <= kWords; ++w) {
+      for (int l = 0; l < kLanes; ++l) {
+        const uint64_t black = black_.words[w][l];
+        const uint64_t white = white_.words[w][l];
+        color_.words[w][l] = (black & black_lane[l]) | (white & ~black_lane[l]);
+        empty_.words[w][l] = board_.words[w][l] & ~black & ~white;
+      }
+    }
+  }
+
+  // Moves the lowest bit of every lane from `candidates_` to `seed_`.
+  void TakeLowestSeeds() {
+    seed_.Clear();
+    for (int l = 0; l < kLanes; ++l) {
+      for (int w = 1; w <= kWords; ++w) {
+        uint64_t& word = candidates_.words[w][l];
+        if (word == 0) continue;
+        seed_.words[w][l] = word & -word;
+        word &= word - 1;
+        break;
+      }
+    }
+  }
+
+  // Grows `seeds` into groups of `color_`, and removes those without
+  // liberties.
+  void RemoveDeadGroups(const Planes& seeds) {
+    // Grow the groups until they stop growing or touch a liberty. A lane
+    // whose group has a liberty drops out: its group is cleared.
+    group_ = seeds;
+    uint64_t changed;
+    do {
+      Dilate(group_, &grown_);
+      uint64_t liberties[kLanes] = {};
+      for (int w = 1; w <= kWords; ++w) {
+        for (int l = 0; l < kLanes; ++l) {
+          liberties[l] |= grown_.words[w][l] & empty_.words[w][l];
+        }
+      }
+      uint64_t dead[kLanes];
+      for (int l = 0; l < kLanes; ++l) dead[l] = liberties[l] == 0 ? ~0ULL : 0;
+      changed = 0;
+      for (int w = 1; w <= kWords; ++w) {
+        for (int l = 0; l < kLanes; ++l) {
+          const uint64_t next = grown_.words[w][l] & color_.words[w][l] & dead[l];
+          changed |= next ^ (group_.words[w][l] & dead[l]);
+          group_.words[w][l] = next;
+        }
+      }
+    } while (changed != 0);
+
+    // What is left has no liberties.
+    for (int w = 1; w <= kWords; ++w) {
+      for (int l = 0; l < kLanes; ++l) {
+        black_.words[w][l] &= ~group_.words[w][l];
+        white_.words[w][l] &= ~group_.words[w][l];
+        candidates_.words[w][l] &= ~group_.words[w][l];
+      }
+    }
+  }
+
+  const absl::Span<const GameRecord> games_;
+  const PositionVisitor& visit_;
+  std::vector<size_t>* const skipped_;
+  size_t next_game_ = 0;
+  int failures_ = 0;
+
+  Lane lanes_[kLanes];
+  Planes black_;
+  Planes white_;
+  Planes board_;    // Points on the board of each lane.
+
+  // Scratch space.
+  Planes move_;         // This step's moves.
+  Planes color_;        // See SelectColor().
+  Planes empty_;
+  Planes seed_;
+  Planes candidates_;
+  Planes suicides_;
+  Planes group_;
+  Planes grown_;
+  BitPosition position_;
+};
+
+}  // namespace
+
+constexpr GoCoord BitPosition::kMaxBoardSize;
+constexpr int BitPosition::kStride;
+constexpr int BitPosition::kWords;
+
+int ReplayBatch(absl::Span<const GameRecord> games,
+                const PositionVisitor& visit, std::vector<size_t>* skipped) {
+  return BatchReplayer(games, visit, skipped).Run();
+}
+
+}  // namespace sgf_parser
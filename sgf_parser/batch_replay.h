@@ -0,0 +1,60 @@
+#ifndef SGF_PARSER_BATCH_REPLAY_H_
+#define SGF_PARSER_BATCH_REPLAY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "sgf_parser/board.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// A position on a square board of up to 19x19, as a bitboard per color. Point
+// (x, y) is bit y * kStride + x, whatever the board size.
+struct BitPosition {
+  static constexpr GoCoord kMaxBoardSize = 19;
+  static constexpr int kStride = kMaxBoardSize;
+  static constexpr int kWords = (kStride * kMaxBoardSize + 63) / 64;
+
+  GoCoord size = 0;
+  uint64_t black[kWords] = {};
+  uint64_t white[kWords] = {};
+
+  GoBoard::Stone At(GoPos pos) const {
+    const int bit = pos.second * kStride + pos.first;
+    const uint64_t mask = uint64_t{1} << (bit % 64);
+    if (black[bit / 64] & mask) return GoBoard::BLACK;
+    if (white[bit / 64] & mask) return GoBoard::WHITE;
+    return GoBoard::EMPTY;
+  }
+};
+
+// Called with the index of a game in the batch, the number of its moves played
+// so far, and the position after them. Move 0 is the position after the
+// pre-set stones. Passes and moves which could not be played still count.
+typedef std::function<void(size_t game, int move, const BitPosition& position)>
+    PositionVisitor;
+
+// Number of games ReplayBatch advances in lockstep.
+constexpr int kReplayLanes = 16;
+
+// Replays games like ReplayRecord, but kReplayLanes at a time. The bitboards of
+// all lanes are interleaved word by word, so the flood fills which find
+// captured groups run over every lane at once and compile to vector code. A
+// lane whose game ends takes the next game right away. Games are visited in
+// lockstep, so positions of different games interleave in the calls to
+// `visit`, but the positions of one game come in order.
+//
+// Games on boards larger than 19x19 are not replayed; their indices are added
+// to `skipped` if it is not null. Returns the number of stones and moves which
+// could not be placed, summed over all games.
+int ReplayBatch(absl::Span<const GameRecord> games,
+                const PositionVisitor& visit, std::vector<size_t>* skipped);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_BATCH_REPLAY_H_
@@ -0,0 +1,195 @@
+#include "sgf_parser/batch_replay.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+// The stones of a position, row by row, as ".XO".
+string Render(const BitPosition& position) {
+  string out;
+  for (int y = 0; y < position.size; ++y) {
+    for (int x = 0; x < position.size; ++x) {
+      const GoBoard::Stone stone = position.At({x, y});
+      out.push_back(stone == GoBoard::BLACK ? 'X'
+                    : stone == GoBoard::WHITE ? 'O' : '.');
+    }
+    out.push_back('\n');
+  }
+  return out;
+}
+
+string Render(const GoBoard& board) {
+  string out;
+  for (int y = 0; y < board.height(); ++y) {
+    for (int x = 0; x < board.width(); ++x) {
+      const GoBoard::Stone stone = board.At({x, y});
+      out.push_back(stone == GoBoard::BLACK ? 'X'
+                    : stone == GoBoard::WHITE ? 'O' : '.');
+    }
+    out.push_back('\n');
+  }
+  return out;
+}
+
+// Positions of every game after every move, by ReplayRecord.
+std::vector<std::vector<string>> ExpectedPositions(
+    const std::vector<GameRecord>& games, int* failures) {
+  std::vector<std::vector<string>> expected(games.size());
+  *failures = 0;
+  for (size_t i = 0; i < games.size(); ++i) {
+    const GoCoord size = GetBoardSize(games[i]);
+    if (size > BitPosition::kMaxBoardSize) continue;
+    GameRecord prefix = games[i];
+    for (size_t moves = 0; moves <= games[i].moves.size(); ++moves) {
+      prefix.moves.assign(games[i].moves.begin(),
+                          games[i].moves.begin() + moves);
+      GoBoard board(size, size);
+      const int prefix_failures = ReplayRecord(prefix, &board);
+      if (moves == games[i].moves.size()) *failures += prefix_failures;
+      expected[i].push_back(Render(board));
+    }
+  }
+  return expected;
+}
+
+void ExpectSameAsReplayRecord(const std::vector<GameRecord>& games) {
+  int expected_failures;
+  const auto expected = ExpectedPositions(games, &expected_failures);
+  std::vector<std::vector<string>> actual(games.size());
+  std::vector<size_t> skipped;
+  const int failures = ReplayBatch(
+      games,
+      [&actual](size_t game, int move, const BitPosition& position) {
+        ASSERT_EQ(move, actual[game].size()) << "game " << game;
+        actual[game].push_back(Render(position));
+      },
+      &skipped);
+  EXPECT_EQ(failures, expected_failures);
+  for (size_t i = 0; i < games.size(); ++i) {
+    if (expected[i].empty()) {
+      EXPECT_TRUE(actual[i].empty());
+      EXPECT_NE(std::find(skipped.begin(), skipped.end(), i), skipped.end());
+      continue;
+    }
+    ASSERT_EQ(actual[i].size(), expected[i].size()) << "game " << i;
+    for (size_t move = 0; move < expected[i].size(); ++move) {
+      ASSERT_EQ(actual[i][move], expected[i][move])
+          << "game " << i << ", move " << move;
+    }
+  }
+}
+
+// A game of random moves on a small area, so there are many captures,
+// suicides and moves onto occupied points.
+GameRecord RandomGame(std::mt19937* rng, GoCoord size, int moves) {
+  GameRecord record;
+  record.board_width = record.board_height = size;
+  std::uniform_int_distribution<int> coord(0, std::min<int>(size, 7) - 1);
+  std::uniform_int_distribution<int> percent(0, 99);
+  if (percent(*rng) < 30) {
+    record.black_stones.emplace_back(coord(*rng), coord(*rng));
+    record.white_stones.emplace_back(coord(*rng), coord(*rng));
+    record.black_stones.emplace_back(size, 0);   // Off the board.
+  }
+  for (int i = 0; i < moves; ++i) {
+    const GoMove::Color color = i % 2 == 0 ? GoMove::BLACK : GoMove::WHITE;
+    const int kind = percent(*rng);
+    if (kind < 3) {
+      record.moves.emplace_back(color, true, GoPos(-1, -1));
+    } else if (kind < 5) {
+      record.moves.emplace_back(color, false, GoPos(size, size));
+    } else {
+      // Corners and edges get their share.
+      int x = coord(*rng);
+      int y = coord(*rng);
+      if (percent(*rng) < 20) x = size - 1 - x;
+      if (percent(*rng) < 20) y = size - 1 - y;
+      record.moves.emplace_back(color, false, GoPos(x, y));
+    }
+  }
+  return record;
+}
+
+class BatchReplayTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(BatchReplayTest, TestData) {
+  std::vector<GameRecord> games;
+  for (const char* file : {"testdata/handicapped.sgf",
+                           "testdata/resigned.sgf"}) {
+    games.emplace_back();
+    ASSERT_TRUE(SimpleParseSgf(ReadFileToString(file), &games.back(), nullptr,
+                               nullptr)) << file;
+  }
+  ExpectSameAsReplayRecord(games);
+}
+
+TEST_F(BatchReplayTest, Captures) {
+  // White's corner stone is captured, then black's lone stone commits
+  // suicide, then black's two stones at the edge are captured at once.
+  GameRecord record;
+  record.board_width = record.board_height = 5;
+  const GoMove::Color b = GoMove::BLACK, w = GoMove::WHITE;
+  for (const GoMove& move : {GoMove(w, false, {0, 0}), GoMove(b, false, {1, 0}),
+                             GoMove(b, false, {0, 1}), GoMove(w, false, {4, 1}),
+                             GoMove(w, false, {3, 0}), GoMove(b, false, {4, 0}),
+                             GoMove(w, false, {1, 1}), GoMove(w, false, {2, 0}),
+                             GoMove(w, false, {0, 2}), GoMove(w, false, {0, 0})}) {
+    record.moves.push_back(move);
+  }
+  ExpectSameAsReplayRecord({record});
+
+  std::vector<BitPosition> positions;
+  ReplayBatch({record}, [&positions](size_t, int, const BitPosition& p) {
+    positions.push_back(p);
+  }, nullptr);
+  ASSERT_EQ(positions.size(), 11);
+  EXPECT_EQ(positions[3].At({0, 0}), GoBoard::EMPTY);
+  EXPECT_EQ(positions[6].At({4, 0}), GoBoard::EMPTY);
+  EXPECT_EQ(Render(positions[10]),
+            "O.OO.\n"
+            ".O..O\n"
+            "O....\n"
+            ".....\n"
+            ".....\n");
+}
+
+TEST_F(BatchReplayTest, ManyGames) {
+  std::mt19937 rng(7);
+  std::vector<GameRecord> games;
+  const GoCoord kSizes[] = {19, 9, 13, 5, 19, 2, 1};
+  for (int i = 0; i < 3 * kReplayLanes + 5; ++i) {
+    // Lengths vary so lanes finish and reload at different times.
+    games.push_back(RandomGame(&rng, kSizes[i % 7], (i * 37) % 150));
+  }
+  // Games without moves, and boards too big for a lane.
+  games.insert(games.begin() + 3, GameRecord());
+  GameRecord big = RandomGame(&rng, 25, 10);
+  games.insert(games.begin() + 20, big);
+  games.push_back(big);
+  ExpectSameAsReplayRecord(games);
+}
+
+TEST_F(BatchReplayTest, Empty) {
+  int calls = 0;
+  EXPECT_EQ(ReplayBatch({}, [&calls](size_t, int, const BitPosition&) {
+    ++calls;
+  }, nullptr), 0);
+  EXPECT_EQ(calls, 0);
+}
+
+}  // namespace
+}  // namespace sgf_parser
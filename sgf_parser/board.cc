@@ -0,0 +1,241 @@
+#include "sgf_parser/board.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+namespace {
+
+int LetterToCoord(char c) {
+  if (c >= 'a' && c <= 'z') return c - 'a';
+  if (c >= 'A' && c <= 'Z') return c - 'A' + 26;
+  return -1;
+}
+
+// Zobrist keys indexed by [x * kMaxBoardSize + y][color]. They don't depend on
+// the board width, so hashes are comparable across boards of the same size.
+const uint64_t* ZobristKeys() {
+  static const std::vector<uint64_t>* keys = [] {
+    const int n = GoBoard::kMaxBoardSize * GoBoard::kMaxBoardSize * 3;
+    auto* v = new std::vector<uint64_t>(n);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    for (auto& k : *v) {
+      // splitmix64.
+      uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      k = z ^ (z >> 31);
+    }
+    return v;
+  }();
+  return keys->data();
+}
+
+}  // namespace
+
+bool ParsePoint(absl::string_view value, GoPos* pos) {
+  if (value.size() != 2) return false;
+  const int x = LetterToCoord(value[0]);
+  const int y = LetterToCoord(value[1]);
+  if (x < 0 || y < 0) return false;
+  *pos = std::make_pair(x, y);
+  return true;
+}
+
+constexpr GoCoord GoBoard::kMaxBoardSize;
+
+GoBoard::GoBoard(GoCoord width, GoCoord height)
+    : width_(width), height_(height) {
+  CHECK(width > 0 && width <= kMaxBoardSize) << "Bad board width " << width;
+  CHECK(height > 0 && height <= kMaxBoardSize) << "Bad board height " << height;
+  points_.assign(width_ * height_, EMPTY);
+  visited_.assign(width_ * height_, 0);
+}
+
+GoBoard GoBoard::Snapshot() const {
+  GoBoard copy(width_, height_);
+  copy.hash_ = hash_;
+  copy.prisoners_[BLACK] = prisoners_[BLACK];
+  copy.prisoners_[WHITE] = prisoners_[WHITE];
+  copy.points_ = points_;
+  return copy;
+}
+
+void GoBoard::Set(int index, Stone stone, bool captured) {
+  const Stone old_stone = points_[index];
+  if (old_stone == stone) return;
+  history_.push_back(Change{index, old_stone, captured});
+  const uint64_t* keys = ZobristKeys();
+  const int key = ((index % width_) * kMaxBoardSize + index / width_) * 3;
+  hash_ ^= keys[key + old_stone] ^ keys[key + stone];
+  points_[index] = stone;
+  if (captured) ++prisoners_[old_stone];
+}
+
+void GoBoard::UndoTo(size_t mark) {
+  CHECK_LE(mark, history_.size());
+  const uint64_t* keys = ZobristKeys();
+  while (history_.size() > mark) {
+    const Change& change = history_.back();
+    const int index = change.index;
+    const int key = ((index % width_) * kMaxBoardSize + index / width_) * 3;
+    hash_ ^= keys[key + points_[index]] ^ keys[key + change.old_stone];
+    points_[index] = change.old_stone;
+    if (change.captured) --prisoners_[change.old_stone];
+    history_.pop_back();
+  }
+}
+
+bool GoBoard::Setup(GoPos pos, Stone stone) {
+  if (!OnBoard(pos)) return false;
+  Set(Index(pos), stone, false);
+  return true;
+}
+
+int GoBoard::RemoveIfDead(int index) {
+  const Stone color = points_[index];
+  if (color == EMPTY) return 0;
+  if (++epoch_ == 0) {
+    std::fill(visited_.begin(), visited_.end(), 0);
+    epoch_ = 1;
+  }
+  stack_.clear();
+  group_.clear();
+  stack_.push_back(index);
+  visited_[index] = epoch_;
+  while (!stack_.empty()) {
+    const int cur = stack_.back();
+    stack_.pop_back();
+    group_.push_back(cur);
+    const int x = cur % width_;
+    const int y = cur / width_;
+    const int neighbors[4] = {
+        x > 0 ? cur - 1 : -1,
+        x + 1 < width_ ? cur + 1 : -1,
+        y > 0 ? cur - width_ : -1,
+        y + 1 < height_ ? cur + width_ : -1,
+    };
+    for (int n : neighbors) {
+      if (n < 0) continue;
+      if (points_[n] == EMPTY) return 0;  // Found a liberty.
+      if (points_[n] == color && visited_[n] != epoch_) {
+        visited_[n] = epoch_;
+        stack_.push_back(n);
+      }
+    }
+  }
+  for (int i : group_) {
+    Set(i, EMPTY, true);
+  }
+  return group_.size();
+}
+
+bool GoBoard::Play(const GoMove& move) {
+  if (move.pass) return true;
+  if (!OnBoard(move.move)) return false;
+  const int index = Index(move.move);
+  if (points_[index] != EMPTY) return false;
+
+  Set(index, static_cast<Stone>(move.player), false);
+  const int x = move.move.first;
+  const int y = move.move.second;
+  const int neighbors[4] = {
+      x > 0 ? index - 1 : -1,
+      x + 1 < width_ ? index + 1 : -1,
+      y > 0 ? index - width_ : -1,
+      y + 1 < height_ ? index + width_ : -1,
+  };
+  const Stone opponent = (move.player == GoMove::BLACK ? WHITE : BLACK);
+  for (int n : neighbors) {
+    if (n >= 0 && points_[n] == opponent) {
+      RemoveIfDead(n);
+    }
+  }
+  RemoveIfDead(index);  // Suicide.
+  return true;
+}
+
+GoCoord GetBoardSize(const internal::GameNode& first_node) {
+  for (const auto& prop : first_node) {
+    int size = 0;
+    if (absl::EqualsIgnoreCase(prop.id, "SZ") && prop.values.size() == 1 &&
+        absl::SimpleAtoi(prop.values[0], &size) && size > 0 &&
+        size <= GoBoard::kMaxBoardSize) {
+      return size;
+    }
+  }
+  return 19;
+}
+
+int ApplyNode(const internal::GameNode& node, GoBoard* board) {
+  int failures = 0;
+  for (const auto& prop : node) {
+    const bool black = absl::EqualsIgnoreCase(prop.id, "B");
+    if (black || absl::EqualsIgnoreCase(prop.id, "W")) {
+      const GoMove::Color color = black ? GoMove::BLACK : GoMove::WHITE;
+      for (const auto& value : prop.values) {
+        GoPos pos;
+        if (!ParsePoint(value, &pos) || !board->OnBoard(pos)) {
+          continue;  // A pass.
+        }
+        if (!board->Play(GoMove(color, false, pos))) {
+          VLOG(1) << "Cannot play " << prop.id << "[" << value << "]";
+          ++failures;
+        }
+      }
+      continue;
+    }
+    GoBoard::Stone stone;
+    if (absl::EqualsIgnoreCase(prop.id, "AB")) {
+      stone = GoBoard::BLACK;
+    } else if (absl::EqualsIgnoreCase(prop.id, "AW")) {
+      stone = GoBoard::WHITE;
+    } else if (absl::EqualsIgnoreCase(prop.id, "AE")) {
+      stone = GoBoard::EMPTY;
+    } else {
+      continue;
+    }
+    for (const auto& value : prop.values) {
+      GoPos pos;
+      if (!ParsePoint(absl::StripAsciiWhitespace(value), &pos) ||
+          !board->Setup(pos, stone)) {
+        VLOG(1) << "Cannot set up " << prop.id << "[" << value << "]";
+        ++failures;
+      }
+    }
+  }
+  return failures;
+}
+
+GoCoord GetBoardSize(const GameRecord& record) {
+  if (record.board_width > 0 && record.board_width <= GoBoard::kMaxBoardSize) {
+    return record.board_width;
+  }
+  return 19;
+}
+
+int ReplayRecord(const GameRecord& record, GoBoard* board) {
+  int failures = 0;
+  for (const auto& pos : record.black_stones) {
+    if (!board->Setup(pos, GoBoard::BLACK)) ++failures;
+  }
+  for (const auto& pos : record.white_stones) {
+    if (!board->Setup(pos, GoBoard::WHITE)) ++failures;
+  }
+  for (const auto& move : record.moves) {
+    // Off-board moves, e.g. "tt", are passes.
+    if (!move.pass && board->OnBoard(move.move) && !board->Play(move)) {
+      ++failures;
+    }
+  }
+  return failures;
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,119 @@
+#ifndef SGF_PARSER_BOARD_H_
+#define SGF_PARSER_BOARD_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// Parses an SGF point value such as "pd". Letters 'a'-'z' map to 0-25 and
+// 'A'-'Z' to 26-51. Returns false if the value is not a two-letter point, e.g.
+// an empty pass. Note "tt" parses fine but is off a 19x19 board.
+bool ParsePoint(absl::string_view value, GoPos* pos);
+
+// A Go board which is updated incrementally and supports cheap undo. Every
+// change is appended to a history log, so rolling back to a mark costs time
+// proportional to the number of stones changed since then.
+class GoBoard {
+ public:
+  enum Stone : uint8_t {
+    EMPTY = 0,
+    BLACK = GoMove::BLACK,
+    WHITE = GoMove::WHITE,
+  };
+
+  static constexpr GoCoord kMaxBoardSize = 52;
+
+  GoBoard(GoCoord width, GoCoord height);
+
+  GoCoord width() const { return width_; }
+  GoCoord height() const { return height_; }
+
+  bool OnBoard(GoPos pos) const {
+    return pos.first >= 0 && pos.first < width_ &&
+           pos.second >= 0 && pos.second < height_;
+  }
+
+  Stone At(GoPos pos) const { return points_[Index(pos)]; }
+
+  // Zobrist hash of the stones on the board. Equal positions on boards of the
+  // same size have equal hashes.
+  uint64_t hash() const { return hash_; }
+
+  // Number of stones of `color` captured by the opponent so far.
+  int prisoners(GoMove::Color color) const { return prisoners_[color]; }
+
+  // Plays a move and removes captured stones. A suicide removes the player's
+  // own group. Passes leave the board unchanged. Returns false, leaving the
+  // board unchanged, if the point is off the board or occupied.
+  bool Play(const GoMove& move);
+
+  // Sets a point without captures, as the AB, AW and AE properties do.
+  // Returns false if the point is off the board.
+  bool Setup(GoPos pos, Stone stone);
+
+  // Undo support: Mark() returns a token and UndoTo() reverts every change
+  // made after the token was taken.
+  size_t Mark() const { return history_.size(); }
+  void UndoTo(size_t mark);
+
+  // Forgets the history. Marks taken before are invalidated.
+  void ClearHistory() { history_.clear(); }
+
+  // Returns a copy of the position without the undo history, e.g. to hand the
+  // position at a branch point over to another thread.
+  GoBoard Snapshot() const;
+
+ private:
+  struct Change {
+    int32_t index;
+    Stone old_stone;
+    bool captured;
+  };
+
+  int Index(GoPos pos) const { return pos.second * width_ + pos.first; }
+
+  void Set(int index, Stone stone, bool captured);
+
+  // Removes the group at `index` if it has no liberties. Returns the number of
+  // stones removed.
+  int RemoveIfDead(int index);
+
+  GoCoord width_;
+  GoCoord height_;
+  uint64_t hash_ = 0;
+  int prisoners_[3] = {0, 0, 0};
+  std::vector<Stone> points_;
+  std::vector<Change> history_;
+
+  // Scratch space for flood fills, kept to avoid allocations.
+  std::vector<int> stack_;
+  std::vector<int> group_;
+  std::vector<uint32_t> visited_;
+  uint32_t epoch_ = 0;
+};
+
+// Returns the board size set by the SZ property of the first node of a game,
+// or 19 if there is no valid SZ property.
+GoCoord GetBoardSize(const internal::GameNode& first_node);
+
+// Applies the B, W, AB, AW and AE properties of a node to the board. Returns
+// the number of moves and stones which could not be placed, e.g. moves onto
+// occupied points. Those are skipped.
+int ApplyNode(const internal::GameNode& node, GoBoard* board);
+
+// Returns the board size of a record, or 19 if it is not set.
+GoCoord GetBoardSize(const GameRecord& record);
+
+// Plays the pre-set stones and the moves of a record on `board`, which is
+// usually empty and of the record's size. Returns the number of stones and
+// moves which could not be placed.
+int ReplayRecord(const GameRecord& record, GoBoard* board);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_BOARD_H_
@@ -0,0 +1,105 @@
+#include "sgf_parser/board.h"
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+GoMove Black(int x, int y) { return GoMove(GoMove::BLACK, false, {x, y}); }
+GoMove White(int x, int y) { return GoMove(GoMove::WHITE, false, {x, y}); }
+
+TEST(GoBoardTest, ParsePoint) {
+  GoPos pos;
+  EXPECT_TRUE(ParsePoint("pd", &pos));
+  EXPECT_EQ(pos, GoPos(15, 3));
+  EXPECT_TRUE(ParsePoint("aZ", &pos));
+  EXPECT_EQ(pos, GoPos(0, 51));
+  EXPECT_FALSE(ParsePoint("", &pos));
+  EXPECT_FALSE(ParsePoint("a1", &pos));
+  EXPECT_FALSE(ParsePoint("abc", &pos));
+}
+
+TEST(GoBoardTest, CaptureAndUndo) {
+  GoBoard board(9, 9);
+  const uint64_t empty_hash = board.hash();
+  ASSERT_TRUE(board.Play(White(0, 0)));
+  ASSERT_TRUE(board.Play(Black(1, 0)));
+  const size_t mark = board.Mark();
+  const uint64_t hash = board.hash();
+  ASSERT_TRUE(board.Play(Black(0, 1)));
+  EXPECT_EQ(board.At({0, 0}), GoBoard::EMPTY);
+  EXPECT_EQ(board.prisoners(GoMove::WHITE), 1);
+
+  // Occupied points are rejected.
+  EXPECT_FALSE(board.Play(White(1, 0)));
+  EXPECT_FALSE(board.Play(White(9, 0)));
+
+  board.UndoTo(mark);
+  EXPECT_EQ(board.At({0, 0}), GoBoard::WHITE);
+  EXPECT_EQ(board.At({0, 1}), GoBoard::EMPTY);
+  EXPECT_EQ(board.prisoners(GoMove::WHITE), 0);
+  EXPECT_EQ(board.hash(), hash);
+
+  board.UndoTo(0);
+  EXPECT_EQ(board.hash(), empty_hash);
+}
+
+TEST(GoBoardTest, Suicide) {
+  GoBoard board(5, 5);
+  ASSERT_TRUE(board.Play(Black(1, 0)));
+  ASSERT_TRUE(board.Play(Black(0, 1)));
+  ASSERT_TRUE(board.Play(White(0, 0)));
+  EXPECT_EQ(board.At({0, 0}), GoBoard::EMPTY);
+  EXPECT_EQ(board.prisoners(GoMove::WHITE), 1);
+}
+
+TEST(GoBoardTest, HashIsOrderIndependent) {
+  GoBoard a(19, 19);
+  GoBoard b(19, 19);
+  a.Play(Black(3, 3));
+  a.Play(White(15, 15));
+  b.Setup({15, 15}, GoBoard::WHITE);
+  b.Setup({3, 3}, GoBoard::BLACK);
+  EXPECT_EQ(a.hash(), b.hash());
+  b.Setup({3, 3}, GoBoard::EMPTY);
+  EXPECT_NE(a.hash(), b.hash());
+}
+
+TEST(GoBoardTest, ApplyNode) {
+  internal::GameTree root(nullptr);
+  ASSERT_TRUE(internal::ParseToRoot(
+      "(;SZ[9]AB[aa][ba]AW[ca][ab];W[bb];B[ab])", &root, nullptr));
+  const auto& sequence = root.children[0]->sequence;
+  EXPECT_EQ(GetBoardSize(sequence[0]), 9);
+
+  GoBoard board(9, 9);
+  EXPECT_EQ(ApplyNode(sequence[0], &board), 0);
+  EXPECT_EQ(board.At({1, 0}), GoBoard::BLACK);
+  EXPECT_EQ(board.At({2, 0}), GoBoard::WHITE);
+  EXPECT_EQ(ApplyNode(sequence[1], &board), 0);
+  EXPECT_EQ(board.At({0, 0}), GoBoard::EMPTY);
+  EXPECT_EQ(board.prisoners(GoMove::BLACK), 2);
+  // Now occupied.
+  EXPECT_EQ(ApplyNode(sequence[2], &board), 1);
+}
+
+TEST(GoBoardTest, ReplayRecord) {
+  GameRecord record;
+  record.board_width = record.board_height = 9;
+  record.black_stones = {{0, 0}};
+  record.moves = {White(1, 0), Black(2, 0), White(0, 1), Black(1, 1),
+                  Black(0, 0),
+                  GoMove(GoMove::BLACK, true, {-1, -1}), Black(19, 19)};
+  EXPECT_EQ(GetBoardSize(record), 9);
+  GoBoard board(9, 9);
+  // Black(0, 0) is played onto a captured point, Black(19, 19) is a pass.
+  EXPECT_EQ(ReplayRecord(record, &board), 0);
+  EXPECT_EQ(board.At({0, 0}), GoBoard::BLACK);
+  EXPECT_EQ(board.At({1, 0}), GoBoard::EMPTY);
+  EXPECT_EQ(board.prisoners(GoMove::BLACK), 1);
+  EXPECT_EQ(board.prisoners(GoMove::WHITE), 1);
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,139 @@
+#ifndef SGF_PARSER_BOUNDED_QUEUE_H_
+#define SGF_PARSER_BOUNDED_QUEUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+
+namespace sgf_parser {
+
+// A bounded lock free multi-producer multi-consumer queue, after Dmitry
+// Vyukov's array based design: each slot carries a sequence number which tells
+// producers and consumers whether it is free or full, so the only contended
+// operations are one CAS on the head or the tail.
+//
+// Push() blocks while the queue is full, which is how a slow consumer applies
+// backpressure to its producers. Close() tells consumers that no more items
+// will come: Pop() then drains the queue and returns false.
+template <typename T>
+class BoundedQueue {
+ public:
+  // The capacity is rounded up to a power of two.
+  explicit BoundedQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    mask_ = size - 1;
+    slots_.reset(new Slot[size]);
+    for (size_t i = 0; i < size; ++i) {
+      slots_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  size_t capacity() const { return mask_ + 1; }
+
+  // Returns false if the queue is full. `item` is left untouched then.
+  bool TryPush(T* item) {
+    size_t pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      const size_t seq = slot.sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) -
+                            static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          slot.value = std::move(*item);
+          slot.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Returns false if the queue is empty.
+  bool TryPop(T* item) {
+    size_t pos = head_.load(std::memory_order_relaxed);
+    while (true) {
+      Slot& slot = slots_[pos & mask_];
+      const size_t seq = slot.sequence.load(std::memory_order_acquire);
+      const intptr_t diff = static_cast<intptr_t>(seq) -
+                            static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (head_.compare_exchange_weak(pos, pos + 1,
+                                        std::memory_order_relaxed)) {
+          *item = std::move(slot.value);
+          slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = head_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Blocks while the queue is full.
+  void Push(T item) {
+    for (int spins = 0; !TryPush(&item); spins += (spins < 128)) {
+      Backoff(spins);
+    }
+  }
+
+  // Blocks while the queue is empty. Returns false once the queue is closed
+  // and drained.
+  bool Pop(T* item) {
+    for (int spins = 0; !TryPop(item); spins += (spins < 128)) {
+      if (closed_.load(std::memory_order_acquire)) {
+        // Items pushed before Close() are visible now.
+        return TryPop(item);
+      }
+      Backoff(spins);
+    }
+    return true;
+  }
+
+  // Must be called after the last Push().
+  void Close() { closed_.store(true, std::memory_order_release); }
+
+ private:
+  struct Slot {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  // Spins briefly, then yields, then sleeps, so that idle stages of a
+  // pipeline don't burn cores.
+  static void Backoff(int spins) {
+    if (spins < 64) return;
+    if (spins < 128) {
+      std::this_thread::yield();
+    } else {
+      std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+  }
+
+  static constexpr size_t kCacheLine = 64;
+
+  std::unique_ptr<Slot[]> slots_;
+  size_t mask_;
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+  alignas(kCacheLine) std::atomic<bool> closed_{false};
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_BOUNDED_QUEUE_H_
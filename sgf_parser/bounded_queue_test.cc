@@ -0,0 +1,60 @@
+#include "sgf_parser/bounded_queue.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+TEST(BoundedQueueTest, FullAndEmpty) {
+  BoundedQueue<int> queue(3);
+  EXPECT_EQ(queue.capacity(), 4);
+  for (int i = 0; i < 4; ++i) {
+    int item = i;
+    EXPECT_TRUE(queue.TryPush(&item));
+  }
+  int item = 4;
+  EXPECT_FALSE(queue.TryPush(&item));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(queue.TryPop(&item));
+    EXPECT_EQ(item, i);
+  }
+  EXPECT_FALSE(queue.TryPop(&item));
+  queue.Close();
+  EXPECT_FALSE(queue.Pop(&item));
+}
+
+TEST(BoundedQueueTest, ManyProducersAndConsumers) {
+  const int kProducers = 3;
+  const int kItems = 10000;
+  BoundedQueue<int> queue(16);
+  std::atomic<int64_t> sum{0};
+  std::atomic<int> count{0};
+  std::vector<std::thread> consumers;
+  for (int i = 0; i < 2; ++i) {
+    consumers.emplace_back([&] {
+      int item;
+      while (queue.Pop(&item)) {
+        sum += item;
+        ++count;
+      }
+    });
+  }
+  std::vector<std::thread> producers;
+  for (int p = 0; p < kProducers; ++p) {
+    producers.emplace_back([&] {
+      for (int i = 1; i <= kItems; ++i) queue.Push(i);
+    });
+  }
+  for (auto& t : producers) t.join();
+  queue.Close();
+  for (auto& t : consumers) t.join();
+  EXPECT_EQ(count.load(), kProducers * kItems);
+  EXPECT_EQ(sum.load(), int64_t{kProducers} * kItems * (kItems + 1) / 2);
+}
+
+}  // namespace
+}  // namespace sgf_parser
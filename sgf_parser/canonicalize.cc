@@ -0,0 +1,228 @@
+#include "sgf_parser/canonicalize.h"
+
+#include <algorithm>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "sgf_parser/validator.h"
+
+namespace sgf_parser {
+
+using absl::string_view;
+using std::string;
+
+namespace {
+
+// Properties whose values are a set of points, so order and repeats don't
+// matter.
+bool IsPointList(string_view id) {
+  static const char* const kPointLists[] = {
+      "AB", "AE", "AR", "AW", "CR", "DD", "LB", "LN", "MA", "SL", "SQ", "TB",
+      "TR", "TW", "VW",
+  };
+  for (const char* list : kPointLists) {
+    if (id == list) return true;
+  }
+  return false;
+}
+
+void CanonicalId(string_view id, string* out) {
+  out->clear();
+  const bool all_letters = std::all_of(id.begin(), id.end(), [](char c) {
+    return absl::ascii_isalpha(c);
+  });
+  if (!all_letters) {
+    // Not a valid id, but the parser took it; keep it as it is.
+    out->assign(id.data(), id.size());
+    return;
+  }
+  const bool has_upper = std::any_of(id.begin(), id.end(), [](char c) {
+    return absl::ascii_isupper(c);
+  });
+  for (const char c : id) {
+    if (!has_upper) {
+      out->push_back(absl::ascii_toupper(c));
+    } else if (absl::ascii_isupper(c)) {
+      out->push_back(c);
+    }
+  }
+}
+
+// Appends `raw`, a value as the parser found it, escaping only ']' and '\'.
+// Escaped ':' stays escaped since it separates the parts of composed values.
+void AppendValue(string_view raw, string* out) {
+  for (size_t i = 0; i < raw.size(); ++i) {
+    char c = raw[i];
+    if (c == '\\' && i + 1 < raw.size()) {
+      c = raw[++i];
+      if (c == '\n' || c == '\r') {
+        // A soft line break, possibly "\r\n" or "\n\r".
+        if (i + 1 < raw.size() && (raw[i + 1] == '\n' || raw[i + 1] == '\r') &&
+            raw[i + 1] != c) {
+          ++i;
+        }
+        continue;
+      }
+      if (c == ':') {
+        out->append("\\:");
+        continue;
+      }
+    }
+    if (c == ']' || c == '\\') out->push_back('\\');
+    out->push_back(c);
+  }
+}
+
+// Finds the end of the game tree starting at sgf[start], one past its ')'.
+size_t FindGameEnd(string_view sgf, size_t start) {
+  int depth = 0;
+  bool in_value = false;
+  for (size_t i = start; i < sgf.size(); ++i) {
+    const char c = sgf[i];
+    if (c == '\\') {
+      ++i;
+    } else if (in_value) {
+      in_value = c != ']';
+    } else if (c == '[') {
+      in_value = true;
+    } else if (c == '(') {
+      ++depth;
+    } else if (c == ')' && --depth == 0) {
+      return i + 1;
+    }
+  }
+  return string_view::npos;
+}
+
+}  // namespace
+
+Canonicalizer::Canonicalizer() : root_(nullptr) {
+}
+
+bool Canonicalizer::Canonicalize(
+    string_view sgf, const std::function<void(string_view)>& emit,
+    string* errors) {
+  // Output may replace the input, so check all of it before emitting a game.
+  if (!ValidateSgf(sgf, nullptr, errors)) return false;
+  size_t cursor = 0;
+  bool first = true;
+  while (true) {
+    size_t start = internal::FindFirst(sgf, cursor, "(", false);
+    if (start == string_view::npos && !first) {
+      // The parser ignores text after the last game; dropping it would lose
+      // data.
+      if (absl::StripAsciiWhitespace(sgf.substr(cursor)).empty()) return true;
+      if (errors != nullptr) {
+        absl::StrAppend(errors, "Text after the last game at offset ", cursor,
+                        ".\n");
+      }
+      return false;
+    }
+    first = false;
+    size_t end = start == string_view::npos ? string_view::npos
+                                            : FindGameEnd(sgf, start);
+    // Let the parser report what is wrong with the rest.
+    string_view game = end == string_view::npos
+        ? sgf.substr(cursor) : sgf.substr(start, end - start);
+
+    pool_.Recycle(&root_);
+    if (!internal::ParseToRoot(game, ParseLimits(), &pool_, &root_, errors)) {
+      return false;
+    }
+    for (const auto& tree : root_.children) {
+      game_.clear();
+      AppendGame(*tree, &game_);
+      game_.push_back('\n');
+      emit(game_);
+    }
+    if (end == string_view::npos) return true;
+    cursor = end;
+  }
+}
+
+void Canonicalizer::AppendGame(const internal::GameTree& game, string* out) {
+  stack_.clear();
+  out->push_back('(');
+  for (const auto& node : game.sequence) AppendNode(node, out);
+  stack_.emplace_back(&game, 0);
+  while (!stack_.empty()) {
+    const internal::GameTree* tree = stack_.back().first;
+    size_t& next = stack_.back().second;
+    if (next == tree->children.size()) {
+      out->push_back(')');
+      stack_.pop_back();
+      continue;
+    }
+    const internal::GameTree* child = tree->children[next++].get();
+    out->push_back('(');
+    for (const auto& node : child->sequence) AppendNode(node, out);
+    stack_.emplace_back(child, 0);
+  }
+}
+
+void Canonicalizer::AppendNode(const internal::GameNode& node, string* out) {
+  out->push_back(';');
+  const size_t n = node.size();
+  if (entries_.size() < n) entries_.resize(n);
+  for (size_t i = 0; i < n; ++i) {
+    CanonicalId(node[i].id, &entries_[i].id);
+    entries_[i].prop = &node[i];
+  }
+  std::stable_sort(entries_.begin(), entries_.begin() + n,
+                   [](const Entry& a, const Entry& b) { return a.id < b.id; });
+
+  for (size_t begin = 0, end; begin < n; begin = end) {
+    const string& id = entries_[begin].id;
+    end = begin + 1;
+    while (end < n && entries_[end].id == id) ++end;
+
+    if (IsPointList(id)) {
+      size_t count = 0;
+      for (size_t i = begin; i < end; ++i) {
+        for (const auto& value : entries_[i].prop->values) {
+          if (values_.size() <= count) values_.emplace_back();
+          values_[count].clear();
+          AppendValue(value, &values_[count++]);
+        }
+      }
+      std::sort(values_.begin(), values_.begin() + count);
+      count = std::unique(values_.begin(), values_.begin() + count) -
+              values_.begin();
+      out->append(id);
+      for (size_t i = 0; i < count; ++i) {
+        absl::StrAppend(out, "[", values_[i], "]");
+      }
+      continue;
+    }
+
+    // Moves are kept even if repeated, since each one is a move.
+    const bool keep_repeats = id == "B" || id == "W";
+    size_t kept = 0;
+    for (size_t i = begin; i < end; ++i) {
+      if (group_.size() <= kept) group_.emplace_back();
+      string& rendered = group_[kept];
+      rendered = id;
+      for (const auto& value : entries_[i].prop->values) {
+        rendered.push_back('[');
+        AppendValue(value, &rendered);
+        rendered.push_back(']');
+      }
+      if (!keep_repeats &&
+          std::find(group_.begin(), group_.begin() + kept, rendered) !=
+              group_.begin() + kept) {
+        continue;
+      }
+      out->append(rendered);
+      ++kept;
+    }
+  }
+}
+
+bool CanonicalizeSgf(string_view sgf, string* out, string* errors) {
+  Canonicalizer canonicalizer;
+  return canonicalizer.Canonicalize(
+      sgf, [out](string_view game) { out->append(game.data(), game.size()); },
+      errors);
+}
+
+}  // namespace sgf_parser
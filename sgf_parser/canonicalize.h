@@ -0,0 +1,69 @@
+#ifndef SGF_PARSER_CANONICALIZE_H_
+#define SGF_PARSER_CANONICALIZE_H_
+
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// Rewrites SGF into a canonical compact form, so files which differ only in
+// style become byte for byte equal:
+//   - no whitespace outside values, and one game per line,
+//   - property ids in upper case; FF[3] style ids with lower case letters, such
+//     as "AddBlack", are reduced to their capitals, "AB",
+//   - the properties of a node sorted by id; repeated point lists (AB, AW, AE
+//     and markup) are merged, with their points sorted and deduplicated, and
+//     other repeated properties are dropped if they are exact copies,
+//   - only ']' and '\' escaped in values, and soft line breaks removed.
+//
+// Games of a collection are parsed and written one at a time, so a large
+// collection never needs a tree for all of it. One Canonicalizer reuses its
+// buffers from game to game; use one per thread.
+class Canonicalizer {
+ public:
+  Canonicalizer();
+
+  Canonicalizer(const Canonicalizer&) = delete;
+  Canonicalizer& operator=(const Canonicalizer&) = delete;
+
+  // Calls `emit` with the canonical form of every game of `sgf`, newline
+  // included. Returns false without emitting anything if `sgf` doesn't parse.
+  // Unlike the parser, also fails on text after the last game, which the
+  // canonical form would drop; the games before it are emitted by then. If
+  // `errors` is not null, parsing errors are saved to it.
+  bool Canonicalize(absl::string_view sgf,
+                    const std::function<void(absl::string_view)>& emit,
+                    std::string* errors);
+
+ private:
+  struct Entry {
+    std::string id;
+    const internal::Property* prop;
+  };
+
+  void AppendGame(const internal::GameTree& game, std::string* out);
+  void AppendNode(const internal::GameNode& node, std::string* out);
+
+  internal::GameTree root_;
+  internal::TreePool pool_;
+  std::string game_;
+
+  // Scratch space.
+  std::vector<std::pair<const internal::GameTree*, size_t>> stack_;
+  std::vector<Entry> entries_;
+  std::vector<std::string> values_;
+  std::vector<std::string> group_;
+};
+
+// Appends the canonical form of `sgf` to `out`. See Canonicalizer.
+bool CanonicalizeSgf(absl::string_view sgf, std::string* out,
+                     std::string* errors);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_CANONICALIZE_H_
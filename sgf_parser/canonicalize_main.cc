@@ -0,0 +1,123 @@
+// Rewrites SGF files into the canonical compact form of canonicalize.h, one
+// file per task on a thread pool.
+//
+// Usage:
+//   sgf_canonicalize [--output_dir=out/] [--threads=N] [--file_list=files.txt]
+//       [file ...]
+//
+// Without --output_dir every file is rewritten in place, through a temporary
+// file which is renamed over it once complete. With it, outputs are named after
+// the base names of the inputs; if two inputs would share an output, nothing is
+// written and the tool exits with 1.
+
+#include <stdio.h>
+
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/canonicalize.h"
+#include "sgf_parser/file_tasks.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/thread_pool.h"
+
+DEFINE_string(output_dir, "",
+              "Directory for the output files, named after the inputs. "
+              "Empty to rewrite the inputs in place.");
+DEFINE_int32(threads, 0, "Worker threads, 0 for one per core.");
+DEFINE_string(file_list, "", "A file with one SGF file name per line.");
+
+namespace sgf_parser {
+namespace {
+
+std::string OutputPath(const std::string& filename) {
+  if (FLAGS_output_dir.empty()) return filename + ".tmp";
+  const size_t slash = filename.rfind('/');
+  return absl::StrCat(FLAGS_output_dir, "/",
+                      slash == std::string::npos ? filename
+                                                 : filename.substr(slash + 1));
+}
+
+// Whether every file gets its own output. Parallel workers writing to the same
+// one would lose all but one of the files.
+bool OutputsAreDistinct(const std::vector<std::string>& files) {
+  std::map<std::string, const std::string*> inputs;
+  bool distinct = true;
+  for (const auto& file : files) {
+    const auto inserted = inputs.emplace(OutputPath(file), &file);
+    if (!inserted.second) {
+      LOG(ERROR) << file << " and " << *inserted.first->second
+                 << " would both be written to " << inserted.first->first;
+      distinct = false;
+    }
+  }
+  return distinct;
+}
+
+bool CanonicalizeFile(const std::string& filename, Canonicalizer* canonicalizer) {
+  const std::string sgf = ReadFileToString(filename);
+  const std::string output = OutputPath(filename);
+  std::ofstream out(output, std::ios::binary);
+  if (!out) {
+    LOG(ERROR) << "Failed to open " << output;
+    return false;
+  }
+  std::string errors;
+  const bool ok = canonicalizer->Canonicalize(
+      sgf, [&out](absl::string_view game) {
+        out.write(game.data(), game.size());
+      }, &errors);
+  out.close();
+  if (!ok || !out) {
+    LOG(ERROR) << filename << ": "
+               << (ok ? "failed to write " + output : errors);
+    remove(output.c_str());
+    return false;
+  }
+  if (FLAGS_output_dir.empty() && rename(output.c_str(), filename.c_str())) {
+    PLOG(ERROR) << "Failed to replace " << filename;
+    remove(output.c_str());
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace sgf_parser
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  const std::vector<std::string> files =
+      sgf_parser::ReadInputFiles(argc, argv, FLAGS_file_list);
+  if (!sgf_parser::OutputsAreDistinct(files)) return 1;
+
+  std::atomic<int64_t> failed{0};
+  {
+    sgf_parser::ThreadPool pool(FLAGS_threads);
+    // One canonicalizer per worker, so its buffers are reused across files.
+    std::vector<std::unique_ptr<sgf_parser::Canonicalizer>> canonicalizers;
+    for (int i = 0; i < pool.num_threads(); ++i) {
+      canonicalizers.emplace_back(new sgf_parser::Canonicalizer());
+    }
+    for (const auto& file : files) {
+      pool.Schedule([&pool, &canonicalizers, &failed, &file]() {
+        if (!sgf_parser::CanonicalizeFile(
+                file, canonicalizers[pool.CurrentWorker()].get())) {
+          ++failed;
+        }
+      });
+    }
+    pool.Wait();
+  }
+  LOG(INFO) << "Canonicalized " << files.size() - failed << " of "
+            << files.size() << " files.";
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+#include "sgf_parser/canonicalize.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+using ::testing::HasSubstr;
+
+string Canonical(const string& sgf) {
+  string out;
+  string errors;
+  CHECK(CanonicalizeSgf(sgf, &out, &errors)) << errors;
+  return out;
+}
+
+class CanonicalizeTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(CanonicalizeTest, Compact) {
+  EXPECT_EQ(Canonical("  (;FF[4] SZ[19]\n  AB[dd]\n[pd]\n\n;B [pp] ;W[dp])\n"),
+            "(;AB[dd][pd]FF[4]SZ[19];B[pp];W[dp])\n");
+}
+
+TEST_F(CanonicalizeTest, Ids) {
+  EXPECT_EQ(Canonical("(;ff[3]AddBlack[aa]PlayerBlack[x];b[bb];w[cc])"),
+            "(;AB[aa]FF[3]PB[x];B[bb];W[cc])\n");
+}
+
+TEST_F(CanonicalizeTest, RepeatedProperties) {
+  EXPECT_EQ(Canonical("(;AB[cc][aa]AW[dd]AB[bb][aa]GN[x]GN[x]GN[y]C[a]C[a])"),
+            "(;AB[aa][bb][cc]AW[dd]C[a]GN[x]GN[y])\n");
+  // Moves are never merged.
+  EXPECT_EQ(Canonical("(;B[aa]B[aa])"), "(;B[aa]B[aa])\n");
+}
+
+TEST_F(CanonicalizeTest, Escaping) {
+  EXPECT_EQ(Canonical("(;C[a\\]b \\\\ \\c soft\\\nbreak]LB[aa:x\\:y])"),
+            "(;C[a\\]b \\\\ c softbreak]LB[aa:x\\:y])\n");
+}
+
+TEST_F(CanonicalizeTest, Variations) {
+  EXPECT_EQ(Canonical("(;B[aa]\n (;W[bb]\n (;B[cc])\n (;B[dd]))\n (;W[ee]))"),
+            "(;B[aa](;W[bb](;B[cc])(;B[dd]))(;W[ee]))\n");
+}
+
+TEST_F(CanonicalizeTest, Collection) {
+  Canonicalizer canonicalizer;
+  std::vector<string> games;
+  string errors;
+  EXPECT_TRUE(canonicalizer.Canonicalize(
+      "(;B[aa])\n(;W[bb])(;B[cc]) \n", [&](absl::string_view game) {
+        games.emplace_back(game);
+      }, &errors));
+  EXPECT_THAT(games, ::testing::ElementsAre("(;B[aa])\n", "(;W[bb])\n",
+                                            "(;B[cc])\n"));
+
+  games.clear();
+  EXPECT_FALSE(canonicalizer.Canonicalize(
+      "(;B[aa])(;W[bb]", [&](absl::string_view game) {
+        games.emplace_back(game);
+      }, &errors));
+  EXPECT_TRUE(games.empty());
+  EXPECT_THAT(errors, HasSubstr("Missing the end of a node"));
+}
+
+TEST_F(CanonicalizeTest, TextAfterTheLastGame) {
+  // Canonical output may replace the input, so nothing may be dropped.
+  for (const char* sgf : {"(;B[aa]))(;W[bb])", "(;B[aa])x(;W[bb])",
+                          "(;B[aa]) trailing"}) {
+    string out, errors;
+    EXPECT_FALSE(CanonicalizeSgf(sgf, &out, &errors)) << sgf;
+    EXPECT_FALSE(errors.empty()) << sgf;
+  }
+}
+
+TEST_F(CanonicalizeTest, TestData) {
+  for (const char* file : {"testdata/handicapped.sgf", "testdata/resigned.sgf",
+                           "testdata/collection.sgf"}) {
+    SCOPED_TRACE(file);
+    const string sgf = ReadFileToString(file);
+    const string canonical = Canonical(sgf);
+    EXPECT_LT(canonical.size(), sgf.size());
+    EXPECT_EQ(Canonical(canonical), canonical);
+
+    GameRecord original, rewritten;
+    ASSERT_TRUE(SimpleParseSgf(sgf, &original, nullptr, nullptr));
+    ASSERT_TRUE(SimpleParseSgf(canonical, &rewritten, nullptr, nullptr));
+    std::sort(original.black_stones.begin(), original.black_stones.end());
+    std::sort(original.white_stones.begin(), original.white_stones.end());
+    EXPECT_EQ(rewritten.DebugString(), original.DebugString());
+  }
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,382 @@
+#include "sgf_parser/corpus.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+#include "sgf_parser/page_buffer.h"
+
+namespace sgf_parser {
+
+using std::string;
+
+const char kCorpusMagic[8] = {'S', 'G', 'F', 'C', 'O', 'R', 'P', '1'};
+
+namespace {
+
+constexpr uint32_t kBlockMagic = 0x4B4C4253;   // "SBLK".
+constexpr size_t kBlockHeaderBytes = 12;
+
+// Move byte 0: the color, the pass flag and x.
+constexpr uint8_t kWhiteBit = 0x80;
+constexpr uint8_t kPassBit = 0x40;
+constexpr int kMaxX = 0x3F;
+constexpr int kMaxY = 0xFF;
+
+void PutVarint(uint64_t value, string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+// Zigzag, so small negative numbers stay short.
+void PutSigned(int64_t value, string* out) {
+  PutVarint((static_cast<uint64_t>(value) << 1) ^ (value >> 63), out);
+}
+
+void PutFloat(float value, string* out) {
+  char bytes[sizeof(value)];
+  memcpy(bytes, &value, sizeof(value));
+  out->append(bytes, sizeof(bytes));
+}
+
+void PutString(const string& value, string* out) {
+  PutVarint(value.size(), out);
+  out->append(value);
+}
+
+void PutUint32(uint32_t value, char* out) {
+  for (int i = 0; i < 4; ++i) out[i] = static_cast<char>(value >> (8 * i));
+}
+
+uint32_t GetUint32(const char* in) {
+  uint32_t value = 0;
+  for (int i = 0; i < 4; ++i) {
+    value |= static_cast<uint32_t>(static_cast<uint8_t>(in[i])) << (8 * i);
+  }
+  return value;
+}
+
+bool GetVarint(absl::string_view* in, uint64_t* value) {
+  *value = 0;
+  for (int shift = 0; shift < 64 && !in->empty(); shift += 7) {
+    const uint8_t byte = in->front();
+    in->remove_prefix(1);
+    *value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (byte < 0x80) return true;
+  }
+  return false;
+}
+
+bool GetSigned(absl::string_view* in, int64_t* value) {
+  uint64_t zigzag;
+  if (!GetVarint(in, &zigzag)) return false;
+  *value = static_cast<int64_t>(zigzag >> 1) ^ -static_cast<int64_t>(zigzag & 1);
+  return true;
+}
+
+bool GetFloat(absl::string_view* in, float* value) {
+  if (in->size() < sizeof(*value)) return false;
+  memcpy(value, in->data(), sizeof(*value));
+  in->remove_prefix(sizeof(*value));
+  return true;
+}
+
+bool GetString(absl::string_view* in, string* value) {
+  uint64_t size;
+  if (!GetVarint(in, &size) || size > in->size()) return false;
+  value->assign(in->data(), size);
+  in->remove_prefix(size);
+  return true;
+}
+
+bool GetCount(absl::string_view* in, size_t bytes_each, uint64_t* count) {
+  return GetVarint(in, count) && *count <= in->size() / bytes_each;
+}
+
+bool PointFits(const GoPos& pos) {
+  return pos.first >= 0 && pos.first <= kMaxX && pos.second >= 0 &&
+         pos.second <= kMaxY;
+}
+
+void PutStones(const std::vector<GoPos>& stones, string* out) {
+  PutVarint(stones.size(), out);
+  for (const GoPos& pos : stones) {
+    out->push_back(static_cast<char>(pos.first));
+    out->push_back(static_cast<char>(pos.second));
+  }
+}
+
+bool GetStones(absl::string_view* in, std::vector<GoPos>* stones) {
+  uint64_t count;
+  if (!GetCount(in, 2, &count)) return false;
+  stones->clear();
+  for (uint64_t i = 0; i < count; ++i) {
+    stones->emplace_back(static_cast<uint8_t>((*in)[2 * i]),
+                         static_cast<uint8_t>((*in)[2 * i + 1]));
+  }
+  in->remove_prefix(2 * count);
+  return true;
+}
+
+}  // namespace
+
+bool EncodeRecord(const GameRecord& record, string* out) {
+  for (const auto* stones : {&record.black_stones, &record.white_stones}) {
+    for (const GoPos& pos : *stones) {
+      if (!PointFits(pos)) return false;
+    }
+  }
+  for (const GoMove& move : record.moves) {
+    if (!move.pass && !PointFits(move.move)) return false;
+  }
+
+  PutVarint(record.board_width, out);
+  PutVarint(record.board_height, out);
+  PutFloat(record.komi, out);
+  PutFloat(record.result, out);
+  PutSigned(record.handicap, out);
+  PutSigned(record.timelimit, out);
+  out->push_back(record.resigned ? 1 : 0);
+  for (const string* value :
+       {&record.black_name, &record.black_rank, &record.white_name,
+        &record.white_rank, &record.date, &record.rule}) {
+    PutString(*value, out);
+  }
+  PutStones(record.black_stones, out);
+  PutStones(record.white_stones, out);
+  PutVarint(record.moves.size(), out);
+  for (const GoMove& move : record.moves) {
+    uint8_t first = move.player == GoMove::WHITE ? kWhiteBit : 0;
+    uint8_t second = 0;
+    if (move.pass) {
+      first |= kPassBit;
+    } else {
+      first |= move.move.first;
+      second = move.move.second;
+    }
+    out->push_back(static_cast<char>(first));
+    out->push_back(static_cast<char>(second));
+  }
+  return true;
+}
+
+bool DecodeRecord(absl::string_view* in, GameRecord* record) {
+  uint64_t width, height, count;
+  int64_t handicap, timelimit;
+  if (!GetVarint(in, &width) || !GetVarint(in, &height) ||
+      !GetFloat(in, &record->komi) || !GetFloat(in, &record->result) ||
+      !GetSigned(in, &handicap) || !GetSigned(in, &timelimit) ||
+      in->empty()) {
+    return false;
+  }
+  record->board_width = width;
+  record->board_height = height;
+  record->handicap = handicap;
+  record->timelimit = timelimit;
+  record->resigned = in->front() != 0;
+  in->remove_prefix(1);
+  for (string* value :
+       {&record->black_name, &record->black_rank, &record->white_name,
+        &record->white_rank, &record->date, &record->rule}) {
+    if (!GetString(in, value)) return false;
+  }
+  if (!GetStones(in, &record->black_stones) ||
+      !GetStones(in, &record->white_stones) || !GetCount(in, 2, &count)) {
+    return false;
+  }
+  record->moves.clear();
+  for (uint64_t i = 0; i < count; ++i) {
+    const uint8_t first = (*in)[2 * i];
+    const uint8_t second = (*in)[2 * i + 1];
+    const GoMove::Color color =
+        first & kWhiteBit ? GoMove::WHITE : GoMove::BLACK;
+    if (first & kPassBit) {
+      record->moves.emplace_back(color, true, GoPos(-1, -1));
+    } else {
+      record->moves.emplace_back(color, false, GoPos(first & kMaxX, second));
+    }
+  }
+  in->remove_prefix(2 * count);
+  return true;
+}
+
+CorpusBlockBuilder::CorpusBlockBuilder() { Clear(); }
+
+bool CorpusBlockBuilder::Add(const GameRecord& record) {
+  if (!EncodeRecord(record, &data_)) return false;
+  ++games_;
+  return true;
+}
+
+absl::string_view CorpusBlockBuilder::Finish() {
+  PutUint32(kBlockMagic, &data_[0]);
+  PutUint32(games_, &data_[4]);
+  PutUint32(data_.size() - kBlockHeaderBytes, &data_[8]);
+  return data_;
+}
+
+void CorpusBlockBuilder::Clear() {
+  data_.assign(kBlockHeaderBytes, '\0');
+  games_ = 0;
+}
+
+struct CorpusWriter::File {
+  std::mutex mu;
+  std::ofstream out;   // Guarded by mu.
+};
+
+CorpusWriter::CorpusWriter() : file_(new File()) {}
+
+CorpusWriter::~CorpusWriter() {}
+
+bool CorpusWriter::Open(const string& filename) {
+  file_->out.open(filename, std::ios::binary | std::ios::trunc);
+  file_->out.write(kCorpusMagic, sizeof(kCorpusMagic));
+  return static_cast<bool>(file_->out);
+}
+
+bool CorpusWriter::Write(CorpusBlockBuilder* builder) {
+  if (builder->games() == 0) return true;
+  const absl::string_view block = builder->Finish();
+  bool ok;
+  {
+    std::lock_guard<std::mutex> lock(file_->mu);
+    file_->out.write(block.data(), block.size());
+    ok = static_cast<bool>(file_->out);
+  }
+  builder->Clear();
+  return ok;
+}
+
+bool CorpusWriter::Close() {
+  std::lock_guard<std::mutex> lock(file_->mu);
+  file_->out.close();
+  return static_cast<bool>(file_->out);
+}
+
+bool ReadCorpus(const string& filename, ThreadPool* pool,
+                const std::function<void(int worker, const GameRecord& record)>&
+                    visit,
+                string* error) {
+  return ReadCorpus(filename, CorpusReadOptions(), pool, visit, error);
+}
+
+bool ReadCorpus(const string& filename, const CorpusReadOptions& options,
+                ThreadPool* pool,
+                const std::function<void(int worker, const GameRecord& record)>&
+                    visit,
+                string* error) {
+  absl::string_view data;
+  std::unique_ptr<PageBuffer> buffer;
+  std::unique_ptr<void, std::function<void(void*)>> unmap;
+  if (options.huge_pages) {
+    PageBufferOptions buffer_options;
+    buffer_options.huge_pages = true;
+    buffer = ReadFileToPageBuffer(filename, buffer_options, error);
+    if (buffer == nullptr) return false;
+    data = absl::string_view(buffer->data(), buffer->size());
+  } else {
+    const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      *error = absl::StrCat("Can't open ", filename, ": ", strerror(errno));
+      return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      *error = absl::StrCat("Can't stat ", filename, ": ", strerror(errno));
+      close(fd);
+      return false;
+    }
+    const size_t size = st.st_size;
+    if (size < sizeof(kCorpusMagic)) {
+      *error = absl::StrCat(filename, " is not a corpus.");
+      close(fd);
+      return false;
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+      *error = absl::StrCat("Can't map ", filename, ": ", strerror(errno));
+      return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    data = absl::string_view(static_cast<const char*>(mapped), size);
+    unmap = std::unique_ptr<void, std::function<void(void*)>>(
+        mapped, [size](void* p) { munmap(p, size); });
+  }
+  const size_t size = data.size();
+  if (size < sizeof(kCorpusMagic) ||
+      memcmp(data.data(), kCorpusMagic, sizeof(kCorpusMagic)) != 0) {
+    *error = absl::StrCat(filename, " is not a corpus.");
+    return false;
+  }
+
+  const int workers = pool != nullptr ? pool->num_threads() : 1;
+  std::vector<GameRecord> records(workers);
+  std::mutex mu;
+  std::atomic<bool> corrupt{false};
+  const auto decode = [&](absl::string_view payload, uint32_t games,
+                          size_t offset) {
+    const int worker = pool != nullptr ? pool->CurrentWorker() : 0;
+    GameRecord* record = &records[worker];
+    for (uint32_t i = 0; i < games; ++i) {
+      if (!DecodeRecord(&payload, record)) {
+        std::lock_guard<std::mutex> lock(mu);
+        *error = absl::StrCat(filename, ": bad game in the block at ", offset);
+        corrupt = true;
+        return;
+      }
+      visit(worker, *record);
+    }
+    if (!payload.empty()) {
+      std::lock_guard<std::mutex> lock(mu);
+      *error = absl::StrCat(filename, ": extra data in the block at ", offset);
+      corrupt = true;
+    }
+  };
+
+  // The headers are checked up front; the blocks are decoded in parallel.
+  size_t offset = sizeof(kCorpusMagic);
+  bool ok = true;
+  while (offset < size) {
+    if (size - offset < kBlockHeaderBytes ||
+        GetUint32(data.data() + offset) != kBlockMagic ||
+        GetUint32(data.data() + offset + 8) >
+            size - offset - kBlockHeaderBytes) {
+      std::lock_guard<std::mutex> lock(mu);
+      *error = absl::StrCat(filename, ": bad block header at ", offset);
+      ok = false;
+      break;
+    }
+    const uint32_t games = GetUint32(data.data() + offset + 4);
+    const absl::string_view payload = data.substr(
+        offset + kBlockHeaderBytes, GetUint32(data.data() + offset + 8));
+    if (pool != nullptr) {
+      pool->Schedule([&decode, payload, games, offset]() {
+        decode(payload, games, offset);
+      });
+    } else {
+      decode(payload, games, offset);
+      if (corrupt) break;
+    }
+    offset += kBlockHeaderBytes + payload.size();
+  }
+  if (pool != nullptr) pool->Wait();
+  return ok && !corrupt;
+}
+
+}  // namespace sgf_parser
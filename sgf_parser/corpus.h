@@ -0,0 +1,115 @@
+#ifndef SGF_PARSER_CORPUS_H_
+#define SGF_PARSER_CORPUS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/thread_pool.h"
+
+namespace sgf_parser {
+
+// A compact binary file of GameRecords, much faster to read back than
+// reparsing SGF. The file starts with the 8 bytes kCorpusMagic, followed by
+// blocks of games. A block has a 12 byte header, the uint32 block magic, the
+// number of games and the size of the payload, all little endian, then the
+// encoded games back to back. Blocks are decoded independently, so a reader
+// hands them out to threads.
+//
+// A game is encoded as varints and length prefixed strings: the board size,
+// komi and result as raw floats, handicap, time limit, resigned, the names,
+// ranks, date and rule, then the pre-set stones as 2 bytes each and the moves
+// as 2 bytes each: the color, pass flag and x, then y.
+extern const char kCorpusMagic[8];
+
+// Appends the encoding of `record` to `out`. Returns false, appending nothing,
+// if a move or stone is out of the 64x256 range the encoding holds. Boards of
+// the parser's 52x52 always fit.
+bool EncodeRecord(const GameRecord& record, std::string* out);
+
+// Decodes one record from the front of `in` and advances it. Returns false if
+// the data is truncated or malformed.
+bool DecodeRecord(absl::string_view* in, GameRecord* record);
+
+// Collects encoded games into a block.
+class CorpusBlockBuilder {
+ public:
+  CorpusBlockBuilder();
+
+  // Returns false if the game could not be encoded; see EncodeRecord().
+  bool Add(const GameRecord& record);
+
+  int games() const { return games_; }
+  // Bytes of the block so far, header included.
+  size_t bytes() const { return data_.size(); }
+
+  // Fills in the header and returns the block, valid until Clear().
+  absl::string_view Finish();
+
+  void Clear();
+
+ private:
+  std::string data_;
+  int games_ = 0;
+};
+
+// Writes blocks to a corpus file. Blocks of several threads may be written
+// concurrently; each block is written whole.
+class CorpusWriter {
+ public:
+  CorpusWriter();
+  ~CorpusWriter();
+
+  CorpusWriter(const CorpusWriter&) = delete;
+  CorpusWriter& operator=(const CorpusWriter&) = delete;
+
+  // Creates or truncates the file and writes the file header.
+  bool Open(const std::string& filename);
+
+  // Writes the block of `builder`, if it has games, and clears it.
+  bool Write(CorpusBlockBuilder* builder);
+
+  bool Close();
+
+ private:
+  struct File;
+  std::unique_ptr<File> file_;
+};
+
+// Suggested size of a block: builders are written out once they grow past it.
+constexpr size_t kCorpusBlockBytes = 1 << 20;
+
+// Reads a corpus file, memory mapped, and calls `visit` with every game. Blocks
+// are decoded on `pool` if it is not null, so `visit` is called concurrently
+// with the index of the worker, in [0, pool->num_threads()); otherwise on the
+// calling thread with worker 0. The record is reused for the worker's next
+// game. Returns false, with a message in `error`, if the file can't be read or
+// is corrupt; games of the blocks before the corruption may have been visited.
+bool ReadCorpus(const std::string& filename, ThreadPool* pool,
+                const std::function<void(int worker, const GameRecord& record)>&
+                    visit,
+                std::string* error);
+
+struct CorpusReadOptions {
+  // Read the file into memory backed by 2 MB pages instead of mapping it. On
+  // most file systems the page cache, which a mapping shares, only has base
+  // pages, so decoding a corpus of many GB misses the TLB every few KB. The
+  // copy costs a sequential pass over the file, which pays off when the corpus
+  // is large and decoded by many threads.
+  bool huge_pages = false;
+};
+
+bool ReadCorpus(const std::string& filename, const CorpusReadOptions& options,
+                ThreadPool* pool,
+                const std::function<void(int worker, const GameRecord& record)>&
+                    visit,
+                std::string* error);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_CORPUS_H_
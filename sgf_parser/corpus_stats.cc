@@ -0,0 +1,204 @@
+#include "sgf_parser/corpus_stats.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+
+namespace sgf_parser {
+
+using std::string;
+
+namespace {
+
+// Buckets of the histograms in DebugString().
+constexpr int kLengthBucket = 50;
+constexpr int kMarginBucket = 10;   // Half points.
+constexpr int kTopFirstMoves = 10;
+
+double Percent(int64_t part, int64_t total) {
+  return total == 0 ? 0 : 100.0 * part / total;
+}
+
+void AddVector(const std::vector<int64_t>& from, std::vector<int64_t>* to) {
+  for (size_t i = 0; i < from.size(); ++i) (*to)[i] += from[i];
+}
+
+// The smallest n with at least `fraction` of the games no longer than n.
+int LengthPercentile(const std::vector<int64_t>& lengths, int64_t games,
+                     double fraction) {
+  int64_t seen = 0;
+  for (size_t n = 0; n < lengths.size(); ++n) {
+    seen += lengths[n];
+    if (seen >= fraction * games) return n;
+  }
+  return lengths.size() - 1;
+}
+
+}  // namespace
+
+constexpr int CorpusStats::kMaxLength;
+constexpr int CorpusStats::kMaxMargin;
+constexpr int CorpusStats::kStride;
+
+CorpusStats::CorpusStats()
+    : lengths(kMaxLength + 1), first_moves(kStride * kStride + 1),
+      black_margins(kMaxMargin + 1), white_margins(kMaxMargin + 1) {}
+
+void CorpusStats::Add(const GameRecord& record) {
+  ++games;
+
+  key_.komi = isfinite(record.komi) ? record.komi + 0.0f : 0;  // No -0.
+  key_.handicap = record.handicap;
+  key_.rule.assign(record.rule);
+  auto it = outcomes.find(key_);
+  if (it == outcomes.end()) it = outcomes.emplace(key_, OutcomeCounts()).first;
+  OutcomeCounts& outcome = it->second;
+  ++outcome.games;
+  if (record.result > 0) ++outcome.black_wins;
+  if (record.result < 0) ++outcome.white_wins;
+
+  ++lengths[std::min<size_t>(record.moves.size(), kMaxLength)];
+
+  if (!record.moves.empty()) {
+    const GoMove& first = record.moves[0];
+    const int size = record.board_width > 0 ? record.board_width : 19;
+    const int x = first.move.first;
+    const int y = first.move.second;
+    // Moves off the board, e.g. "tt", are passes.
+    if (first.pass || x < 0 || y < 0 || x >= size || y >= size ||
+        x >= kStride || y >= kStride) {
+      ++first_moves.back();
+    } else {
+      ++first_moves[y * kStride + x];
+    }
+  }
+
+  if (record.resigned) {
+    ++(record.result > 0 ? black_wins_by_resignation
+                         : white_wins_by_resignation);
+  } else if (record.result == 0 || !isfinite(record.result)) {
+    ++no_result;
+  } else {
+    // Clamp before rounding: lround() of a huge result, e.g. "B+1e30",
+    // overflows.
+    const int margin =
+        lround(std::min<double>(fabs(record.result) * 2, kMaxMargin));
+    ++(record.result > 0 ? black_margins : white_margins)[margin];
+  }
+}
+
+void CorpusStats::Merge(const CorpusStats& other) {
+  games += other.games;
+  for (const auto& group : other.outcomes) {
+    OutcomeCounts& outcome = outcomes[group.first];
+    outcome.games += group.second.games;
+    outcome.black_wins += group.second.black_wins;
+    outcome.white_wins += group.second.white_wins;
+  }
+  AddVector(other.lengths, &lengths);
+  AddVector(other.first_moves, &first_moves);
+  AddVector(other.black_margins, &black_margins);
+  AddVector(other.white_margins, &white_margins);
+  black_wins_by_resignation += other.black_wins_by_resignation;
+  white_wins_by_resignation += other.white_wins_by_resignation;
+  no_result += other.no_result;
+}
+
+string CorpusStats::DebugString() const {
+  string debug;
+  absl::StrAppend(&debug, "Games: ", games, "\n");
+
+  absl::StrAppend(&debug, "Outcomes by komi, handicap and rule:\n");
+  std::vector<std::pair<GameGroup, OutcomeCounts>> groups(outcomes.begin(),
+                                                          outcomes.end());
+  std::sort(groups.begin(), groups.end(),
+            [](const std::pair<GameGroup, OutcomeCounts>& a,
+               const std::pair<GameGroup, OutcomeCounts>& b) {
+              return a.first < b.first;
+            });
+  for (const auto& group : groups) {
+    const OutcomeCounts& outcome = group.second;
+    absl::StrAppendFormat(
+        &debug,
+        "  komi %g, handicap %d, rule \"%s\": %d games, black wins %.1f%%, "
+        "white wins %.1f%%\n",
+        group.first.komi, group.first.handicap, group.first.rule,
+        outcome.games, Percent(outcome.black_wins, outcome.games),
+        Percent(outcome.white_wins, outcome.games));
+  }
+
+  int64_t moves = 0;
+  for (size_t n = 0; n < lengths.size(); ++n) moves += n * lengths[n];
+  absl::StrAppendFormat(
+      &debug, "Game length: mean %.1f, median %d, 90th percentile %d\n",
+      games == 0 ? 0.0 : static_cast<double>(moves) / games,
+      LengthPercentile(lengths, games, 0.5),
+      LengthPercentile(lengths, games, 0.9));
+  for (int begin = 0; begin <= kMaxLength; begin += kLengthBucket) {
+    int64_t count = 0;
+    for (int n = begin; n < begin + kLengthBucket && n <= kMaxLength; ++n) {
+      count += lengths[n];
+    }
+    if (count == 0) continue;
+    if (begin + kLengthBucket > kMaxLength) {
+      absl::StrAppendFormat(&debug, "  %d or more moves: %d\n", begin, count);
+    } else {
+      absl::StrAppendFormat(&debug, "  %d-%d moves: %d\n", begin,
+                            begin + kLengthBucket - 1, count);
+    }
+  }
+
+  absl::StrAppend(&debug, "First moves:\n");
+  std::vector<std::pair<int64_t, int>> firsts;
+  int64_t with_moves = 0;
+  for (size_t i = 0; i < first_moves.size(); ++i) {
+    with_moves += first_moves[i];
+    if (first_moves[i] > 0) firsts.emplace_back(-first_moves[i], i);
+  }
+  std::sort(firsts.begin(), firsts.end());
+  if (firsts.size() > kTopFirstMoves) firsts.resize(kTopFirstMoves);
+  for (const auto& first : firsts) {
+    const int i = first.second;
+    const string point =
+        i == kStride * kStride
+            ? "pass" : absl::StrCat("(", i % kStride, ", ", i / kStride, ")");
+    absl::StrAppendFormat(&debug, "  %s: %d, %.1f%%\n", point, -first.first,
+                          Percent(-first.first, with_moves));
+  }
+
+  absl::StrAppend(&debug, "Results: black wins by resignation ",
+                  black_wins_by_resignation, ", white wins by resignation ",
+                  white_wins_by_resignation, ", no result ", no_result, "\n");
+  absl::StrAppend(&debug, "Margins in points: black wins, white wins\n");
+  for (int begin = 0; begin <= kMaxMargin; begin += kMarginBucket) {
+    int64_t black = 0, white = 0;
+    for (int m = begin; m < begin + kMarginBucket && m <= kMaxMargin; ++m) {
+      black += black_margins[m];
+      white += white_margins[m];
+    }
+    if (black == 0 && white == 0) continue;
+    if (begin + kMarginBucket > kMaxMargin) {
+      absl::StrAppendFormat(&debug, "  %g or more: %d, %d\n", begin / 2.0,
+                            black, white);
+    } else {
+      absl::StrAppendFormat(&debug, "  %g-%g: %d, %d\n", begin / 2.0,
+                            (begin + kMarginBucket - 1) / 2.0, black, white);
+    }
+  }
+  return debug;
+}
+
+ShardedCorpusStats::ShardedCorpusStats(int workers) {
+  for (int i = 0; i < workers; ++i) shards_.emplace_back(new CorpusStats());
+}
+
+CorpusStats ShardedCorpusStats::Merged() const {
+  CorpusStats merged;
+  for (const auto& shard : shards_) merged.Merge(*shard);
+  return merged;
+}
+
+}  // namespace sgf_parser
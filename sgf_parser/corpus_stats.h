@@ -0,0 +1,107 @@
+#ifndef SGF_PARSER_CORPUS_STATS_H_
+#define SGF_PARSER_CORPUS_STATS_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// Games under the same conditions, the groups of CorpusStats::outcomes.
+struct GameGroup {
+  float komi = 0;     // Komi which is not finite counts as 0.
+  int handicap = 0;
+  std::string rule;
+
+  bool operator==(const GameGroup& other) const {
+    return komi == other.komi && handicap == other.handicap &&
+           rule == other.rule;
+  }
+  bool operator<(const GameGroup& other) const {
+    return std::tie(komi, handicap, rule) <
+           std::tie(other.komi, other.handicap, other.rule);
+  }
+
+  template <typename H>
+  friend H AbslHashValue(H h, const GameGroup& group) {
+    return H::combine(std::move(h), group.komi, group.handicap, group.rule);
+  }
+};
+
+struct OutcomeCounts {
+  int64_t games = 0;
+  int64_t black_wins = 0;
+  int64_t white_wins = 0;   // Games without a result are neither.
+};
+
+// Aggregates over a corpus of games. Add() is cheap, so a parallel pass keeps
+// one CorpusStats per thread and merges them at the end; see
+// ShardedCorpusStats.
+struct CorpusStats {
+  // Games of this many moves or more share the last bucket of `lengths`.
+  static constexpr int kMaxLength = 1000;
+  // Margins of this many half points or more share the last bucket.
+  static constexpr int kMaxMargin = 400;
+  // First moves are indexed by y * kStride + x; boards larger than this
+  // don't count. The last entry counts passes.
+  static constexpr int kStride = 52;
+
+  int64_t games = 0;
+
+  // Win rates by komi, handicap and rule.
+  absl::flat_hash_map<GameGroup, OutcomeCounts> outcomes;
+
+  // lengths[n] is the number of games of n moves.
+  std::vector<int64_t> lengths;
+
+  // Counts of the first move of games.
+  std::vector<int64_t> first_moves;
+
+  // Games won on points, by margin in half points.
+  std::vector<int64_t> black_margins;
+  std::vector<int64_t> white_margins;
+
+  int64_t black_wins_by_resignation = 0;
+  int64_t white_wins_by_resignation = 0;
+  int64_t no_result = 0;
+
+  CorpusStats();
+
+  void Add(const GameRecord& record);
+
+  void Merge(const CorpusStats& other);
+
+  // A readable report of every aggregate.
+  std::string DebugString() const;
+
+ private:
+  GameGroup key_;   // Scratch, so Add() doesn't copy the rule of every game.
+};
+
+// A CorpusStats per worker thread, each on its own cache lines.
+class ShardedCorpusStats {
+ public:
+  explicit ShardedCorpusStats(int workers);
+
+  // Only one thread may add to a worker's shard at a time.
+  void Add(int worker, const GameRecord& record) {
+    shards_[worker]->Add(record);
+  }
+
+  // Merges the shards.
+  CorpusStats Merged() const;
+
+ private:
+  std::vector<std::unique_ptr<CorpusStats>> shards_;
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_CORPUS_STATS_H_
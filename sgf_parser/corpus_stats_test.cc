@@ -0,0 +1,114 @@
+#include "sgf_parser/corpus_stats.h"
+
+#include <string>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+namespace {
+
+GameRecord MakeRecord(float komi, int handicap, const std::string& rule,
+                      float result, bool resigned, int moves) {
+  GameRecord record;
+  record.board_width = record.board_height = 19;
+  record.komi = komi;
+  record.handicap = handicap;
+  record.rule = rule;
+  record.result = result;
+  record.resigned = resigned;
+  for (int i = 0; i < moves; ++i) {
+    record.moves.emplace_back(i % 2 == 0 ? GoMove::BLACK : GoMove::WHITE,
+                              false, GoPos(3 + i % 13, 15));
+  }
+  return record;
+}
+
+class CorpusStatsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(CorpusStatsTest, Add) {
+  CorpusStats stats;
+  stats.Add(MakeRecord(6.5, 0, "Japanese", 3.5, false, 200));
+  stats.Add(MakeRecord(6.5, 0, "Japanese", -1.2, true, 150));
+  stats.Add(MakeRecord(0.5, 2, "Japanese", 0, false, 0));
+  stats.Add(MakeRecord(6.5, 0, "Chinese", -10, false, 5000));
+
+  EXPECT_EQ(stats.games, 4);
+  ASSERT_EQ(stats.outcomes.size(), 3);
+  const OutcomeCounts& japanese = stats.outcomes[GameGroup{6.5, 0, "Japanese"}];
+  EXPECT_EQ(japanese.games, 2);
+  EXPECT_EQ(japanese.black_wins, 1);
+  EXPECT_EQ(japanese.white_wins, 1);
+  const OutcomeCounts& handicap = stats.outcomes[GameGroup{0.5, 2, "Japanese"}];
+  EXPECT_EQ(handicap.games, 1);
+  EXPECT_EQ(handicap.black_wins + handicap.white_wins, 0);
+
+  EXPECT_EQ(stats.lengths[200], 1);
+  EXPECT_EQ(stats.lengths[150], 1);
+  EXPECT_EQ(stats.lengths[0], 1);
+  EXPECT_EQ(stats.lengths[CorpusStats::kMaxLength], 1);
+  EXPECT_EQ(stats.first_moves[15 * CorpusStats::kStride + 3], 3);
+
+  EXPECT_EQ(stats.black_margins[7], 1);
+  EXPECT_EQ(stats.white_margins[20], 1);
+  EXPECT_EQ(stats.white_wins_by_resignation, 1);
+  EXPECT_EQ(stats.black_wins_by_resignation, 0);
+  EXPECT_EQ(stats.no_result, 1);
+
+  const std::string debug = stats.DebugString();
+  EXPECT_NE(debug.find("Games: 4"), std::string::npos) << debug;
+  EXPECT_NE(debug.find("komi 6.5, handicap 0, rule \"Japanese\": 2 games, "
+                       "black wins 50.0%"), std::string::npos) << debug;
+  EXPECT_NE(debug.find("(3, 15): 3"), std::string::npos) << debug;
+}
+
+TEST_F(CorpusStatsTest, FirstMovePasses) {
+  CorpusStats stats;
+  GameRecord record = MakeRecord(0, 0, "", 0, false, 0);
+  record.moves.emplace_back(GoMove::BLACK, true, GoPos(-1, -1));
+  stats.Add(record);
+  // "tt" on a 19x19 board.
+  record.moves[0] = GoMove(GoMove::BLACK, false, GoPos(19, 19));
+  stats.Add(record);
+  EXPECT_EQ(stats.first_moves.back(), 2);
+}
+
+TEST_F(CorpusStatsTest, HugeMargins) {
+  CorpusStats stats;
+  GameRecord record;
+  std::string errors;
+  ASSERT_TRUE(SimpleParseSgf("(;GM[1]SZ[19]RE[B+1e30];B[pd])", &record,
+                             nullptr, &errors)) << errors;
+  stats.Add(record);
+  stats.Add(MakeRecord(6.5, 0, "", -1e30, false, 10));
+  stats.Add(MakeRecord(6.5, 0, "", -3e38, false, 10));
+  EXPECT_EQ(stats.black_margins[CorpusStats::kMaxMargin], 1);
+  EXPECT_EQ(stats.white_margins[CorpusStats::kMaxMargin], 2);
+  EXPECT_EQ(stats.no_result, 0);
+}
+
+TEST_F(CorpusStatsTest, Sharded) {
+  ShardedCorpusStats sharded(3);
+  CorpusStats single;
+  for (int i = 0; i < 300; ++i) {
+    const GameRecord record = MakeRecord(i % 4 == 0 ? 0.5 : 7.5, i % 3, "AGA",
+                                         (i % 5) - 2.5, i % 7 == 0, i);
+    sharded.Add(i % 3, record);
+    single.Add(record);
+  }
+  const CorpusStats merged = sharded.Merged();
+  EXPECT_EQ(merged.games, 300);
+  EXPECT_EQ(merged.DebugString(), single.DebugString());
+  EXPECT_EQ(merged.lengths, single.lengths);
+  EXPECT_EQ(merged.black_margins, single.black_margins);
+  EXPECT_EQ(merged.white_margins, single.white_margins);
+}
+
+}  // namespace
+}  // namespace sgf_parser
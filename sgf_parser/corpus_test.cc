@@ -0,0 +1,201 @@
+#include "sgf_parser/corpus.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using std::string;
+
+std::vector<GameRecord> TestRecords() {
+  std::vector<GameRecord> records;
+  for (const char* file : {"testdata/collection.sgf",
+                           "testdata/handicapped.sgf",
+                           "testdata/resigned.sgf"}) {
+    records.emplace_back();
+    CHECK(SimpleParseSgf(ReadFileToString(file), &records.back(), nullptr,
+                         nullptr)) << file;
+  }
+  records.emplace_back();
+  GameRecord& odd = records.back();
+  odd.board_width = 52;
+  odd.board_height = 13;
+  odd.komi = -3.5;
+  odd.handicap = -1;
+  odd.result = 0;
+  odd.rule = "Chinese";
+  odd.moves.emplace_back(GoMove::WHITE, false, GoPos(51, 12));
+  odd.moves.emplace_back(GoMove::BLACK, true, GoPos(-1, -1));
+  return records;
+}
+
+string TempFile(const string& name) {
+  const char* dir = getenv("TEST_TMPDIR");
+  return absl::StrCat(dir != nullptr ? dir : "/tmp", "/", name, ".", getpid());
+}
+
+class CorpusTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(CorpusTest, RoundTrip) {
+  const std::vector<GameRecord> records = TestRecords();
+  string data;
+  for (const GameRecord& record : records) {
+    ASSERT_TRUE(EncodeRecord(record, &data));
+  }
+  absl::string_view in(data);
+  GameRecord decoded;
+  for (const GameRecord& record : records) {
+    ASSERT_TRUE(DecodeRecord(&in, &decoded));
+    EXPECT_EQ(decoded.DebugString(), record.DebugString());
+    EXPECT_EQ(decoded.komi, record.komi);
+    EXPECT_EQ(decoded.result, record.result);
+    EXPECT_EQ(decoded.resigned, record.resigned);
+    ASSERT_EQ(decoded.moves.size(), record.moves.size());
+    for (size_t i = 0; i < record.moves.size(); ++i) {
+      EXPECT_EQ(decoded.moves[i].player, record.moves[i].player);
+      EXPECT_EQ(decoded.moves[i].pass, record.moves[i].pass);
+    }
+  }
+  EXPECT_TRUE(in.empty());
+
+  // A move out of range isn't encoded at all.
+  GameRecord big;
+  big.moves.emplace_back(GoMove::BLACK, false, GoPos(64, 0));
+  string out = "x";
+  EXPECT_FALSE(EncodeRecord(big, &out));
+  EXPECT_EQ(out, "x");
+}
+
+TEST_F(CorpusTest, Truncated) {
+  string data;
+  ASSERT_TRUE(EncodeRecord(TestRecords()[2], &data));
+  GameRecord decoded;
+  for (size_t size = 0; size < data.size(); ++size) {
+    absl::string_view in(data.data(), size);
+    EXPECT_FALSE(DecodeRecord(&in, &decoded)) << size;
+  }
+}
+
+TEST_F(CorpusTest, WriteAndRead) {
+  const std::vector<GameRecord> records = TestRecords();
+  const string filename = TempFile("corpus_test");
+  CorpusWriter writer;
+  ASSERT_TRUE(writer.Open(filename));
+  CorpusBlockBuilder builder;
+  int written = 0;
+  // Blocks of 1 to 3 games.
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_TRUE(builder.Add(records[i % records.size()]));
+    ++written;
+    if (builder.games() == 1 + i % 3) {
+      ASSERT_TRUE(writer.Write(&builder));
+    }
+  }
+  ASSERT_TRUE(writer.Write(&builder));
+  EXPECT_EQ(builder.games(), 0);
+  ASSERT_TRUE(writer.Close());
+
+  std::vector<string> expected;
+  for (const GameRecord& record : records) {
+    expected.push_back(record.DebugString());
+  }
+  for (ThreadPool* pool : {static_cast<ThreadPool*>(nullptr),
+                           new ThreadPool(4)}) {
+    std::atomic<int> games{0}, mismatches{0};
+    string error;
+    CorpusReadOptions options;
+    options.huge_pages = pool != nullptr;
+    EXPECT_TRUE(ReadCorpus(
+        filename, options, pool,
+        [&](int worker, const GameRecord& record) {
+          CHECK_LT(worker, pool != nullptr ? pool->num_threads() : 1);
+          ++games;
+          bool found = false;
+          for (const string& debug : expected) {
+            found = found || record.DebugString() == debug;
+          }
+          if (!found) ++mismatches;
+        },
+        &error)) << error;
+    EXPECT_EQ(games, written);
+    EXPECT_EQ(mismatches, 0);
+    delete pool;
+  }
+  remove(filename.c_str());
+}
+
+TEST_F(CorpusTest, Corrupt) {
+  const string filename = TempFile("corpus_corrupt_test");
+  const auto write = [&filename](const string& contents) {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out << contents;
+  };
+  const auto read = [&filename](int* games) {
+    *games = 0;
+    string error;
+    ThreadPool pool(2);
+    std::atomic<int> count{0};
+    const bool ok = ReadCorpus(
+        filename, &pool, [&count](int, const GameRecord&) { ++count; },
+        &error);
+    *games = count;
+    EXPECT_EQ(ok, error.empty()) << error;
+    return ok;
+  };
+
+  CorpusBlockBuilder builder;
+  builder.Add(TestRecords()[1]);
+  const string block(builder.Finish());
+  const string header(kCorpusMagic, sizeof(kCorpusMagic));
+  int games;
+
+  write(header + block + block);
+  EXPECT_TRUE(read(&games));
+  EXPECT_EQ(games, 2);
+
+  write("not a corpus");
+  EXPECT_FALSE(read(&games));
+  write("");
+  EXPECT_FALSE(read(&games));
+
+  // A truncated block.
+  write(header + block + block.substr(0, block.size() - 1));
+  EXPECT_FALSE(read(&games));
+
+  // A block which claims more games than it has.
+  string more = block;
+  more[4] = 2;
+  write(header + more);
+  EXPECT_FALSE(read(&games));
+
+  // A block with bytes after its games.
+  string extra = block + "x";
+  extra[8] += 1;
+  write(header + extra);
+  EXPECT_FALSE(read(&games));
+
+  string error;
+  EXPECT_FALSE(ReadCorpus(
+      "testdata/does_not_exist", nullptr, [](int, const GameRecord&) {},
+      &error));
+  EXPECT_FALSE(error.empty());
+  remove(filename.c_str());
+}
+
+}  // namespace
+}  // namespace sgf_parser
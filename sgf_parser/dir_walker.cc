@@ -0,0 +1,237 @@
+#include "sgf_parser/dir_walker.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+namespace {
+
+// The layout getdents64() fills in. glibc only wraps it since 2.30.
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+// Directories waiting to be listed. The walk is over when the queue is empty
+// and no thread is listing a directory, since only those add new ones.
+class DirQueue {
+ public:
+  explicit DirQueue(const std::vector<std::string>& roots)
+      : dirs_(roots.begin(), roots.end()) {}
+
+  void Push(std::string dir) {
+    std::lock_guard<std::mutex> lock(mu_);
+    dirs_.push_back(std::move(dir));
+    cv_.notify_one();
+  }
+
+  // Blocks until a directory is available. Returns false when the walk is
+  // over. Every successful Pop() must be followed by Done().
+  bool Pop(std::string* dir) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [this] { return !dirs_.empty() || busy_ == 0; });
+    if (dirs_.empty()) return false;
+    // LIFO: depth first keeps the queue short on deep trees.
+    *dir = std::move(dirs_.back());
+    dirs_.pop_back();
+    ++busy_;
+    return true;
+  }
+
+  void Done() {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (--busy_ == 0 && dirs_.empty()) cv_.notify_all();
+  }
+
+ private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::string> dirs_;
+  int busy_ = 0;
+};
+
+class Walker {
+ public:
+  Walker(const DirWalkerOptions& options, DirQueue* queue, int worker,
+         const std::function<void(int, std::vector<WalkedFile>*)>* callback)
+      : options_(options), queue_(queue), worker_(worker),
+        callback_(callback),
+        buffer_(new char[options.getdents_buffer_size]) {}
+
+  // Returns false if some directory could not be read.
+  bool Run() {
+    bool ok = true;
+    std::string dir;
+    while (queue_->Pop(&dir)) {
+      ok &= ListDirectory(dir);
+      queue_->Done();
+    }
+    Flush();
+    return ok;
+  }
+
+ private:
+  bool Matches(absl::string_view name) const {
+    if (options_.extensions.empty()) return true;
+    for (const auto& ext : options_.extensions) {
+      if (absl::EndsWithIgnoreCase(name, ext)) return true;
+    }
+    return false;
+  }
+
+  void Flush() {
+    if (batch_.empty()) return;
+    if (options_.sort_by_inode) {
+      std::sort(batch_.begin(), batch_.end(),
+                [](const WalkedFile& a, const WalkedFile& b) {
+                  return a.inode < b.inode;
+                });
+    }
+    (*callback_)(worker_, &batch_);
+    batch_.clear();
+  }
+
+  bool ListDirectory(const std::string& dir) {
+    const int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+      PLOG(WARNING) << "Cannot open directory " << dir;
+      return false;
+    }
+    bool ok = true;
+    while (true) {
+      const long n = syscall(SYS_getdents64, fd, buffer_.get(),
+                             options_.getdents_buffer_size);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        PLOG(WARNING) << "Cannot read directory " << dir;
+        ok = false;
+        break;
+      }
+      if (n == 0) break;
+      for (long pos = 0; pos < n;) {
+        const auto* entry =
+            reinterpret_cast<const LinuxDirent64*>(buffer_.get() + pos);
+        pos += entry->d_reclen;
+        HandleEntry(fd, dir, entry);
+      }
+    }
+    close(fd);
+    return ok;
+  }
+
+  void HandleEntry(int dir_fd, const std::string& dir,
+                   const LinuxDirent64* entry) {
+    const absl::string_view name(entry->d_name);
+    if (name == "." || name == "..") return;
+    unsigned char type = entry->d_type;
+    struct stat st;
+    bool have_stat = false;
+    if (type == DT_UNKNOWN) {
+      // Some file systems don't fill in d_type.
+      if (fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+        return;
+      }
+      have_stat = true;
+      type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : 0;
+    }
+    if (type == DT_DIR) {
+      queue_->Push(JoinPath(dir, name));
+      return;
+    }
+    if (type != DT_REG || !Matches(name)) return;
+    if (!have_stat &&
+        fstatat(dir_fd, entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+      return;
+    }
+    batch_.push_back(WalkedFile{JoinPath(dir, name),
+                                static_cast<uint64_t>(st.st_size),
+                                entry->d_ino});
+    if (batch_.size() >= options_.batch_size) Flush();
+  }
+
+  static std::string JoinPath(const std::string& dir, absl::string_view name) {
+    std::string path;
+    path.reserve(dir.size() + 1 + name.size());
+    path.append(dir);
+    if (!dir.empty() && dir.back() != '/') path.push_back('/');
+    path.append(name.data(), name.size());
+    return path;
+  }
+
+  const DirWalkerOptions& options_;
+  DirQueue* queue_;
+  const int worker_;
+  const std::function<void(int, std::vector<WalkedFile>*)>* callback_;
+  std::unique_ptr<char[]> buffer_;
+  std::vector<WalkedFile> batch_;
+};
+
+}  // namespace
+
+bool WalkDirectories(
+    const std::vector<std::string>& roots, const DirWalkerOptions& options,
+    const std::function<void(int worker, std::vector<WalkedFile>* batch)>&
+        callback) {
+  CHECK_GE(options.getdents_buffer_size, sizeof(LinuxDirent64) + 256);
+  DirQueue queue(roots);
+  const int threads = std::max(1, options.threads);
+  std::vector<char> ok(threads, true);
+  std::vector<std::thread> workers;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back([&, i] {
+      Walker walker(options, &queue, i, &callback);
+      ok[i] = walker.Run();
+    });
+  }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  return std::all_of(ok.begin(), ok.end(), [](char b) { return b; });
+}
+
+bool WalkAndLoadFiles(const std::vector<std::string>& roots,
+                      const DirWalkerOptions& options,
+                      const BatchLoaderOptions& loader,
+                      const std::function<void(const LoadedFile&)>& callback) {
+  BatchLoaderOptions per_walker = loader;
+  per_walker.threads = 1;
+  // Each walker thread loads its batches itself. Pinned, they would all take
+  // the first CPU.
+  per_walker.pin_threads = false;
+  return WalkDirectories(
+      roots, options, [&](int worker, std::vector<WalkedFile>* batch) {
+        std::vector<std::string> paths;
+        paths.reserve(batch->size());
+        for (auto& file : *batch) {
+          paths.push_back(std::move(file.path));
+        }
+        LoadFiles(paths, per_walker, [&](const LoadedFile& file) {
+          LoadedFile copy = file;
+          copy.worker = worker;
+          callback(copy);
+        });
+      });
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,67 @@
+#ifndef SGF_PARSER_DIR_WALKER_H_
+#define SGF_PARSER_DIR_WALKER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "sgf_parser/batch_loader.h"
+
+namespace sgf_parser {
+
+// A regular file found by WalkDirectories().
+struct WalkedFile {
+  std::string path;
+  uint64_t size;
+  uint64_t inode;
+};
+
+struct DirWalkerOptions {
+  // Threads which list directories.
+  int threads = 4;
+
+  // Only files ending with one of these extensions, compared ignoring case,
+  // are reported. Empty means all regular files.
+  std::vector<std::string> extensions = {".sgf"};
+
+  // Files are reported in batches of up to this many.
+  size_t batch_size = 4096;
+
+  // Sort every batch by inode number, which roughly follows the on-disk
+  // layout on many file systems and makes the following reads more local.
+  bool sort_by_inode = false;
+
+  // Buffer for getdents64(). Larger buffers mean fewer system calls for large
+  // directories.
+  size_t getdents_buffer_size = 256 << 10;
+};
+
+// Lists the trees under `roots` in parallel. Threads share a work queue of
+// directories; each reads its directory with getdents64() into a large buffer,
+// queues the subdirectories and collects matching files, with their sizes
+// from fstatat(). Symbolic links are not followed.
+//
+// `callback` is called concurrently from the walker threads, with the index of
+// the thread in [0, threads), and may modify or consume the batch. Returns
+// false if some directory could not be read; the walk continues past it.
+bool WalkDirectories(
+    const std::vector<std::string>& roots, const DirWalkerOptions& options,
+    const std::function<void(int worker, std::vector<WalkedFile>* batch)>&
+        callback);
+
+// Walks the trees and loads every batch with LoadFiles() on the walker thread
+// that found it, so enumeration and loading overlap. `loader.threads` and
+// `loader.pin_threads` are ignored: each walker thread loads with its own
+// ring. In the callback, LoadedFile::index is the index within the batch and
+// LoadedFile::worker the walker thread.
+bool WalkAndLoadFiles(const std::vector<std::string>& roots,
+                      const DirWalkerOptions& options,
+                      const BatchLoaderOptions& loader,
+                      const std::function<void(const LoadedFile&)>& callback);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_DIR_WALKER_H_
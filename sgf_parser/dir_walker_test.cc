@@ -0,0 +1,90 @@
+#include "sgf_parser/dir_walker.h"
+
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+class DirWalkerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+    const char* tmp = getenv("TEST_TMPDIR");
+    root_ = string(tmp != nullptr ? tmp : "/tmp") + "/dir_walker_test";
+    for (const char* dir : {"", "/a", "/a/b", "/a/b/c", "/d"}) {
+      mkdir((root_ + dir).c_str(), 0755);
+    }
+    for (const char* file : {"/1.sgf", "/a/2.SGF", "/a/b/3.sgf",
+                             "/a/b/c/4.sgf", "/d/5.sgf", "/d/6.txt"}) {
+      std::ofstream(root_ + file) << file;
+    }
+  }
+
+  string root_;
+};
+
+TEST_F(DirWalkerTest, FindsFilesWithSizes) {
+  DirWalkerOptions options;
+  options.threads = 3;
+  options.batch_size = 2;
+  options.sort_by_inode = true;
+  std::mutex mu;
+  std::map<string, uint64_t> found;
+  EXPECT_TRUE(WalkDirectories({root_}, options,
+                              [&](int, std::vector<WalkedFile>* batch) {
+    std::lock_guard<std::mutex> lock(mu);
+    EXPECT_LE(batch->size(), 2);
+    for (size_t i = 1; i < batch->size(); ++i) {
+      EXPECT_LE((*batch)[i - 1].inode, (*batch)[i].inode);
+    }
+    for (const auto& file : *batch) found[file.path] = file.size;
+  }));
+  const std::map<string, uint64_t> expected = {
+      {root_ + "/1.sgf", 6},       {root_ + "/a/2.SGF", 8},
+      {root_ + "/a/b/3.sgf", 10},  {root_ + "/a/b/c/4.sgf", 12},
+      {root_ + "/d/5.sgf", 8},
+  };
+  EXPECT_EQ(found, expected);
+}
+
+TEST_F(DirWalkerTest, AllFilesAndMissingRoot) {
+  DirWalkerOptions options;
+  options.extensions.clear();
+  int count = 0;
+  EXPECT_FALSE(WalkDirectories({root_ + "/d", root_ + "/missing"}, options,
+                               [&](int, std::vector<WalkedFile>* batch) {
+    count += batch->size();
+  }));
+  EXPECT_EQ(count, 2);
+}
+
+TEST_F(DirWalkerTest, WalkAndLoad) {
+  std::mutex mu;
+  std::map<string, string> contents;
+  DirWalkerOptions options;
+  options.threads = 2;
+  EXPECT_TRUE(WalkAndLoadFiles({root_ + "/a"}, options, BatchLoaderOptions(),
+                               [&](const LoadedFile& file) {
+    std::lock_guard<std::mutex> lock(mu);
+    EXPECT_EQ(file.error, 0);
+    EXPECT_LT(file.worker, 2);
+    contents[*file.filename] = string(file.contents);
+  }));
+  EXPECT_EQ(contents.size(), 3);
+  EXPECT_EQ(contents[root_ + "/a/b/3.sgf"], "/a/b/3.sgf");
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,101 @@
+// Converts SGF files to JSON Lines, a per-move CSV or GTP command streams, one
+// file per task on a thread pool. Every worker converts into its own buffer
+// and appends it to the output in large batches, so games of different files
+// may come out in any order, but the lines of one game stay together. Exits
+// with 1 if any file failed to parse or export.
+//
+// Usage:
+//   sgf_export --format=jsonl|csv|gtp --output=games.jsonl [--threads=N]
+//       [--file_list=files.txt] [file ...]
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/file_tasks.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/record_export.h"
+#include "sgf_parser/thread_pool.h"
+
+DEFINE_string(format, "jsonl", "Output format: jsonl, csv or gtp.");
+DEFINE_string(output, "", "Output file.");
+DEFINE_int32(threads, 0, "Worker threads, 0 for one per core.");
+DEFINE_string(file_list, "", "A file with one SGF file name per line.");
+
+namespace sgf_parser {
+namespace {
+
+enum class Format { JSONL, CSV, GTP };
+
+bool ExportFile(Format format, const std::string& filename,
+                FileWorker* worker) {
+  if (!worker->Parse(filename, ReadFileToString(filename))) return false;
+  switch (format) {
+    case Format::JSONL:
+      AppendJsonLine(worker->record, &worker->buffer);
+      break;
+    case Format::CSV:
+      AppendMovesCsv(worker->record, filename, &worker->buffer);
+      break;
+    case Format::GTP: {
+      const size_t size = worker->buffer.size();
+      worker->buffer.append("# ").append(filename).push_back('\n');
+      if (!AppendGtpCommands(worker->record, &worker->buffer)) {
+        LOG(ERROR) << filename << ": can't be written as GTP commands.";
+        worker->buffer.resize(size);
+        return false;
+      }
+      break;
+    }
+  }
+  return true;
+}
+
+bool ParseFormat(const std::string& name, Format* format) {
+  if (name == "jsonl") {
+    *format = Format::JSONL;
+  } else if (name == "csv") {
+    *format = Format::CSV;
+  } else if (name == "gtp") {
+    *format = Format::GTP;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+}  // namespace sgf_parser
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK(!FLAGS_output.empty()) << "--output is required.";
+  sgf_parser::Format format = sgf_parser::Format::JSONL;
+  CHECK(sgf_parser::ParseFormat(FLAGS_format, &format))
+      << "Unknown --format: " << FLAGS_format;
+
+  const std::vector<std::string> files =
+      sgf_parser::ReadInputFiles(argc, argv, FLAGS_file_list);
+
+  std::ofstream out(FLAGS_output, std::ios::binary);
+  CHECK(out) << "Failed to open " << FLAGS_output;
+  if (format == sgf_parser::Format::CSV) out << sgf_parser::kMovesCsvHeader;
+
+  int64_t failed;
+  {
+    sgf_parser::ThreadPool pool(FLAGS_threads);
+    sgf_parser::FileTaskRunner runner(&pool, &out);
+    failed = runner.Run(files, [format](const std::string& file,
+                                        sgf_parser::FileWorker* worker) {
+      return sgf_parser::ExportFile(format, file, worker);
+    });
+  }
+  out.close();
+  CHECK(out) << "Failed to write " << FLAGS_output;
+  LOG(INFO) << "Exported " << files.size() - failed << " of " << files.size()
+            << " files.";
+  return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,560 @@
+#include "sgf_parser/features.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using std::string;
+
+namespace {
+
+typedef internal::Bitboard Bits;
+
+constexpr int kStride = BitPosition::kStride;
+constexpr int kWords = BitPosition::kWords;
+constexpr int kPoints = kStride * BitPosition::kMaxBoardSize;
+
+// Ladders longer than this many moves count as escaped.
+constexpr int kMaxLadderDepth = 200;
+
+bool Test(const Bits& b, int bit) { return b.w[bit / 64] >> (bit % 64) & 1; }
+void Set(Bits* b, int bit) { b->w[bit / 64] |= uint64_t{1} << (bit % 64); }
+void Clear(Bits* b, int bit) { b->w[bit / 64] &= ~(uint64_t{1} << (bit % 64)); }
+
+Bits Point(int bit) {
+  Bits b;
+  Set(&b, bit);
+  return b;
+}
+
+Bits And(const Bits& a, const Bits& b) {
+  Bits r;
+  for (int i = 0; i < kWords; ++i) r.w[i] = a.w[i] & b.w[i];
+  return r;
+}
+
+Bits Or(const Bits& a, const Bits& b) {
+  Bits r;
+  for (int i = 0; i < kWords; ++i) r.w[i] = a.w[i] | b.w[i];
+  return r;
+}
+
+Bits AndNot(const Bits& a, const Bits& b) {
+  Bits r;
+  for (int i = 0; i < kWords; ++i) r.w[i] = a.w[i] & ~b.w[i];
+  return r;
+}
+
+bool Any(const Bits& b) {
+  uint64_t any = 0;
+  for (int i = 0; i < kWords; ++i) any |= b.w[i];
+  return any != 0;
+}
+
+bool Equal(const Bits& a, const Bits& b) {
+  uint64_t diff = 0;
+  for (int i = 0; i < kWords; ++i) diff |= a.w[i] ^ b.w[i];
+  return diff == 0;
+}
+
+int Count(const Bits& b) {
+  int count = 0;
+  for (int i = 0; i < kWords; ++i) count += __builtin_popcountll(b.w[i]);
+  return count;
+}
+
+// Calls `f` with every set bit.
+template <typename F>
+void ForEach(const Bits& b, F f) {
+  for (int i = 0; i < kWords; ++i) {
+    for (uint64_t word = b.w[i]; word != 0; word &= word - 1) {
+      f(i * 64 + __builtin_ctzll(word));
+    }
+  }
+}
+
+// Columns 0 and kStride - 1, which shifting by one point must not wrap into.
+struct ColumnMasks {
+  Bits not_first;
+  Bits not_last;
+
+  ColumnMasks() {
+    for (int i = 0; i < kWords; ++i) not_first.w[i] = not_last.w[i] = ~0ULL;
+    for (int y = 0; y < BitPosition::kMaxBoardSize; ++y) {
+      Clear(&not_first, y * kStride);
+      Clear(&not_last, y * kStride + kStride - 1);
+    }
+  }
+};
+
+// `b` and its four neighbors. Points off the board may be set; callers mask
+// them out.
+Bits Dilate(const Bits& b) {
+  static const ColumnMasks masks;
+  Bits r;
+  for (int i = 0; i < kWords; ++i) {
+    const uint64_t g = b.w[i];
+    const uint64_t prev = i > 0 ? b.w[i - 1] : 0;
+    const uint64_t next = i + 1 < kWords ? b.w[i + 1] : 0;
+    const uint64_t right = ((g << 1) | (prev >> 63)) & masks.not_first.w[i];
+    const uint64_t left = ((g >> 1) | (next << 63)) & masks.not_last.w[i];
+    const uint64_t down = (g << kStride) | (prev >> (64 - kStride));
+    const uint64_t up = (g >> kStride) | (next << (64 - kStride));
+    r.w[i] = g | right | left | down | up;
+  }
+  return r;
+}
+
+// The neighbors of `b`, without `b` itself.
+Bits Neighbors(const Bits& b) { return AndNot(Dilate(b), b); }
+
+// The group of `color` stones containing `bit`, by flood fill.
+Bits Flood(const Bits& color, int bit) {
+  Bits group = Point(bit);
+  while (true) {
+    const Bits grown = And(Dilate(group), color);
+    if (Equal(grown, group)) return group;
+    group = grown;
+  }
+}
+
+GoBoard::Stone Opponent(GoBoard::Stone color) {
+  return color == GoBoard::BLACK ? GoBoard::WHITE : GoBoard::BLACK;
+}
+
+// Zobrist keys for ladder positions, indexed by [point][color].
+const uint64_t* LadderKeys() {
+  static const std::vector<uint64_t>* keys = [] {
+    auto* v = new std::vector<uint64_t>(kPoints * 3);
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    for (auto& k : *v) {
+      // splitmix64.
+      uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      k = z ^ (z >> 31);
+    }
+    return v;
+  }();
+  return keys->data();
+}
+
+uint8_t CapLiberties(int liberties) {
+  return std::min(liberties, kMaxFeatureLiberties);
+}
+
+// Adds the time since it was created to a counter when destroyed.
+class ScopedTimer {
+ public:
+  explicit ScopedTimer(double* seconds)
+      : seconds_(seconds), start_(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    *seconds_ += std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_).count();
+  }
+
+ private:
+  double* const seconds_;
+  const std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace
+
+string FeatureTimings::DebugString() const {
+  const double n = std::max<int64_t>(positions, 1);
+  string debug;
+  absl::StrAppend(&debug, "Positions: ", positions, "\n");
+  absl::StrAppend(&debug, "Liberties: ", liberties_seconds / n * 1e6,
+                  " us per position\n");
+  absl::StrAppend(&debug, "Atari: ", atari_seconds / n * 1e6,
+                  " us per position\n");
+  absl::StrAppend(&debug, "Liberties after move: ",
+                  liberties_after_seconds / n * 1e6, " us per position\n");
+  absl::StrAppend(&debug, "Ladders: ", ladder_seconds / n * 1e6,
+                  " us per position, ", ladder_searches, " searches, ",
+                  ladder_nodes, " nodes, ", ladder_memo_hits, " memo hits\n");
+  return debug;
+}
+
+FeatureExtractor::FeatureExtractor() {
+  Reset(19);
+}
+
+void FeatureExtractor::Reset(GoCoord size) {
+  CHECK(size > 0 && size <= BitPosition::kMaxBoardSize)
+      << "Bad board size " << size;
+  size_ = size;
+  on_board_ = Bits();
+  for (int y = 0; y < size; ++y) {
+    for (int x = 0; x < size; ++x) Set(&on_board_, y * kStride + x);
+  }
+  for (auto& stones : stones_) stones = Bits();
+  group_of_.assign(kPoints, -1);
+  groups_.clear();
+  free_groups_.clear();
+  groups_valid_ = true;
+}
+
+GoBoard::Stone FeatureExtractor::At(GoPos pos) const {
+  const int bit = pos.second * kStride + pos.first;
+  if (Test(stones_[GoBoard::BLACK], bit)) return GoBoard::BLACK;
+  if (Test(stones_[GoBoard::WHITE], bit)) return GoBoard::WHITE;
+  return GoBoard::EMPTY;
+}
+
+FeatureExtractor::Bits FeatureExtractor::Empty() const {
+  return AndNot(on_board_, Or(stones_[GoBoard::BLACK], stones_[GoBoard::WHITE]));
+}
+
+bool FeatureExtractor::Setup(GoPos pos, GoBoard::Stone stone) {
+  if (pos.first < 0 || pos.first >= size_ || pos.second < 0 ||
+      pos.second >= size_) {
+    return false;
+  }
+  const int bit = pos.second * kStride + pos.first;
+  Clear(&stones_[GoBoard::BLACK], bit);
+  Clear(&stones_[GoBoard::WHITE], bit);
+  if (stone != GoBoard::EMPTY) Set(&stones_[stone], bit);
+  // Setup doesn't capture, so groups may merge or lose liberties in any way.
+  // It is rare enough to just rebuild the groups before they are needed.
+  groups_valid_ = false;
+  return true;
+}
+
+void FeatureExtractor::RebuildGroups() {
+  group_of_.assign(kPoints, -1);
+  groups_.clear();
+  free_groups_.clear();
+  const Bits empty = Empty();
+  for (const GoBoard::Stone color : {GoBoard::BLACK, GoBoard::WHITE}) {
+    ForEach(stones_[color], [&](int bit) {
+      if (group_of_[bit] >= 0) return;
+      const int g = NewGroup(color);
+      groups_[g].stones = Flood(stones_[color], bit);
+      groups_[g].liberties = And(Dilate(groups_[g].stones), empty);
+      ForEach(groups_[g].stones, [&](int stone) { group_of_[stone] = g; });
+    });
+  }
+  groups_valid_ = true;
+}
+
+int FeatureExtractor::NewGroup(GoBoard::Stone color) {
+  int g;
+  if (!free_groups_.empty()) {
+    g = free_groups_.back();
+    free_groups_.pop_back();
+  } else {
+    g = groups_.size();
+    groups_.emplace_back();
+  }
+  groups_[g] = Group();
+  groups_[g].color = color;
+  return g;
+}
+
+void FeatureExtractor::Capture(int group) {
+  const Bits stones = groups_[group].stones;
+  const GoBoard::Stone color = groups_[group].color;
+  stones_[color] = AndNot(stones_[color], stones);
+  ForEach(stones, [this](int bit) { group_of_[bit] = -1; });
+  groups_[group] = Group();
+  free_groups_.push_back(group);
+  // The stones around the captured ones gain liberties.
+  ForEach(And(Neighbors(stones), stones_[Opponent(color)]), [&](int bit) {
+    Group& neighbor = groups_[group_of_[bit]];
+    neighbor.liberties = Or(neighbor.liberties, And(Dilate(Point(bit)), stones));
+  });
+}
+
+bool FeatureExtractor::Play(const GoMove& move) {
+  if (move.pass) return true;
+  const GoPos& pos = move.move;
+  if (pos.first < 0 || pos.first >= size_ || pos.second < 0 ||
+      pos.second >= size_) {
+    return false;
+  }
+  const int bit = pos.second * kStride + pos.first;
+  if (!Test(Empty(), bit)) return false;
+  if (!groups_valid_) RebuildGroups();
+
+  const GoBoard::Stone color = static_cast<GoBoard::Stone>(move.player);
+  const GoBoard::Stone opponent = Opponent(color);
+  Set(&stones_[color], bit);
+  int g = NewGroup(color);
+  groups_[g].stones = Point(bit);
+  groups_[g].liberties = And(Dilate(groups_[g].stones), Empty());
+  group_of_[bit] = g;
+
+  const Bits neighbors = And(Neighbors(groups_[g].stones), on_board_);
+  ForEach(neighbors, [&](int n) {
+    const int h = group_of_[n];
+    if (h < 0 || h == g) return;
+    if (groups_[h].color == opponent) {
+      Clear(&groups_[h].liberties, bit);
+      return;
+    }
+    // Merge the smaller group into the larger one.
+    int from = h, into = g;
+    if (Count(groups_[h].stones) > Count(groups_[g].stones)) std::swap(from, into);
+    groups_[into].stones = Or(groups_[into].stones, groups_[from].stones);
+    groups_[into].liberties =
+        Or(groups_[into].liberties, groups_[from].liberties);
+    ForEach(groups_[from].stones, [&](int stone) { group_of_[stone] = into; });
+    groups_[from] = Group();
+    free_groups_.push_back(from);
+    g = into;
+  });
+  Clear(&groups_[g].liberties, bit);
+
+  ForEach(neighbors, [&](int n) {
+    const int h = group_of_[n];
+    if (h >= 0 && groups_[h].color == opponent &&
+        !Any(groups_[h].liberties)) {
+      Capture(h);
+    }
+  });
+  if (!Any(groups_[g].liberties)) Capture(g);  // Suicide.
+  return true;
+}
+
+bool FeatureExtractor::LadderPlay(LadderBoard* board, int point,
+                                  GoBoard::Stone color) const {
+  const Bits occupied = Or(board->stones[GoBoard::BLACK],
+                           board->stones[GoBoard::WHITE]);
+  if (Test(occupied, point) || !Test(on_board_, point)) return false;
+  const uint64_t* keys = LadderKeys();
+  const GoBoard::Stone opponent = Opponent(color);
+  Set(&board->stones[color], point);
+  board->hash ^= keys[point * 3 + color];
+
+  Bits empty = AndNot(on_board_, Or(occupied, Point(point)));
+  Bits checked;
+  ForEach(And(Dilate(Point(point)), board->stones[opponent]), [&](int n) {
+    if (Test(checked, n)) return;
+    const Bits group = Flood(board->stones[opponent], n);
+    checked = Or(checked, group);
+    if (Any(And(Dilate(group), empty))) return;
+    board->stones[opponent] = AndNot(board->stones[opponent], group);
+    ForEach(group, [&](int stone) { board->hash ^= keys[stone * 3 + opponent]; });
+    empty = Or(empty, group);
+  });
+  // No suicides while reading ladders.
+  return Any(And(Dilate(Flood(board->stones[color], point)), empty));
+}
+
+// The defender's group is in atari and the defender is to move: it can
+// capture an attacking group in atari next to it, or extend. Either works if
+// the attacker then can't capture it.
+bool FeatureExtractor::DefenderCaptured(const LadderBoard& board, int stone,
+                                        int depth) {
+  if (depth >= kMaxLadderDepth) return false;
+  ++timings_.ladder_nodes;
+  const uint64_t key = board.hash ^ LadderKeys()[stone * 3] ^ 1;
+  const auto it = ladder_memo_.find(key);
+  if (it != ladder_memo_.end()) {
+    ++timings_.ladder_memo_hits;
+    return it->second;
+  }
+
+  const GoBoard::Stone defender =
+      Test(board.stones[GoBoard::BLACK], stone) ? GoBoard::BLACK
+                                                : GoBoard::WHITE;
+  const GoBoard::Stone attacker = Opponent(defender);
+  const Bits empty = AndNot(on_board_, Or(board.stones[GoBoard::BLACK],
+                                          board.stones[GoBoard::WHITE]));
+  const Bits group = Flood(board.stones[defender], stone);
+  const Bits liberties = And(Dilate(group), empty);
+  if (Count(liberties) >= 2) return false;
+
+  // Moves which may save the group: its liberty, and the last liberty of
+  // every attacking group next to it.
+  Bits moves = liberties;
+  Bits checked;
+  ForEach(And(Dilate(group), board.stones[attacker]), [&](int n) {
+    if (Test(checked, n)) return;
+    const Bits attackers = Flood(board.stones[attacker], n);
+    checked = Or(checked, attackers);
+    const Bits attacker_liberties = And(Dilate(attackers), empty);
+    if (Count(attacker_liberties) == 1) moves = Or(moves, attacker_liberties);
+  });
+
+  bool captured = true;
+  ForEach(moves, [&](int move) {
+    if (!captured) return;
+    LadderBoard next = board;
+    if (LadderPlay(&next, move, defender) &&
+        !AttackerCaptures(next, stone, depth + 1)) {
+      captured = false;
+    }
+  });
+  ladder_memo_[key] = captured;
+  return captured;
+}
+
+// The attacker is to move. A group with one liberty is captured and one with
+// three or more escapes; with two, the attacker tries both as ataris.
+bool FeatureExtractor::AttackerCaptures(const LadderBoard& board, int stone,
+                                        int depth) {
+  if (depth >= kMaxLadderDepth) return false;
+  ++timings_.ladder_nodes;
+  const uint64_t key = board.hash ^ LadderKeys()[stone * 3] ^ 2;
+  const auto it = ladder_memo_.find(key);
+  if (it != ladder_memo_.end()) {
+    ++timings_.ladder_memo_hits;
+    return it->second;
+  }
+
+  const GoBoard::Stone defender =
+      Test(board.stones[GoBoard::BLACK], stone) ? GoBoard::BLACK
+                                                : GoBoard::WHITE;
+  const GoBoard::Stone attacker = Opponent(defender);
+  const Bits empty = AndNot(on_board_, Or(board.stones[GoBoard::BLACK],
+                                          board.stones[GoBoard::WHITE]));
+  const Bits liberties =
+      And(Dilate(Flood(board.stones[defender], stone)), empty);
+  const int count = Count(liberties);
+
+  bool captured = count <= 1;
+  if (count == 2) {
+    ForEach(liberties, [&](int move) {
+      if (captured) return;
+      LadderBoard next = board;
+      if (LadderPlay(&next, move, attacker) &&
+          DefenderCaptured(next, stone, depth + 1)) {
+        captured = true;
+      }
+    });
+  }
+  ladder_memo_[key] = captured;
+  return captured;
+}
+
+void FeatureExtractor::Compute(GoMove::Color to_move,
+                               PositionFeatures* features) {
+  if (!groups_valid_) RebuildGroups();
+  ++timings_.positions;
+  const int points = size_ * size_;
+  features->size = size_;
+  features->to_move = to_move;
+  features->liberties.assign(points, 0);
+  features->atari.assign(points, 0);
+  features->liberties_after.assign(points, 0);
+  features->ladder_capture.assign(points, 0);
+  features->ladder_escape.assign(points, 0);
+  const auto index = [this](int bit) {
+    return bit / kStride * size_ + bit % kStride;
+  };
+
+  {
+    ScopedTimer timer(&timings_.liberties_seconds);
+    for (const auto color : {GoBoard::BLACK, GoBoard::WHITE}) {
+      ForEach(stones_[color], [&](int bit) {
+        features->liberties[index(bit)] =
+            CapLiberties(Count(groups_[group_of_[bit]].liberties));
+      });
+    }
+  }
+  {
+    ScopedTimer timer(&timings_.atari_seconds);
+    for (int i = 0; i < points; ++i) {
+      features->atari[i] = features->liberties[i] == 1;
+    }
+  }
+
+  const GoBoard::Stone player = static_cast<GoBoard::Stone>(to_move);
+  const GoBoard::Stone opponent = Opponent(player);
+  const Bits empty = Empty();
+  {
+    ScopedTimer timer(&timings_.liberties_after_seconds);
+    ForEach(empty, [&](int bit) {
+      Bits stones = Point(bit);
+      Bits freed;   // Opponent stones the move captures.
+      ForEach(And(Dilate(stones), Or(stones_[player], stones_[opponent])),
+              [&](int n) {
+        const Group& group = groups_[group_of_[n]];
+        if (group.color == player) {
+          stones = Or(stones, group.stones);
+        } else if (Count(group.liberties) == 1) {
+          freed = Or(freed, group.stones);
+        }
+      });
+      const Bits liberties =
+          AndNot(And(Dilate(stones), Or(empty, freed)), Point(bit));
+      features->liberties_after[index(bit)] = CapLiberties(Count(liberties));
+    });
+  }
+
+  {
+    ScopedTimer timer(&timings_.ladder_seconds);
+    ladder_memo_.clear();
+    LadderBoard root;
+    root.stones[GoBoard::BLACK] = stones_[GoBoard::BLACK];
+    root.stones[GoBoard::WHITE] = stones_[GoBoard::WHITE];
+    const uint64_t* keys = LadderKeys();
+    for (const auto color : {GoBoard::BLACK, GoBoard::WHITE}) {
+      ForEach(stones_[color], [&](int bit) {
+        root.hash ^= keys[bit * 3 + color];
+      });
+    }
+
+    // Only liberties of groups with one or two liberties can start a ladder.
+    Bits starts;
+    for (const Group& group : groups_) {
+      if (group.color == GoBoard::EMPTY) continue;  // Free.
+      const int count = Count(group.liberties);
+      if ((group.color == opponent && count == 2) ||
+          (group.color == player && count == 1)) {
+        starts = Or(starts, group.liberties);
+      }
+    }
+    ForEach(starts, [&](int bit) {
+      if (features->liberties_after[index(bit)] == 0) return;
+      LadderBoard next = root;
+      if (!LadderPlay(&next, bit, player)) return;
+      ForEach(And(Dilate(Point(bit)), Or(stones_[player], stones_[opponent])),
+              [&](int n) {
+        const Group& group = groups_[group_of_[n]];
+        const int count = Count(group.liberties);
+        if (group.color == opponent && count == 2 &&
+            Test(group.liberties, bit) && Test(next.stones[opponent], n) &&
+            !features->ladder_capture[index(bit)]) {
+          ++timings_.ladder_searches;
+          features->ladder_capture[index(bit)] =
+              DefenderCaptured(next, n, 0);
+        } else if (group.color == player && count == 1 &&
+                   !features->ladder_escape[index(bit)]) {
+          ++timings_.ladder_searches;
+          features->ladder_escape[index(bit)] =
+              !AttackerCaptures(next, bit, 0);
+        }
+      });
+    });
+  }
+}
+
+bool ComputeGameFeatures(const GameRecord& record, FeatureExtractor* extractor,
+                         const FeatureVisitor& visit) {
+  const GoCoord size = GetBoardSize(record);
+  if (size > BitPosition::kMaxBoardSize) return false;
+  extractor->Reset(size);
+  for (const auto& pos : record.black_stones) {
+    extractor->Setup(pos, GoBoard::BLACK);
+  }
+  for (const auto& pos : record.white_stones) {
+    extractor->Setup(pos, GoBoard::WHITE);
+  }
+  PositionFeatures features;
+  for (size_t i = 0; i < record.moves.size(); ++i) {
+    const GoMove& move = record.moves[i];
+    extractor->Compute(move.player, &features);
+    visit(i, features);
+    extractor->Play(move);
+  }
+  return true;
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,149 @@
+#ifndef SGF_PARSER_FEATURES_H_
+#define SGF_PARSER_FEATURES_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "sgf_parser/batch_replay.h"
+#include "sgf_parser/board.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+namespace internal {
+
+// A set of points, bit y * BitPosition::kStride + x.
+struct Bitboard {
+  uint64_t w[BitPosition::kWords] = {};
+};
+
+}  // namespace internal
+
+// Liberty counts in features are capped at this.
+constexpr int kMaxFeatureLiberties = 8;
+
+// Features of a position for the player to move. Every vector has a value per
+// point, indexed by y * size + x.
+struct PositionFeatures {
+  GoCoord size = 0;
+  GoMove::Color to_move = GoMove::BLACK;
+
+  // Liberties of the group on a point, 0 for empty points.
+  std::vector<uint8_t> liberties;
+
+  // 1 for stones whose group has a single liberty.
+  std::vector<uint8_t> atari;
+
+  // For empty points, the liberties of the player's group there after playing
+  // it, or 0 if it would be a suicide. 0 for stones.
+  std::vector<uint8_t> liberties_after;
+
+  // 1 for empty points where playing ataris an opponent group which can't
+  // escape a ladder.
+  std::vector<uint8_t> ladder_capture;
+
+  // 1 for empty points where playing extends a group of the player in atari
+  // out of a ladder.
+  std::vector<uint8_t> ladder_escape;
+};
+
+// Time spent on each feature, summed over the positions computed.
+struct FeatureTimings {
+  int64_t positions = 0;
+  double liberties_seconds = 0;
+  double atari_seconds = 0;
+  double liberties_after_seconds = 0;
+  double ladder_seconds = 0;
+  int64_t ladder_searches = 0;      // Ladders read from the root.
+  int64_t ladder_nodes = 0;         // Positions visited while reading.
+  int64_t ladder_memo_hits = 0;     // Positions answered from the memo.
+
+  // Per position costs, one feature per line.
+  std::string DebugString() const;
+};
+
+// Computes PositionFeatures while a game is replayed. It keeps a cache of the
+// groups on the board and their liberties, as bitboards, which Play() updates
+// incrementally, so features don't need a flood fill per point. Ladders are
+// read on bitboard copies of the position, with a memo of the positions seen,
+// keyed by Zobrist hash, shared by all the ladders read from one position.
+//
+// Boards up to 19x19 are supported. Play() follows GoBoard::Play().
+class FeatureExtractor {
+ public:
+  FeatureExtractor();
+
+  FeatureExtractor(const FeatureExtractor&) = delete;
+  FeatureExtractor& operator=(const FeatureExtractor&) = delete;
+
+  // Clears the board and sets its size, which must be at most 19.
+  void Reset(GoCoord size);
+
+  GoCoord size() const { return size_; }
+
+  GoBoard::Stone At(GoPos pos) const;
+
+  // Like GoBoard::Setup().
+  bool Setup(GoPos pos, GoBoard::Stone stone);
+
+  // Like GoBoard::Play().
+  bool Play(const GoMove& move);
+
+  void Compute(GoMove::Color to_move, PositionFeatures* features);
+
+  const FeatureTimings& timings() const { return timings_; }
+
+ private:
+  typedef internal::Bitboard Bits;
+
+  struct Group {
+    Bits stones;
+    Bits liberties;
+    GoBoard::Stone color = GoBoard::EMPTY;
+  };
+
+  // A position ladders are read on.
+  struct LadderBoard {
+    Bits stones[3];     // Indexed by GoBoard::Stone; EMPTY is unused.
+    uint64_t hash = 0;
+  };
+
+  void RebuildGroups();
+  int NewGroup(GoBoard::Stone color);
+  void Capture(int group);
+  Bits Empty() const;
+
+  // Ladder reading. `stone` is any stone of the group being chased.
+  bool LadderPlay(LadderBoard* board, int point, GoBoard::Stone color) const;
+  bool DefenderCaptured(const LadderBoard& board, int stone, int depth);
+  bool AttackerCaptures(const LadderBoard& board, int stone, int depth);
+
+  GoCoord size_ = 0;
+  Bits on_board_;
+  Bits stones_[3];                    // Indexed by GoBoard::Stone.
+  std::vector<int16_t> group_of_;     // Group index per point, -1 if empty.
+  std::vector<Group> groups_;
+  std::vector<int> free_groups_;
+  bool groups_valid_ = true;          // False after Setup().
+
+  absl::flat_hash_map<uint64_t, bool> ladder_memo_;
+  FeatureTimings timings_;
+};
+
+// Called before every move of a game with the move's index and the features of
+// the position for the player making it.
+typedef std::function<void(int move, const PositionFeatures& features)>
+    FeatureVisitor;
+
+// Replays `record` like ReplayRecord, computing features before every move.
+// Returns false, without calling `visit`, if the board is larger than 19x19.
+bool ComputeGameFeatures(const GameRecord& record, FeatureExtractor* extractor,
+                         const FeatureVisitor& visit);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_FEATURES_H_
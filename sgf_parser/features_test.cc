@@ -0,0 +1,201 @@
+#include "sgf_parser/features.h"
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+// Liberties of the group at `pos` on `board`, by a plain flood fill.
+int BoardLiberties(const GoBoard& board, GoPos pos) {
+  const GoBoard::Stone color = board.At(pos);
+  std::vector<bool> seen(board.width() * board.height());
+  std::vector<bool> liberty(board.width() * board.height());
+  std::vector<GoPos> stack = {pos};
+  seen[pos.second * board.width() + pos.first] = true;
+  int liberties = 0;
+  while (!stack.empty()) {
+    const GoPos p = stack.back();
+    stack.pop_back();
+    for (const GoPos& n : {GoPos(p.first - 1, p.second), GoPos(p.first + 1, p.second),
+                           GoPos(p.first, p.second - 1), GoPos(p.first, p.second + 1)}) {
+      if (!board.OnBoard(n)) continue;
+      const int i = n.second * board.width() + n.first;
+      if (board.At(n) == GoBoard::EMPTY) {
+        if (!liberty[i]) ++liberties;
+        liberty[i] = true;
+      } else if (board.At(n) == color && !seen[i]) {
+        seen[i] = true;
+        stack.push_back(n);
+      }
+    }
+  }
+  return std::min(liberties, kMaxFeatureLiberties);
+}
+
+// Checks the liberty features of every position against GoBoard.
+void ExpectSameAsBoard(const GameRecord& record) {
+  const GoCoord size = GetBoardSize(record);
+  GoBoard board(size, size);
+  for (const auto& pos : record.black_stones) board.Setup(pos, GoBoard::BLACK);
+  for (const auto& pos : record.white_stones) board.Setup(pos, GoBoard::WHITE);
+  FeatureExtractor extractor;
+  int positions = 0;
+  ASSERT_TRUE(ComputeGameFeatures(record, &extractor,
+      [&](int move, const PositionFeatures& features) {
+    ASSERT_EQ(move, positions++);
+    ASSERT_EQ(features.size, size);
+    ASSERT_EQ(features.to_move, record.moves[move].player);
+    for (GoCoord y = 0; y < size; ++y) {
+      for (GoCoord x = 0; x < size; ++x) {
+        const int i = y * size + x;
+        ASSERT_EQ(extractor.At({x, y}), board.At({x, y}));
+        if (board.At({x, y}) != GoBoard::EMPTY) {
+          const int liberties = BoardLiberties(board, {x, y});
+          ASSERT_EQ(features.liberties[i], liberties)
+              << "move " << move << " at " << x << "," << y;
+          ASSERT_EQ(features.atari[i], liberties == 1);
+          ASSERT_EQ(features.liberties_after[i], 0);
+          ASSERT_EQ(features.ladder_capture[i], 0);
+          ASSERT_EQ(features.ladder_escape[i], 0);
+          continue;
+        }
+        ASSERT_EQ(features.liberties[i], 0);
+        GoBoard after = board.Snapshot();
+        after.Play(GoMove(features.to_move, false, {x, y}));
+        const int expected = after.At({x, y}) == GoBoard::EMPTY
+                                 ? 0 : BoardLiberties(after, {x, y});
+        ASSERT_EQ(features.liberties_after[i], expected)
+            << "move " << move << " at " << x << "," << y;
+      }
+    }
+    const GoMove& next = record.moves[move];
+    if (!next.pass && !board.OnBoard(next.move)) return;
+    board.Play(next);
+  }));
+  EXPECT_EQ(positions, record.moves.size());
+}
+
+// A game of random moves in a corner, so there are many captures and
+// suicides.
+GameRecord RandomGame(std::mt19937* rng, GoCoord size, int moves) {
+  GameRecord record;
+  record.board_width = record.board_height = size;
+  std::uniform_int_distribution<int> coord(0, std::min<int>(size, 6) - 1);
+  std::uniform_int_distribution<int> percent(0, 99);
+  if (percent(*rng) < 30) {
+    record.black_stones.emplace_back(coord(*rng), coord(*rng));
+    record.white_stones.emplace_back(coord(*rng), coord(*rng));
+  }
+  for (int i = 0; i < moves; ++i) {
+    const GoMove::Color color = i % 2 == 0 ? GoMove::BLACK : GoMove::WHITE;
+    const int kind = percent(*rng);
+    if (kind < 3) {
+      record.moves.emplace_back(color, true, GoPos(-1, -1));
+    } else if (kind < 5) {
+      record.moves.emplace_back(color, false, GoPos(size, size));
+    } else {
+      record.moves.emplace_back(color, false, GoPos(coord(*rng), coord(*rng)));
+    }
+  }
+  return record;
+}
+
+// Features of a position given as rows of ".XO".
+PositionFeatures Features(const std::vector<std::string>& rows,
+                          GoMove::Color to_move, FeatureExtractor* extractor) {
+  extractor->Reset(rows.size());
+  for (size_t y = 0; y < rows.size(); ++y) {
+    for (size_t x = 0; x < rows[y].size(); ++x) {
+      if (rows[y][x] == 'X') extractor->Setup(GoPos(x, y), GoBoard::BLACK);
+      if (rows[y][x] == 'O') extractor->Setup(GoPos(x, y), GoBoard::WHITE);
+    }
+  }
+  PositionFeatures features;
+  extractor->Compute(to_move, &features);
+  return features;
+}
+
+class FeaturesTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(FeaturesTest, Liberties) {
+  std::mt19937 rng(11);
+  for (const GoCoord size : {19, 9, 7, 5, 2, 1}) {
+    for (int i = 0; i < 5; ++i) {
+      ExpectSameAsBoard(RandomGame(&rng, size, 120));
+    }
+  }
+}
+
+TEST_F(FeaturesTest, TestData) {
+  for (const char* file : {"testdata/handicapped.sgf",
+                           "testdata/resigned.sgf"}) {
+    GameRecord record;
+    ASSERT_TRUE(SimpleParseSgf(ReadFileToString(file), &record, nullptr,
+                               nullptr)) << file;
+    ExpectSameAsBoard(record);
+  }
+}
+
+TEST_F(FeaturesTest, Ladder) {
+  // Black ataris white's stone from above at C3 and it runs down and right
+  // until the edge. An atari from the right at D4 works too, toward the top
+  // left corner.
+  std::vector<std::string> rows = {
+      ".........",
+      ".........",
+      "...X.....",
+      ".XO......",
+      "..X......",
+      ".........",
+      ".........",
+      ".........",
+      ".........",
+  };
+  FeatureExtractor extractor;
+  PositionFeatures features = Features(rows, GoMove::BLACK, &extractor);
+  EXPECT_EQ(features.atari[3 * 9 + 2], 0);
+  EXPECT_EQ(features.liberties[3 * 9 + 2], 2);
+  EXPECT_EQ(features.ladder_capture[2 * 9 + 2], 1);
+  EXPECT_EQ(features.ladder_capture[3 * 9 + 3], 1);
+  EXPECT_EQ(std::count(features.ladder_capture.begin(),
+                       features.ladder_capture.end(), 1), 2);
+
+  // A white stone on the diagonal breaks the first ladder only.
+  rows[7][7] = 'O';
+  features = Features(rows, GoMove::BLACK, &extractor);
+  EXPECT_EQ(features.ladder_capture[2 * 9 + 2], 0);
+  EXPECT_EQ(features.ladder_capture[3 * 9 + 3], 1);
+
+  // After the atari from above, white extending doesn't help, unless the
+  // breaker is there.
+  rows[2][2] = 'X';
+  features = Features(rows, GoMove::WHITE, &extractor);
+  EXPECT_EQ(features.atari[3 * 9 + 2], 1);
+  EXPECT_EQ(features.ladder_escape[3 * 9 + 3], 1);
+  rows[7][7] = '.';
+  features = Features(rows, GoMove::WHITE, &extractor);
+  EXPECT_EQ(features.ladder_escape[3 * 9 + 3], 0);
+  EXPECT_EQ(std::count(features.ladder_escape.begin(),
+                       features.ladder_escape.end(), 1), 0);
+
+  const FeatureTimings& timings = extractor.timings();
+  EXPECT_EQ(timings.positions, 4);
+  EXPECT_EQ(timings.ladder_searches, 6);
+  EXPECT_GT(timings.ladder_nodes, 20);
+  EXPECT_GT(timings.ladder_seconds, 0);
+  EXPECT_NE(timings.DebugString().find("Ladders: "), std::string::npos);
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,70 @@
+#include "sgf_parser/file_tasks.h"
+
+#include <atomic>
+#include <fstream>
+
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+namespace {
+
+// A worker writes its buffer out once it grows past this.
+constexpr size_t kFlushBytes = 1 << 20;
+
+}  // namespace
+
+std::vector<std::string> ReadInputFiles(int argc, char* argv[],
+                                        const std::string& file_list) {
+  std::vector<std::string> files(argv + 1, argv + argc);
+  if (file_list.empty()) return files;
+  std::ifstream list(file_list);
+  CHECK(list) << "Failed to open " << file_list;
+  std::string line;
+  while (std::getline(list, line)) {
+    if (!line.empty()) files.push_back(line);
+  }
+  CHECK(list.eof()) << "Failed to read " << file_list;
+  return files;
+}
+
+bool FileWorker::Parse(const std::string& filename, absl::string_view sgf) {
+  std::string errors;
+  if (!parser.Parse(sgf, &record, nullptr, &errors)) {
+    LOG(ERROR) << filename << ": " << errors.substr(0, errors.find('\n'));
+    return false;
+  }
+  return true;
+}
+
+FileTaskRunner::FileTaskRunner(ThreadPool* pool, std::ostream* out)
+    : pool_(pool), out_(out) {
+  for (int i = 0; i < pool->num_threads(); ++i) {
+    workers_.emplace_back(new FileWorker());
+  }
+}
+
+int64_t FileTaskRunner::Run(const std::vector<std::string>& files,
+                            const FileTask& task) {
+  std::atomic<int64_t> failed{0};
+  for (size_t i = 0; i < files.size(); ++i) {
+    pool_->Schedule([this, &task, &failed, &files, i]() {
+      FileWorker* worker = workers_[pool_->CurrentWorker()].get();
+      worker->file_index = i;
+      if (!task(files[i], worker)) ++failed;
+      if (worker->buffer.size() >= kFlushBytes) Flush(&worker->buffer);
+    });
+  }
+  pool_->Wait();
+  for (const auto& worker : workers_) Flush(&worker->buffer);
+  return failed;
+}
+
+void FileTaskRunner::Flush(std::string* buffer) {
+  if (buffer->empty()) return;
+  std::lock_guard<std::mutex> lock(mu_);
+  if (out_ != nullptr) out_->write(buffer->data(), buffer->size());
+  buffer->clear();
+}
+
+}  // namespace sgf_parser
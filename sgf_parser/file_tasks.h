@@ -0,0 +1,72 @@
+#ifndef SGF_PARSER_FILE_TASKS_H_
+#define SGF_PARSER_FILE_TASKS_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/thread_pool.h"
+
+namespace sgf_parser {
+
+// The input files of a command line tool: the arguments after argv[0], then
+// the non-empty lines of `file_list` unless it is empty. Dies if the list can't
+// be read.
+std::vector<std::string> ReadInputFiles(int argc, char* argv[],
+                                        const std::string& file_list);
+
+// What a worker keeps from file to file: a parser and a record, whose buffers
+// grow to fit the largest game, and its share of the output.
+struct FileWorker {
+  // Index, in the files passed to FileTaskRunner::Run, of the file the task is
+  // on. Lets tasks order their results the same way on every run.
+  int64_t file_index = -1;
+  SgfParser parser;
+  GameRecord record;
+  std::string buffer;
+
+  // Parses `sgf`, the contents of `filename`, into `record`. Logs the first
+  // error and returns false if it fails.
+  bool Parse(const std::string& filename, absl::string_view sgf);
+};
+
+// Runs a task per file on a thread pool, every worker with its own FileWorker.
+// What tasks append to FileWorker::buffer goes to a shared output in batches of
+// about a megabyte, so the output of one file stays together, but files come
+// out in any order.
+class FileTaskRunner {
+ public:
+  // Returns false to count the file as failed.
+  typedef std::function<bool(const std::string& filename, FileWorker* worker)>
+      FileTask;
+
+  // `out` may be null if the tasks write nothing.
+  FileTaskRunner(ThreadPool* pool, std::ostream* out);
+
+  FileTaskRunner(const FileTaskRunner&) = delete;
+  FileTaskRunner& operator=(const FileTaskRunner&) = delete;
+
+  // Runs `task` for every file, waits for them and writes out what is left in
+  // the buffers. Returns the number of files the task failed on. Must not be
+  // called from a worker.
+  int64_t Run(const std::vector<std::string>& files, const FileTask& task);
+
+ private:
+  void Flush(std::string* buffer);
+
+  ThreadPool* const pool_;
+  std::vector<std::unique_ptr<FileWorker>> workers_;
+  std::mutex mu_;
+  std::ostream* const out_;   // Guarded by mu_.
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_FILE_TASKS_H_
@@ -0,0 +1,64 @@
+#include "sgf_parser/file_tasks.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+string TempFile(const string& name) {
+  const char* tmp = getenv("TEST_TMPDIR");
+  return string(tmp != nullptr ? tmp : "/tmp") + "/file_tasks_test_" + name;
+}
+
+TEST(FileTasksTest, ReadInputFiles) {
+  const string list = TempFile("list");
+  std::ofstream(list) << "c.sgf\n\nd.sgf\n";
+  char arg0[] = "tool", arg1[] = "a.sgf", arg2[] = "b.sgf";
+  char* argv[] = {arg0, arg1, arg2};
+  EXPECT_EQ(ReadInputFiles(3, argv, ""),
+            std::vector<string>({"a.sgf", "b.sgf"}));
+  EXPECT_EQ(ReadInputFiles(3, argv, list),
+            std::vector<string>({"a.sgf", "b.sgf", "c.sgf", "d.sgf"}));
+  EXPECT_EQ(ReadInputFiles(1, argv, list),
+            std::vector<string>({"c.sgf", "d.sgf"}));
+  remove(list.c_str());
+}
+
+TEST(FileTasksTest, Run) {
+  std::vector<string> files;
+  for (int i = 0; i < 50; ++i) {
+    files.push_back(TempFile(std::to_string(i)));
+    std::ofstream(files.back())
+        << (i % 10 == 0 ? "(;B[aa" : "(;SZ[19];B[aa];W[bb])");
+  }
+  ThreadPool pool(3);
+  std::stringstream out;
+  FileTaskRunner runner(&pool, &out);
+  const int64_t failed =
+      runner.Run(files, [&files](const string& file, FileWorker* worker) {
+        EXPECT_EQ(file, files[worker->file_index]);
+        if (!worker->Parse(file, ReadFileToString(file))) return false;
+        worker->buffer.append(std::to_string(worker->record.moves.size()))
+            .append("\n");
+        return true;
+      });
+  EXPECT_EQ(failed, 5);
+  string expected;
+  for (int i = 0; i < 45; ++i) expected += "2\n";
+  EXPECT_EQ(out.str(), expected);
+  for (const auto& file : files) remove(file.c_str());
+}
+
+}  // namespace
+}  // namespace sgf_parser
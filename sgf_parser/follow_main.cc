@@ -0,0 +1,89 @@
+// Follows a live game which is being appended to an SGF file. Waits for
+// changes with inotify, applies the appended moves with SgfFollower and logs
+// every new move with the time it took to read and apply it. Exits when the
+// game ends, the file is removed, or nothing changes for --timeout seconds.
+//
+// Usage:
+//   sgf_follow [--timeout=600] game.sgf
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <string>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/follower.h"
+
+DEFINE_int32(timeout, 600,
+             "Stop after this many seconds without a change, 0 for never.");
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK_EQ(argc, 2) << "Usage: sgf_follow [--timeout=600] game.sgf";
+  const std::string filename = argv[1];
+
+  const int inotify = inotify_init1(IN_CLOEXEC);
+  PCHECK(inotify >= 0) << "inotify_init1";
+  PCHECK(inotify_add_watch(inotify, filename.c_str(),
+                           IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF) >= 0)
+      << "Can't watch " << filename;
+
+  sgf_parser::SgfFollower follower;
+  std::string errors;
+  CHECK(follower.Open(filename, &errors)) << errors;
+
+  // Set when the file is removed or renamed. The follower still has it open,
+  // so one more Poll() picks up what was written before that. That open file
+  // also keeps IN_DELETE_SELF from coming, so a removal shows up as IN_ATTRIB
+  // (the link count) and is checked with stat().
+  bool gone = false;
+  while (true) {
+    const auto start = std::chrono::steady_clock::now();
+    const int added = follower.Poll(&errors);
+    const auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    CHECK_GE(added, 0) << errors;
+    const auto& moves = follower.record().moves;
+    for (size_t i = moves.size() - added; i < moves.size(); ++i) {
+      const sgf_parser::GoMove& move = moves[i];
+      LOG(INFO) << "Move " << i + 1 << ": "
+                << (move.player == sgf_parser::GoMove::BLACK ? "B" : "W")
+                << (move.pass ? " pass" : "") << " [" << move.move.first << ","
+                << move.move.second << "], applied in " << elapsed.count()
+                << " us";
+    }
+    if (follower.finished() || gone) break;
+
+    struct pollfd wait = {inotify, POLLIN, 0};
+    const int ready = poll(&wait, 1, FLAGS_timeout > 0 ? FLAGS_timeout * 1000
+                                                        : -1);
+    PCHECK(ready >= 0) << "poll";
+    if (ready == 0) {
+      LOG(INFO) << "No change for " << FLAGS_timeout << " seconds.";
+      break;
+    }
+    alignas(struct inotify_event) char events[4096];
+    const ssize_t n = read(inotify, events, sizeof(events));
+    PCHECK(n > 0) << "read";
+    for (ssize_t p = 0; p < n;) {
+      const auto* event = reinterpret_cast<const struct inotify_event*>(
+          events + p);
+      struct stat st;
+      if ((event->mask & IN_MOVE_SELF) ||
+          ((event->mask & IN_ATTRIB) && stat(filename.c_str(), &st) != 0)) {
+        gone = true;
+      }
+      p += sizeof(struct inotify_event) + event->len;
+    }
+  }
+
+  LOG(INFO) << (follower.finished() ? "The game ended" : "Stopped")
+            << " after " << follower.record().moves.size() << " moves.";
+  close(inotify);
+  return 0;
+}
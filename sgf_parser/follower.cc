@@ -0,0 +1,279 @@
+#include "sgf_parser/follower.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using std::string;
+
+namespace {
+
+// Bytes read from the file at a time.
+constexpr size_t kReadBytes = 64 << 10;
+
+// Consumed input is dropped from the buffer once there is this much of it.
+constexpr size_t kCompactBytes = 64 << 10;
+
+enum class Scan { FOUND, MORE, BAD };
+
+// Like internal::FindFirst() of a structural character: skips whitespace and
+// escaped characters up to one of `targets`, at *pos. MORE if the input ends
+// first, with *pos where scanning can resume.
+Scan SkipTo(absl::string_view text, absl::string_view targets, size_t* pos) {
+  size_t p = *pos;
+  for (; p < text.size(); ++p) {
+    const char c = text[p];
+    if (c == '\\') {
+      if (p + 1 == text.size()) break;
+      ++p;
+    } else if (targets.find(c) != absl::string_view::npos) {
+      *pos = p;
+      return Scan::FOUND;
+    } else if (!absl::ascii_isspace(c)) {
+      return Scan::BAD;
+    }
+  }
+  *pos = p;
+  return Scan::MORE;
+}
+
+// Follows internal::ConsumeNode() through the properties of a node which
+// start at `pos`. Sets *end to the ";", "(" or ")" after the node, or to npos
+// if it hasn't been appended yet, and *closed to just after the "]" of the
+// last value which is complete.
+void ScanNode(absl::string_view text, size_t pos, size_t* end,
+              size_t* closed) {
+  enum { ID, VALUE, NEXT } state = ID;
+  *end = absl::string_view::npos;
+  *closed = pos;
+  bool escaping = false;
+  for (; pos < text.size(); ++pos) {
+    const char c = text[pos];
+    if (escaping) {
+      escaping = false;
+    } else if (c == '\\') {
+      escaping = true;
+    } else if (state == ID) {
+      if (c == '[') state = VALUE;
+    } else if (state == VALUE) {
+      if (c == ']') {
+        state = NEXT;
+        *closed = pos + 1;
+      }
+    } else if (c == '[') {
+      state = VALUE;
+    } else if (c == ';' || c == '(' || c == ')') {
+      *end = pos;
+      return;
+    }
+  }
+}
+
+bool IsMove(const internal::Property& prop) {
+  return absl::EqualsIgnoreCase(prop.id, "B") ||
+         absl::EqualsIgnoreCase(prop.id, "W");
+}
+
+}  // namespace
+
+SgfFollower::SgfFollower() {}
+
+SgfFollower::~SgfFollower() {
+  if (fd_ >= 0) close(fd_);
+}
+
+bool SgfFollower::Open(const string& filename, string* errors) {
+  if (fd_ >= 0) close(fd_);
+  Reset();
+  fd_ = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    if (errors != nullptr) {
+      absl::StrAppend(errors, "Can't open ", filename, ": ", strerror(errno),
+                      "\n");
+    }
+    state_ = State::FAILED;
+    return false;
+  }
+  return true;
+}
+
+void SgfFollower::Reset() {
+  state_ = State::START;
+  buffer_.clear();
+  cursor_ = 0;
+  applied_ = 0;
+  first_node_ = true;
+  record_.Reset();
+  board_.reset();
+  illegal_moves_ = 0;
+  offset_ = 0;
+}
+
+int SgfFollower::Poll(string* errors) {
+  CHECK_GE(fd_, 0) << "Not open.";
+  if (state_ == State::FAILED) return -1;
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    if (errors != nullptr) {
+      absl::StrAppend(errors, "Can't stat: ", strerror(errno), "\n");
+    }
+    state_ = State::FAILED;
+    return -1;
+  }
+  const uint64_t file_size = st.st_size;
+  if (file_size < offset_) {
+    VLOG(1) << "The file was truncated; following it from the beginning.";
+    Reset();
+  }
+  const size_t moves = record_.moves.size();
+  // Bytes appended after the fstat() are read by the next call.
+  while (offset_ < file_size) {
+    const size_t size = buffer_.size();
+    const size_t want = std::min<uint64_t>(file_size - offset_, kReadBytes);
+    buffer_.resize(size + want);
+    const ssize_t n = pread(fd_, &buffer_[size], want, offset_);
+    buffer_.resize(size + std::max<ssize_t>(n, 0));
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0) {
+      if (errors != nullptr) {
+        absl::StrAppend(errors, "Read error: ", strerror(errno), "\n");
+      }
+      state_ = State::FAILED;
+      return -1;
+    }
+    if (n == 0) break;
+    offset_ += n;
+  }
+  if (!Process(errors)) {
+    state_ = State::FAILED;
+    return -1;
+  }
+  return record_.moves.size() - moves;
+}
+
+int SgfFollower::Append(absl::string_view data, string* errors) {
+  if (state_ == State::FAILED) return -1;
+  const size_t moves = record_.moves.size();
+  buffer_.append(data.data(), data.size());
+  if (!Process(errors)) {
+    state_ = State::FAILED;
+    return -1;
+  }
+  return record_.moves.size() - moves;
+}
+
+bool SgfFollower::Process(string* errors) {
+  while (state_ == State::START || state_ == State::TREE_START ||
+         state_ == State::NODE) {
+    if (state_ != State::NODE) {
+      const bool start = state_ == State::START;
+      size_t p = cursor_;
+      const Scan scan = SkipTo(buffer_, start ? "(" : ";", &p);
+      if (scan == Scan::BAD) {
+        if (errors != nullptr) {
+          absl::StrAppend(errors, start ? "Failed in finding a tree start."
+                                        : "Failed in finding a node start.",
+                          "\n");
+        }
+        return false;
+      }
+      if (scan == Scan::MORE) {
+        cursor_ = p;
+        break;
+      }
+      if (start) {
+        cursor_ = p + 1;
+        state_ = State::TREE_START;
+      } else {
+        cursor_ = p;
+        applied_ = 0;
+        state_ = State::NODE;
+      }
+      continue;
+    }
+
+    size_t end, closed;
+    ScanNode(buffer_, cursor_ + 1, &end, &closed);
+    internal::ParseBudget unlimited;
+    node_.clear();
+    if (end == absl::string_view::npos) {
+      // Apply the properties which are complete, parsing them up to the last
+      // closed value, as if the node ended there.
+      if (closed > cursor_ + 1) {
+        partial_.assign(buffer_, cursor_ + 1, closed - cursor_ - 1);
+        partial_.push_back(')');
+        string ignored;
+        if (internal::ConsumeNode(partial_, 0, &node_, &unlimited, nullptr,
+                                  &ignored) == partial_.size() - 1) {
+          const int complete = node_.size() - (IsMove(node_.back()) ? 0 : 1);
+          if (!ApplyProperties(complete, errors)) return false;
+        }
+      }
+      break;
+    }
+
+    if (internal::ConsumeNode(buffer_, cursor_ + 1, &node_, &unlimited,
+                              nullptr, errors) != end ||
+        !ApplyProperties(node_.size(), errors)) {
+      return false;
+    }
+    if (first_node_) {
+      // The first node sets the board size.
+      first_node_ = false;
+      const GoCoord size = GetBoardSize(record_);
+      board_.reset(new GoBoard(size, size));
+      illegal_moves_ += ReplayRecord(record_, board_.get());
+    }
+    applied_ = 0;
+    if (buffer_[end] == ';') {
+      cursor_ = end;
+    } else if (buffer_[end] == '(') {
+      cursor_ = end + 1;
+      state_ = State::TREE_START;
+    } else {
+      cursor_ = end + 1;
+      state_ = State::FINISHED;
+    }
+  }
+
+  if (state_ == State::FINISHED) {
+    buffer_.clear();
+    cursor_ = 0;
+  } else if (cursor_ >= kCompactBytes && cursor_ * 2 >= buffer_.size()) {
+    buffer_.erase(0, cursor_);
+    cursor_ = 0;
+  }
+  return true;
+}
+
+bool SgfFollower::ApplyProperties(int end, string* errors) {
+  if (end <= applied_) return true;
+  for (int i = applied_; i < end; ++i) {
+    if (!internal::HandleProperty(node_[i], &record_, nullptr, errors)) {
+      return false;
+    }
+  }
+  if (board_ != nullptr) {
+    apply_.clear();
+    for (int i = applied_; i < end; ++i) {
+      apply_.emplace_back(node_[i].id);
+      apply_.back().values = node_[i].values;
+    }
+    illegal_moves_ += ApplyNode(apply_, board_.get());
+  }
+  applied_ = end;
+  return true;
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,109 @@
+#ifndef SGF_PARSER_FOLLOWER_H_
+#define SGF_PARSER_FOLLOWER_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/board.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// Follows an SGF file which is still being written, such as a live game whose
+// server appends every move to it. Each Poll() only reads the bytes appended
+// since the last one and applies the properties they complete to a GameRecord
+// and a board, so the cost of a new move doesn't depend on the length of the
+// game.
+//
+// Properties are applied once nothing appended later can change them: when the
+// next property or node starts. The B and W properties of a move are applied
+// as soon as their value is closed, since a live server doesn't write the next
+// node before the next move. Only the main line is followed, i.e. the first
+// variation wherever the game branches, and the game is finished at the first
+// ")" after it.
+//
+// Example, with an inotify or poll loop:
+//   SgfFollower follower;
+//   CHECK(follower.Open(filename, &errors));
+//   while (!follower.finished()) {
+//     WaitForChange(filename);
+//     if (follower.Poll(&errors) > 0) Show(*follower.board());
+//   }
+class SgfFollower {
+ public:
+  SgfFollower();
+  ~SgfFollower();
+
+  SgfFollower(const SgfFollower&) = delete;
+  SgfFollower& operator=(const SgfFollower&) = delete;
+
+  // Starts following `filename` from its beginning.
+  bool Open(const std::string& filename, std::string* errors);
+
+  // Reads what was appended to the file since the last call and applies it.
+  // Returns the number of new moves, or -1 on an error, after which the
+  // follower stays failed. A file which got shorter was rewritten, and is
+  // followed again from its beginning.
+  int Poll(std::string* errors);
+
+  // Applies `data` as if it was appended to the file. Same return as Poll().
+  int Append(absl::string_view data, std::string* errors);
+
+  // Forgets the game, to follow a new one.
+  void Reset();
+
+  // The game so far.
+  const GameRecord& record() const { return record_; }
+
+  // The position after the moves so far, or null until the first node, which
+  // sets the board size, is complete.
+  const GoBoard* board() const { return board_.get(); }
+
+  // Moves and setup stones which could not be placed on the board.
+  int illegal_moves() const { return illegal_moves_; }
+
+  // Whether the main line has ended.
+  bool finished() const { return state_ == State::FINISHED; }
+
+ private:
+  enum class State {
+    START,        // Before the "(" of the game.
+    TREE_START,   // Before the ";" of the first node of a tree.
+    NODE,         // In the node which starts at cursor_.
+    FINISHED,
+    FAILED,
+  };
+
+  // Consumes as much of buffer_ as is complete.
+  bool Process(std::string* errors);
+
+  // Applies properties [applied_, end) of node_.
+  bool ApplyProperties(int end, std::string* errors);
+
+  State state_ = State::START;
+  // Input not consumed yet starts at cursor_.
+  std::string buffer_;
+  size_t cursor_ = 0;
+  // Properties of the node at cursor_ which have been applied.
+  int applied_ = 0;
+  bool first_node_ = true;
+
+  GameRecord record_;
+  std::unique_ptr<GoBoard> board_;
+  int illegal_moves_ = 0;
+
+  // Scratch space, kept to avoid allocations.
+  internal::GameNode node_;
+  internal::GameNode apply_;
+  std::string partial_;
+
+  int fd_ = -1;
+  uint64_t offset_ = 0;   // Bytes of the file read so far.
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_FOLLOWER_H_
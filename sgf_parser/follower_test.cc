@@ -0,0 +1,153 @@
+#include "sgf_parser/follower.h"
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <random>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using std::string;
+
+class SgfFollowerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(SgfFollowerTest, TestDataInPieces) {
+  std::mt19937 rng(1);
+  for (const char* file : {"testdata/collection.sgf",
+                           "testdata/handicapped.sgf",
+                           "testdata/resigned.sgf"}) {
+    const string sgf = ReadFileToString(file);
+    GameRecord expected;
+    ASSERT_TRUE(SimpleParseSgf(sgf, &expected, nullptr, nullptr)) << file;
+    const GoCoord size = GetBoardSize(expected);
+    GoBoard board(size, size);
+    ReplayRecord(expected, &board);
+
+    // Byte by byte, and in random pieces.
+    for (int max_piece : {1, 50}) {
+      SgfFollower follower;
+      string errors;
+      size_t moves = 0;
+      for (size_t pos = 0; pos < sgf.size();) {
+        const size_t piece = 1 + rng() % max_piece;
+        const int added = follower.Append(sgf.substr(pos, piece), &errors);
+        ASSERT_GE(added, 0) << errors;
+        moves += added;
+        pos += piece;
+      }
+      EXPECT_TRUE(follower.finished()) << file;
+      EXPECT_EQ(moves, expected.moves.size()) << file;
+      EXPECT_EQ(follower.record().DebugString(), expected.DebugString());
+      ASSERT_NE(follower.board(), nullptr);
+      EXPECT_EQ(follower.board()->hash(), board.hash()) << file;
+    }
+  }
+}
+
+TEST_F(SgfFollowerTest, MovesApplyAtOnce) {
+  SgfFollower follower;
+  string errors;
+  EXPECT_EQ(follower.Append("(;GM[1]SZ[9]PB[Alice]", &errors), 0);
+  EXPECT_EQ(follower.board(), nullptr);
+  // PB could still get more values, until the next property starts.
+  EXPECT_EQ(follower.record().black_name, "");
+  EXPECT_EQ(follower.Append("PW[Bob]", &errors), 0);
+  EXPECT_EQ(follower.record().black_name, "Alice");
+
+  EXPECT_EQ(follower.Append(";B[cc", &errors), 0);
+  ASSERT_NE(follower.board(), nullptr);
+  EXPECT_EQ(follower.board()->width(), 9);
+  // The move is applied when its value closes, before the next node.
+  EXPECT_EQ(follower.Append("]", &errors), 1);
+  EXPECT_EQ(follower.board()->At(GoPos(2, 2)), GoBoard::BLACK);
+  EXPECT_EQ(follower.Append("C[a [comment\\]", &errors), 0);
+  EXPECT_EQ(follower.Append("];W[gg]", &errors), 1);
+  EXPECT_EQ(follower.Append(";B[]", &errors), 1);
+  EXPECT_EQ(follower.record().moves.size(), 3);
+  EXPECT_TRUE(follower.record().moves[2].pass);
+  EXPECT_FALSE(follower.finished());
+  EXPECT_EQ(follower.Append("RE[W+R])", &errors), 0);
+  EXPECT_TRUE(follower.finished());
+  EXPECT_TRUE(follower.record().resigned);
+  EXPECT_EQ(follower.Append("(;B[aa])", &errors), 0);
+  EXPECT_EQ(follower.record().moves.size(), 3);
+}
+
+TEST_F(SgfFollowerTest, MainLine) {
+  SgfFollower follower;
+  string errors;
+  EXPECT_EQ(follower.Append("(;SZ[9];B[aa](;W[bb];B[cc])(;W[dd]))", &errors),
+            3);
+  EXPECT_TRUE(follower.finished());
+  EXPECT_EQ(follower.record().moves[1].move, GoPos(1, 1));
+}
+
+TEST_F(SgfFollowerTest, Errors) {
+  SgfFollower follower;
+  string errors;
+  EXPECT_EQ(follower.Append("  (  ;SZ[9];B[aa]", &errors), 1);
+  EXPECT_EQ(follower.Append(";B[aa]x;", &errors), -1);
+  EXPECT_FALSE(errors.empty());
+  EXPECT_EQ(follower.Append(";W[bb]", &errors), -1);
+
+  follower.Reset();
+  errors.clear();
+  EXPECT_EQ(follower.Append("x(;B[aa])", &errors), -1);
+  EXPECT_FALSE(errors.empty());
+}
+
+TEST_F(SgfFollowerTest, Poll) {
+  const char* dir = getenv("TEST_TMPDIR");
+  const string filename = absl::StrCat(dir != nullptr ? dir : "/tmp",
+                                       "/follower_test.", getpid(), ".sgf");
+  std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+  SgfFollower follower;
+  string errors;
+  ASSERT_TRUE(follower.Open(filename, &errors)) << errors;
+  EXPECT_EQ(follower.Poll(&errors), 0);
+
+  out << "(;SZ[19]KM[6.5]" << std::flush;
+  EXPECT_EQ(follower.Poll(&errors), 0);
+  // A long game, a move at a time.
+  for (int i = 0; i < 300; ++i) {
+    const char x = 'a' + i % 19;
+    const char y = 'a' + i / 19 % 19;
+    out << ";" << (i % 2 == 0 ? "B" : "W") << "[" << x << y << "]"
+        << std::flush;
+    ASSERT_EQ(follower.Poll(&errors), 1) << i << errors;
+  }
+  EXPECT_EQ(follower.Poll(&errors), 0);
+  out << ")" << std::flush;
+  EXPECT_EQ(follower.Poll(&errors), 0);
+  EXPECT_TRUE(follower.finished());
+  EXPECT_EQ(follower.record().moves.size(), 300);
+  EXPECT_EQ(follower.record().komi, 6.5);
+  out.close();
+
+  // A rewritten file is followed from the beginning.
+  std::ofstream rewritten(filename, std::ios::binary | std::ios::trunc);
+  rewritten << "(;SZ[9];B[ee]" << std::flush;
+  EXPECT_EQ(follower.Poll(&errors), 1);
+  EXPECT_FALSE(follower.finished());
+  EXPECT_EQ(follower.record().moves.size(), 1);
+  EXPECT_EQ(follower.board()->width(), 9);
+  rewritten.close();
+  remove(filename.c_str());
+
+  EXPECT_FALSE(follower.Open(filename, &errors));
+}
+
+}  // namespace
+}  // namespace sgf_parser
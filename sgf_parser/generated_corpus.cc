@@ -0,0 +1,71 @@
+#include "sgf_parser/generated_corpus.h"
+
+#include "absl/strings/str_cat.h"
+
+namespace sgf_parser {
+
+using std::string;
+
+namespace {
+
+// A number in [0, n). Unlike std::uniform_int_distribution, which standard
+// libraries implement differently, it only depends on the generator, whose
+// output the standard fixes.
+int Uniform(std::mt19937* rng, int n) {
+  return (*rng)() % n;
+}
+
+// Draws both coordinates in a fixed order.
+string Point(std::mt19937* rng) {
+  const char x = 'a' + Uniform(rng, 19);
+  const char y = 'a' + Uniform(rng, 19);
+  return string{x, y};
+}
+
+}  // namespace
+
+// Random values are drawn into locals before formatting: the order in which
+// function arguments are evaluated is unspecified, and differs by compiler.
+string GenerateGame(std::mt19937* rng) {
+  const int moves = 120 + Uniform(rng, 201);
+  const int black = Uniform(rng, 100);
+  const int black_rank = 1 + Uniform(rng, 9);
+  const int white = Uniform(rng, 100);
+  const int white_rank = 1 + Uniform(rng, 9);
+  const int month = 1 + Uniform(rng, 9);
+  const int day = Uniform(rng, 10);
+  const bool black_wins = Uniform(rng, 2) == 0;
+  string sgf = absl::StrCat(
+      "(;GM[1]FF[4]CA[UTF-8]SZ[19]KM[6.5]RU[Japanese]TM[1800]",
+      "PB[player", black, "]BR[", black_rank, "d]",
+      "PW[player", white, "]WR[", white_rank, "d]",
+      "DT[2020-0", month, "-1", day, "]",
+      black_wins ? "RE[B+R]" : "RE[W+3.5]", "\n");
+  for (int i = 0; i < moves; ++i) {
+    const char* color = i % 2 == 0 ? "B" : "W";
+    const string point = Point(rng);
+    const int centiseconds = Uniform(rng, 100);
+    absl::StrAppend(&sgf, ";", color, "[", point, "]", color, "L[",
+                    1800 - i * 5, ".", centiseconds, "]");
+    if (Uniform(rng, 100) < 5) {
+      absl::StrAppend(&sgf, "C[A comment on move ", i + 1,
+                      " with [brackets\\] and an escaped \\\\ backslash.]");
+    }
+    if (i % 10 == 9) sgf.push_back('\n');
+  }
+  const string first = Point(rng);
+  const string second = Point(rng);
+  const string alternative = Point(rng);
+  absl::StrAppend(&sgf, "(;B[", first, "];W[", second, "])(;B[", alternative,
+                  "]C[Also possible.]))\n");
+  return sgf;
+}
+
+std::vector<string> GenerateCorpus(int games, int seed) {
+  std::mt19937 rng(seed);
+  std::vector<string> corpus;
+  for (int i = 0; i < games; ++i) corpus.push_back(GenerateGame(&rng));
+  return corpus;
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,19 @@
+#ifndef SGF_PARSER_GENERATED_CORPUS_H_
+#define SGF_PARSER_GENERATED_CORPUS_H_
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace sgf_parser {
+
+// A plausible 19x19 game with comments, times and a variation at the end.
+std::string GenerateGame(std::mt19937* rng);
+
+// `games` games which only depend on `seed`, so benchmarks of different builds
+// measure the same input.
+std::vector<std::string> GenerateCorpus(int games, int seed);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_GENERATED_CORPUS_H_
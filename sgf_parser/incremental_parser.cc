@@ -0,0 +1,305 @@
+#include "sgf_parser/incremental_parser.h"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using internal::GameNode;
+using internal::GameTree;
+using internal::TreePool;
+
+namespace {
+
+// Where an edit lands in the old tree: node `node` of `tree`, or only the
+// tree if `node` is -1. Positions are in the old buffer.
+struct Target {
+  GameTree* tree = nullptr;
+  size_t tree_begin = 0;   // "(".
+  size_t tree_end = 0;     // ")".
+  int node = -1;
+  size_t node_begin = 0;   // ";".
+  size_t node_end = 0;     // The ";", "(" or ")" after the node.
+};
+
+class Spans {
+ public:
+  explicit Spans(absl::string_view sgf) : sgf_(sgf) {}
+
+  // The ";" of a node. Every node has a property, whose id is preceded by
+  // nothing but whitespace.
+  size_t NodeStart(const GameNode& node) const {
+    const size_t p = SkipBack(node[0].id.data() - sgf_.data());
+    DCHECK_EQ(sgf_[p], ';');
+    return p;
+  }
+
+  // The ";", "(" or ")" after a node. Every property has a value, which is
+  // followed by its "]".
+  size_t NodeEnd(const GameNode& node) const {
+    const absl::string_view value = node.back().values.back();
+    const size_t p = SkipForward(value.data() + value.size() - sgf_.data() + 1);
+    DCHECK(p < sgf_.size() &&
+           (sgf_[p] == ';' || sgf_[p] == '(' || sgf_[p] == ')'));
+    return p;
+  }
+
+  // The "(" of a tree, or npos if it can't be told. Between the "(" and the
+  // first ";" there may be escaped characters as well as whitespace, so a
+  // "(" right after a backslash is ambiguous.
+  size_t TreeStart(const GameTree& tree) const {
+    const size_t p = SkipBack(NodeStart(tree.sequence[0]));
+    if (sgf_[p] != '(' || (p > 0 && sgf_[p - 1] == '\\')) {
+      return absl::string_view::npos;
+    }
+    return p;
+  }
+
+  // Follows the last variations down to a leaf, then the ")" back up.
+  size_t TreeEnd(const GameTree& tree) const {
+    const GameTree* leaf = &tree;
+    int depth = 0;
+    while (!leaf->children.empty()) {
+      leaf = leaf->children.back().get();
+      ++depth;
+    }
+    size_t p = NodeEnd(leaf->sequence.back());
+    for (int i = 0; i < depth; ++i) {
+      p = internal::FindFirst(sgf_, p + 1, "()", false);
+    }
+    DCHECK(p < sgf_.size() && sgf_[p] == ')');
+    return p;
+  }
+
+ private:
+  // The first non-whitespace byte before `pos`.
+  size_t SkipBack(size_t pos) const {
+    do {
+      --pos;
+    } while (absl::ascii_isspace(sgf_[pos]));
+    return pos;
+  }
+
+  // The first non-whitespace byte at or after `pos`.
+  size_t SkipForward(size_t pos) const {
+    while (pos < sgf_.size() && absl::ascii_isspace(sgf_[pos])) ++pos;
+    return pos;
+  }
+
+  const absl::string_view sgf_;
+};
+
+// The smallest node or tree which strictly encloses the edit, keeping its
+// first byte; none if the edit touches the top level.
+Target Locate(GameTree* root, absl::string_view sgf, const SgfEdit& edit) {
+  const Spans spans(sgf);
+  Target target;
+  GameTree* parent = root;
+  bool ambiguous = false;
+  const auto tree_start = [&](const GameTree& tree) {
+    const size_t p = spans.TreeStart(tree);
+    ambiguous |= p == absl::string_view::npos;
+    return p;
+  };
+  while (true) {
+    // The last child starting before the edit.
+    auto& children = parent->children;
+    auto child = std::partition_point(
+        children.begin(), children.end(),
+        [&](const std::unique_ptr<GameTree>& tree) {
+          return tree_start(*tree) < edit.begin;
+        });
+    if (ambiguous) return Target();
+    if (child == children.begin()) break;
+    GameTree* tree = (--child)->get();
+    const size_t end = spans.TreeEnd(*tree);
+    if (edit.end > end) break;
+    target = Target{tree, spans.TreeStart(*tree), end};
+
+    if (!tree->children.empty()) {
+      const size_t start = tree_start(*tree->children[0]);
+      if (ambiguous) return Target();
+      if (start < edit.begin) {
+        parent = tree;
+        continue;
+      }
+    }
+    const auto& sequence = tree->sequence;
+    auto node = std::partition_point(
+        sequence.begin(), sequence.end(), [&](const GameNode& node) {
+          return spans.NodeStart(node) < edit.begin;
+        });
+    if (node == sequence.begin()) break;   // The edit is before the ";".
+    --node;
+    if (spans.NodeEnd(*node) >= edit.end) {
+      target.node = node - sequence.begin();
+      target.node_begin = spans.NodeStart(*node);
+      target.node_end = spans.NodeEnd(*node);
+    }
+    break;
+  }
+  return target;
+}
+
+// Points every id and value of the trees under `root` into `new_sgf`.
+void Rebase(absl::string_view old_sgf, absl::string_view new_sgf,
+            const SgfEdit& edit, GameTree* root) {
+  const auto rebase = [&](absl::string_view* view) {
+    size_t offset = view->data() - old_sgf.data();
+    if (offset >= edit.end) offset = offset - edit.end + edit.begin + edit.size;
+    *view = absl::string_view(new_sgf.data() + offset, view->size());
+  };
+  std::vector<GameTree*> pending = {root};
+  while (!pending.empty()) {
+    GameTree* tree = pending.back();
+    pending.pop_back();
+    for (GameNode& node : tree->sequence) {
+      for (internal::Property& prop : node) {
+        rebase(&prop.id);
+        for (absl::string_view& value : prop.values) rebase(&value);
+      }
+    }
+    for (auto& child : tree->children) pending.push_back(child.get());
+  }
+}
+
+void Clear(GameTree* tree, TreePool* pool) {
+  if (pool != nullptr) {
+    pool->Recycle(tree);
+  } else {
+    tree->sequence.clear();
+    tree->children.clear();
+  }
+}
+
+// Parses the node of `target`, emptied, again from the ";" at `begin` of
+// `new_sgf`. Returns false unless it ends at `end`.
+bool ReparseNode(absl::string_view new_sgf, size_t begin, size_t end,
+                 const Target& target, TreePool* pool) {
+  GameNode& node = target.tree->sequence[target.node];
+  internal::ParseBudget unlimited;
+  std::string errors;
+  return internal::ConsumeNode(new_sgf, begin + 1, &node, &unlimited, pool,
+                               &errors) == end;
+}
+
+// Parses the tree of `target` again from the "(" at `begin` of `new_sgf` to
+// the ")" at `end`. Returns false unless that is exactly one tree.
+bool ReparseTree(absl::string_view new_sgf, size_t begin, size_t end,
+                 const Target& target, TreePool* pool) {
+  Clear(target.tree, pool);
+  GameTree parsed(nullptr);
+  std::string errors;
+  // A tree which closes before `end` is followed by bytes which its parent
+  // wouldn't accept.
+  if (!internal::ParseToRoot(new_sgf.substr(begin, end + 1 - begin),
+                             ParseLimits(), pool, &parsed, &errors) ||
+      parsed.children.size() != 1 ||
+      Spans(new_sgf).TreeEnd(*parsed.children[0]) != end) {
+    Clear(&parsed, pool);
+    return false;
+  }
+  GameTree* tree = target.tree;
+  tree->sequence = std::move(parsed.children[0]->sequence);
+  tree->children = std::move(parsed.children[0]->children);
+  for (auto& child : tree->children) child->parent = tree;
+  if (pool != nullptr) {
+    parsed.children[0]->parent = nullptr;
+    pool->trees.push_back(std::move(parsed.children[0]));
+  }
+  parsed.children.clear();
+  return true;
+}
+
+}  // namespace
+
+bool ReparseToRoot(absl::string_view old_sgf, absl::string_view new_sgf,
+                   const SgfEdit& edit, TreePool* pool, GameTree* root,
+                   ReparseScope* scope, std::string* errors) {
+  CHECK_LE(edit.begin, edit.end);
+  CHECK_LE(edit.end, old_sgf.size());
+  CHECK_EQ(old_sgf.size() - (edit.end - edit.begin) + edit.size,
+           new_sgf.size());
+  ReparseScope unused_scope;
+  if (scope == nullptr) scope = &unused_scope;
+
+  // The node is tried first, then its tree. Everything else only moves.
+  const Target target = Locate(root, old_sgf, edit);
+  if (target.tree != nullptr) {
+    const auto moved = [&edit](size_t pos) {
+      return pos - edit.end + edit.begin + edit.size;
+    };
+    if (target.node >= 0) {
+      GameNode& node = target.tree->sequence[target.node];
+      for (auto& prop : node) {
+        if (pool != nullptr) {
+          prop.values.clear();
+          pool->values.push_back(std::move(prop.values));
+        }
+      }
+      node.clear();
+    } else {
+      Clear(target.tree, pool);
+    }
+    Rebase(old_sgf, new_sgf, edit, root);
+    if (target.node >= 0) {
+      *scope = ReparseScope::NODE;
+      if (ReparseNode(new_sgf, target.node_begin, moved(target.node_end),
+                      target, pool)) {
+        return true;
+      }
+    }
+    *scope = ReparseScope::TREE;
+    if (ReparseTree(new_sgf, target.tree_begin, moved(target.tree_end), target,
+                    pool)) {
+      return true;
+    }
+  }
+  VLOG(1) << "Reparsing everything.";
+  *scope = ReparseScope::FULL;
+  Clear(root, pool);
+  return internal::ParseToRoot(new_sgf, ParseLimits(), pool, root, errors);
+}
+
+IncrementalParser::IncrementalParser() : root_(nullptr) {}
+
+bool IncrementalParser::Parse(absl::string_view sgf, std::string* errors) {
+  buffers_[current_].assign(sgf.data(), sgf.size());
+  pool_.Recycle(&root_);
+  last_scope_ = ReparseScope::FULL;
+  valid_ = internal::ParseToRoot(buffers_[current_], ParseLimits(),
+                                 &pool_, &root_, errors);
+  return valid_;
+}
+
+bool IncrementalParser::Edit(size_t begin, size_t end,
+                             absl::string_view replacement,
+                             std::string* errors) {
+  const std::string& old_sgf = buffers_[current_];
+  CHECK_LE(begin, end);
+  CHECK_LE(end, old_sgf.size());
+  std::string& new_sgf = buffers_[1 - current_];
+  new_sgf.assign(old_sgf, 0, begin);
+  new_sgf.append(replacement.data(), replacement.size());
+  new_sgf.append(old_sgf, end, std::string::npos);
+
+  if (valid_) {
+    valid_ = ReparseToRoot(old_sgf, new_sgf,
+                           SgfEdit{begin, end, replacement.size()}, &pool_,
+                           &root_, &last_scope_, errors);
+  } else {
+    pool_.Recycle(&root_);
+    last_scope_ = ReparseScope::FULL;
+    valid_ = internal::ParseToRoot(new_sgf, ParseLimits(), &pool_,
+                                   &root_, errors);
+  }
+  current_ = 1 - current_;
+  return valid_;
+}
+
+}  // namespace sgf_parser
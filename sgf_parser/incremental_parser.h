@@ -0,0 +1,90 @@
+#ifndef SGF_PARSER_INCREMENTAL_PARSER_H_
+#define SGF_PARSER_INCREMENTAL_PARSER_H_
+
+#include <stddef.h>
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// An edit of an SGF buffer: the bytes [begin, end) of the old buffer were
+// replaced by `size` bytes, which start at `begin` in the new buffer.
+struct SgfEdit {
+  size_t begin = 0;
+  size_t end = 0;
+  size_t size = 0;
+};
+
+// How much of the tree a reparse had to rebuild.
+enum class ReparseScope {
+  NODE,   // The node around the edit.
+  TREE,   // The smallest game tree, "(" to ")", around the edit.
+  FULL,   // Everything.
+};
+
+// Brings `root`, filled by internal::ParseToRoot from `old_sgf`, up to date
+// with `new_sgf`, which is `old_sgf` after `edit`. Only the node or the
+// smallest game tree enclosing the edit is parsed again and spliced into the
+// tree, keeping its place; every other property id and value is rebased to
+// point into `new_sgf`, so `old_sgf` may be freed afterwards. If the reparsed
+// text doesn't end where the old node or tree did, e.g. because the edit
+// added or removed a bracket, the whole buffer is parsed again.
+//
+// The result, including the errors, is the same as parsing `new_sgf` into an
+// empty root with ParseToRoot and no limits. On failure `root` is unusable
+// until a successful full parse. Buffers of the replaced parts go to `pool`
+// and are taken from it if it is not null. `scope` may be null.
+bool ReparseToRoot(absl::string_view old_sgf, absl::string_view new_sgf,
+                   const SgfEdit& edit, internal::TreePool* pool,
+                   internal::GameTree* root, ReparseScope* scope,
+                   std::string* errors);
+
+// Owns an SGF document and its tree, and keeps the tree up to date as the
+// document is edited, e.g. on every keystroke of an editor. Edits of a
+// comment or a move only reparse their node, however large the document.
+//
+// Example:
+//   IncrementalParser parser;
+//   CHECK(parser.Parse(sgf, &errors));
+//   parser.Edit(begin, end, "text", &errors);
+//   TreeCursor cursor(parser.root().children[0].get());
+class IncrementalParser {
+ public:
+  IncrementalParser();
+
+  IncrementalParser(const IncrementalParser&) = delete;
+  IncrementalParser& operator=(const IncrementalParser&) = delete;
+
+  // Parses a new document from scratch.
+  bool Parse(absl::string_view sgf, std::string* errors);
+
+  // Replaces the bytes [begin, end) of the document with `replacement` and
+  // updates the tree. Returns false if the edited document doesn't parse, in
+  // which case the next edit parses it from scratch.
+  bool Edit(size_t begin, size_t end, absl::string_view replacement,
+            std::string* errors);
+
+  absl::string_view sgf() const { return buffers_[current_]; }
+
+  // Valid if the last parse or edit succeeded. Values point into sgf().
+  const internal::GameTree& root() const { return root_; }
+
+  ReparseScope last_scope() const { return last_scope_; }
+
+ private:
+  // The document and the one before the last edit, so edits don't allocate
+  // once both have grown.
+  std::string buffers_[2];
+  int current_ = 0;
+  bool valid_ = false;
+  ReparseScope last_scope_ = ReparseScope::FULL;
+  internal::GameTree root_;
+  internal::TreePool pool_;
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_INCREMENTAL_PARSER_H_
@@ -0,0 +1,188 @@
+#include "sgf_parser/incremental_parser.h"
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using internal::GameTree;
+using std::string;
+
+// The trees under `root`, with the offset of every value in `sgf`, which
+// also checks that the values point into it.
+string DumpTree(const GameTree& root, absl::string_view sgf) {
+  string dump;
+  const auto offset = [sgf](absl::string_view view) {
+    CHECK(view.data() >= sgf.data() &&
+          view.data() + view.size() <= sgf.data() + sgf.size());
+    return view.data() - sgf.data();
+  };
+  std::vector<std::pair<const GameTree*, int>> pending = {{&root, 0}};
+  while (!pending.empty()) {
+    const GameTree* tree = pending.back().first;
+    const int depth = pending.back().second;
+    pending.pop_back();
+    CHECK(tree == &root || tree->parent != nullptr);
+    absl::StrAppend(&dump, string(depth, ' '), "(\n");
+    for (const auto& node : tree->sequence) {
+      absl::StrAppend(&dump, string(depth, ' '), ";");
+      for (const auto& prop : node) {
+        absl::StrAppend(&dump, prop.id, "@", offset(prop.id));
+        for (const auto& value : prop.values) {
+          absl::StrAppend(&dump, "[", value, "]@", offset(value));
+        }
+      }
+      absl::StrAppend(&dump, "\n");
+    }
+    for (auto it = tree->children.rbegin(); it != tree->children.rend();
+         ++it) {
+      CHECK_EQ((*it)->parent, tree);
+      pending.emplace_back(it->get(), depth + 1);
+    }
+  }
+  return dump;
+}
+
+// The result of parsing `sgf` from scratch.
+string FullParse(absl::string_view sgf, bool* ok) {
+  GameTree root(nullptr);
+  *ok = internal::ParseToRoot(sgf, &root, nullptr);
+  return *ok ? DumpTree(root, sgf) : "";
+}
+
+class IncrementalParserTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(IncrementalParserTest, Scopes) {
+  const string sgf =
+      "(;GM[1]SZ[9]C[a comment];B[ee];W[cc]\n"
+      "(;B[dd];W[ff])\n"
+      "(;B[gg]C[another]))";
+  IncrementalParser parser;
+  string errors;
+  ASSERT_TRUE(parser.Parse(sgf, &errors)) << errors;
+  EXPECT_EQ(parser.last_scope(), ReparseScope::FULL);
+
+  // Editing a comment only reparses its node.
+  const size_t comment = sgf.find("a comment");
+  ASSERT_TRUE(parser.Edit(comment, comment + 1, "the longer", &errors));
+  EXPECT_EQ(parser.last_scope(), ReparseScope::NODE);
+  EXPECT_EQ(parser.sgf().substr(comment, 20), "the longer comment];");
+  EXPECT_EQ(parser.root().children[0]->sequence[0][2].values[0],
+            "the longer comment");
+
+  // A move in a variation.
+  size_t move = parser.sgf().find("gg");
+  ASSERT_TRUE(parser.Edit(move, move + 2, "hh", &errors));
+  EXPECT_EQ(parser.last_scope(), ReparseScope::NODE);
+  EXPECT_EQ(parser.root().children[0]->children[1]->sequence[0][0].values[0],
+            "hh");
+
+  // New nodes and variations reparse their tree.
+  move = parser.sgf().find(";W[cc]");
+  ASSERT_TRUE(parser.Edit(move, move, ";W[ab];B[ba]", &errors));
+  EXPECT_EQ(parser.last_scope(), ReparseScope::TREE);
+  EXPECT_EQ(parser.root().children[0]->sequence.size(), 5);
+  move = parser.sgf().find(";W[ff]");
+  ASSERT_TRUE(parser.Edit(move + 6, move + 6, "(;B[aa])(;B[bb])", &errors));
+  EXPECT_EQ(parser.last_scope(), ReparseScope::TREE);
+  EXPECT_EQ(parser.root().children[0]->children[0]->children.size(), 2);
+
+  // Deleting the first "(" reparses everything, and fails.
+  EXPECT_FALSE(parser.Edit(0, 1, "", &errors));
+  EXPECT_EQ(parser.last_scope(), ReparseScope::FULL);
+  EXPECT_FALSE(errors.empty());
+  ASSERT_TRUE(parser.Edit(0, 0, "(", &errors));
+  EXPECT_EQ(parser.last_scope(), ReparseScope::FULL);
+
+  bool ok;
+  EXPECT_EQ(DumpTree(parser.root(), parser.sgf()),
+            FullParse(parser.sgf(), &ok));
+  EXPECT_TRUE(ok);
+}
+
+TEST_F(IncrementalParserTest, TopLevel) {
+  // A new game at the top level can't be spliced into a tree.
+  const string sgf = "(;B[aa]C[x];W[bb])";
+  IncrementalParser parser;
+  string errors;
+  ASSERT_TRUE(parser.Parse(sgf, &errors));
+  ASSERT_TRUE(parser.Edit(sgf.size(), sgf.size(), "(;W[cc])", &errors));
+  EXPECT_EQ(parser.last_scope(), ReparseScope::FULL);
+  EXPECT_EQ(parser.root().children.size(), 2);
+}
+
+TEST_F(IncrementalParserTest, RandomEdits) {
+  // Random edits, mostly of SGF syntax, must give the same tree and the same
+  // success as parsing the edited text from scratch.
+  const char* kPieces[] = {"[", "]", "(", ")", ";", "\\", " ", "\n", "B",
+                           "W", "C", "aa", "[x]", ";B[cd]", "(;W[ef])",
+                           "C[note]"};
+  std::mt19937 rng(7);
+  int scopes[3] = {};
+  for (const char* file : {"testdata/collection.sgf",
+                           "testdata/handicapped.sgf",
+                           "testdata/resigned.sgf"}) {
+    IncrementalParser parser;
+    string errors;
+    string last_valid = ReadFileToString(file);
+    ASSERT_TRUE(parser.Parse(last_valid, &errors)) << file;
+    for (int i = 0; i < 1000; ++i) {
+      const size_t size = parser.sgf().size();
+      const size_t begin = rng() % (size + 1);
+      const size_t end = std::min(size, begin + rng() % 3);
+      string replacement;
+      for (int n = rng() % 3; n > 0; --n) {
+        replacement += kPieces[rng() % (sizeof(kPieces) / sizeof(kPieces[0]))];
+      }
+      const string before(parser.sgf());
+      errors.clear();
+      const bool ok = parser.Edit(begin, end, replacement, &errors);
+      ++scopes[static_cast<int>(parser.last_scope())];
+      bool expected_ok;
+      const string expected = FullParse(parser.sgf(), &expected_ok);
+      ASSERT_EQ(ok, expected_ok) << before << "\n" << parser.sgf();
+      if (ok) {
+        last_valid.assign(parser.sgf().data(), parser.sgf().size());
+        ASSERT_EQ(DumpTree(parser.root(), parser.sgf()), expected)
+            << before << "\n" << parser.sgf();
+      } else {
+        EXPECT_FALSE(errors.empty());
+      }
+      // Keep the document mostly valid by undoing failed edits.
+      if (!ok && rng() % 4 != 0) {
+        ASSERT_TRUE(parser.Parse(last_valid, &errors));
+      }
+    }
+  }
+  EXPECT_GT(scopes[static_cast<int>(ReparseScope::NODE)], 0);
+  EXPECT_GT(scopes[static_cast<int>(ReparseScope::TREE)], 0);
+  EXPECT_GT(scopes[static_cast<int>(ReparseScope::FULL)], 0);
+}
+
+TEST_F(IncrementalParserTest, WithoutPool) {
+  const string old_sgf = "(;SZ[9];B[aa](;W[bb])(;W[cc]))";
+  GameTree root(nullptr);
+  ASSERT_TRUE(internal::ParseToRoot(old_sgf, &root, nullptr));
+  string new_sgf = old_sgf;
+  new_sgf.replace(17, 2, "dd];B[ee");
+  ReparseScope scope;
+  ASSERT_TRUE(ReparseToRoot(old_sgf, new_sgf, SgfEdit{17, 19, 8}, nullptr,
+                            &root, &scope, nullptr));
+  EXPECT_EQ(scope, ReparseScope::TREE);
+  bool ok;
+  EXPECT_EQ(DumpTree(root, new_sgf), FullParse(new_sgf, &ok));
+}
+
+}  // namespace
+}  // namespace sgf_parser
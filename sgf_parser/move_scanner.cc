@@ -0,0 +1,319 @@
+#include "sgf_parser/move_scanner.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "absl/strings/ascii.h"
+
+namespace sgf_parser {
+
+using absl::string_view;
+
+namespace {
+
+constexpr uint64_t kMultiplier = 0x100000001b3ULL;
+
+uint64_t Mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+uint64_t MoveToken(GoMove::Color color, bool pass, GoCoord x, GoCoord y) {
+  const uint64_t packed = pass ? static_cast<uint64_t>(color)
+      : (static_cast<uint64_t>(color) |
+         static_cast<uint64_t>(static_cast<uint16_t>(x)) << 8 |
+         static_cast<uint64_t>(static_cast<uint16_t>(y)) << 24);
+  return Mix(packed + 1);
+}
+
+// A sequence of moves: its length, its polynomial hash, and the multiplier
+// which shifts a hash past it, so two sequences combine in constant time.
+struct MoveSequence {
+  int64_t moves = 0;
+  uint64_t hash = 0;
+  uint64_t shift = 1;
+  bool bad = false;     // Contains a move the parser would reject.
+
+  void Append(uint64_t token) {
+    ++moves;
+    hash = hash * kMultiplier + token;
+    shift *= kMultiplier;
+  }
+
+  void Append(const MoveSequence& other) {
+    moves += other.moves;
+    hash = hash * other.shift + other.hash;
+    shift *= other.shift;
+    bad = bad || other.bad;
+  }
+};
+
+// A game tree being scanned.
+struct Frame {
+  int nodes = 0;              // Nodes in its own sequence.
+  MoveSequence own;           // Moves in its own sequence.
+  int best_dist = -1;         // Nodes on the longest path through a child.
+  MoveSequence best;          // Moves on that path.
+};
+
+// Bit i is set if p[i] is one of the characters which matter to the structure.
+uint32_t StructuralMask(const char* p, size_t len) {
+#ifdef __SSE2__
+  if (len == 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hits = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('['));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(']')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(';')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('(')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(')')));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\\')));
+    return _mm_movemask_epi8(hits);
+  }
+#endif
+  uint32_t mask = 0;
+  for (size_t i = 0; i < len; ++i) {
+    switch (p[i]) {
+      case '[': case ']': case ';': case '(': case ')': case '\\':
+        mask |= 1u << i;
+    }
+  }
+  return mask;
+}
+
+// Whether internal::FindFirst, not expecting contents, skips sgf[begin, end).
+bool Skippable(string_view sgf, size_t begin, size_t end) {
+  while (begin < end) {
+    if (sgf[begin] == '\\') {
+      begin += 2;
+    } else if (!absl::ascii_isspace(sgf[begin])) {
+      return false;
+    } else {
+      ++begin;
+    }
+  }
+  return true;
+}
+
+bool IsBlank(string_view sgf, size_t begin, size_t end) {
+  for (; begin < end; ++begin) {
+    if (!absl::ascii_isspace(sgf[begin])) return false;
+  }
+  return true;
+}
+
+// Whether sgf[begin, end) is the id of a move, and whose.
+bool MoveId(string_view sgf, size_t begin, size_t end, GoMove::Color* color) {
+  while (begin < end && absl::ascii_isspace(sgf[begin])) ++begin;
+  while (end > begin && absl::ascii_isspace(sgf[end - 1])) --end;
+  if (end - begin != 1) return false;
+  const char c = absl::ascii_toupper(sgf[begin]);
+  if (c != 'B' && c != 'W') return false;
+  *color = c == 'B' ? GoMove::BLACK : GoMove::WHITE;
+  return true;
+}
+
+// Follows the states of internal::ParseToRoot and ConsumeNode, driven by the
+// structural characters only.
+class Scanner {
+ public:
+  explicit Scanner(string_view sgf) : sgf_(sgf) {
+    frames_.reserve(16);
+    frames_.emplace_back();   // The collection.
+  }
+
+  bool Run(MainLineSummary* summary) {
+    const char* data = sgf_.data();
+    const size_t n = sgf_.size();
+    for (size_t block = 0; block < n && state_ != END; block += 16) {
+      const size_t len = n - block < 16 ? n - block : 16;
+      uint32_t mask = StructuralMask(data + block, len);
+      while (mask != 0) {
+        const size_t pos = block + __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (pos < skip_until_) continue;
+        if (!Step(pos)) return false;
+        if (state_ == END) break;
+      }
+    }
+    if ((state_ != NEXT_TREE && state_ != END) || frames_.size() != 1) {
+      return false;
+    }
+    const Frame& root = frames_.back();
+    if (root.best_dist < 0 || root.best.bad) return false;
+    summary->moves = root.best.moves;
+    summary->hash = root.best.hash;
+    return true;
+  }
+
+ private:
+  enum State {
+    START,          // Looking for the first '('.
+    TREE_START,     // After '(', looking for ';'.
+    NODE_START,     // After ';', looking for the first '['.
+    VALUE,          // Inside a value.
+    NEXT_VALUE,     // After ']'.
+    NEXT_TREE,      // After ')'.
+    END,            // The parser stops here.
+  };
+
+  bool Step(size_t pos) {
+    const char c = sgf_[pos];
+    if (c == '\\') {
+      // Escapes work the same everywhere. Outside values the escaped pair
+      // counts as contents, which the gap checks below see.
+      skip_until_ = pos + 2;
+      return true;
+    }
+    switch (state_) {
+      case START:
+        if (!Skippable(sgf_, gap_start_, pos) || c != '(') return false;
+        PushTree(pos);
+        return true;
+      case TREE_START:
+        if (!Skippable(sgf_, gap_start_, pos) || c != ';') return false;
+        StartNode(pos);
+        return true;
+      case NODE_START:
+        // Like ConsumeNode, everything up to the first '[' is the id.
+        if (c == '[') StartValue(pos);
+        return true;
+      case VALUE:
+        if (c == ']') EndValue(pos);
+        return true;
+      case NEXT_VALUE: {
+        // A stray ']' is just contents, which the next token finds.
+        if (c == ']') return true;
+        const bool blank = IsBlank(sgf_, gap_start_, pos);
+        if (c == '[') {
+          if (!blank) is_move_ = MoveId(sgf_, gap_start_, pos, &color_);
+          value_start_ = pos + 1;
+          state_ = VALUE;
+          return true;
+        }
+        if (!blank) return false;
+        if (c == ';') {
+          StartNode(pos);
+        } else if (c == '(') {
+          PushTree(pos);
+        } else {
+          PopTree(pos);
+        }
+        return true;
+      }
+      case NEXT_TREE:
+        if (!Skippable(sgf_, gap_start_, pos) || (c != '(' && c != ')')) {
+          state_ = END;
+          return true;
+        }
+        if (c == '(') {
+          PushTree(pos);
+          return true;
+        }
+        if (frames_.size() == 1) return false;
+        PopTree(pos);
+        return true;
+      case END:
+        return true;
+    }
+    return false;
+  }
+
+  void PushTree(size_t pos) {
+    frames_.emplace_back();
+    gap_start_ = pos + 1;
+    state_ = TREE_START;
+  }
+
+  void PopTree(size_t pos) {
+    Frame& frame = frames_.back();
+    int dist = frame.nodes;
+    MoveSequence path = frame.own;
+    if (frame.best_dist >= 0) {
+      dist += frame.best_dist;
+      path.Append(frame.best);
+    }
+    frames_.pop_back();
+    Frame& parent = frames_.back();
+    // Only a strictly longer path wins, like GetFurthestLeaf.
+    if (dist > parent.best_dist) {
+      parent.best_dist = dist;
+      parent.best = path;
+    }
+    gap_start_ = pos + 1;
+    state_ = NEXT_TREE;
+  }
+
+  void StartNode(size_t pos) {
+    ++frames_.back().nodes;
+    // Most nodes are a single move, ";B[pd]". Take those in one step.
+    if (pos + 6 <= sgf_.size()) {
+      const char* p = sgf_.data() + pos;
+      if ((p[1] == 'B' || p[1] == 'W') && p[2] == '[' && p[5] == ']' &&
+          p[3] != ']' && p[3] != '\\' && p[4] != ']' && p[4] != '\\') {
+        color_ = p[1] == 'B' ? GoMove::BLACK : GoMove::WHITE;
+        is_move_ = true;
+        value_start_ = pos + 3;
+        skip_until_ = pos + 6;
+        EndValue(pos + 5);
+        return;
+      }
+    }
+    gap_start_ = pos + 1;
+    state_ = NODE_START;
+  }
+
+  void StartValue(size_t pos) {
+    is_move_ = MoveId(sgf_, gap_start_, pos, &color_);
+    value_start_ = pos + 1;
+    state_ = VALUE;
+  }
+
+  void EndValue(size_t pos) {
+    if (is_move_) {
+      MoveSequence& own = frames_.back().own;
+      const size_t len = pos - value_start_;
+      if (len == 0) {
+        own.Append(MoveToken(color_, true, -1, -1));
+      } else if (len == 2) {
+        const GoCoord x = absl::ascii_tolower(sgf_[value_start_]) - 'a';
+        const GoCoord y = absl::ascii_tolower(sgf_[value_start_ + 1]) - 'a';
+        own.Append(MoveToken(color_, false, x, y));
+      } else {
+        own.bad = true;
+      }
+    }
+    gap_start_ = pos + 1;
+    state_ = NEXT_VALUE;
+  }
+
+  const string_view sgf_;
+  std::vector<Frame> frames_;
+  State state_ = START;
+  size_t skip_until_ = 0;     // Characters before this are already handled.
+  size_t gap_start_ = 0;      // Where the text since the last token starts.
+  size_t value_start_ = 0;
+  bool is_move_ = false;      // Whether the current property is B or W.
+  GoMove::Color color_ = GoMove::BLACK;
+};
+
+}  // namespace
+
+uint64_t HashMoves(const std::vector<GoMove>& moves) {
+  MoveSequence sequence;
+  for (const auto& move : moves) {
+    sequence.Append(MoveToken(move.player, move.pass, move.move.first,
+                              move.move.second));
+  }
+  return sequence.hash;
+}
+
+bool ScanMainLine(string_view sgf, MainLineSummary* summary) {
+  return Scanner(sgf).Run(summary);
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,36 @@
+#ifndef SGF_PARSER_MOVE_SCANNER_H_
+#define SGF_PARSER_MOVE_SCANNER_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// The main line of a game as a move count and a fingerprint.
+struct MainLineSummary {
+  int64_t moves = 0;
+  uint64_t hash = 0;
+};
+
+// The fingerprint of a move sequence, e.g. GameRecord::moves.
+uint64_t HashMoves(const std::vector<GoMove>& moves);
+
+// Finds the main line of `sgf` the way SimpleParseSgf does, i.e. the longest
+// path to a leaf, and summarizes its moves without building a tree or a
+// GameRecord: for input SimpleParseSgf accepts, `summary->moves` equals
+// GameRecord::moves.size() and `summary->hash` equals HashMoves() of them.
+//
+// The input is scanned 16 bytes at a time for the characters which matter to
+// the structure, so comments and other values cost little more than reading
+// them. Returns false if the input is malformed or a move on the main line
+// isn't a point or a pass; it doesn't check everything the parser does, use
+// ValidateSgf() for that.
+bool ScanMainLine(absl::string_view sgf, MainLineSummary* summary);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_MOVE_SCANNER_H_
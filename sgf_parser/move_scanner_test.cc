@@ -0,0 +1,77 @@
+#include "sgf_parser/move_scanner.h"
+
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+// Scans `sgf` and checks the summary against SimpleParseSgf.
+void ExpectSameAsParser(const string& sgf) {
+  SCOPED_TRACE(sgf.substr(0, 80));
+  GameRecord record;
+  ASSERT_TRUE(SimpleParseSgf(sgf, &record, nullptr, nullptr));
+  MainLineSummary summary;
+  ASSERT_TRUE(ScanMainLine(sgf, &summary));
+  EXPECT_EQ(summary.moves, record.moves.size());
+  EXPECT_EQ(summary.hash, HashMoves(record.moves));
+}
+
+class MoveScannerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(MoveScannerTest, TestData) {
+  for (const char* file : {"testdata/handicapped.sgf", "testdata/resigned.sgf",
+                           "testdata/collection.sgf"}) {
+    const string sgf = ReadFileToString(file);
+    ASSERT_FALSE(sgf.empty()) << file;
+    ExpectSameAsParser(sgf);
+  }
+  MainLineSummary summary;
+  ASSERT_TRUE(ScanMainLine(ReadFileToString("testdata/resigned.sgf"),
+                           &summary));
+  EXPECT_EQ(summary.moves, 20);
+}
+
+TEST_F(MoveScannerTest, FollowsTheLongestVariation) {
+  ExpectSameAsParser("(;B[aa](;W[bb])(;W[cc];B[dd])(;W[ee];B[ff]))");
+  ExpectSameAsParser("(;B[aa](;W[bb];B[cc](;W[dd])(;W[ee];B[ff]))(;W[gg]))");
+  // The longest game of a collection.
+  ExpectSameAsParser("(;B[aa])(;B[bb];W[cc])(;B[dd])");
+
+  MainLineSummary first, second;
+  ASSERT_TRUE(ScanMainLine("(;B[aa](;W[bb];B[cc])(;W[cc];B[bb]))", &first));
+  ASSERT_TRUE(ScanMainLine("(;B[aa](;W[cc];B[bb])(;W[bb];B[cc]))", &second));
+  EXPECT_EQ(first.moves, 3);
+  EXPECT_NE(first.hash, second.hash);
+}
+
+TEST_F(MoveScannerTest, SkipsComments) {
+  ExpectSameAsParser("(;C[B[aa\\] (;W[bb\\]) ;B[cc\\]]B[dd];W[]C[(];b[ee]\n"
+                     "w\n[ff]AB[gg][hh]LB[ii:x])");
+  string comment(1000, ';');
+  ExpectSameAsParser("(;B[aa]C[" + comment + "];W[bb])");
+}
+
+TEST_F(MoveScannerTest, Malformed) {
+  MainLineSummary summary;
+  EXPECT_FALSE(ScanMainLine("", &summary));
+  EXPECT_FALSE(ScanMainLine("(;B[aa]", &summary));
+  EXPECT_FALSE(ScanMainLine("(;B[aa", &summary));
+  EXPECT_FALSE(ScanMainLine("(;B[aa]))", &summary));
+  EXPECT_FALSE(ScanMainLine("x(;B[aa])", &summary));
+  EXPECT_FALSE(ScanMainLine("(;B[abc])", &summary));
+}
+
+}  // namespace
+}  // namespace sgf_parser
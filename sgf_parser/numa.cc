@@ -0,0 +1,148 @@
+#include "sgf_parser/numa.h"
+
+#include <dirent.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+namespace {
+
+// Affinity masks hold this many CPUs; machines with more are rare enough that
+// their extra CPUs are simply never used for pinning.
+constexpr int kMaxCpus = 4096;
+constexpr int kMaskWords = kMaxCpus / (8 * sizeof(unsigned long));
+constexpr size_t kMaskBytes = kMaskWords * sizeof(unsigned long);
+
+cpu_set_t* AsCpuSet(std::vector<unsigned long>* mask) {
+  return reinterpret_cast<cpu_set_t*>(mask->data());
+}
+
+std::vector<int> AllowedCpus() {
+  std::vector<unsigned long> mask(kMaskWords);
+  std::vector<int> cpus;
+  if (sched_getaffinity(0, kMaskBytes, AsCpuSet(&mask)) == 0) {
+    for (int cpu = 0; cpu < kMaxCpus; ++cpu) {
+      if (CPU_ISSET_S(cpu, kMaskBytes, AsCpuSet(&mask))) cpus.push_back(cpu);
+    }
+  }
+  if (cpus.empty()) {
+    const int n = std::max(1u, std::thread::hardware_concurrency());
+    for (int cpu = 0; cpu < n; ++cpu) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+}  // namespace
+
+bool ParseCpuList(absl::string_view list, std::vector<int>* cpus) {
+  cpus->clear();
+  list = absl::StripAsciiWhitespace(list);
+  if (list.empty()) return true;
+  for (absl::string_view range : absl::StrSplit(list, ',')) {
+    std::pair<absl::string_view, absl::string_view> bounds =
+        absl::StrSplit(range, absl::MaxSplits('-', 1));
+    int first, last;
+    if (!absl::SimpleAtoi(bounds.first, &first)) return false;
+    if (bounds.second.empty() && !absl::StrContains(range, '-')) {
+      last = first;
+    } else if (!absl::SimpleAtoi(bounds.second, &last)) {
+      return false;
+    }
+    if (first < 0 || last < first) return false;
+    for (int cpu = first; cpu <= last; ++cpu) cpus->push_back(cpu);
+  }
+  return true;
+}
+
+std::vector<NumaNode> ReadNumaTopology() {
+  const std::vector<int> allowed = AllowedCpus();
+  std::vector<NumaNode> nodes;
+  const char kNodeDir[] = "/sys/devices/system/node";
+  if (DIR* dir = opendir(kNodeDir)) {
+    while (const dirent* entry = readdir(dir)) {
+      absl::string_view name = entry->d_name;
+      NumaNode node;
+      if (!absl::ConsumePrefix(&name, "node") ||
+          !absl::SimpleAtoi(name, &node.id)) {
+        continue;
+      }
+      std::ifstream in(std::string(kNodeDir) + "/" + entry->d_name +
+                       "/cpulist");
+      std::stringstream list;
+      list << in.rdbuf();
+      std::vector<int> cpus;
+      if (!in || !ParseCpuList(list.str(), &cpus)) {
+        LOG(WARNING) << "Can't read the CPUs of NUMA node " << node.id;
+        continue;
+      }
+      for (int cpu : cpus) {
+        if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+          node.cpus.push_back(cpu);
+        }
+      }
+      // Nodes of memory only, or of CPUs we may not use, get no workers.
+      if (!node.cpus.empty()) nodes.push_back(std::move(node));
+    }
+    closedir(dir);
+  }
+  if (nodes.empty()) {
+    NumaNode node;
+    node.cpus = allowed;
+    nodes.push_back(std::move(node));
+  }
+  std::sort(nodes.begin(), nodes.end(),
+            [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+  return nodes;
+}
+
+std::vector<CpuPlacement> PlaceThreads(const std::vector<NumaNode>& nodes,
+                                       int threads) {
+  std::vector<CpuPlacement> placements(std::max(0, threads));
+  if (nodes.empty()) return placements;
+  for (int i = 0; i < threads; ++i) {
+    const NumaNode& node = nodes[i % nodes.size()];
+    const int k = i / nodes.size();
+    placements[i].node = node.id;
+    if (!node.cpus.empty()) {
+      placements[i].cpu = node.cpus[k % node.cpus.size()];
+    }
+  }
+  return placements;
+}
+
+ScopedCpuPin::ScopedCpuPin(int cpu) : previous_(kMaskWords) {
+  if (cpu < 0 || cpu >= kMaxCpus) return;
+  if (sched_getaffinity(0, kMaskBytes, AsCpuSet(&previous_)) != 0) {
+    PLOG(WARNING) << "sched_getaffinity failed";
+    return;
+  }
+  std::vector<unsigned long> mask(kMaskWords);
+  CPU_SET_S(cpu, kMaskBytes, AsCpuSet(&mask));
+  if (sched_setaffinity(0, kMaskBytes, AsCpuSet(&mask)) != 0) {
+    PLOG(WARNING) << "Can't pin to CPU " << cpu;
+    return;
+  }
+  ok_ = true;
+}
+
+ScopedCpuPin::~ScopedCpuPin() {
+  if (ok_ && sched_setaffinity(0, kMaskBytes, AsCpuSet(&previous_)) != 0) {
+    PLOG(WARNING) << "Can't restore the CPU affinity";
+  }
+}
+
+}  // namespace sgf_parser
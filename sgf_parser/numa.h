@@ -0,0 +1,58 @@
+#ifndef SGF_PARSER_NUMA_H_
+#define SGF_PARSER_NUMA_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace sgf_parser {
+
+// A NUMA node and the CPUs of it which this process may run on.
+struct NumaNode {
+  int id = 0;
+  std::vector<int> cpus;
+};
+
+// Parses a Linux CPU list such as "0-3,8,10-11". Returns false if it is
+// malformed.
+bool ParseCpuList(absl::string_view list, std::vector<int>* cpus);
+
+// The nodes with CPUs in the affinity mask of the process, from
+// /sys/devices/system/node. Without NUMA support, or if sysfs can't be read,
+// a single node 0 with all allowed CPUs.
+std::vector<NumaNode> ReadNumaTopology();
+
+// Where a worker thread runs.
+struct CpuPlacement {
+  int cpu = -1;
+  int node = 0;
+};
+
+// Places `threads` workers so consecutive workers alternate between nodes,
+// and workers of a node take its CPUs in order before sharing any.
+std::vector<CpuPlacement> PlaceThreads(const std::vector<NumaNode>& nodes,
+                                       int threads);
+
+// Pins the calling thread to one CPU for the lifetime of the object, then
+// restores its previous affinity. Pinning is best effort: ok() is false if the
+// kernel refused.
+class ScopedCpuPin {
+ public:
+  explicit ScopedCpuPin(int cpu);
+  ~ScopedCpuPin();
+
+  ScopedCpuPin(const ScopedCpuPin&) = delete;
+  ScopedCpuPin& operator=(const ScopedCpuPin&) = delete;
+
+  bool ok() const { return ok_; }
+
+ private:
+  bool ok_ = false;
+  std::vector<unsigned long> previous_;   // A cpu_set_t of any size.
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_NUMA_H_
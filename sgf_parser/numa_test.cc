@@ -0,0 +1,78 @@
+#include "sgf_parser/numa.h"
+
+#include <sched.h>
+
+#include <set>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::testing::ElementsAre;
+
+int AllowedCpuCount() {
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  if (sched_getaffinity(0, sizeof(mask), &mask) != 0) return -1;
+  return CPU_COUNT(&mask);
+}
+
+TEST(NumaTest, ParseCpuList) {
+  std::vector<int> cpus;
+  EXPECT_TRUE(ParseCpuList("0-3,8,10-11\n", &cpus));
+  EXPECT_THAT(cpus, ElementsAre(0, 1, 2, 3, 8, 10, 11));
+  EXPECT_TRUE(ParseCpuList("5", &cpus));
+  EXPECT_THAT(cpus, ElementsAre(5));
+  EXPECT_TRUE(ParseCpuList("\n", &cpus));   // A node without CPUs.
+  EXPECT_TRUE(cpus.empty());
+  for (const char* bad : {"1,,2", "3-", "-3", "4-2", "x", "1-2-3"}) {
+    EXPECT_FALSE(ParseCpuList(bad, &cpus)) << bad;
+  }
+}
+
+TEST(NumaTest, PlaceThreads) {
+  std::vector<NumaNode> nodes(2);
+  nodes[0].id = 0;
+  nodes[0].cpus = {0, 1};
+  nodes[1].id = 1;
+  nodes[1].cpus = {2, 3, 4};
+  const std::vector<CpuPlacement> placements = PlaceThreads(nodes, 7);
+  std::vector<int> cpus, node_ids;
+  for (const CpuPlacement& placement : placements) {
+    cpus.push_back(placement.cpu);
+    node_ids.push_back(placement.node);
+  }
+  EXPECT_THAT(cpus, ElementsAre(0, 2, 1, 3, 0, 4, 1));
+  EXPECT_THAT(node_ids, ElementsAre(0, 1, 0, 1, 0, 1, 0));
+}
+
+TEST(NumaTest, ReadNumaTopology) {
+  const std::vector<NumaNode> nodes = ReadNumaTopology();
+  ASSERT_FALSE(nodes.empty());
+  std::set<int> cpus;
+  for (const NumaNode& node : nodes) {
+    EXPECT_FALSE(node.cpus.empty());
+    for (int cpu : node.cpus) EXPECT_TRUE(cpus.insert(cpu).second) << cpu;
+  }
+  EXPECT_EQ(cpus.size(), AllowedCpuCount());
+}
+
+TEST(NumaTest, ScopedCpuPin) {
+  const int allowed = AllowedCpuCount();
+  const int cpu = ReadNumaTopology().back().cpus.back();
+  {
+    ScopedCpuPin pin(cpu);
+    ASSERT_TRUE(pin.ok());
+    EXPECT_EQ(AllowedCpuCount(), 1);
+    EXPECT_EQ(sched_getcpu(), cpu);
+  }
+  EXPECT_EQ(AllowedCpuCount(), allowed);
+  ScopedCpuPin invalid(-1);
+  EXPECT_FALSE(invalid.ok());
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,194 @@
+#include "sgf_parser/page_buffer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/mempolicy.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/strip.h"
+#include "glog/logging.h"
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << MAP_HUGE_SHIFT)
+#endif
+
+namespace sgf_parser {
+
+namespace {
+
+// Node masks passed to mbind() hold this many nodes.
+constexpr int kMaxNodes = 4096;
+
+size_t RoundUp(size_t size, size_t unit) {
+  return (size + unit - 1) / unit * unit;
+}
+
+// Whether madvise(MADV_HUGEPAGE) can get transparent huge pages, i.e. THP is
+// not disabled with "never".
+bool TransparentHugePagesEnabled() {
+  static const bool enabled = [] {
+    std::ifstream in("/sys/kernel/mm/transparent_hugepage/enabled");
+    std::string mode;
+    if (!std::getline(in, mode)) return false;
+    return !absl::StrContains(mode, "[never]");
+  }();
+  return enabled;
+}
+
+}  // namespace
+
+const char* PageBackingName(PageBacking backing) {
+  switch (backing) {
+    case PageBacking::SMALL:
+      return "small";
+    case PageBacking::TRANSPARENT:
+      return "transparent";
+    case PageBacking::HUGETLB:
+      return "hugetlb";
+  }
+  return "unknown";
+}
+
+PageBuffer::PageBuffer(size_t size, const PageBufferOptions& options)
+    : size_(size) {
+  if (size == 0) return;
+  const size_t page = sysconf(_SC_PAGESIZE);
+  void* p = MAP_FAILED;
+  if (options.huge_pages && size >= kHugePageBytes) {
+    mapped_ = RoundUp(size, kHugePageBytes);
+    p = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB, -1, 0);
+    if (p != MAP_FAILED) {
+      backing_ = PageBacking::HUGETLB;
+      mapping_ = data_ = static_cast<char*>(p);
+    } else if (TransparentHugePagesEnabled()) {
+      // Huge pages need 2 MB aligned addresses. Map a huge page more than
+      // needed and trim it.
+      p = mmap(nullptr, mapped_ + kHugePageBytes, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (p == MAP_FAILED) {
+        PLOG(FATAL) << "mmap of " << mapped_ << " bytes failed";
+      }
+      char* start = static_cast<char*>(p);
+      char* aligned = reinterpret_cast<char*>(
+          RoundUp(reinterpret_cast<uintptr_t>(start), kHugePageBytes));
+      if (aligned > start) munmap(start, aligned - start);
+      munmap(aligned + mapped_, start + kHugePageBytes - aligned);
+      mapping_ = data_ = aligned;
+      if (madvise(data_, mapped_, MADV_HUGEPAGE) == 0) {
+        backing_ = PageBacking::TRANSPARENT;
+      } else {
+        VLOG(1) << "madvise(MADV_HUGEPAGE) failed: " << strerror(errno);
+      }
+    }
+  }
+  if (data_ == nullptr) {
+    mapped_ = RoundUp(size, page);
+    p = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+      PLOG(FATAL) << "mmap of " << mapped_ << " bytes failed";
+    }
+    mapping_ = data_ = static_cast<char*>(p);
+  }
+
+  // No libnuma: set the policy with the system call. It fails without NUMA
+  // support, where first touch below is as good.
+  if (options.node >= 0 && options.node < kMaxNodes) {
+    std::vector<unsigned long> nodes(kMaxNodes / (8 * sizeof(unsigned long)));
+    nodes[options.node / (8 * sizeof(unsigned long))] |=
+        1UL << (options.node % (8 * sizeof(unsigned long)));
+    if (syscall(SYS_mbind, mapping_, mapped_, MPOL_PREFERRED, nodes.data(),
+                kMaxNodes + 1, 0) != 0) {
+      VLOG(1) << "mbind to node " << options.node
+              << " failed: " << strerror(errno);
+    }
+  }
+  for (size_t offset = 0; offset < mapped_; offset += page) {
+    data_[offset] = 0;
+  }
+}
+
+PageBuffer::~PageBuffer() {
+  if (mapping_ != nullptr) munmap(mapping_, mapped_);
+}
+
+size_t PageBuffer::HugePageBytes() const {
+  if (backing_ == PageBacking::HUGETLB) return size_;
+  if (backing_ == PageBacking::SMALL) return 0;
+  // The block of the mapping starts with its address range, "start-end ...",
+  // followed by "Field: value kB" lines.
+  std::ifstream smaps("/proc/self/smaps");
+  const uintptr_t address = reinterpret_cast<uintptr_t>(data_);
+  bool in_mapping = false;
+  std::string line;
+  while (std::getline(smaps, line)) {
+    absl::string_view field = line;
+    if (absl::ConsumePrefix(&field, "AnonHugePages:")) {
+      if (!in_mapping) continue;
+      field = absl::StripAsciiWhitespace(field);
+      size_t kb = 0;
+      if (!absl::ConsumeSuffix(&field, " kB") ||
+          !absl::SimpleAtoi(field, &kb)) {
+        return 0;
+      }
+      return std::min(kb << 10, size_);
+    }
+    const std::vector<absl::string_view> range =
+        absl::StrSplit(absl::string_view(line).substr(0, line.find(' ')),
+                       absl::MaxSplits('-', 1));
+    uint64_t start, end;
+    if (range.size() == 2 && absl::SimpleHexAtoi(range[0], &start) &&
+        absl::SimpleHexAtoi(range[1], &end)) {
+      in_mapping = start <= address && address < end;
+    }
+  }
+  return 0;
+}
+
+std::unique_ptr<PageBuffer> ReadFileToPageBuffer(
+    const std::string& filename, const PageBufferOptions& options,
+    std::string* error) {
+  const int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = absl::StrCat("Can't open ", filename, ": ", strerror(errno));
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    *error = absl::StrCat("Can't stat ", filename, ": ", strerror(errno));
+    close(fd);
+    return nullptr;
+  }
+  std::unique_ptr<PageBuffer> buffer(new PageBuffer(st.st_size, options));
+  size_t done = 0;
+  while (done < buffer->size()) {
+    const ssize_t n =
+        pread(fd, buffer->data() + done, buffer->size() - done, done);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      *error = n < 0 ? absl::StrCat("Can't read ", filename, ": ",
+                                    strerror(errno))
+                     : absl::StrCat(filename, " got shorter while reading.");
+      close(fd);
+      return nullptr;
+    }
+    done += n;
+  }
+  close(fd);
+  return buffer;
+}
+
+}  // namespace sgf_parser
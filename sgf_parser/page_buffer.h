@@ -0,0 +1,73 @@
+#ifndef SGF_PARSER_PAGE_BUFFER_H_
+#define SGF_PARSER_PAGE_BUFFER_H_
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+namespace sgf_parser {
+
+// Size of the huge pages a PageBuffer asks for.
+constexpr size_t kHugePageBytes = 2 << 20;
+
+// How the pages of a PageBuffer are backed.
+enum class PageBacking {
+  SMALL,         // Base pages, 4 KB on x86.
+  TRANSPARENT,   // Transparent huge pages, requested with madvise(). The kernel
+                 // backs what it can with 2 MB pages, the rest with base pages.
+  HUGETLB,       // 2 MB pages reserved by the administrator, in
+                 // vm.nr_hugepages.
+};
+
+const char* PageBackingName(PageBacking backing);
+
+struct PageBufferOptions {
+  // Back the buffer with 2 MB pages, so scanning a large buffer misses the TLB
+  // 512 times less often: reserved huge pages if there are enough free, else
+  // transparent huge pages, else base pages. Buffers smaller than a huge page
+  // always get base pages.
+  bool huge_pages = false;
+
+  // Prefer memory of this NUMA node; -1 for any. Either way the pages are
+  // touched by the constructing thread, so without mbind() support they still
+  // land on its node by first touch: construct the buffer on the thread,
+  // pinned, which will use it.
+  int node = -1;
+};
+
+// Zeroed memory mapped for the buffers the parser scans: loader arenas, file
+// contents and corpora.
+class PageBuffer {
+ public:
+  PageBuffer(size_t size, const PageBufferOptions& options);
+  ~PageBuffer();
+
+  PageBuffer(const PageBuffer&) = delete;
+  PageBuffer& operator=(const PageBuffer&) = delete;
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+  PageBacking backing() const { return backing_; }
+
+  // Bytes actually backed by huge pages, from /proc/self/smaps. For
+  // PageBacking::TRANSPARENT it may be anything from 0 to the whole buffer.
+  size_t HugePageBytes() const;
+
+ private:
+  char* data_ = nullptr;
+  size_t size_;
+  char* mapping_ = nullptr;   // data_ minus the alignment padding.
+  size_t mapped_ = 0;
+  PageBacking backing_ = PageBacking::SMALL;
+};
+
+// Reads a whole file into a PageBuffer of its size. Returns null, with a
+// message in `error`, if the file can't be read.
+std::unique_ptr<PageBuffer> ReadFileToPageBuffer(
+    const std::string& filename, const PageBufferOptions& options,
+    std::string* error);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_PAGE_BUFFER_H_
@@ -0,0 +1,82 @@
+#include "sgf_parser/page_buffer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+TEST(PageBufferTest, ZeroedAndWritable) {
+  for (bool huge_pages : {false, true}) {
+    for (size_t size : {size_t{0}, size_t{1}, size_t{4096}, size_t{100000},
+                        kHugePageBytes + 1}) {
+      PageBufferOptions options;
+      options.huge_pages = huge_pages;
+      options.node = 0;
+      PageBuffer buffer(size, options);
+      EXPECT_EQ(buffer.size(), size);
+      for (size_t i = 0; i < size; ++i) {
+        ASSERT_EQ(buffer.data()[i], 0) << i;
+        buffer.data()[i] = i;
+      }
+      if (!huge_pages || size < kHugePageBytes) {
+        EXPECT_EQ(buffer.backing(), PageBacking::SMALL);
+        EXPECT_EQ(buffer.HugePageBytes(), 0);
+      }
+    }
+  }
+}
+
+TEST(PageBufferTest, HugePages) {
+  PageBufferOptions options;
+  options.huge_pages = true;
+  PageBuffer buffer(3 * kHugePageBytes, options);
+  // Which backing we get depends on the machine; each has its guarantees.
+  LOG(INFO) << PageBackingName(buffer.backing()) << " pages, "
+            << buffer.HugePageBytes() << " bytes in huge pages";
+  if (buffer.backing() != PageBacking::SMALL) {
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(buffer.data()) % kHugePageBytes, 0);
+  }
+  if (buffer.backing() == PageBacking::HUGETLB) {
+    EXPECT_EQ(buffer.HugePageBytes(), 3 * kHugePageBytes);
+  } else {
+    EXPECT_LE(buffer.HugePageBytes(), 3 * kHugePageBytes);
+  }
+}
+
+TEST(PageBufferTest, ReadFileToPageBuffer) {
+  const char* tmp = getenv("TEST_TMPDIR");
+  const string filename = string(tmp != nullptr ? tmp : "/tmp") +
+                          "/page_buffer_test";
+  string contents;
+  for (int i = 0; i < 100000; ++i) contents.push_back('a' + i % 26);
+  std::ofstream(filename) << contents;
+  for (bool huge_pages : {false, true}) {
+    PageBufferOptions options;
+    options.huge_pages = huge_pages;
+    string error;
+    std::unique_ptr<PageBuffer> buffer =
+        ReadFileToPageBuffer(filename, options, &error);
+    ASSERT_TRUE(buffer != nullptr) << error;
+    EXPECT_EQ(string(buffer->data(), buffer->size()), contents);
+  }
+
+  string error;
+  EXPECT_TRUE(ReadFileToPageBuffer("testdata/does_not_exist",
+                                   PageBufferOptions(), &error) == nullptr);
+  EXPECT_FALSE(error.empty());
+  remove(filename.c_str());
+}
+
+}  // namespace
+}  // namespace sgf_parser
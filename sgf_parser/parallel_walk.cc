@@ -0,0 +1,85 @@
+#include "sgf_parser/parallel_walk.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using internal::GameTree;
+
+namespace {
+
+// Shared by the tasks of one ParallelWalk() call.
+struct WalkState {
+  ThreadPool* pool;
+  const std::function<void(const VariationNode&)>* visitor;
+
+  std::atomic<int64_t> pending{0};
+  std::mutex mu;
+  std::condition_variable done;
+};
+
+void WalkVariation(WalkState* state, const GameTree* game,
+                   const GameTree* tree, GoBoard* board, int depth);
+
+void ScheduleVariation(WalkState* state, const GameTree* game,
+                       const GameTree* tree, GoBoard board, int depth) {
+  state->pending.fetch_add(1);
+  // std::function requires a copyable callable, hence the shared_ptr.
+  auto snapshot = std::make_shared<GoBoard>(std::move(board));
+  state->pool->Schedule([state, game, tree, snapshot, depth] {
+    WalkVariation(state, game, tree, snapshot.get(), depth);
+    // Decrement under the lock, so ParallelWalk() can't return and destroy
+    // the state before this task is done with it.
+    std::lock_guard<std::mutex> lock(state->mu);
+    if (state->pending.fetch_sub(1) == 1) {
+      state->done.notify_all();
+    }
+  });
+}
+
+void WalkVariation(WalkState* state, const GameTree* game,
+                   const GameTree* tree, GoBoard* board, int depth) {
+  while (true) {
+    for (size_t i = 0; i < tree->sequence.size(); ++i) {
+      ApplyNode(tree->sequence[i], board);
+      board->ClearHistory();   // Never undone.
+      (*state->visitor)(VariationNode{game, tree, i, depth, board});
+      ++depth;
+    }
+    if (tree->children.empty()) return;
+    for (size_t i = 1; i < tree->children.size(); ++i) {
+      ScheduleVariation(state, game, tree->children[i].get(),
+                        board->Snapshot(), depth);
+    }
+    tree = tree->children[0].get();
+  }
+}
+
+}  // namespace
+
+void ParallelWalk(const GameTree& root, ThreadPool* pool,
+                  const std::function<void(const VariationNode&)>& visitor) {
+  CHECK_LT(pool->CurrentWorker(), 0)
+      << "ParallelWalk() called from a worker of the pool.";
+  WalkState state;
+  state.pool = pool;
+  state.visitor = &visitor;
+  // Keep the count above zero until all games are scheduled.
+  state.pending.fetch_add(1);
+  for (const auto& game : root.children) {
+    if (game->sequence.empty()) continue;
+    const GoCoord size = GetBoardSize(game->sequence[0]);
+    ScheduleVariation(&state, game.get(), game.get(), GoBoard(size, size), 0);
+  }
+  std::unique_lock<std::mutex> lock(state.mu);
+  state.pending.fetch_sub(1);
+  state.done.wait(lock, [&state] { return state.pending.load() == 0; });
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,40 @@
+#ifndef SGF_PARSER_PARALLEL_WALK_H_
+#define SGF_PARSER_PARALLEL_WALK_H_
+
+#include <stddef.h>
+
+#include <functional>
+
+#include "sgf_parser/board.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/thread_pool.h"
+
+namespace sgf_parser {
+
+// A node visited by ParallelWalk().
+struct VariationNode {
+  const internal::GameTree* game;   // The top level tree of the game.
+  const internal::GameTree* tree;   // The node is tree->sequence[index].
+  size_t index;
+  int depth;                        // Number of steps from the first node.
+  const GoBoard* board;             // The position after the node.
+};
+
+// Visits every node of every game under `root`, as filled by
+// internal::ParseToRoot, together with the position after the node.
+//
+// Each variation is a task on `pool`: the task walks the sequence of its tree
+// and continues into the first subtree itself, while every other subtree
+// becomes a new task with a snapshot of the board at the branch point. Idle
+// workers steal those tasks, so large analysis trees are processed by all
+// cores.
+//
+// `visitor` is called concurrently from the workers. Calls for the nodes of
+// one line of play are made in order, from parent to child. Blocks until all
+// nodes have been visited; must not be called from a worker of `pool`.
+void ParallelWalk(const internal::GameTree& root, ThreadPool* pool,
+                  const std::function<void(const VariationNode&)>& visitor);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_PARALLEL_WALK_H_
@@ -0,0 +1,45 @@
+#include "sgf_parser/parallel_walk.h"
+
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "sgf_parser/tree_cursor.h"
+
+namespace sgf_parser {
+namespace {
+
+typedef std::pair<const internal::GameTree*, size_t> NodeId;
+
+TEST(ParallelWalkTest, VisitsEveryNodeWithItsPosition) {
+  const char kCollection[] =
+      "(;SZ[9];B[aa];W[bb](;B[cc](;W[dd])(;W[ba];B[ab]))(;B[dd]))"
+      "(;SZ[13];B[mm](;W[ll])(;W[aa])(;W[bb]))";
+  internal::GameTree root(nullptr);
+  ASSERT_TRUE(internal::ParseToRoot(kCollection, &root, nullptr));
+
+  ThreadPool pool(4);
+  std::mutex mu;
+  std::map<NodeId, std::pair<int, uint64_t>> visited;
+  ParallelWalk(root, &pool, [&](const VariationNode& node) {
+    std::lock_guard<std::mutex> lock(mu);
+    EXPECT_TRUE(visited.emplace(NodeId(node.tree, node.index),
+                                std::make_pair(node.depth,
+                                               node.board->hash())).second);
+  });
+  EXPECT_EQ(visited.size(), 13);
+
+  for (const auto& game : root.children) {
+    TreeCursor cursor(game.get());
+    for (const auto& entry : visited) {
+      if (!cursor.JumpTo(entry.first.first, entry.first.second)) continue;
+      EXPECT_EQ(entry.second.first, cursor.depth());
+      EXPECT_EQ(entry.second.second, cursor.board().hash());
+    }
+  }
+}
+
+}  // namespace
+}  // namespace sgf_parser
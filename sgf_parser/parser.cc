@@ -1,6 +1,7 @@
 #include "sgf_parser/parser.h"
 
 #include <math.h>       /* fabs */
+#include <algorithm>
 #include <fstream>
 #include <memory>
 #include <vector>
@@ -47,6 +48,9 @@ void GameRecord::Reset() {
   result = 0.0f;
   resigned = false;
 
+  black_stones.clear();
+  white_stones.clear();
+  moves.clear();
   black_name.clear();
   black_rank.clear();
   white_name.clear();
@@ -114,6 +118,18 @@ string GameRecord::DebugString() const {
 
 namespace internal {
 
+GameTree::~GameTree() {
+  std::vector<std::unique_ptr<GameTree>> pending = std::move(children);
+  while (!pending.empty()) {
+    std::unique_ptr<GameTree> tree = std::move(pending.back());
+    pending.pop_back();
+    for (auto& child : tree->children) {
+      pending.push_back(std::move(child));
+    }
+    tree->children.clear();
+  }
+}
+
 void DumpTree(const GameTree& tree, int level) {
   string indent(level * 2, ' ');
   LOG(INFO) << indent << "A tree at level " << level;
@@ -137,19 +153,77 @@ void DumpRoot(const GameTree& root) {
   }
 }
 
-GameTree* NewChild(GameTree* current) {
-  GameTree* child = new GameTree(current);
-  current->children.emplace_back(absl::WrapUnique<GameTree>(child));
+void RecycleSequence(GameTree* tree, TreePool* pool) {
+  for (auto& node : tree->sequence) {
+    for (auto& prop : node) {
+      prop.values.clear();
+      pool->values.push_back(std::move(prop.values));
+    }
+    node.clear();
+    pool->nodes.push_back(std::move(node));
+  }
+  tree->sequence.clear();
+}
+
+void TreePool::Recycle(GameTree* root) {
+  // Trees are visited in pre-order, the order parsing creates them in, and
+  // reversed at the end since parsing takes from the back: parsing the same
+  // input again puts every buffer back where it was.
+  const size_t first_tree = trees.size();
+  const size_t first_node = nodes.size();
+  const size_t first_values = values.size();
+  RecycleSequence(root, this);
+  pending.clear();
+  for (auto it = root->children.rbegin(); it != root->children.rend(); ++it) {
+    pending.push_back(std::move(*it));
+  }
+  root->children.clear();
+  while (!pending.empty()) {
+    std::unique_ptr<GameTree> tree = std::move(pending.back());
+    pending.pop_back();
+    RecycleSequence(tree.get(), this);
+    for (auto it = tree->children.rbegin(); it != tree->children.rend(); ++it) {
+      pending.push_back(std::move(*it));
+    }
+    tree->children.clear();
+    tree->parent = nullptr;
+    trees.push_back(std::move(tree));
+  }
+  std::reverse(trees.begin() + first_tree, trees.end());
+  std::reverse(nodes.begin() + first_node, nodes.end());
+  std::reverse(values.begin() + first_values, values.end());
+}
+
+GameTree* NewChild(GameTree* current, TreePool* pool) {
+  if (pool == nullptr || pool->trees.empty()) {
+    GameTree* child = new GameTree(current);
+    current->children.emplace_back(absl::WrapUnique<GameTree>(child));
+    return child;
+  }
+  current->children.push_back(std::move(pool->trees.back()));
+  pool->trees.pop_back();
+  GameTree* child = current->children.back().get();
+  child->parent = current;
   return child;
 }
 
-GameNode* NewNode(GameTree* current) {
-  current->sequence.emplace_back(GameNode());
+GameNode* NewNode(GameTree* current, TreePool* pool) {
+  if (pool == nullptr || pool->nodes.empty()) {
+    current->sequence.emplace_back(GameNode());
+  } else {
+    current->sequence.push_back(std::move(pool->nodes.back()));
+    pool->nodes.pop_back();
+  }
   return &current->sequence.back();
 }
 
-Property* NewProperty(string_view property_id, GameNode* node) {
+Property* NewProperty(string_view property_id, GameNode* node,
+                      TreePool* pool) {
   node->emplace_back(Property(property_id));
+  if (pool != nullptr && !pool->values.empty()) {
+    node->back().values.swap(pool->values.back());
+    pool->values.pop_back();
+  }
   return &node->back();
 }
 
@@ -162,7 +236,8 @@ string_view SubstrAndStripWhitespace(
 
 string_view::size_type FindFirst(string_view sgf, string_view::size_type start,
                                  string_view targets, bool expect_contents) {
-  VLOG(2) << "Searching at the position: " << sgf.substr(start);
+  // Only log a prefix; logging the whole remainder makes parsing quadratic.
+  VLOG(2) << "Searching at the position: " << sgf.substr(start, 32);
   bool escaping = false;
   for (; start < sgf.size(); ++start) {
     if (escaping) {
@@ -184,9 +259,25 @@ string_view::size_type FindFirst(string_view sgf, string_view::size_type start,
 #define RETURN_IF_NPOS(pos, msg, retval) \
     RETURN_IF((pos) == string_view::npos, msg, retval)
 
+// Takes one unit from `budget`. Returns false if it is used up.
+bool Charge(int64_t* budget) {
+  if (*budget < 0) return true;
+  if (*budget == 0) return false;
+  --*budget;
+  return true;
+}
+
 string_view::size_type ConsumeNode(string_view sgf,
                                    string_view::size_type start,
                                    GameNode* node, string* errors) {
+  ParseBudget unlimited;
+  return ConsumeNode(sgf, start, node, &unlimited, nullptr, errors);
+}
+
+string_view::size_type ConsumeNode(string_view sgf,
+                                   string_view::size_type start,
+                                   GameNode* node, ParseBudget* budget,
+                                   TreePool* pool, string* errors) {
   enum State {
     NODE_START  = 2,     //   '['  -->  VALUE_START
     VALUE_START = 6,     //   ']'  -->  NEXT_VALUE
@@ -204,13 +295,19 @@ string_view::size_type ConsumeNode(string_view sgf,
       auto p = FindFirst(sgf, cursor, "[", true);
       RETURN_IF_NPOS(p, "Reach the end of of node.", p);
       auto id = SubstrAndStripWhitespace(sgf, cursor, p - cursor);
-      current_property = NewProperty(id, node);
+      RETURN_IF(!Charge(&budget->properties),
+                "Exceeded the maximum number of properties.",
+                string_view::npos);
+      current_property = NewProperty(id, node, pool);
       state = VALUE_START;
       cursor = p + 1;
     } else if (state == VALUE_START) {
       VLOG(2) << "Enter state VALUE_START";
       auto p = FindFirst(sgf, cursor, "]", true);
       RETURN_IF_NPOS(p, "Missing the end of a property value.", p);
+      RETURN_IF(!Charge(&budget->values),
+                "Exceeded the maximum number of property values.",
+                string_view::npos);
       // Extract property value.
       current_property->values.emplace_back(sgf.substr(cursor, p - cursor));
       state = NEXT_VALUE;
@@ -222,7 +319,10 @@ string_view::size_type ConsumeNode(string_view sgf,
       string_view gap = SubstrAndStripWhitespace(sgf, cursor, p - cursor);
       if (sgf[p] == '[') {
         if (!gap.empty()) {
-          current_property = NewProperty(gap, node);
+          RETURN_IF(!Charge(&budget->properties),
+                    "Exceeded the maximum number of properties.",
+                    string_view::npos);
+          current_property = NewProperty(gap, node, pool);
         }
         state = VALUE_START;
       } else {   // ';', '(' or ')'
@@ -240,6 +340,16 @@ string_view::size_type ConsumeNode(string_view sgf,
 // Return false if the input is ill-formatted.
 // All errors are saved to "errors" if it is not null.
 bool ParseToRoot(string_view sgf, GameTree* root, string* errors) {
+  return ParseToRoot(sgf, ParseLimits(), nullptr, root, errors);
+}
+
+bool ParseToRoot(string_view sgf, const ParseLimits& limits, GameTree* root,
+                 string* errors) {
+  return ParseToRoot(sgf, limits, nullptr, root, errors);
+}
+
+bool ParseToRoot(string_view sgf, const ParseLimits& limits, TreePool* pool,
+                 GameTree* root, string* errors) {
   enum State {
     START = 0,         // Start of everything,   '('  -->  TREE_START
     TREE_START = 1,    // Enter a new tree,      ';'  -->  NODE_START
@@ -252,6 +362,17 @@ bool ParseToRoot(string_view sgf, GameTree* root, string* errors) {
     END = 4,           // The final state.
   };
 
+  RETURN_IF(limits.max_bytes > 0 && sgf.size() > limits.max_bytes,
+            "Exceeded the maximum input size.", false);
+  ParseBudget budget;
+  if (limits.max_properties > 0) budget.properties = limits.max_properties;
+  if (limits.max_values > 0) budget.values = limits.max_values;
+  int64_t nodes_left = limits.max_nodes > 0 ? limits.max_nodes : -1;
+  int depth = 0;
+  const auto too_deep = [&limits, &depth]() {
+    return limits.max_depth > 0 && depth >= limits.max_depth;
+  };
+
   GameTree* current_tree = root;
   State state = START;
   string_view::size_type cursor = 0;
@@ -262,7 +383,8 @@ bool ParseToRoot(string_view sgf, GameTree* root, string* errors) {
       RETURN_IF_NPOS(p, "Failed in finding a tree start.", false);
       cursor = p + 1;
       state = TREE_START;
-      current_tree = NewChild(current_tree);
+      current_tree = NewChild(current_tree, pool);
+      ++depth;
     } else if (state == TREE_START) {
       VLOG(2) << "Tree start.";
       auto p = FindFirst(sgf, cursor, ";", false);
@@ -271,7 +393,10 @@ bool ParseToRoot(string_view sgf, GameTree* root, string* errors) {
       cursor = p + 1;
     } else if (state == NODE_START) {
       VLOG(2) << "Node start.";
-      auto p = ConsumeNode(sgf, cursor, NewNode(current_tree), errors);
+      RETURN_IF(!Charge(&nodes_left), "Exceeded the maximum number of nodes.",
+                false);
+      auto p = ConsumeNode(sgf, cursor, NewNode(current_tree, pool), &budget,
+                           pool, errors);
       RETURN_IF_NPOS(p, "Error in parsing a node.", false);
       if (sgf[p] == ';') {
         state = NODE_START;
@@ -279,9 +404,12 @@ bool ParseToRoot(string_view sgf, GameTree* root, string* errors) {
         current_tree = current_tree->parent;
         RETURN_IF(current_tree == nullptr,
                   "Trying to going up in the root tree.", false);
+        --depth;
         state = NEXT_TREE;
       } else if (sgf[p] == '(') {
-        current_tree = NewChild(current_tree);
+        RETURN_IF(too_deep(), "Exceeded the maximum tree depth.", false);
+        current_tree = NewChild(current_tree, pool);
+        ++depth;
         state = TREE_START;
       }
       cursor = p + 1;
@@ -291,12 +419,15 @@ bool ParseToRoot(string_view sgf, GameTree* root, string* errors) {
       if (p == string_view::npos) {
         state = END;
       } else if (sgf[p] == '(') {
-        current_tree = NewChild(current_tree);
+        RETURN_IF(too_deep(), "Exceeded the maximum tree depth.", false);
+        current_tree = NewChild(current_tree, pool);
+        ++depth;
         state = TREE_START;
       } else if (sgf[p] == ')') {
         current_tree = current_tree->parent;
         RETURN_IF(current_tree == nullptr,
                   "Trying to going up in the root tree.", false);
+        --depth;
         state = NEXT_TREE;
       }
       cursor = p + 1;
@@ -310,29 +441,52 @@ bool ParseToRoot(string_view sgf, GameTree* root, string* errors) {
 
 #undef RETURN_IF_NPOS
 
-std::pair<const GameTree*, int> GetFurthestLeaf(const GameTree* root) {
-  if (root->children.empty()) {
-    // This is already a leaf node. Return this node.
-    return std::make_pair(root, root->sequence.size());
-  }
-  const GameTree* furthest_leaf = nullptr;
+// `stack` is scratch space, empty on return.
+std::pair<const GameTree*, int> GetFurthestLeaf(
+    const GameTree* root, std::vector<std::pair<const GameTree*, int>>* stack) {
+  // Depth first, with an explicit stack so deep trees can't overflow the call
+  // stack. Children are visited in order and only a strictly longer path
+  // replaces the best one, so ties go to the first variation.
+  const GameTree* furthest_leaf = root;
   int longest_dist = -1;
-  for (const auto& child : root->children) {
-    auto r = GetFurthestLeaf(child.get());
-    if (r.second > longest_dist) {
-      furthest_leaf = r.first;
-      longest_dist = r.second;
+  stack->emplace_back(root, root->sequence.size());
+  while (!stack->empty()) {
+    const GameTree* tree = stack->back().first;
+    const int dist = stack->back().second;
+    stack->pop_back();
+    if (tree->children.empty()) {
+      if (dist > longest_dist) {
+        furthest_leaf = tree;
+        longest_dist = dist;
+      }
+      continue;
+    }
+    for (auto it = tree->children.rbegin(); it != tree->children.rend(); ++it) {
+      stack->emplace_back(it->get(), dist + (*it)->sequence.size());
     }
   }
-  return std::make_pair(furthest_leaf, longest_dist + root->sequence.size());
+  return std::make_pair(furthest_leaf, longest_dist);
 }
 
-}  // namespace internal
+// Assigns in place, so a reused record keeps its string buffers.
+void AssignValue(string_view value, string* field) {
+  field->assign(value.data(), value.size());
+}
 
-bool HandleProperty(const internal::Property& prop, GameRecord* record,
+bool HandleProperty(const Property& prop, GameRecord* record,
                     std::vector<std::pair<string, string>>* unparsed,
                     string* errors) {
-  const string id = absl::AsciiStrToUpper(prop.id);
+  // All the ids handled below have one or two letters, so upper-casing them
+  // into a fixed buffer is enough, and never allocates. Longer ids are left
+  // empty and end up in `unparsed`.
+  char upper[2];
+  string_view id;
+  if (prop.id.size() <= sizeof(upper)) {
+    for (size_t i = 0; i < prop.id.size(); ++i) {
+      upper[i] = absl::ascii_toupper(prop.id[i]);
+    }
+    id = string_view(upper, prop.id.size());
+  }
   if (id == "SZ") {
     RETURN_IF(prop.values.size() != 1, "Bad SZ property.", false);
     int size = 0;
@@ -361,41 +515,42 @@ bool HandleProperty(const internal::Property& prop, GameRecord* record,
     }
   } else if (id == "RU") {
     RETURN_IF(prop.values.size() != 1, "Bad rule.", false);
-    record->rule = string(prop.values[0]);
+    AssignValue(prop.values[0], &record->rule);
   } else if (id == "PB" || id == "BT") {
     RETURN_IF(prop.values.size() != 1, "Bad black name value.", false);
-    record->black_name = string(prop.values[0]);
+    AssignValue(prop.values[0], &record->black_name);
   } else if (id == "PW" || id == "WT") {
     RETURN_IF(prop.values.size() != 1, "Bad white name value.", false);
-    record->white_name = string(prop.values[0]);
+    AssignValue(prop.values[0], &record->white_name);
   } else if (id == "BR") {
     RETURN_IF(prop.values.size() != 1, "Bad black rank.", false);
-    record->black_rank = string(prop.values[0]);
+    AssignValue(prop.values[0], &record->black_rank);
   } else if (id == "WR") {
     RETURN_IF(prop.values.size() != 1, "Bad white rank.", false);
-    record->white_rank = string(prop.values[0]);
+    AssignValue(prop.values[0], &record->white_rank);
   } else if (id == "DT") {
     RETURN_IF(prop.values.size() != 1, "Bad date.", false);
-    record->date = string(prop.values[0]);
+    AssignValue(prop.values[0], &record->date);
   } else if (id == "RE") {
     RETURN_IF(prop.values.size() != 1, "Bad result (RE) property.", false);
-    string re = absl::AsciiStrToUpper(prop.values[0]);
+    const string_view re = prop.values[0];
+    // Only the prefix needs upper-casing, and it fits in the small string
+    // buffer.
+    const string prefix = absl::AsciiStrToUpper(re.substr(0, 3));
     // Resign, Timeout or Forfeit
-    if (re.substr(0, 3) == "B+R" || re.substr(0, 3) == "B+T" ||
-        re.substr(0, 3) == "B+F") {
+    if (prefix == "B+R" || prefix == "B+T" || prefix == "B+F") {
       record->result = 1.2;    // Actually any positive number works.
       record->resigned = true;
-    } else if (re.substr(0, 3) == "W+R" || re.substr(0, 3) == "W+T" ||
-               re.substr(0, 3) == "W+F") {
+    } else if (prefix == "W+R" || prefix == "W+T" || prefix == "W+F") {
       record->result = -1.2;  // Actually any negative number works.
       record->resigned = true;
     } else if (re.size() >= 3) {
       float score;
       RETURN_IF(!absl::SimpleAtof(re.substr(2), &score),
                 "Bad result (RE) value: failed in parsing score.", false);
-      if (re[0] == 'B') {
+      if (prefix[0] == 'B') {
         record->result = score;
-      } else if (re[0] == 'W') {
+      } else if (prefix[0] == 'W') {
         record->result = -score;
       } else {
         LOG_ERROR("Bad result (RE) value: unknown color.");
@@ -429,33 +584,30 @@ bool HandleProperty(const internal::Property& prop, GameRecord* record,
       }
     }
   } else if (unparsed != nullptr){
-    unparsed->push_back(std::make_pair(id, absl::StrJoin(prop.values, ",")));
+    unparsed->push_back(std::make_pair(absl::AsciiStrToUpper(prop.id),
+                                       absl::StrJoin(prop.values, ",")));
   }
   return true;
 }
 
-bool SimpleParseSgf(const string& sgf, GameRecord* record,
+bool FillGameRecord(const GameTree& tree, ParseScratch* scratch,
+                    GameRecord* record,
                     std::vector<std::pair<string, string>>* unparsed,
                     string* errors) {
-  internal::GameTree root(nullptr);
-  if (!internal::ParseToRoot(sgf, &root, errors)) {
-    return false;
-  }
-  RETURN_IF(root.children.empty(), "An empty tree collection.", false);
-
   // Find the furthest leaf node.
-  auto leaf_with_dist = GetFurthestLeaf(&root);
+  auto leaf_with_dist = GetFurthestLeaf(&tree, &scratch->stack);
 
   // Get the path.
-  std::vector<const internal::GameTree*> path;
-  const internal::GameTree* node = leaf_with_dist.first;
-  while (node != &root) {
+  std::vector<const GameTree*>& path = scratch->path;
+  path.clear();
+  const GameTree* node = leaf_with_dist.first;
+  while (node != tree.parent) {
     path.push_back(node);
     node = node->parent;
   }
 
   while (!path.empty()) {
-    const internal::GameTree* current = path.back();
+    const GameTree* current = path.back();
     path.pop_back();
     for (const auto& node : current->sequence) {
       for (const auto& prop : node) {
@@ -469,6 +621,49 @@ bool SimpleParseSgf(const string& sgf, GameRecord* record,
   return true;
 }
 
+}  // namespace internal
+
+bool FillGameRecord(const internal::GameTree& tree, GameRecord* record,
+                    std::vector<std::pair<string, string>>* unparsed,
+                    string* errors) {
+  internal::ParseScratch scratch;
+  return internal::FillGameRecord(tree, &scratch, record, unparsed, errors);
+}
+
+bool SimpleParseSgf(string_view sgf, GameRecord* record,
+                    std::vector<std::pair<string, string>>* unparsed,
+                    string* errors) {
+  return SimpleParseSgf(sgf, ParseLimits(), record, unparsed, errors);
+}
+
+bool SimpleParseSgf(string_view sgf, const ParseLimits& limits,
+                    GameRecord* record,
+                    std::vector<std::pair<string, string>>* unparsed,
+                    string* errors) {
+  internal::GameTree root(nullptr);
+  if (!internal::ParseToRoot(sgf, limits, &root, errors)) {
+    return false;
+  }
+  RETURN_IF(root.children.empty(), "An empty tree collection.", false);
+  return FillGameRecord(root, record, unparsed, errors);
+}
+
+SgfParser::SgfParser(const ParseLimits& limits)
+    : limits_(limits), root_(nullptr) {
+}
+
+bool SgfParser::Parse(string_view sgf, GameRecord* record,
+                      std::vector<std::pair<string, string>>* unparsed,
+                      string* errors) {
+  pool_.Recycle(&root_);
+  record->Reset();
+  if (!internal::ParseToRoot(sgf, limits_, &pool_, &root_, errors)) {
+    return false;
+  }
+  RETURN_IF(root_.children.empty(), "An empty tree collection.", false);
+  return internal::FillGameRecord(root_, &scratch_, record, unparsed, errors);
+}
+
 bool SimpleParseSgfAndCheck(
     const std::string& sgf_file_name, GoCoord expected_board_size,
     bool check_has_result, GameRecord* record, std::string* errors) {
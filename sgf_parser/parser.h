@@ -1,6 +1,9 @@
 #ifndef SGF_PARSER_PARSER_H_
 #define SGF_PARSER_PARSER_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include <memory>
 #include <set>
 #include <string>
@@ -11,6 +14,10 @@
 
 namespace sgf_parser {
 
+namespace internal {
+struct GameTree;
+}  // namespace internal
+
 // Coordinate and position.
 typedef int16_t GoCoord;
 typedef std::pair<GoCoord, GoCoord> GoPos;
@@ -56,16 +63,41 @@ struct GameRecord {
 
   GameRecord();
 
-  // Reset all fields to default values.
+  // Reset all fields to default values. Vectors and strings are cleared, which
+  // keeps their capacity for the next game.
   void Reset();
 
   // Dump contents to a string.
   std::string DebugString() const;
 };
 
+// Resource limits enforced while parsing, so hostile input can't make the
+// parser allocate without bound. Zero means unlimited. Exceeding a limit fails
+// the parse with an error.
+struct ParseLimits {
+  size_t max_bytes = 0;          // Size of the input.
+  int max_depth = 0;             // Nesting of game trees.
+  int64_t max_nodes = 0;         // Nodes in the whole collection.
+  int64_t max_properties = 0;    // Properties in the whole collection.
+  int64_t max_values = 0;        // Property values in the whole collection.
+};
+
 // If "unparsed" is not null, unparsed properties are saved to this vector.
 // If "errors" is not null, parsing errors are saved to this string.
-bool SimpleParseSgf(const std::string& sgf, GameRecord* record,
+bool SimpleParseSgf(absl::string_view sgf, GameRecord* record,
+                    std::vector<std::pair<std::string, std::string>>* unparsed,
+                    std::string* errors);
+
+// Same as above, but fails if the input exceeds `limits`.
+bool SimpleParseSgf(absl::string_view sgf, const ParseLimits& limits,
+                    GameRecord* record,
+                    std::vector<std::pair<std::string, std::string>>* unparsed,
+                    std::string* errors);
+
+// Like SimpleParseSgf, but fills the record from an already parsed tree: either
+// the root filled by internal::ParseToRoot, or one of its children, i.e. one
+// game of a collection. The main line is the longest path to a leaf.
+bool FillGameRecord(const internal::GameTree& tree, GameRecord* record,
                     std::vector<std::pair<std::string, std::string>>* unparsed,
                     std::string* errors);
 
@@ -122,6 +154,10 @@ struct GameTree {
         sequence(std::move(other.sequence)),
         children(std::move(other.children)) {
   }
+
+  // Destroys the subtrees iteratively, so deeply nested input can't overflow
+  // the stack.
+  ~GameTree();
 };
 
 // Finds the first occurrence of any of the characters in `targets`.
@@ -134,14 +170,92 @@ absl::string_view::size_type ConsumeNode(
     absl::string_view sgf, absl::string_view::size_type start,
     GameNode* node, std::string* errors);
 
+// Remaining budgets of a parse; negative means unlimited.
+struct ParseBudget {
+  int64_t properties = -1;
+  int64_t values = -1;
+};
+
+// Buffers recycled from trees which are no longer needed, so parsing into a
+// tree again reuses them instead of allocating.
+struct TreePool {
+  std::vector<std::unique_ptr<GameTree>> trees;
+  std::vector<GameNode> nodes;
+  std::vector<std::vector<absl::string_view>> values;
+  std::vector<std::unique_ptr<GameTree>> pending;   // Scratch space.
+
+  // Moves everything under `root` into the pool, leaving it empty.
+  void Recycle(GameTree* root);
+};
+
+// Parse a node, charging its properties and values to `budget`. Property
+// values reuse buffers from `pool` if it is not null.
+absl::string_view::size_type ConsumeNode(
+    absl::string_view sgf, absl::string_view::size_type start,
+    GameNode* node, ParseBudget* budget, TreePool* pool, std::string* errors);
+
 // Return false if the input is ill-formatted.
 // All errors are saved to "errors" if it is not null.
 bool ParseToRoot(absl::string_view sgf, GameTree* root, std::string* errors);
 
+// Same as above, but also returns false if the input exceeds `limits`.
+bool ParseToRoot(absl::string_view sgf, const ParseLimits& limits,
+                 GameTree* root, std::string* errors);
+
+// Same as above, but takes trees, nodes and value buffers from `pool` before
+// allocating new ones.
+bool ParseToRoot(absl::string_view sgf, const ParseLimits& limits,
+                 TreePool* pool, GameTree* root, std::string* errors);
+
+// Fills the field of `record` which `prop` sets, or appends it to `unparsed`
+// if it isn't one of the fields of a GameRecord. Moves and setup stones are
+// appended.
+bool HandleProperty(const Property& prop, GameRecord* record,
+                    std::vector<std::pair<std::string, std::string>>* unparsed,
+                    std::string* errors);
+
+// Scratch space of FillGameRecord.
+struct ParseScratch {
+  std::vector<std::pair<const GameTree*, int>> stack;
+  std::vector<const GameTree*> path;
+};
+
+// Like sgf_parser::FillGameRecord, but reuses `scratch`.
+bool FillGameRecord(const GameTree& tree, ParseScratch* scratch,
+                    GameRecord* record,
+                    std::vector<std::pair<std::string, std::string>>* unparsed,
+                    std::string* errors);
+
 // For debugging.
 void DumpRoot(const GameTree& root);
 
 }  // namespace internal
+
+// Parses one input after another, recycling the memory of the previous parse.
+// Once its buffers have grown to fit the inputs, a parse doesn't allocate
+// unless `unparsed` is requested or there are errors.
+class SgfParser {
+ public:
+  explicit SgfParser(const ParseLimits& limits = ParseLimits());
+
+  SgfParser(const SgfParser&) = delete;
+  SgfParser& operator=(const SgfParser&) = delete;
+
+  // Like SimpleParseSgf, but resets `record` first, so a record reused across
+  // parses keeps its buffers too.
+  bool Parse(absl::string_view sgf, GameRecord* record,
+             std::vector<std::pair<std::string, std::string>>* unparsed,
+             std::string* errors);
+
+  // The tree of the last parse. It points into that parse's input.
+  const internal::GameTree& root() const { return root_; }
+
+ private:
+  const ParseLimits limits_;
+  internal::GameTree root_;
+  internal::TreePool pool_;
+  internal::ParseScratch scratch_;
+};
 }  // namespace sgf_parser
 
 #endif  // SGF_PARSER_PARSER_H_
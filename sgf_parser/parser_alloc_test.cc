@@ -0,0 +1,120 @@
+// Checks how much the parser allocates. Parsing with a warmed up SgfParser
+// must not allocate at all; SimpleParseSgf has to build a new tree every time
+// but must stay within a budget per node and property.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "sgf_parser/alloc_counter.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+// Allocations allowed for one parse once the parser has seen its inputs.
+constexpr int64_t kSteadyStateBudget = 0;
+
+// Allocations allowed for SimpleParseSgf per node and property: the trees, and
+// the vectors of nodes, properties and values, which grow one at a time.
+constexpr int64_t kSimpleParseBudgetPerElement = 2;
+
+// Passes over the inputs before SgfParser counts as warmed up.
+constexpr int kWarmUpPasses = 3;
+
+const char* const kFiles[] = {
+    "testdata/handicapped.sgf",
+    "testdata/resigned.sgf",
+    "testdata/collection.sgf",
+};
+
+// Counts nodes and properties.
+int64_t CountElements(const internal::GameTree& root) {
+  int64_t elements = root.sequence.size();
+  for (const auto& node : root.sequence) elements += node.size();
+  for (const auto& child : root.children) elements += CountElements(*child);
+  return elements;
+}
+
+class ParserAllocTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+    for (const char* file : kFiles) {
+      inputs_.push_back(ReadFileToString(file));
+      ASSERT_FALSE(inputs_.back().empty()) << file;
+    }
+  }
+
+  std::vector<string> inputs_;
+};
+
+TEST(AllocationCounterTest, CountsNew) {
+  AllocationCounter counter;
+  EXPECT_EQ(counter.allocations(), 0);
+  std::unique_ptr<std::vector<int>> v(new std::vector<int>(100));
+  EXPECT_EQ(counter.allocations(), 2);
+  EXPECT_GE(counter.bytes(), 100 * sizeof(int));
+  {
+    AllocationCounter nested;
+    v.reset();
+    EXPECT_EQ(nested.allocations(), 0);
+  }
+  counter.Reset();
+  EXPECT_EQ(counter.allocations(), 0);
+}
+
+TEST_F(ParserAllocTest, SteadyState) {
+  SgfParser parser;
+  GameRecord record;
+  string errors;
+  for (int pass = 0; pass < kWarmUpPasses; ++pass) {
+    for (const auto& sgf : inputs_) {
+      ASSERT_TRUE(parser.Parse(sgf, &record, nullptr, &errors)) << errors;
+    }
+  }
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    AllocationCounter counter;
+    ASSERT_TRUE(parser.Parse(inputs_[i], &record, nullptr, &errors)) << errors;
+    EXPECT_LE(counter.allocations(), kSteadyStateBudget)
+        << kFiles[i] << ": " << counter.bytes() << " bytes";
+  }
+}
+
+TEST_F(ParserAllocTest, SameResultAsSimpleParse) {
+  SgfParser parser;
+  GameRecord reused;
+  string errors;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (const auto& sgf : inputs_) {
+      GameRecord expected;
+      ASSERT_TRUE(SimpleParseSgf(sgf, &expected, nullptr, &errors)) << errors;
+      ASSERT_TRUE(parser.Parse(sgf, &reused, nullptr, &errors)) << errors;
+      EXPECT_EQ(reused.DebugString(), expected.DebugString());
+    }
+  }
+}
+
+TEST_F(ParserAllocTest, SimpleParseBudget) {
+  for (size_t i = 0; i < inputs_.size(); ++i) {
+    internal::GameTree root(nullptr);
+    ASSERT_TRUE(internal::ParseToRoot(inputs_[i], &root, nullptr));
+    const int64_t elements = CountElements(root);
+
+    GameRecord record;
+    string errors;
+    AllocationCounter counter;
+    ASSERT_TRUE(SimpleParseSgf(inputs_[i], &record, nullptr, &errors));
+    LOG(INFO) << kFiles[i] << ": " << counter.allocations()
+              << " allocations for " << elements << " nodes and properties";
+    EXPECT_LE(counter.allocations(), kSimpleParseBudgetPerElement * elements)
+        << kFiles[i];
+  }
+}
+
+}  // namespace
+}  // namespace sgf_parser
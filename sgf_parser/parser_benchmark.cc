@@ -0,0 +1,336 @@
+// Benchmarks of the parser on a generated corpus, with the buffers holding it
+// backed by base pages and by huge pages. For each it reports the throughput
+// and, where the kernel lets us count them, the dTLB load misses per MB.
+// Games are visited in a shuffled order, as a server parsing requests or a
+// trainer sampling positions would, so every game starts on a cold page.
+//
+// Usage:
+//   parser_benchmark [--games=20000] [--seed=1] [--corpus_file=/tmp/x.corpus]
+//
+// For read_corpus the copied huge pages include the copy, which the mapped
+// file, already in the page cache, doesn't pay.
+//
+// The replay benchmarks produce every position of every game: replay_batch
+// with ReplayBatch, replay_board by playing each move on a GoBoard and reading
+// the position back. replay_record only plays the moves with ReplayRecord, as
+// a job which needs the final position would.
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_format.h"
+#include "absl/strings/string_view.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/batch_replay.h"
+#include "sgf_parser/board.h"
+#include "sgf_parser/corpus.h"
+#include "sgf_parser/generated_corpus.h"
+#include "sgf_parser/move_scanner.h"
+#include "sgf_parser/page_buffer.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/validator.h"
+
+DEFINE_int32(games, 20000, "Games in the generated corpus.");
+DEFINE_int32(seed, 1, "Seed of the generated corpus.");
+DEFINE_string(corpus_file, "/tmp/parser_benchmark.corpus",
+              "Where the binary corpus benchmark writes its file.");
+
+namespace sgf_parser {
+namespace {
+
+using std::string;
+
+// Counts the dTLB load misses of the calling thread in user space. Not
+// available without a PMU, e.g. in many VMs, or if kernel.perf_event_paranoid
+// forbids it.
+class TlbMissCounter {
+ public:
+  TlbMissCounter() {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    fd_ = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    if (fd_ < 0) {
+      LOG(WARNING) << "Can't count dTLB misses: " << strerror(errno);
+    }
+  }
+  ~TlbMissCounter() {
+    if (fd_ >= 0) close(fd_);
+  }
+
+  void Start() {
+    if (fd_ < 0) return;
+    ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+  }
+
+  // Misses since Start(), or -1 if they can't be counted.
+  int64_t Stop() {
+    if (fd_ < 0) return -1;
+    ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+    int64_t count;
+    if (read(fd_, &count, sizeof(count)) != sizeof(count)) return -1;
+    return count;
+  }
+
+ private:
+  int fd_ = -1;
+};
+
+// The games of the corpus back to back in one buffer.
+struct TextCorpus {
+  std::unique_ptr<PageBuffer> buffer;
+  std::vector<absl::string_view> games;   // In visiting order.
+};
+
+TextCorpus CopyCorpus(const std::vector<string>& games,
+                      const std::vector<int>& order, bool huge_pages) {
+  size_t bytes = 0;
+  for (const string& game : games) bytes += game.size();
+  PageBufferOptions options;
+  options.huge_pages = huge_pages;
+  TextCorpus corpus;
+  corpus.buffer.reset(new PageBuffer(bytes, options));
+  std::vector<absl::string_view> views;
+  char* p = corpus.buffer->data();
+  for (const string& game : games) {
+    memcpy(p, game.data(), game.size());
+    views.emplace_back(p, game.size());
+    p += game.size();
+  }
+  for (int i : order) corpus.games.push_back(views[i]);
+  return corpus;
+}
+
+struct Measurement {
+  double seconds;
+  int64_t tlb_misses;   // -1 if they can't be counted.
+};
+
+template <typename Fn>
+Measurement Measure(TlbMissCounter* counter, Fn fn) {
+  const auto start = std::chrono::steady_clock::now();
+  counter->Start();
+  fn();
+  const int64_t misses = counter->Stop();
+  return {std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                        start).count(),
+          misses};
+}
+
+// `huge` is the share of the input in huge pages, if known.
+void Report(absl::string_view name, absl::string_view pages, int64_t bytes,
+            const Measurement& m, absl::string_view huge) {
+  const double mb = bytes / 1e6;
+  absl::PrintF("%-12s %-12s %10.1f %14s %10s\n", name, pages, mb / m.seconds,
+               m.tlb_misses < 0 ? "n/a"
+                                : absl::StrFormat("%.1f", m.tlb_misses / mb),
+               huge);
+}
+
+// Stones on the board, to check that the replays agree.
+int64_t CountStones(const BitPosition& position) {
+  int64_t stones = 0;
+  for (int i = 0; i < BitPosition::kWords; ++i) {
+    stones += __builtin_popcountll(position.black[i]) +
+              __builtin_popcountll(position.white[i]);
+  }
+  return stones;
+}
+
+// Reads the stones of `board` back into `position`.
+void ReadPosition(const GoBoard& board, BitPosition* position) {
+  *position = BitPosition();
+  position->size = board.width();
+  for (GoCoord y = 0; y < board.height(); ++y) {
+    for (GoCoord x = 0; x < board.width(); ++x) {
+      const GoBoard::Stone stone = board.At(GoPos(x, y));
+      if (stone == GoBoard::EMPTY) continue;
+      const int bit = y * BitPosition::kStride + x;
+      uint64_t* words =
+          stone == GoBoard::BLACK ? position->black : position->white;
+      words[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+  }
+}
+
+void ReportPositions(absl::string_view name, int64_t positions,
+                     const Measurement& m) {
+  absl::PrintF("%-14s %10.2f\n", name, positions / m.seconds / 1e6);
+}
+
+string HugeShare(const PageBuffer& buffer) {
+  return absl::StrFormat("%.0f%%", 100.0 * buffer.HugePageBytes() /
+                                       std::max<size_t>(1, buffer.size()));
+}
+
+void RunBenchmarks() {
+  const std::vector<string> games = GenerateCorpus(FLAGS_games, FLAGS_seed);
+  int64_t bytes = 0;
+  for (const string& game : games) bytes += game.size();
+  std::mt19937 rng(FLAGS_seed);
+  std::vector<int> order(games.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::shuffle(order.begin(), order.end(), rng);
+  TlbMissCounter counter;
+  absl::PrintF("%d games, %.1f MB\n", games.size(), bytes / 1e6);
+  absl::PrintF("%-12s %-12s %10s %14s %10s\n", "benchmark", "pages", "MB/s",
+               "dTLB miss/MB", "huge");
+  SgfParser parser;
+  GameRecord record;
+  string errors;
+  for (bool huge_pages : {false, true}) {
+    const TextCorpus corpus = CopyCorpus(games, order, huge_pages);
+    const string pages = PageBackingName(corpus.buffer->backing());
+    const Measurement find_first = Measure(&counter, [&] {
+      size_t values = 0;
+      for (absl::string_view game : corpus.games) {
+        for (auto p = internal::FindFirst(game, 0, "]", true);
+             p != absl::string_view::npos;
+             p = internal::FindFirst(game, p + 1, "]", true)) {
+          ++values;
+        }
+      }
+      CHECK_GT(values, 0);
+    });
+    Report("find_first", pages, bytes, find_first, HugeShare(*corpus.buffer));
+    const Measurement parse = Measure(&counter, [&] {
+      for (absl::string_view game : corpus.games) {
+        CHECK(parser.Parse(game, &record, nullptr, &errors)) << errors;
+      }
+    });
+    Report("parse", pages, bytes, parse, HugeShare(*corpus.buffer));
+    const Measurement validate = Measure(&counter, [&] {
+      for (absl::string_view game : corpus.games) {
+        CHECK(ValidateSgf(game, nullptr, &errors)) << errors;
+      }
+    });
+    Report("validate", pages, bytes, validate, HugeShare(*corpus.buffer));
+    const Measurement scan = Measure(&counter, [&] {
+      int64_t moves = 0;
+      MainLineSummary summary;
+      for (absl::string_view game : corpus.games) {
+        CHECK(ScanMainLine(game, &summary));
+        moves += summary.moves;
+      }
+      CHECK_GT(moves, 0);
+    });
+    Report("scan_main", pages, bytes, scan, HugeShare(*corpus.buffer));
+  }
+
+  // The binary corpus, decoded from the page cache or from huge pages.
+  CorpusWriter writer;
+  CHECK(writer.Open(FLAGS_corpus_file)) << FLAGS_corpus_file;
+  CorpusBlockBuilder builder;
+  for (const string& game : games) {
+    CHECK(parser.Parse(game, &record, nullptr, &errors)) << errors;
+    CHECK(builder.Add(record));
+    if (builder.bytes() >= kCorpusBlockBytes) CHECK(writer.Write(&builder));
+  }
+  CHECK(writer.Write(&builder));
+  CHECK(writer.Close());
+  const int64_t corpus_bytes = std::ifstream(
+      FLAGS_corpus_file, std::ios::ate | std::ios::binary).tellg();
+  for (bool huge_pages : {false, true}) {
+    CorpusReadOptions options;
+    options.huge_pages = huge_pages;
+    int64_t moves = 0;
+    string error;
+    const Measurement read = Measure(&counter, [&] {
+      CHECK(ReadCorpus(FLAGS_corpus_file, options, nullptr,
+                       [&moves](int, const GameRecord& game) {
+                         moves += game.moves.size();
+                       },
+                       &error)) << error;
+    });
+    CHECK_GT(moves, 0);
+    Report("read_corpus", huge_pages ? "copied huge" : "mapped",
+           corpus_bytes, read, "");
+  }
+  remove(FLAGS_corpus_file.c_str());
+
+  // Every position of every game on a board of up to 19x19.
+  std::vector<GameRecord> records;
+  for (const string& game : games) {
+    CHECK(parser.Parse(game, &record, nullptr, &errors)) << errors;
+    if (GetBoardSize(record) <= BitPosition::kMaxBoardSize) {
+      records.push_back(record);
+    }
+  }
+  absl::PrintF("%-14s %10s\n", "benchmark", "Mpos/s");
+  int64_t moves = 0;
+  const Measurement replay_record = Measure(&counter, [&] {
+    for (const GameRecord& game : records) {
+      const GoCoord size = GetBoardSize(game);
+      GoBoard board(size, size);
+      ReplayRecord(game, &board);
+      moves += game.moves.size();
+    }
+  });
+  ReportPositions("replay_record", moves + records.size(), replay_record);
+  int64_t board_positions = 0, board_stones = 0;
+  const Measurement replay_board = Measure(&counter, [&] {
+    BitPosition position;
+    for (GameRecord& game : records) {
+      const GoCoord size = GetBoardSize(game);
+      GoBoard board(size, size);
+      // The pre-set stones first, then one move at a time.
+      std::vector<GoMove> game_moves;
+      game_moves.swap(game.moves);
+      ReplayRecord(game, &board);
+      for (size_t i = 0; i <= game_moves.size(); ++i) {
+        if (i > 0) {
+          const GoMove& move = game_moves[i - 1];
+          // Off-board moves are passes, as in ReplayRecord.
+          if (!move.pass && board.OnBoard(move.move)) board.Play(move);
+        }
+        ReadPosition(board, &position);
+        ++board_positions;
+        board_stones += CountStones(position);
+      }
+      game.moves.swap(game_moves);
+    }
+  });
+  ReportPositions("replay_board", board_positions, replay_board);
+  int64_t batch_positions = 0, batch_stones = 0;
+  const Measurement replay_batch = Measure(&counter, [&] {
+    ReplayBatch(records, [&](size_t, int, const BitPosition& position) {
+      ++batch_positions;
+      batch_stones += CountStones(position);
+    }, nullptr);
+  });
+  ReportPositions("replay_batch", batch_positions, replay_batch);
+  CHECK_EQ(batch_positions, board_positions);
+  CHECK_EQ(batch_stones, board_stones);
+}
+
+}  // namespace
+}  // namespace sgf_parser
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  sgf_parser::RunBenchmarks();
+  return 0;
+}
@@ -0,0 +1,206 @@
+// A libFuzzer target for the parser. Besides crashes and sanitizer reports it
+// checks that:
+//   - every property id and value points into the input,
+//   - ParseToRoot accepts the input under limits equal to its own size,
+//   - SimpleParseSgf only succeeds if ParseToRoot does,
+//   - ValidateSgf agrees with ParseToRoot, errors included,
+//   - ScanMainLine finds the same main line as SimpleParseSgf,
+//   - HandleProperty accepts anything ParseToRoot produces without crashing,
+//   - SgfParser agrees with SimpleParseSgf, and once it has recycled the
+//     buffers of a parse, parsing the same input again doesn't allocate,
+//   - parsing cost grows linearly: the input is also parsed as two copies of
+//     itself, which is still a valid collection if the input is, and neither
+//     the allocations nor the time may more than double (with some slack).
+//     Allocations per input byte are also capped.
+//
+// Build with -fsanitize=fuzzer and seed it with the test data:
+//   parser_fuzzer -max_len=65536 corpus/ testdata/
+//
+// With SGF_PARSER_FUZZER_MAIN defined it instead gets a main which runs the
+// target once over every file on the command line, to replay a corpus or a
+// crash without libFuzzer.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "glog/logging.h"
+#include "sgf_parser/alloc_counter.h"
+#include "sgf_parser/move_scanner.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/validator.h"
+
+namespace sgf_parser {
+namespace {
+
+using absl::string_view;
+
+// A linear parser allocates a few times per node, property and value, each of
+// which takes at least a byte or two of input.
+constexpr int64_t kMaxAllocationsPerByte = 4;
+constexpr int64_t kAllocationSlack = 64;
+
+// Timing is noisy, so only inputs which take long enough are compared, and the
+// doubled input may take up to three times as long: a quadratic parse takes
+// four times.
+constexpr double kMinTimedSeconds = 200e-6;
+constexpr double kMaxTimeGrowth = 3.0;
+
+struct Cost {
+  int64_t allocations = 0;
+  double seconds = 0;
+};
+
+// The cheapest of a few runs of SimpleParseSgf over `sgf`.
+Cost MeasureParse(string_view sgf) {
+  Cost best;
+  for (int i = 0; i < 3; ++i) {
+    GameRecord record;
+    AllocationCounter counter;
+    const auto start = std::chrono::steady_clock::now();
+    SimpleParseSgf(sgf, &record, nullptr, nullptr);
+    const auto end = std::chrono::steady_clock::now();
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    if (i == 0 || seconds < best.seconds) best.seconds = seconds;
+    best.allocations = counter.allocations();
+  }
+  return best;
+}
+
+bool Contains(string_view outer, string_view inner) {
+  return inner.data() >= outer.data() &&
+         inner.data() + inner.size() <= outer.data() + outer.size();
+}
+
+// Checks the tree and fills `limits` with what parsing it took.
+void CheckTree(string_view sgf, const internal::GameTree& root,
+               ParseLimits* limits) {
+  std::vector<std::pair<const internal::GameTree*, int>> stack;
+  stack.emplace_back(&root, 0);
+  GameRecord record;
+  std::vector<std::pair<std::string, std::string>> unparsed;
+  while (!stack.empty()) {
+    const internal::GameTree* tree = stack.back().first;
+    const int depth = stack.back().second;
+    stack.pop_back();
+    limits->max_depth = std::max(limits->max_depth, depth);
+    limits->max_nodes += tree->sequence.size();
+    for (const auto& node : tree->sequence) {
+      for (const auto& prop : node) {
+        CHECK(Contains(sgf, prop.id)) << "A property id outside the input.";
+        ++limits->max_properties;
+        for (const auto& value : prop.values) {
+          CHECK(Contains(sgf, value)) << "A property value outside the input.";
+          ++limits->max_values;
+        }
+        internal::HandleProperty(prop, &record, &unparsed, nullptr);
+      }
+    }
+    for (const auto& child : tree->children) {
+      CHECK_EQ(child->parent, tree);
+      stack.emplace_back(child.get(), depth + 1);
+    }
+  }
+}
+
+void CheckCostIsLinear(string_view sgf) {
+  const std::string doubled = std::string(sgf) + std::string(sgf);
+  Cost once = MeasureParse(sgf);
+  Cost twice = MeasureParse(doubled);
+
+  CHECK_LE(once.allocations,
+           kMaxAllocationsPerByte * static_cast<int64_t>(sgf.size()) +
+               kAllocationSlack)
+      << "Too many allocations for an input of " << sgf.size() << " bytes: "
+      << once.allocations;
+  CHECK_LE(twice.allocations, 2 * once.allocations + kAllocationSlack)
+      << "Allocations grow superlinearly: " << once.allocations << " for "
+      << sgf.size() << " bytes, " << twice.allocations << " for twice that.";
+
+  if (once.seconds < kMinTimedSeconds) return;
+  if (twice.seconds > kMaxTimeGrowth * once.seconds) {
+    // Measure again before blaming the parser for a hiccup.
+    once = MeasureParse(sgf);
+    twice = MeasureParse(doubled);
+    CHECK_LE(twice.seconds, kMaxTimeGrowth * once.seconds)
+        << "Parse time grows superlinearly: " << once.seconds << "s for "
+        << sgf.size() << " bytes, " << twice.seconds << "s for twice that.";
+  }
+}
+
+void FuzzOne(string_view sgf) {
+  internal::GameTree root(nullptr);
+  std::string parse_errors;
+  const bool parsed = internal::ParseToRoot(sgf, &root, &parse_errors);
+
+  std::string validate_errors;
+  CHECK_EQ(ValidateSgf(sgf, nullptr, &validate_errors), parsed);
+  CHECK_EQ(validate_errors, parse_errors);
+
+  GameRecord record;
+  const bool filled = SimpleParseSgf(sgf, &record, nullptr, nullptr);
+  CHECK(parsed || !filled) << "SimpleParseSgf accepted what ParseToRoot didn't.";
+
+  if (filled) {
+    MainLineSummary summary;
+    CHECK(ScanMainLine(sgf, &summary)) << "ScanMainLine rejected a game.";
+    CHECK_EQ(summary.moves, static_cast<int64_t>(record.moves.size()));
+    CHECK_EQ(summary.hash, HashMoves(record.moves));
+  }
+
+  SgfParser parser;
+  GameRecord reused;
+  CHECK_EQ(parser.Parse(sgf, &reused, nullptr, nullptr), filled);
+  if (filled) {
+    CHECK_EQ(reused.DebugString(), record.DebugString());
+    // The first reparse fills the pool of recycled buffers.
+    CHECK(parser.Parse(sgf, &reused, nullptr, nullptr));
+    AllocationCounter counter;
+    CHECK(parser.Parse(sgf, &reused, nullptr, nullptr));
+    CHECK_EQ(counter.allocations(), 0) << "Parsing again allocated.";
+  }
+
+  if (parsed) {
+    ParseLimits limits;
+    CheckTree(sgf, root, &limits);
+    limits.max_bytes = sgf.size();
+    internal::GameTree again(nullptr);
+    CHECK(internal::ParseToRoot(sgf, limits, &again, nullptr))
+        << "Rejected under limits equal to its own size.";
+  }
+
+  CheckCostIsLinear(sgf);
+}
+
+}  // namespace
+}  // namespace sgf_parser
+
+extern "C" int LLVMFuzzerInitialize(int*, char***) {
+  // Parse errors are expected and logging them would dominate the run time.
+  FLAGS_minloglevel = 2;
+  return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  sgf_parser::FuzzOne(
+      absl::string_view(reinterpret_cast<const char*>(data), size));
+  return 0;
+}
+
+#ifdef SGF_PARSER_FUZZER_MAIN
+int main(int argc, char* argv[]) {
+  LLVMFuzzerInitialize(&argc, &argv);
+  for (int i = 1; i < argc; ++i) {
+    const std::string input = sgf_parser::ReadFileToString(argv[i]);
+    LOG(INFO) << "Running " << argv[i] << " (" << input.size() << " bytes)";
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()),
+                           input.size());
+  }
+  return 0;
+}
+#endif  // SGF_PARSER_FUZZER_MAIN
@@ -72,6 +72,52 @@ TEST_F(SgfParserIntenalTest, Simple) {
     });
 }
 
+TEST_F(SgfParserIntenalTest, Limits) {
+  const char kInput[] = "(;SZ[9]AB[aa][bb];B[cc](;W[dd])(;W[ee];B[ff]))";
+  ParseLimits limits;
+  limits.max_bytes = sizeof(kInput) - 1;
+  limits.max_depth = 2;
+  limits.max_nodes = 5;
+  limits.max_properties = 6;
+  limits.max_values = 7;
+  root_.reset(new internal::GameTree(nullptr));
+  EXPECT_TRUE(internal::ParseToRoot(kInput, limits, root_.get(), &errors_));
+  EXPECT_TRUE(errors_.empty());
+
+  const std::vector<std::pair<ParseLimits, string>> kExceeded = {
+      {{sizeof(kInput) - 2, 0, 0, 0, 0}, "maximum input size"},
+      {{0, 1, 0, 0, 0}, "maximum tree depth"},
+      {{0, 0, 4, 0, 0}, "maximum number of nodes"},
+      {{0, 0, 0, 5, 0}, "maximum number of properties"},
+      {{0, 0, 0, 0, 6}, "maximum number of property values"},
+  };
+  for (const auto& exceeded : kExceeded) {
+    root_.reset(new internal::GameTree(nullptr));
+    errors_.clear();
+    EXPECT_FALSE(internal::ParseToRoot(kInput, exceeded.first, root_.get(),
+                                       &errors_));
+    EXPECT_THAT(errors_, HasSubstr(exceeded.second));
+  }
+}
+
+TEST_F(SgfParserIntenalTest, DeeplyNested) {
+  // Each level adds a variation with one move, so the main line goes through
+  // all of them.
+  constexpr int kDepth = 200000;
+  string sgf;
+  for (int i = 0; i < kDepth; ++i) sgf += "(;B[aa]";
+  sgf.append(kDepth, ')');
+  GameRecord game;
+  string errors;
+  ASSERT_TRUE(SimpleParseSgf(sgf, &game, nullptr, &errors)) << errors;
+  EXPECT_EQ(game.moves.size(), kDepth);
+
+  ParseLimits limits;
+  limits.max_depth = 100;
+  EXPECT_FALSE(SimpleParseSgf(sgf, limits, &game, nullptr, &errors));
+  EXPECT_THAT(errors, HasSubstr("maximum tree depth"));
+}
+
 class SgfParserTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -101,5 +147,16 @@ TEST_F(SgfParserTest, Resigned) {
   LOG(INFO) << "\n" << game.DebugString();
 }
 
+TEST_F(SgfParserTest, ResetAndReuse) {
+  const string sgf = ReadFileToString("testdata/resigned.sgf");
+  GameRecord game;
+  string errors;
+  ASSERT_TRUE(SimpleParseSgf(sgf, &game, nullptr, &errors)) << errors;
+  game.Reset();
+  EXPECT_TRUE(game.moves.empty());
+  ASSERT_TRUE(SimpleParseSgf(sgf, &game, nullptr, &errors)) << errors;
+  EXPECT_EQ(game.moves.size(), 20);
+}
+
 }  // namespace
 }  // namespace sgf_parser
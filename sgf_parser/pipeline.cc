@@ -0,0 +1,183 @@
+#include "sgf_parser/pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <utility>
+
+#include "absl/strings/str_format.h"
+#include "glog/logging.h"
+#include "sgf_parser/board.h"
+#include "sgf_parser/bounded_queue.h"
+
+namespace sgf_parser {
+
+namespace {
+
+typedef std::vector<PipelineItem> Batch;
+typedef std::chrono::steady_clock Clock;
+
+int64_t Nanos(Clock::duration d) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+}
+
+struct Stage {
+  StageStats stats;
+  PipelineOptions::StageFn fn;
+  BoundedQueue<Batch>* in = nullptr;    // Null for the read stage.
+  BoundedQueue<Batch>* out = nullptr;   // Null for the write stage.
+
+  std::atomic<int> running{0};
+  std::atomic<int64_t> items{0};
+  std::atomic<int64_t> busy_ns{0};
+  std::atomic<int64_t> starved_ns{0};
+  std::atomic<int64_t> blocked_ns{0};
+};
+
+// The read stage has no input queue. Its threads take batches of file names
+// directly from the list.
+struct Source {
+  const std::vector<std::string>* filenames;
+  std::atomic<size_t> next{0};
+  size_t batch_size;
+
+  bool NextBatch(Batch* batch) {
+    const size_t begin = next.fetch_add(batch_size);
+    if (begin >= filenames->size()) return false;
+    const size_t end = std::min(begin + batch_size, filenames->size());
+    batch->resize(end - begin);
+    for (size_t i = begin; i < end; ++i) {
+      (*batch)[i - begin].filename = (*filenames)[i];
+    }
+    return true;
+  }
+};
+
+void RunStage(Stage* stage, Source* source) {
+  int64_t items = 0, busy = 0, starved = 0, blocked = 0;
+  Batch batch;
+  while (true) {
+    const auto t0 = Clock::now();
+    const bool has_input = stage->in == nullptr ? source->NextBatch(&batch)
+                                                : stage->in->Pop(&batch);
+    const auto t1 = Clock::now();
+    starved += Nanos(t1 - t0);
+    if (!has_input) break;
+    for (auto& item : batch) {
+      if (item.ok || stage->out == nullptr) {
+        stage->fn(&item);
+      }
+    }
+    items += batch.size();
+    const auto t2 = Clock::now();
+    busy += Nanos(t2 - t1);
+    if (stage->out != nullptr) {
+      stage->out->Push(std::move(batch));
+      batch = Batch();
+      blocked += Nanos(Clock::now() - t2);
+    }
+  }
+  stage->items += items;
+  stage->busy_ns += busy;
+  stage->starved_ns += starved;
+  stage->blocked_ns += blocked;
+  if (stage->running.fetch_sub(1) == 1 && stage->out != nullptr) {
+    stage->out->Close();
+  }
+}
+
+}  // namespace
+
+std::string StageStats::DebugString() const {
+  return absl::StrFormat(
+      "%-7s threads=%d items=%d utilization=%.2f busy=%.3fs starved=%.3fs "
+      "blocked=%.3fs",
+      name, threads, items, utilization(), busy_seconds, starved_seconds,
+      blocked_seconds);
+}
+
+PipelineOptions::PipelineOptions() {
+  read = [](PipelineItem* item) {
+    item->sgf = ReadFileToString(item->filename);
+    if (item->sgf.empty()) {
+      item->ok = false;
+      item->errors = "Cannot read the file or it is empty.";
+    }
+  };
+  parse = [](PipelineItem* item) {
+    item->ok = SimpleParseSgf(item->sgf, &item->record, nullptr,
+                              &item->errors);
+  };
+  replay = [](PipelineItem* item) {
+    const GoCoord size = GetBoardSize(item->record);
+    GoBoard board(size, size);
+    item->illegal_moves = ReplayRecord(item->record, &board);
+    item->final_hash = board.hash();
+  };
+  write = [](PipelineItem*) {};
+}
+
+std::vector<StageStats> RunPipeline(const std::vector<std::string>& filenames,
+                                    const PipelineOptions& options) {
+  const size_t batch_size = std::max(1, options.batch_size);
+  const size_t queue_batches = std::max(1, options.queue_batches);
+  const struct {
+    const char* name;
+    const PipelineOptions::StageFn& fn;
+    int threads;
+  } configs[] = {
+    {"read", options.read, options.read_threads},
+    {"parse", options.parse, options.parse_threads},
+    {"replay", options.replay, options.replay_threads},
+    {"write", options.write, options.write_threads},
+  };
+  const int kNumStages = 4;
+
+  std::vector<std::unique_ptr<BoundedQueue<Batch>>> queues;
+  std::unique_ptr<Stage> stages[kNumStages];
+  for (int i = 0; i < kNumStages; ++i) {
+    stages[i].reset(new Stage);
+    stages[i]->stats.name = configs[i].name;
+    stages[i]->stats.threads = std::max(1, configs[i].threads);
+    stages[i]->fn = configs[i].fn;
+    stages[i]->running = stages[i]->stats.threads;
+    if (i > 0) {
+      queues.emplace_back(new BoundedQueue<Batch>(queue_batches));
+      stages[i - 1]->out = queues.back().get();
+      stages[i]->in = queues.back().get();
+    }
+  }
+
+  Source source;
+  source.filenames = &filenames;
+  source.batch_size = batch_size;
+
+  const auto start = Clock::now();
+  std::vector<std::thread> threads;
+  for (auto& stage : stages) {
+    for (int t = 0; t < stage->stats.threads; ++t) {
+      threads.emplace_back(RunStage, stage.get(), &source);
+    }
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  const double wall = Nanos(Clock::now() - start) * 1e-9;
+
+  std::vector<StageStats> stats;
+  for (auto& stage : stages) {
+    StageStats s = stage->stats;
+    s.items = stage->items;
+    s.busy_seconds = stage->busy_ns * 1e-9;
+    s.starved_seconds = stage->starved_ns * 1e-9;
+    s.blocked_seconds = stage->blocked_ns * 1e-9;
+    s.wall_seconds = wall;
+    VLOG(1) << s.DebugString();
+    stats.push_back(std::move(s));
+  }
+  return stats;
+}
+
+}  // namespace sgf_parser
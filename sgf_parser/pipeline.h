@@ -0,0 +1,80 @@
+#ifndef SGF_PARSER_PIPELINE_H_
+#define SGF_PARSER_PIPELINE_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// A file flowing through a Pipeline. Each stage fills in its part.
+struct PipelineItem {
+  std::string filename;
+  std::string sgf;            // Filled by the read stage.
+  GameRecord record;          // Filled by the parse stage.
+  uint64_t final_hash = 0;    // Filled by the replay stage: the hash of the
+  int illegal_moves = 0;      // final position and the moves which could not
+                              // be played.
+  bool ok = true;             // Set to false by a failing stage. Later stages
+  std::string errors;         // except the write stage skip the item then.
+};
+
+// Utilization of one stage. All times are summed over the stage's threads.
+struct StageStats {
+  std::string name;
+  int threads = 0;
+  int64_t items = 0;
+  double busy_seconds = 0;      // Processing items.
+  double starved_seconds = 0;   // Waiting for input from the previous stage.
+  double blocked_seconds = 0;   // Waiting for room in the next stage's queue.
+  double wall_seconds = 0;      // Of the whole run.
+
+  // Fraction of the stage's thread time spent processing. A stage near 1.0
+  // while the others are starved is the one to give more threads.
+  double utilization() const {
+    return wall_seconds > 0 ? busy_seconds / (wall_seconds * threads) : 0;
+  }
+
+  std::string DebugString() const;
+};
+
+struct PipelineOptions {
+  typedef std::function<void(PipelineItem*)> StageFn;
+
+  // The stages. Defaults are ReadFileToString, SimpleParseSgf, ReplayRecord
+  // and nothing, so `write` is usually replaced.
+  StageFn read;
+  StageFn parse;
+  StageFn replay;
+  StageFn write;
+
+  int read_threads = 1;
+  int parse_threads = 1;
+  int replay_threads = 1;
+  int write_threads = 1;
+
+  // Items are handed from stage to stage in batches to amortize
+  // synchronization.
+  int batch_size = 32;
+
+  // Capacity, in batches, of the queue in front of each stage. A full queue
+  // blocks the previous stage.
+  int queue_batches = 8;
+
+  PipelineOptions();
+};
+
+// Runs files through read -> parse -> replay -> write stages. The stages run
+// concurrently on their own threads and are connected by bounded lock free
+// queues. Blocks until every file has been written. Returns the statistics of
+// the stages in order.
+std::vector<StageStats> RunPipeline(const std::vector<std::string>& filenames,
+                                    const PipelineOptions& options);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_PIPELINE_H_
@@ -0,0 +1,69 @@
+#include "sgf_parser/pipeline.h"
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+TEST(PipelineTest, ProcessesAllFiles) {
+  std::vector<string> files;
+  for (int i = 0; i < 50; ++i) {
+    files.push_back("testdata/handicapped.sgf");
+    files.push_back("testdata/resigned.sgf");
+  }
+  files.push_back("testdata/does_not_exist.sgf");
+
+  PipelineOptions options;
+  options.parse_threads = 2;
+  options.batch_size = 8;
+  options.queue_batches = 2;
+  std::mutex mu;
+  std::map<string, int> moves;
+  std::map<string, uint64_t> hashes;
+  int failures = 0;
+  options.write = [&](PipelineItem* item) {
+    std::lock_guard<std::mutex> lock(mu);
+    if (!item->ok) {
+      ++failures;
+      return;
+    }
+    EXPECT_EQ(item->illegal_moves, 0);
+    moves[item->filename] = item->record.moves.size();
+    if (hashes.count(item->filename)) {
+      EXPECT_EQ(hashes[item->filename], item->final_hash);
+    }
+    hashes[item->filename] = item->final_hash;
+  };
+
+  const std::vector<StageStats> stats = RunPipeline(files, options);
+  EXPECT_EQ(failures, 1);
+  EXPECT_EQ(moves["testdata/handicapped.sgf"], 15);
+  EXPECT_EQ(moves["testdata/resigned.sgf"], 20);
+  ASSERT_EQ(stats.size(), 4);
+  EXPECT_EQ(stats[0].name, "read");
+  EXPECT_EQ(stats[1].threads, 2);
+  for (const auto& s : stats) {
+    LOG(INFO) << s.DebugString();
+    EXPECT_EQ(s.items, files.size());
+    EXPECT_GE(s.utilization(), 0.0);
+    EXPECT_LE(s.utilization(), 1.0);
+  }
+}
+
+TEST(PipelineTest, EmptyInput) {
+  const std::vector<StageStats> stats = RunPipeline({}, PipelineOptions());
+  for (const auto& s : stats) {
+    EXPECT_EQ(s.items, 0);
+  }
+}
+
+}  // namespace
+}  // namespace sgf_parser
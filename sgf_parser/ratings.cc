@@ -0,0 +1,229 @@
+#include "sgf_parser/ratings.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <functional>
+#include <tuple>
+#include <utility>
+
+#include "absl/strings/ascii.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using std::string;
+
+namespace {
+
+// Days since 1970-01-01 of a date of the proleptic Gregorian calendar.
+int32_t DaysFromCivil(int year, int month, int day) {
+  year -= month <= 2;
+  const int era = (year >= 0 ? year : year - 399) / 400;
+  const int year_of_era = year - era * 400;
+  const int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 +
+                          day - 1;
+  const int day_of_era = year_of_era * 365 + year_of_era / 4 -
+                         year_of_era / 100 + day_of_year;
+  return era * 146097 + day_of_era - 719468;
+}
+
+// Parses `digits` decimal digits at `*pos` and advances it. Returns -1 if they
+// are not there.
+int ParseDigits(absl::string_view s, size_t* pos, int digits) {
+  if (*pos + digits > s.size()) return -1;
+  int value = 0;
+  for (int i = 0; i < digits; ++i) {
+    const char c = s[*pos + i];
+    if (!absl::ascii_isdigit(c)) return -1;
+    value = value * 10 + (c - '0');
+  }
+  *pos += digits;
+  return value;
+}
+
+double ToElo(double gamma) { return 400 * log10(gamma); }
+
+}  // namespace
+
+int PlayerTable::Intern(absl::string_view name) {
+  const auto it = ids_.find(name);
+  if (it != ids_.end()) return it->second;
+  const int id = names_.size();
+  names_.emplace_back(name);
+  ids_.emplace(names_.back(), id);
+  return id;
+}
+
+int PlayerTable::Find(absl::string_view name) const {
+  const auto it = ids_.find(name);
+  return it == ids_.end() ? -1 : it->second;
+}
+
+void PlayerTable::Merge(const PlayerTable& other, std::vector<int>* remap) {
+  remap->resize(other.size());
+  for (int i = 0; i < other.size(); ++i) (*remap)[i] = Intern(other.name(i));
+}
+
+int32_t ParseGameDay(absl::string_view date) {
+  size_t pos = 0;
+  const int year = ParseDigits(date, &pos, 4);
+  if (year < 0) return -1;
+  int month = 1, day = 1;
+  if (pos < date.size() && date[pos] == '-') {
+    ++pos;
+    month = ParseDigits(date, &pos, 2);
+    if (month < 1 || month > 12) return -1;
+    if (pos < date.size() && date[pos] == '-') {
+      ++pos;
+      day = ParseDigits(date, &pos, 2);
+      if (day < 1 || day > 31) return -1;
+    }
+  }
+  return DaysFromCivil(year, month, day);
+}
+
+bool AddRatedGame(const GameRecord& record, int64_t file, int32_t game_index,
+                  PlayerTable* players, std::vector<RatedGame>* games) {
+  if (record.black_name.empty() || record.white_name.empty() ||
+      record.black_name == record.white_name || record.result == 0.0f) {
+    return false;
+  }
+  RatedGame game;
+  game.black = players->Intern(record.black_name);
+  game.white = players->Intern(record.white_name);
+  game.score = record.result > 0 ? 1 : 0;
+  game.day = ParseGameDay(record.date);
+  game.file = file;
+  game.game = game_index;
+  games->push_back(game);
+  return true;
+}
+
+void SortGamesByDay(std::vector<RatedGame>* games) {
+  std::stable_sort(games->begin(), games->end(),
+                   [](const RatedGame& a, const RatedGame& b) {
+                     return std::tie(a.day, a.file, a.game) <
+                            std::tie(b.day, b.file, b.game);
+                   });
+}
+
+std::vector<double> ComputeElo(absl::Span<const RatedGame> games,
+                               int num_players, const EloOptions& options) {
+  std::vector<double> ratings(num_players, options.initial);
+  for (const RatedGame& game : games) {
+    double& black = ratings[game.black];
+    double& white = ratings[game.white];
+    const double expected = 1 / (1 + pow(10, (white - black) / 400));
+    const double delta = options.k * (game.score - expected);
+    black += delta;
+    white -= delta;
+  }
+  return ratings;
+}
+
+std::vector<double> ComputeBradleyTerry(absl::Span<const RatedGame> games,
+                                        int num_players,
+                                        const BradleyTerryOptions& options,
+                                        ThreadPool* pool,
+                                        BradleyTerryStats* stats) {
+  CHECK_GT(options.prior_games, 0);
+  CHECK_GT(options.games_per_task, 0);
+  BradleyTerryStats unused_stats;
+  if (stats == nullptr) stats = &unused_stats;
+  *stats = BradleyTerryStats();
+
+  // Wins, counting draws and the prior's virtual draws as half.
+  std::vector<double> wins(num_players, options.prior_games / 2);
+  for (const RatedGame& game : games) {
+    wins[game.black] += game.score;
+    wins[game.white] += 1 - game.score;
+  }
+
+  std::vector<double> gamma(num_players, 1.0);
+  // Sums of 1 / (gamma_black + gamma_white), an array per worker.
+  const int workers = pool != nullptr ? pool->num_threads() : 1;
+  std::vector<std::vector<double>> sums(workers,
+                                        std::vector<double>(num_players));
+  const auto run = [pool](std::function<void()> task) {
+    if (pool != nullptr) {
+      pool->Schedule(std::move(task));
+    } else {
+      task();
+    }
+  };
+  const int players_per_task =
+      std::max<int>(1, (num_players + 4 * workers - 1) / (4 * workers));
+  std::vector<double> log_change(num_players);
+
+  for (int iteration = 0; iteration < options.max_iterations; ++iteration) {
+    for (size_t begin = 0; begin < games.size();
+         begin += options.games_per_task) {
+      const size_t end =
+          std::min(games.size(), begin + options.games_per_task);
+      run([&, begin, end]() {
+        const int worker = pool != nullptr ? pool->CurrentWorker() : 0;
+        double* sum = sums[worker].data();
+        for (size_t i = begin; i < end; ++i) {
+          const RatedGame& game = games[i];
+          const double inverse = 1 / (gamma[game.black] + gamma[game.white]);
+          sum[game.black] += inverse;
+          sum[game.white] += inverse;
+        }
+      });
+    }
+    if (pool != nullptr) pool->Wait();
+
+    // Every task updates a range of players and clears their sums for the
+    // next iteration.
+    for (int begin = 0; begin < num_players; begin += players_per_task) {
+      const int end = std::min(num_players, begin + players_per_task);
+      run([&, begin, end]() {
+        for (int i = begin; i < end; ++i) {
+          double sum = options.prior_games / (gamma[i] + 1);
+          for (auto& worker_sums : sums) {
+            sum += worker_sums[i];
+            worker_sums[i] = 0;
+          }
+          const double updated = wins[i] / sum;
+          log_change[i] = log(updated / gamma[i]);
+          gamma[i] = updated;
+        }
+      });
+    }
+    if (pool != nullptr) pool->Wait();
+
+    // Scaling every gamma alike doesn't change the likelihood of the games,
+    // only of the prior, so the iteration above is slow to find the scale.
+    // Find it directly with a few Newton steps on the prior alone.
+    double shift = 0;
+    for (int step = 0; step < 5; ++step) {
+      const double scale = exp(shift);
+      double gradient = 0, curvature = 0;
+      for (int i = 0; i < num_players; ++i) {
+        const double p = gamma[i] * scale / (gamma[i] * scale + 1);
+        gradient += 0.5 - p;
+        curvature += p * (1 - p);
+      }
+      if (curvature <= 0) break;
+      shift += gradient / curvature;
+    }
+    const double scale = exp(shift);
+    double max_change = 0;
+    for (int i = 0; i < num_players; ++i) {
+      gamma[i] *= scale;
+      max_change = std::max(max_change, fabs(ToElo(exp(log_change[i] + shift))));
+    }
+
+    stats->iterations = iteration + 1;
+    stats->max_change = max_change;
+    VLOG(1) << "Iteration " << iteration << ": max change " << max_change;
+    if (max_change <= options.tolerance) break;
+  }
+
+  std::vector<double> ratings(num_players);
+  for (int i = 0; i < num_players; ++i) ratings[i] = ToElo(gamma[i]);
+  return ratings;
+}
+
+}  // namespace sgf_parser
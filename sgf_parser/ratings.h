@@ -0,0 +1,116 @@
+#ifndef SGF_PARSER_RATINGS_H_
+#define SGF_PARSER_RATINGS_H_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/thread_pool.h"
+
+namespace sgf_parser {
+
+// Interns player names as dense ids, so games and ratings refer to players by
+// index instead of by string.
+class PlayerTable {
+ public:
+  PlayerTable() = default;
+
+  // Returns the id of `name`, adding it if it is new.
+  int Intern(absl::string_view name);
+
+  // Returns the id of `name`, or -1 if it is not in the table.
+  int Find(absl::string_view name) const;
+
+  const std::string& name(int id) const { return names_[id]; }
+  int size() const { return names_.size(); }
+
+  // Interns every player of `other`. (*remap)[i] is set to the id in this
+  // table of player i of `other`, e.g. to merge the tables of several workers.
+  void Merge(const PlayerTable& other, std::vector<int>* remap);
+
+ private:
+  absl::flat_hash_map<std::string, int> ids_;
+  std::vector<std::string> names_;
+};
+
+// A game between two players of a PlayerTable.
+struct RatedGame {
+  int black = -1;
+  int white = -1;
+  float score = 0;   // Black's: 1 for a win, 0 for a loss, 0.5 for a draw.
+  int32_t day = -1;  // Days since 1970-01-01 the game was played, or -1.
+
+  // Where the game comes from: the index of its file in the input and of the
+  // game in the file. Orders games of the same day, so the order doesn't
+  // depend on which thread read which file.
+  int64_t file = -1;
+  int32_t game = 0;
+};
+
+// Parses the first date of a DT value, "YYYY-MM-DD", "YYYY-MM" or "YYYY", as
+// days since 1970-01-01. A missing month or day is the first. Returns -1 if
+// there is no date.
+int32_t ParseGameDay(absl::string_view date);
+
+// Appends the game of `record`, game `game` of file `file` of the input, to
+// `games`, interning its players. Returns false and adds nothing if a player
+// name is missing, both names are the same, or there is no result.
+bool AddRatedGame(const GameRecord& record, int64_t file, int32_t game,
+                  PlayerTable* players, std::vector<RatedGame>* games);
+
+// Sorts games by day, with games of unknown dates first, then by file and game
+// index, so the order only depends on the input.
+void SortGamesByDay(std::vector<RatedGame>* games);
+
+struct EloOptions {
+  double initial = 1500;
+  double k = 16;
+};
+
+// Elo ratings of `num_players` players after playing `games` in order. It's a
+// single cheap pass, good for a first ordering of players, but the ratings
+// depend on the order and lag behind players who improve.
+std::vector<double> ComputeElo(absl::Span<const RatedGame> games,
+                               int num_players, const EloOptions& options);
+
+struct BradleyTerryOptions {
+  int max_iterations = 500;
+  // Stops once no player's rating moves by more than this many Elo points.
+  double tolerance = 0.01;
+  // Every player is given this many virtual draws against a player rated 0,
+  // which keeps the ratings of players who never lose or never win finite.
+  double prior_games = 2;
+  // Games per task of an iteration.
+  int games_per_task = 1 << 16;
+};
+
+struct BradleyTerryStats {
+  int iterations = 0;
+  double max_change = 0;   // In the last iteration, in Elo points.
+};
+
+// Maximum likelihood Bradley-Terry ratings of `num_players` players, on the
+// Elo scale: a player rated 400 points above another is expected to score 10
+// to 1 against them. Every game counts the same whatever its date.
+//
+// It runs the minorization-maximization iteration of Hunter (2004), which only
+// needs, per player, the sum over their games of 1 / (gamma_black +
+// gamma_white). Every iteration splits the games into tasks on `pool`, each of
+// which sums into its own array, then adds the arrays up by ranges of players.
+// Scaling all strengths alike only changes the prior's likelihood, which the
+// iteration is slow to follow, so every iteration also solves for that scale
+// directly. `pool` and `stats` may be null.
+std::vector<double> ComputeBradleyTerry(absl::Span<const RatedGame> games,
+                                        int num_players,
+                                        const BradleyTerryOptions& options,
+                                        ThreadPool* pool,
+                                        BradleyTerryStats* stats);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_RATINGS_H_
@@ -0,0 +1,121 @@
+// Rates the players of a corpus of SGF files. Files are parsed on a thread
+// pool, every worker interning players into its own table, and the tables are
+// merged at the end. Writes a tab separated table with a line per player,
+// strongest first: the name, games, wins, the Elo rating after the games in
+// date order, and the Bradley-Terry rating.
+//
+// Usage:
+//   sgf_ratings --output=ratings.tsv [--threads=N] [--file_list=files.txt]
+//       [file ...]
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/file_tasks.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/ratings.h"
+#include "sgf_parser/thread_pool.h"
+
+DEFINE_string(output, "", "Output file for the ratings.");
+DEFINE_int32(threads, 0, "Worker threads, 0 for one per core.");
+DEFINE_string(file_list, "", "A file with one SGF file name per line.");
+DEFINE_double(elo_k, 16, "K factor of Elo ratings.");
+DEFINE_int32(max_iterations, 500, "Bradley-Terry iterations at most.");
+DEFINE_double(tolerance, 0.01,
+              "Bradley-Terry stops once no rating moves by more than this.");
+DEFINE_double(prior_games, 2,
+              "Virtual draws of every player against one rated 0.");
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK(!FLAGS_output.empty()) << "--output is required.";
+
+  const std::vector<std::string> files =
+      sgf_parser::ReadInputFiles(argc, argv, FLAGS_file_list);
+
+  sgf_parser::ThreadPool pool(FLAGS_threads);
+  // Every worker interns into its own table.
+  std::vector<sgf_parser::PlayerTable> worker_players(pool.num_threads());
+  std::vector<std::vector<sgf_parser::RatedGame>> worker_games(
+      pool.num_threads());
+  int64_t failed;
+  {
+    sgf_parser::FileTaskRunner runner(&pool, nullptr);
+    failed = runner.Run(files, [&](const std::string& file,
+                                   sgf_parser::FileWorker* worker) {
+      if (!worker->Parse(file, sgf_parser::ReadFileToString(file))) {
+        return false;
+      }
+      const int i = pool.CurrentWorker();
+      sgf_parser::AddRatedGame(worker->record, worker->file_index, 0,
+                               &worker_players[i], &worker_games[i]);
+      return true;
+    });
+  }
+
+  // Merge the workers' tables and games.
+  sgf_parser::PlayerTable players;
+  std::vector<sgf_parser::RatedGame> games;
+  std::vector<int> remap;
+  for (int i = 0; i < pool.num_threads(); ++i) {
+    players.Merge(worker_players[i], &remap);
+    for (sgf_parser::RatedGame game : worker_games[i]) {
+      game.black = remap[game.black];
+      game.white = remap[game.white];
+      games.push_back(game);
+    }
+  }
+  worker_players.clear();
+  worker_games.clear();
+  LOG(INFO) << "Rating " << players.size() << " players from " << games.size()
+            << " games; " << failed << " of " << files.size()
+            << " files failed to parse.";
+
+  sgf_parser::SortGamesByDay(&games);
+  sgf_parser::EloOptions elo_options;
+  elo_options.k = FLAGS_elo_k;
+  const std::vector<double> elo =
+      sgf_parser::ComputeElo(games, players.size(), elo_options);
+
+  sgf_parser::BradleyTerryOptions options;
+  options.max_iterations = FLAGS_max_iterations;
+  options.tolerance = FLAGS_tolerance;
+  options.prior_games = FLAGS_prior_games;
+  sgf_parser::BradleyTerryStats stats;
+  const std::vector<double> ratings = sgf_parser::ComputeBradleyTerry(
+      games, players.size(), options, &pool, &stats);
+  LOG(INFO) << "Bradley-Terry: " << stats.iterations << " iterations, last "
+            << "change " << stats.max_change << ".";
+
+  std::vector<int> played(players.size()), won(players.size());
+  for (const auto& game : games) {
+    ++played[game.black];
+    ++played[game.white];
+    if (game.score == 1) ++won[game.black];
+    if (game.score == 0) ++won[game.white];
+  }
+  std::vector<int> order(players.size());
+  std::iota(order.begin(), order.end(), 0);
+  // Ties go by name; player ids depend on which thread read which file.
+  std::sort(order.begin(), order.end(), [&ratings, &players](int a, int b) {
+    if (ratings[a] != ratings[b]) return ratings[a] > ratings[b];
+    return players.name(a) < players.name(b);
+  });
+
+  std::ofstream out(FLAGS_output);
+  CHECK(out) << "Failed to open " << FLAGS_output;
+  out << "player\tgames\twins\telo\trating\n";
+  for (const int i : order) {
+    out << players.name(i) << "\t" << played[i] << "\t" << won[i] << "\t"
+        << elo[i] << "\t" << ratings[i] << "\n";
+  }
+  out.close();
+  CHECK(out) << "Failed to write " << FLAGS_output;
+  return 0;
+}
@@ -0,0 +1,200 @@
+#include "sgf_parser/ratings.h"
+
+#include <math.h>
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+class RatingsTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(RatingsTest, PlayerTable) {
+  PlayerTable players;
+  EXPECT_EQ(players.Intern("Lee Sedol"), 0);
+  EXPECT_EQ(players.Intern("Ke Jie"), 1);
+  EXPECT_EQ(players.Intern("Lee Sedol"), 0);
+  EXPECT_EQ(players.Find("Ke Jie"), 1);
+  EXPECT_EQ(players.Find("Shin Jinseo"), -1);
+  EXPECT_EQ(players.size(), 2);
+  EXPECT_EQ(players.name(1), "Ke Jie");
+
+  PlayerTable other;
+  other.Intern("Shin Jinseo");
+  other.Intern("Lee Sedol");
+  std::vector<int> remap;
+  players.Merge(other, &remap);
+  EXPECT_EQ(remap, std::vector<int>({2, 0}));
+  EXPECT_EQ(players.size(), 3);
+}
+
+TEST_F(RatingsTest, ParseGameDay) {
+  EXPECT_EQ(ParseGameDay("1970-01-01"), 0);
+  EXPECT_EQ(ParseGameDay("2000-03-01"), 11017);
+  EXPECT_EQ(ParseGameDay("2000-03"), 11017);
+  EXPECT_EQ(ParseGameDay("2016"), 16801);
+  EXPECT_EQ(ParseGameDay("2016-03-09,10"), 16869);
+  EXPECT_EQ(ParseGameDay("1969-12-31"), -1 - 0);
+  EXPECT_EQ(ParseGameDay(""), -1);
+  EXPECT_EQ(ParseGameDay("March 2016"), -1);
+  EXPECT_EQ(ParseGameDay("2016-13-01"), -1);
+}
+
+TEST_F(RatingsTest, AddRatedGame) {
+  PlayerTable players;
+  std::vector<RatedGame> games;
+  GameRecord record;
+  record.black_name = "A";
+  record.white_name = "B";
+  record.date = "2020-01-02";
+  EXPECT_FALSE(AddRatedGame(record, 7, 0, &players, &games));   // No result.
+  record.result = -1.2;
+  record.resigned = true;
+  ASSERT_TRUE(AddRatedGame(record, 7, 0, &players, &games));
+  ASSERT_EQ(games.size(), 1);
+  EXPECT_EQ(games[0].black, 0);
+  EXPECT_EQ(games[0].white, 1);
+  EXPECT_EQ(games[0].score, 0);
+  EXPECT_EQ(games[0].day, ParseGameDay("2020-01-02"));
+  EXPECT_EQ(games[0].file, 7);
+  EXPECT_EQ(games[0].game, 0);
+  record.white_name = "A";
+  EXPECT_FALSE(AddRatedGame(record, 7, 0, &players, &games));
+  record.white_name.clear();
+  EXPECT_FALSE(AddRatedGame(record, 7, 0, &players, &games));
+  EXPECT_EQ(games.size(), 1);
+}
+
+TEST_F(RatingsTest, SortGamesByDay) {
+  std::vector<RatedGame> games(5);
+  const int32_t days[] = {5, -1, 3, 3, 3};
+  const int64_t files[] = {0, 1, 4, 2, 2};
+  const int32_t indices[] = {0, 0, 0, 1, 0};
+  for (int i = 0; i < 5; ++i) {
+    games[i].black = i;
+    games[i].day = days[i];
+    games[i].file = files[i];
+    games[i].game = indices[i];
+  }
+  SortGamesByDay(&games);
+  EXPECT_EQ(games[0].black, 1);
+  EXPECT_EQ(games[1].black, 4);
+  EXPECT_EQ(games[2].black, 3);
+  EXPECT_EQ(games[3].black, 2);
+  EXPECT_EQ(games[4].black, 0);
+}
+
+TEST_F(RatingsTest, EloDoesNotDependOnInputOrder) {
+  std::mt19937 rng(1);
+  std::vector<RatedGame> games(500);
+  for (size_t i = 0; i < games.size(); ++i) {
+    games[i].black = rng() % 10;
+    games[i].white = (games[i].black + 1 + rng() % 9) % 10;
+    games[i].score = rng() % 2;
+    games[i].day = rng() % 5;   // Many games on each day.
+    games[i].file = i / 2;
+    games[i].game = i % 2;
+  }
+  std::vector<RatedGame> shuffled = games;
+  std::shuffle(shuffled.begin(), shuffled.end(), rng);
+  SortGamesByDay(&games);
+  SortGamesByDay(&shuffled);
+  EXPECT_EQ(ComputeElo(games, 10, EloOptions()),
+            ComputeElo(shuffled, 10, EloOptions()));
+}
+
+TEST_F(RatingsTest, Elo) {
+  std::vector<RatedGame> games(1);
+  games[0].black = 1;
+  games[0].white = 0;
+  games[0].score = 1;
+  const std::vector<double> ratings = ComputeElo(games, 3, EloOptions());
+  EXPECT_DOUBLE_EQ(ratings[0], 1492);
+  EXPECT_DOUBLE_EQ(ratings[1], 1508);
+  EXPECT_DOUBLE_EQ(ratings[2], 1500);
+}
+
+TEST_F(RatingsTest, BradleyTerryTwoPlayers) {
+  // Three wins out of four is a 3 to 1 strength ratio.
+  std::vector<RatedGame> games(4);
+  for (int i = 0; i < 4; ++i) {
+    games[i].black = i % 2;
+    games[i].white = 1 - i % 2;
+    games[i].score = i == 3 ? 1 : games[i].black == 0;
+  }
+  BradleyTerryOptions options;
+  options.prior_games = 1e-4;
+  options.tolerance = 1e-6;
+  options.max_iterations = 10000;
+  BradleyTerryStats stats;
+  const std::vector<double> ratings =
+      ComputeBradleyTerry(games, 2, options, nullptr, &stats);
+  EXPECT_NEAR(ratings[0] - ratings[1], 400 * log10(3), 0.1);
+  EXPECT_LE(stats.max_change, options.tolerance);
+  EXPECT_GT(stats.iterations, 1);
+}
+
+TEST_F(RatingsTest, BradleyTerryRecoversStrengths) {
+  constexpr int kPlayers = 30;
+  std::mt19937 rng(1);
+  std::uniform_int_distribution<int> player(0, kPlayers - 1);
+  std::uniform_real_distribution<double> uniform(0, 1);
+  // True ratings from -580 to 580.
+  const auto strength = [](int i) { return 40.0 * (i - (kPlayers - 1) / 2.0); };
+  std::vector<RatedGame> games;
+  for (int i = 0; i < 60000; ++i) {
+    RatedGame game;
+    game.black = player(rng);
+    do {
+      game.white = player(rng);
+    } while (game.white == game.black);
+    const double expected =
+        1 / (1 + pow(10, (strength(game.white) - strength(game.black)) / 400));
+    game.score = uniform(rng) < expected;
+    games.push_back(game);
+  }
+  // A player who never loses still gets a finite rating.
+  for (int i = 0; i < 10; ++i) {
+    RatedGame game;
+    game.black = kPlayers;
+    game.white = i;
+    game.score = 1;
+    games.push_back(game);
+  }
+
+  BradleyTerryOptions options;
+  options.games_per_task = 1000;
+  BradleyTerryStats stats;
+  ThreadPool pool(4);
+  const std::vector<double> ratings =
+      ComputeBradleyTerry(games, kPlayers + 2, options, &pool, &stats);
+  EXPECT_LT(stats.iterations, options.max_iterations);
+  double mean = 0;
+  for (int i = 0; i < kPlayers; ++i) mean += ratings[i] / kPlayers;
+  for (int i = 0; i < kPlayers; ++i) {
+    EXPECT_NEAR(ratings[i] - mean, strength(i), 40) << "player " << i;
+  }
+  EXPECT_TRUE(std::isfinite(ratings[kPlayers]));
+  EXPECT_GT(ratings[kPlayers], ratings[9]);
+  EXPECT_NEAR(ratings[kPlayers + 1], 0, 0.1);   // No games.
+
+  // The same without a pool.
+  const std::vector<double> serial =
+      ComputeBradleyTerry(games, kPlayers + 2, options, nullptr, nullptr);
+  for (int i = 0; i < kPlayers + 2; ++i) {
+    EXPECT_NEAR(serial[i], ratings[i], 1e-6) << "player " << i;
+  }
+}
+
+}  // namespace
+}  // namespace sgf_parser
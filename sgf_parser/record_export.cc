@@ -0,0 +1,222 @@
+#include "sgf_parser/record_export.h"
+
+#include <charconv>
+#include <cmath>
+#include <vector>
+
+namespace sgf_parser {
+
+using absl::string_view;
+using std::string;
+
+const char kMovesCsvHeader[] = "game,move,color,x,y\n";
+
+namespace {
+
+// GTP columns skip 'I'.
+constexpr char kGtpColumns[] = "ABCDEFGHJKLMNOPQRSTUVWXYZ";
+constexpr int kMaxGtpBoardSize = sizeof(kGtpColumns) - 1;
+
+void AppendInt(int64_t value, string* out) {
+  char buffer[24];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out->append(buffer, result.ptr - buffer);
+}
+
+// The shortest decimal which reads back as `value`, e.g. "7.5" or "-1.2".
+void AppendFloat(float value, string* out) {
+  char buffer[32];
+  const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out->append(buffer, result.ptr - buffer);
+}
+
+void AppendJsonFloat(float value, string* out) {
+  if (std::isfinite(value)) {
+    AppendFloat(value, out);
+  } else {
+    out->append("null");
+  }
+}
+
+void AppendJsonString(string_view value, string* out) {
+  static const char kHex[] = "0123456789abcdef";
+  out->push_back('"');
+  size_t plain = 0;   // Start of the run which needs no escaping.
+  for (size_t i = 0; i < value.size(); ++i) {
+    const unsigned char c = value[i];
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    out->append(value.data() + plain, i - plain);
+    plain = i + 1;
+    switch (c) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default: {
+        const char escaped[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 15]};
+        out->append(escaped, sizeof(escaped));
+      }
+    }
+  }
+  out->append(value.data() + plain, value.size() - plain);
+  out->push_back('"');
+}
+
+void AppendJsonField(string_view name, string_view value, string* out) {
+  out->append(",\"");
+  out->append(name.data(), name.size());
+  out->append("\":");
+  AppendJsonString(value, out);
+}
+
+void AppendJsonStones(const std::vector<GoPos>& stones, string* out) {
+  out->push_back('[');
+  for (size_t i = 0; i < stones.size(); ++i) {
+    if (i > 0) out->push_back(',');
+    out->push_back('[');
+    AppendInt(stones[i].first, out);
+    out->push_back(',');
+    AppendInt(stones[i].second, out);
+    out->push_back(']');
+  }
+  out->push_back(']');
+}
+
+const char* ColorName(GoMove::Color color) {
+  return color == GoMove::BLACK ? "B" : "W";
+}
+
+void AppendCsvField(string_view value, string* out) {
+  if (value.find_first_of(",\"\r\n") == string_view::npos) {
+    out->append(value.data(), value.size());
+    return;
+  }
+  out->push_back('"');
+  for (const char c : value) {
+    if (c == '"') out->push_back('"');
+    out->push_back(c);
+  }
+  out->push_back('"');
+}
+
+// Appends " <vertex>", or returns false if `pos` is off the board.
+bool AppendGtpVertex(const GoPos& pos, int size, string* out) {
+  if (pos.first < 0 || pos.first >= size || pos.second < 0 ||
+      pos.second >= size) {
+    return false;
+  }
+  out->push_back(' ');
+  out->push_back(kGtpColumns[pos.first]);
+  AppendInt(size - pos.second, out);
+  return true;
+}
+
+// Fails if `pos` is off the board. Only moves may be passes; a setup stone at
+// "tt" is off the board like any other.
+bool AppendGtpPlay(GoMove::Color color, bool pass, const GoPos& pos, int size,
+                   string* out) {
+  out->append("play ");
+  out->append(ColorName(color));
+  if (pass) {
+    out->append(" pass\n");
+    return true;
+  }
+  if (!AppendGtpVertex(pos, size, out)) return false;
+  out->push_back('\n');
+  return true;
+}
+
+}  // namespace
+
+void AppendJsonLine(const GameRecord& record, string* out) {
+  out->append("{\"board_width\":");
+  AppendInt(record.board_width, out);
+  out->append(",\"board_height\":");
+  AppendInt(record.board_height, out);
+  out->append(",\"komi\":");
+  AppendJsonFloat(record.komi, out);
+  out->append(",\"handicap\":");
+  AppendInt(record.handicap, out);
+  out->append(",\"timelimit\":");
+  AppendInt(record.timelimit, out);
+  out->append(",\"result\":");
+  AppendJsonFloat(record.result, out);
+  out->append(record.resigned ? ",\"resigned\":true" : ",\"resigned\":false");
+  AppendJsonField("black_name", record.black_name, out);
+  AppendJsonField("black_rank", record.black_rank, out);
+  AppendJsonField("white_name", record.white_name, out);
+  AppendJsonField("white_rank", record.white_rank, out);
+  AppendJsonField("date", record.date, out);
+  AppendJsonField("rule", record.rule, out);
+  out->append(",\"black_stones\":");
+  AppendJsonStones(record.black_stones, out);
+  out->append(",\"white_stones\":");
+  AppendJsonStones(record.white_stones, out);
+  out->append(",\"moves\":[");
+  for (size_t i = 0; i < record.moves.size(); ++i) {
+    const GoMove& move = record.moves[i];
+    out->append(i > 0 ? ",[\"" : "[\"");
+    out->append(ColorName(move.player));
+    out->push_back('"');
+    if (!move.pass) {
+      out->push_back(',');
+      AppendInt(move.move.first, out);
+      out->push_back(',');
+      AppendInt(move.move.second, out);
+    }
+    out->push_back(']');
+  }
+  out->append("]}\n");
+}
+
+void AppendMovesCsv(const GameRecord& record, string_view game, string* out) {
+  for (size_t i = 0; i < record.moves.size(); ++i) {
+    const GoMove& move = record.moves[i];
+    AppendCsvField(game, out);
+    out->push_back(',');
+    AppendInt(i + 1, out);
+    out->push_back(',');
+    out->append(ColorName(move.player));
+    out->push_back(',');
+    if (!move.pass) {
+      AppendInt(move.move.first, out);
+      out->push_back(',');
+      AppendInt(move.move.second, out);
+    } else {
+      out->push_back(',');
+    }
+    out->push_back('\n');
+  }
+}
+
+bool AppendGtpCommands(const GameRecord& record, string* out) {
+  const int size = record.board_width == 0 ? 19 : record.board_width;
+  if (record.board_height != record.board_width || size > kMaxGtpBoardSize ||
+      !std::isfinite(record.komi)) {
+    return false;
+  }
+  const size_t original_size = out->size();
+  out->append("boardsize ");
+  AppendInt(size, out);
+  out->append("\nclear_board\nkomi ");
+  AppendFloat(record.komi, out);
+  out->push_back('\n');
+  bool ok = true;
+  for (const auto& stone : record.black_stones) {
+    ok = ok && AppendGtpPlay(GoMove::BLACK, false, stone, size, out);
+  }
+  for (const auto& stone : record.white_stones) {
+    ok = ok && AppendGtpPlay(GoMove::WHITE, false, stone, size, out);
+  }
+  for (const auto& move : record.moves) {
+    // FF[3] writes a pass as "tt" on boards up to 19x19.
+    const bool pass = move.pass || (size <= 19 && move.move.first == 19 &&
+                                    move.move.second == 19);
+    ok = ok && AppendGtpPlay(move.player, pass, move.move, size, out);
+  }
+  if (!ok) out->resize(original_size);
+  return ok;
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,44 @@
+#ifndef SGF_PARSER_RECORD_EXPORT_H_
+#define SGF_PARSER_RECORD_EXPORT_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// Exporters of GameRecord to formats other tools read. They append to `out`,
+// so a caller converting many games can reuse one buffer and write it out in
+// large batches. Numbers are formatted with std::to_chars, which is exact and
+// much cheaper than going through streams or StrAppend.
+
+// Appends `record` as one line of JSON, newline included:
+//   {"board_width":19,"board_height":19,"komi":7.5,"handicap":0,
+//    "timelimit":600,"result":-1.2,"resigned":true,"black_name":"...",
+//    "black_rank":"...","white_name":"...","white_rank":"...","date":"...",
+//    "rule":"...","black_stones":[[3,3]],"white_stones":[],
+//    "moves":[["B",15,3],["W"]]}
+// A move is [color, x, y], or just [color] for a pass. Komi and result which
+// are not finite are written as null.
+void AppendJsonLine(const GameRecord& record, std::string* out);
+
+// The header line of AppendMovesCsv.
+extern const char kMovesCsvHeader[];
+
+// Appends one CSV line per move of `record`: the game, e.g. its file name, the
+// move number starting from 1, the color, and x and y, which are empty for a
+// pass. `game` is quoted if it has to be.
+void AppendMovesCsv(const GameRecord& record, absl::string_view game,
+                    std::string* out);
+
+// Appends the GTP commands which set up `record` and play its moves:
+// boardsize, clear_board, komi, a play for every pre-set stone, then a play
+// for every move. A board without SZ is 19x19. Returns false, and appends
+// nothing, if the board is not square or is larger than GTP's 25x25, if a
+// stone or move is off the board, or if komi is not finite.
+bool AppendGtpCommands(const GameRecord& record, std::string* out);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_RECORD_EXPORT_H_
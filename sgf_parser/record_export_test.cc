@@ -0,0 +1,115 @@
+#include "sgf_parser/record_export.h"
+
+#include <algorithm>
+#include <string>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+GameRecord Parse(const string& sgf) {
+  GameRecord record;
+  string errors;
+  CHECK(SimpleParseSgf(sgf, &record, nullptr, &errors)) << errors;
+  return record;
+}
+
+class RecordExportTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(RecordExportTest, JsonLine) {
+  const GameRecord record = Parse(
+      "(;SZ[9]KM[6.5]HA[2]PB[Bob \"the\" crawfish]BR[4d]PW[a\tb]RE[W+R]"
+      "AB[cc][gg];W[ee];B[];W[ab])");
+  string out = "x";
+  AppendJsonLine(record, &out);
+  EXPECT_EQ(out,
+            "x{\"board_width\":9,\"board_height\":9,\"komi\":6.5,"
+            "\"handicap\":2,\"timelimit\":-1,\"result\":-1.2,"
+            "\"resigned\":true,\"black_name\":\"Bob \\\"the\\\" crawfish\","
+            "\"black_rank\":\"4d\",\"white_name\":\"a\\tb\","
+            "\"white_rank\":\"\",\"date\":\"\",\"rule\":\"\","
+            "\"black_stones\":[[2,2],[6,6]],\"white_stones\":[],"
+            "\"moves\":[[\"W\",4,4],[\"B\"],[\"W\",0,1]]}\n");
+
+  GameRecord control;
+  control.black_name = string("a\x01\\z", 4);
+  control.komi = 1.0f / 0.0f;
+  out.clear();
+  AppendJsonLine(control, &out);
+  EXPECT_NE(out.find("\"komi\":null"), string::npos) << out;
+  EXPECT_NE(out.find("\"black_name\":\"a\\u0001\\\\z\""), string::npos) << out;
+}
+
+TEST_F(RecordExportTest, MovesCsv) {
+  const GameRecord record = Parse("(;SZ[19];B[pd];W[];B[dp])");
+  string out = kMovesCsvHeader;
+  AppendMovesCsv(record, "games/a.sgf", &out);
+  AppendMovesCsv(record, "b,\"c\".sgf", &out);
+  EXPECT_EQ(out,
+            "game,move,color,x,y\n"
+            "games/a.sgf,1,B,15,3\n"
+            "games/a.sgf,2,W,,\n"
+            "games/a.sgf,3,B,3,15\n"
+            "\"b,\"\"c\"\".sgf\",1,B,15,3\n"
+            "\"b,\"\"c\"\".sgf\",2,W,,\n"
+            "\"b,\"\"c\"\".sgf\",3,B,3,15\n");
+}
+
+TEST_F(RecordExportTest, GtpCommands) {
+  string out;
+  EXPECT_TRUE(AppendGtpCommands(
+      Parse("(;SZ[19]KM[7.5]AB[dd]AW[aa];W[pd];B[];W[jj];B[tt];W[ha])"),
+      &out));
+  EXPECT_EQ(out,
+            "boardsize 19\nclear_board\nkomi 7.5\n"
+            "play B D16\nplay W A19\n"
+            "play W Q16\nplay B pass\nplay W K10\nplay B pass\nplay W H19\n");
+
+  // No SZ means 19x19.
+  out.clear();
+  EXPECT_TRUE(AppendGtpCommands(Parse("(;B[ss])"), &out));
+  EXPECT_EQ(out, "boardsize 19\nclear_board\nkomi 0\nplay B T1\n");
+
+  // Failures leave the buffer as it was.
+  out = "kept\n";
+  EXPECT_FALSE(AppendGtpCommands(Parse("(;SZ[9];B[aa];W[jj])"), &out));
+  GameRecord rectangular = Parse("(;SZ[19];B[aa])");
+  rectangular.board_height = 9;
+  EXPECT_FALSE(AppendGtpCommands(rectangular, &out));
+  EXPECT_FALSE(AppendGtpCommands(Parse("(;SZ[26];B[aa])"), &out));
+  // "tt" is a pass only as a move.
+  EXPECT_FALSE(AppendGtpCommands(Parse("(;SZ[19]AB[tt];B[aa])"), &out));
+  EXPECT_FALSE(AppendGtpCommands(Parse("(;SZ[19]AW[tt];B[aa])"), &out));
+  EXPECT_EQ(out, "kept\n");
+}
+
+TEST_F(RecordExportTest, TestData) {
+  const GameRecord record =
+      Parse(ReadFileToString("testdata/handicapped.sgf"));
+  string json;
+  AppendJsonLine(record, &json);
+  EXPECT_EQ(json.find('\n'), json.size() - 1);
+
+  string csv;
+  AppendMovesCsv(record, "handicapped", &csv);
+  EXPECT_EQ(std::count(csv.begin(), csv.end(), '\n'), record.moves.size());
+
+  string gtp;
+  ASSERT_TRUE(AppendGtpCommands(record, &gtp));
+  EXPECT_EQ(std::count(gtp.begin(), gtp.end(), '\n'),
+            3 + record.black_stones.size() + record.white_stones.size() +
+                record.moves.size());
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,303 @@
+// Guards the hot paths of the parser against performance regressions. Runs
+// FindFirst, ParseToRoot, HandleProperty, SimpleParseSgf, ValidateSgf,
+// ScanMainLine and ReadFileToString on a generated corpus which only depends on --seed, each --repetitions
+// times, and compares the median throughput and the allocations per game with
+// a checked-in baseline. Exits with 1 if a benchmark got slower beyond
+// --tolerance with 95% confidence, or allocates more than the baseline.
+//
+// Throughput depends on the machine and the build, so the baseline is only
+// meaningful for the machine it was written on, with -c opt. After an
+// intended change, or on a new machine, write a new one:
+//   bazel run -c opt //:parser_perf_gate --
+//       --write_baseline=$PWD/testdata/benchmark_baseline.txt
+// and check it:
+//   bazel test -c opt //:parser_perf_gate
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/alloc_counter.h"
+#include "sgf_parser/generated_corpus.h"
+#include "sgf_parser/move_scanner.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/validator.h"
+
+DEFINE_string(baseline, "testdata/benchmark_baseline.txt",
+              "The baseline to compare with.");
+DEFINE_string(write_baseline, "",
+              "Write the measured medians to this file instead of comparing.");
+DEFINE_int32(repetitions, 9, "Measured runs of every benchmark.");
+DEFINE_double(tolerance, 0.2,
+              "Relative drop of the median throughput which is tolerated.");
+DEFINE_double(alloc_tolerance, 0.05,
+              "Relative growth of the allocations per game which is "
+              "tolerated.");
+DEFINE_int32(games, 2000, "Games in the generated corpus.");
+DEFINE_int32(files, 500, "Games written to files for ReadFileToString.");
+DEFINE_int32(seed, 1, "Seed of the generated corpus.");
+
+namespace sgf_parser {
+namespace {
+
+using std::string;
+
+struct Benchmark {
+  string name;
+  int64_t bytes;   // Input processed by one run.
+  int64_t games;
+  std::function<void()> run;
+};
+
+struct Result {
+  std::vector<double> mb_per_s;   // Sorted.
+  double allocations_per_game = -1;
+
+  double median() const { return mb_per_s[mb_per_s.size() / 2]; }
+};
+
+struct Baseline {
+  double mb_per_s = 0;
+  double allocations_per_game = 0;
+};
+
+// The median of n samples lies between the k-th smallest and the k-th largest
+// with probability 1 - 2 P(B <= k) for B ~ Binomial(n, 1/2). Returns the
+// largest k for which that is at least 95%, or 0 if none is.
+int MedianConfidenceRank(int n) {
+  int k = 0;
+  double below = std::pow(0.5, n);   // P(B <= k).
+  double term = below;               // P(B == k).
+  while (k + 1 < n / 2) {
+    term *= static_cast<double>(n - k) / (k + 1);
+    if (1 - 2 * (below + term) < 0.95) break;
+    below += term;
+    ++k;
+  }
+  return k;
+}
+
+Result Measure(const Benchmark& benchmark) {
+  benchmark.run();   // Warm up caches and the allocator.
+  Result result;
+  for (int i = 0; i < std::max(1, FLAGS_repetitions); ++i) {
+    AllocationCounter counter;
+    const auto start = std::chrono::steady_clock::now();
+    benchmark.run();
+    const double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    result.mb_per_s.push_back(benchmark.bytes / 1e6 / seconds);
+    // Runs are deterministic; what differs is noise, e.g. the allocator
+    // growing a thread cache.
+    const double allocations =
+        static_cast<double>(counter.allocations()) / benchmark.games;
+    if (result.allocations_per_game < 0 ||
+        allocations < result.allocations_per_game) {
+      result.allocations_per_game = allocations;
+    }
+  }
+  std::sort(result.mb_per_s.begin(), result.mb_per_s.end());
+  return result;
+}
+
+bool ReadBaseline(const string& filename,
+                  std::map<string, Baseline>* baseline) {
+  std::ifstream in(filename);
+  if (!in) return false;
+  string line;
+  while (std::getline(in, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    const std::vector<absl::string_view> fields =
+        absl::StrSplit(line, ' ', absl::SkipEmpty());
+    Baseline entry;
+    if (fields.size() != 3 || !absl::SimpleAtod(fields[1], &entry.mb_per_s) ||
+        !absl::SimpleAtod(fields[2], &entry.allocations_per_game)) {
+      LOG(ERROR) << filename << ": bad line: " << line;
+      return false;
+    }
+    (*baseline)[string(fields[0])] = entry;
+  }
+  return true;
+}
+
+// A plain recursive walk; the generated games are shallow.
+void ForEachProperty(const internal::GameTree& tree,
+                     const std::function<void(const internal::Property&)>& fn) {
+  for (const internal::GameNode& node : tree.sequence) {
+    for (const internal::Property& prop : node) fn(prop);
+  }
+  for (const auto& child : tree.children) ForEachProperty(*child, fn);
+}
+
+int Run() {
+  const std::vector<string> games = GenerateCorpus(FLAGS_games, FLAGS_seed);
+  int64_t bytes = 0;
+  for (const string& game : games) bytes += game.size();
+  const int64_t count = games.size();
+  std::vector<Benchmark> benchmarks;
+  string errors;
+
+  benchmarks.push_back({"find_first", bytes, count, [&] {
+    int64_t values = 0;
+    for (absl::string_view game : games) {
+      for (auto p = internal::FindFirst(game, 0, "]", true);
+           p != absl::string_view::npos;
+           p = internal::FindFirst(game, p + 1, "]", true)) {
+        ++values;
+      }
+    }
+    CHECK_GT(values, 0);
+  }});
+
+  benchmarks.push_back({"parse_to_root", bytes, count, [&] {
+    for (const string& game : games) {
+      internal::GameTree root(nullptr);
+      CHECK(internal::ParseToRoot(game, &root, &errors)) << errors;
+    }
+  }});
+
+  std::vector<std::unique_ptr<internal::GameTree>> trees;
+  for (const string& game : games) {
+    trees.emplace_back(new internal::GameTree(nullptr));
+    CHECK(internal::ParseToRoot(game, trees.back().get(), &errors)) << errors;
+  }
+  GameRecord reused;
+  benchmarks.push_back({"handle_property", bytes, count, [&] {
+    for (const auto& tree : trees) {
+      reused.Reset();
+      ForEachProperty(*tree, [&](const internal::Property& prop) {
+        CHECK(internal::HandleProperty(prop, &reused, nullptr, &errors))
+            << errors;
+      });
+    }
+  }});
+
+  benchmarks.push_back({"simple_parse_sgf", bytes, count, [&] {
+    for (const string& game : games) {
+      GameRecord record;
+      CHECK(SimpleParseSgf(game, &record, nullptr, &errors)) << errors;
+    }
+  }});
+
+  benchmarks.push_back({"validate_sgf", bytes, count, [&] {
+    for (const string& game : games) {
+      CHECK(ValidateSgf(game, nullptr, &errors)) << errors;
+    }
+  }});
+
+  benchmarks.push_back({"scan_main_line", bytes, count, [&] {
+    MainLineSummary summary;
+    for (const string& game : games) {
+      CHECK(ScanMainLine(game, &summary)) << game;
+    }
+  }});
+
+  const char* tmp = getenv("TEST_TMPDIR");
+  const string dir = tmp != nullptr ? tmp : "/tmp";
+  std::vector<string> files;
+  int64_t file_bytes = 0;
+  for (int i = 0; i < std::min<int>(FLAGS_files, games.size()); ++i) {
+    files.push_back(absl::StrCat(dir, "/perf_gate_", i, ".sgf"));
+    std::ofstream(files.back()) << games[i];
+    file_bytes += games[i].size();
+  }
+  benchmarks.push_back({"read_file_to_string", file_bytes,
+                        static_cast<int64_t>(files.size()), [&] {
+    for (const string& file : files) {
+      CHECK(!ReadFileToString(file).empty()) << file;
+    }
+  }});
+
+  std::map<string, Result> results;
+  for (const Benchmark& benchmark : benchmarks) {
+    results[benchmark.name] = Measure(benchmark);
+  }
+  for (const string& file : files) remove(file.c_str());
+
+  if (!FLAGS_write_baseline.empty()) {
+    std::ofstream out(FLAGS_write_baseline);
+    out << "# Written by parser_perf_gate with --games=" << FLAGS_games
+        << " --seed=" << FLAGS_seed << ".\n"
+        << "# benchmark  median MB/s  allocations per game\n";
+    for (const Benchmark& benchmark : benchmarks) {
+      const Result& result = results[benchmark.name];
+      out << absl::StrFormat("%s %.1f %.2f\n", benchmark.name, result.median(),
+                             result.allocations_per_game);
+    }
+    out.close();
+    CHECK(out) << "Can't write " << FLAGS_write_baseline;
+    LOG(INFO) << "Wrote " << FLAGS_write_baseline;
+    return 0;
+  }
+
+  std::map<string, Baseline> baseline;
+  if (!ReadBaseline(FLAGS_baseline, &baseline)) {
+    LOG(ERROR) << "Can't read the baseline " << FLAGS_baseline;
+    return 1;
+  }
+  bool ok = true;
+  absl::PrintF("%-20s %10s %19s %10s %8s %12s %10s\n", "benchmark", "MB/s",
+               "95% interval", "baseline", "change", "allocs/game",
+               "baseline");
+  for (const Benchmark& benchmark : benchmarks) {
+    const Result& result = results[benchmark.name];
+    const auto found = baseline.find(benchmark.name);
+    if (found == baseline.end()) {
+      LOG(ERROR) << "No baseline for " << benchmark.name
+                 << "; write one with --write_baseline.";
+      ok = false;
+      continue;
+    }
+    const Baseline& base = found->second;
+    const int k = MedianConfidenceRank(result.mb_per_s.size());
+    const double low = result.mb_per_s[k];
+    const double high = result.mb_per_s[result.mb_per_s.size() - 1 - k];
+    absl::PrintF("%-20s %10.1f %8.1f - %8.1f %10.1f %+7.1f%% %12.2f %10.2f\n",
+                 benchmark.name, result.median(), low, high, base.mb_per_s,
+                 100 * (result.median() / base.mb_per_s - 1),
+                 result.allocations_per_game, base.allocations_per_game);
+    // Even the optimistic end of the interval is too slow.
+    if (high < base.mb_per_s * (1 - FLAGS_tolerance)) {
+      LOG(ERROR) << benchmark.name << " regressed: " << high
+                 << " MB/s at best, the baseline is " << base.mb_per_s;
+      ok = false;
+    } else if (low > base.mb_per_s * (1 + FLAGS_tolerance)) {
+      LOG(INFO) << benchmark.name
+                << " got faster; consider writing a new baseline.";
+    }
+    if (result.allocations_per_game >
+        base.allocations_per_game * (1 + FLAGS_alloc_tolerance) + 1e-9) {
+      LOG(ERROR) << benchmark.name << " allocates "
+                 << result.allocations_per_game << " times per game, the "
+                 << "baseline " << base.allocations_per_game;
+      ok = false;
+    }
+  }
+  return ok ? 0 : 1;
+}
+
+}  // namespace
+}  // namespace sgf_parser
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  return sgf_parser::Run();
+}
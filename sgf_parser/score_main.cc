@@ -0,0 +1,112 @@
+// Scores the final position of SGF files and checks it against their RE
+// results, one file per task on a thread pool. Writes a tab separated report
+// with a line per file: the file name, the ResultCheck, the recorded result
+// and the scored one, which can fill in a missing RE. Lines of different files
+// may come out in any order.
+//
+// Usage:
+//   sgf_score --output=report.tsv [--rule=area|territory] [--tolerance=1]
+//       [--remove_dead_stones] [--threads=N] [--file_list=files.txt]
+//       [file ...]
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/file_tasks.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/scoring.h"
+#include "sgf_parser/thread_pool.h"
+
+DEFINE_string(output, "", "Output file for the report.");
+DEFINE_string(rule, "area", "Rule of the scored result: area or territory.");
+DEFINE_double(tolerance, 1.0,
+              "How far, in points, a recorded result may be from a scored one "
+              "to match.");
+DEFINE_bool(remove_dead_stones, true,
+            "Remove stones which look dead before scoring.");
+DEFINE_int32(threads, 0, "Worker threads, 0 for one per core.");
+DEFINE_string(file_list, "", "A file with one SGF file name per line.");
+
+namespace sgf_parser {
+namespace {
+
+constexpr int kNumChecks = static_cast<int>(ResultCheck::RESIGNED) + 1;
+
+class ResultChecker {
+ public:
+  explicit ResultChecker(ScoringRule rule) : rule_(rule) {}
+
+  bool CheckFile(const std::string& filename, FileWorker* worker) {
+    if (!worker->Parse(filename, ReadFileToString(filename))) return false;
+    const GameRecord& record = worker->record;
+    Score score;
+    if (ScoreRecord(record, FLAGS_remove_dead_stones, &score) > 0) {
+      VLOG(1) << filename << ": some moves could not be played.";
+    }
+    const ResultCheck check = CheckResult(record, score, FLAGS_tolerance);
+    ++counts_[static_cast<int>(check)];
+    absl::StrAppend(
+        &worker->buffer, filename, "\t", ResultCheckName(check), "\t",
+        check == ResultCheck::MISSING
+            ? "" : ResultString(record.result, record.resigned),
+        "\t", ResultString(ScoredResult(score, record.komi, rule_), false),
+        "\n");
+    return true;
+  }
+
+  int64_t count(ResultCheck check) const {
+    return counts_[static_cast<int>(check)];
+  }
+
+ private:
+  const ScoringRule rule_;
+  std::atomic<int64_t> counts_[kNumChecks] = {};
+};
+
+}  // namespace
+}  // namespace sgf_parser
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK(!FLAGS_output.empty()) << "--output is required.";
+  CHECK(FLAGS_rule == "area" || FLAGS_rule == "territory")
+      << "Unknown --rule: " << FLAGS_rule;
+  const sgf_parser::ScoringRule rule = FLAGS_rule == "area"
+                                           ? sgf_parser::ScoringRule::AREA
+                                           : sgf_parser::ScoringRule::TERRITORY;
+
+  const std::vector<std::string> files =
+      sgf_parser::ReadInputFiles(argc, argv, FLAGS_file_list);
+
+  std::ofstream out(FLAGS_output, std::ios::binary);
+  CHECK(out) << "Failed to open " << FLAGS_output;
+  out << "file\tcheck\trecorded\tscored\n";
+
+  sgf_parser::ResultChecker checker(rule);
+  int64_t failed;
+  {
+    sgf_parser::ThreadPool pool(FLAGS_threads);
+    sgf_parser::FileTaskRunner runner(&pool, &out);
+    failed = runner.Run(files, [&checker](const std::string& file,
+                                          sgf_parser::FileWorker* worker) {
+      return checker.CheckFile(file, worker);
+    });
+  }
+  out.close();
+  CHECK(out) << "Failed to write " << FLAGS_output;
+  using sgf_parser::ResultCheck;
+  LOG(INFO) << "Checked " << files.size() - failed << " of "
+            << files.size() << " files: "
+            << checker.count(ResultCheck::MATCHES) << " match, "
+            << checker.count(ResultCheck::SAME_WINNER) << " same winner, "
+            << checker.count(ResultCheck::WRONG_WINNER) << " wrong winner, "
+            << checker.count(ResultCheck::MISSING) << " missing, "
+            << checker.count(ResultCheck::RESIGNED) << " resigned.";
+  return 0;
+}
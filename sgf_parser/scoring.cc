@@ -0,0 +1,264 @@
+#include "sgf_parser/scoring.h"
+
+#include <math.h>
+
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using std::string;
+
+namespace {
+
+int ColorBit(GoBoard::Stone stone) { return 1 << stone; }
+
+GoBoard::Stone Opponent(GoBoard::Stone color) {
+  return color == GoBoard::BLACK ? GoBoard::WHITE : GoBoard::BLACK;
+}
+
+// The points of a board in a flat array, with flood fills which label
+// connected areas of it.
+class Scorer {
+ public:
+  explicit Scorer(const GoBoard& board)
+      : width_(board.width()), height_(board.height()),
+        points_(width_ * height_), label_(width_ * height_) {
+    for (int y = 0; y < height_; ++y) {
+      for (int x = 0; x < width_; ++x) {
+        points_[y * width_ + x] = board.At({x, y});
+      }
+    }
+  }
+
+  void RemoveDeadStones(Score* score);
+  void Count(Score* score);
+
+ private:
+  template <typename F>
+  void ForNeighbors(int i, F f) const {
+    const int x = i % width_;
+    if (x > 0) f(i - 1);
+    if (x + 1 < width_) f(i + 1);
+    if (i >= width_) f(i - width_);
+    if (i + width_ < static_cast<int>(points_.size())) f(i + width_);
+  }
+
+  // Labels the area of points connected to `start` for which `in` holds with
+  // `id` in `labels`, and appends them to `area` if it is not null. Returns the
+  // ColorBit()s of the points bordering the area.
+  template <typename In>
+  int Flood(int start, In in, int id, std::vector<int>* labels,
+            std::vector<int>* area) {
+    int border = 0;
+    stack_.assign(1, start);
+    (*labels)[start] = id;
+    while (!stack_.empty()) {
+      const int i = stack_.back();
+      stack_.pop_back();
+      if (area != nullptr) area->push_back(i);
+      ForNeighbors(i, [&](int n) {
+        if (!in(points_[n])) {
+          border |= ColorBit(points_[n]);
+        } else if ((*labels)[n] != id) {
+          (*labels)[n] = id;
+          stack_.push_back(n);
+        }
+      });
+    }
+    return border;
+  }
+
+  const int width_;
+  const int height_;
+  std::vector<GoBoard::Stone> points_;
+  std::vector<int> label_;
+  std::vector<int> stack_;
+};
+
+void Scorer::RemoveDeadStones(Score* score) {
+  const int n = points_.size();
+
+  // Empty regions which are an eye of one color.
+  std::vector<int>& region = label_;
+  region.assign(n, -1);
+  std::vector<GoBoard::Stone> eye_of;
+  for (int i = 0; i < n; ++i) {
+    if (points_[i] != GoBoard::EMPTY || region[i] >= 0) continue;
+    const int border = Flood(
+        i, [](GoBoard::Stone s) { return s == GoBoard::EMPTY; },
+        eye_of.size(), &region, nullptr);
+    eye_of.push_back(border == ColorBit(GoBoard::BLACK) ? GoBoard::BLACK
+                     : border == ColorBit(GoBoard::WHITE) ? GoBoard::WHITE
+                                                          : GoBoard::EMPTY);
+  }
+  std::vector<bool> has_eye(n, false);
+  for (int i = 0; i < n; ++i) {
+    if (points_[i] == GoBoard::EMPTY) continue;
+    ForNeighbors(i, [&](int j) {
+      if (points_[j] == GoBoard::EMPTY && eye_of[region[j]] == points_[i]) {
+        has_eye[i] = true;
+      }
+    });
+  }
+
+  // Chains of each color, through empty points. chain[color][i] is the chain
+  // of `color` which point i belongs to, or -1.
+  struct Chain {
+    bool alive = false;
+    int neighbor = -1;             // A bordering chain of the opponent.
+    bool many_neighbors = false;   // More than one such chain.
+    bool neighbors_alive = true;   // Whether they are all alive.
+  };
+  std::vector<int> chain[3];
+  std::vector<Chain> chains[3];
+  for (const GoBoard::Stone color : {GoBoard::BLACK, GoBoard::WHITE}) {
+    chain[color].assign(n, -1);
+    const GoBoard::Stone opponent = Opponent(color);
+    for (int i = 0; i < n; ++i) {
+      if (points_[i] != color || chain[color][i] >= 0) continue;
+      const int border = Flood(
+          i, [opponent](GoBoard::Stone s) { return s != opponent; },
+          chains[color].size(), &chain[color], nullptr);
+      chains[color].emplace_back();
+      chains[color].back().alive = (border & ColorBit(opponent)) == 0;
+    }
+    for (int i = 0; i < n; ++i) {
+      if (points_[i] == color && has_eye[i]) chains[color][chain[color][i]].alive = true;
+    }
+  }
+  for (const GoBoard::Stone color : {GoBoard::BLACK, GoBoard::WHITE}) {
+    const GoBoard::Stone opponent = Opponent(color);
+    for (int i = 0; i < n; ++i) {
+      if (chain[color][i] < 0) continue;
+      Chain& c = chains[color][chain[color][i]];
+      ForNeighbors(i, [&](int j) {
+        if (points_[j] != opponent) return;
+        const int k = chain[opponent][j];
+        if (c.neighbor < 0) c.neighbor = k;
+        c.many_neighbors = c.many_neighbors || c.neighbor != k;
+        c.neighbors_alive = c.neighbors_alive && chains[opponent][k].alive;
+      });
+    }
+  }
+
+  // A chain without an eye dies if one chain of the opponent encloses it, or if
+  // all the chains around it live.
+  std::vector<bool> dead[3];
+  for (const GoBoard::Stone color : {GoBoard::BLACK, GoBoard::WHITE}) {
+    for (const Chain& c : chains[color]) {
+      dead[color].push_back(!c.alive &&
+                            (!c.many_neighbors || c.neighbors_alive));
+    }
+  }
+
+  // Seki: dying chains of both colors sharing empty points both live.
+  for (int i = 0; i < n; ++i) {
+    const int b = chain[GoBoard::BLACK][i];
+    const int w = chain[GoBoard::WHITE][i];
+    if (b >= 0 && w >= 0 && dead[GoBoard::BLACK][b] &&
+        dead[GoBoard::WHITE][w]) {
+      dead[GoBoard::BLACK][b] = dead[GoBoard::WHITE][w] = false;
+    }
+  }
+
+  for (int i = 0; i < n; ++i) {
+    const GoBoard::Stone color = points_[i];
+    if (color == GoBoard::EMPTY || !dead[color][chain[color][i]]) continue;
+    ++(color == GoBoard::BLACK ? score->dead_black : score->dead_white);
+    points_[i] = GoBoard::EMPTY;
+  }
+}
+
+void Scorer::Count(Score* score) {
+  const int n = points_.size();
+  label_.assign(n, -1);
+  std::vector<int> area;
+  int regions = 0;
+  for (int i = 0; i < n; ++i) {
+    if (points_[i] == GoBoard::BLACK) {
+      ++score->black_stones;
+    } else if (points_[i] == GoBoard::WHITE) {
+      ++score->white_stones;
+    } else if (label_[i] < 0) {
+      area.clear();
+      const int border = Flood(
+          i, [](GoBoard::Stone s) { return s == GoBoard::EMPTY; }, regions++,
+          &label_, &area);
+      if (border == ColorBit(GoBoard::BLACK)) {
+        score->black_territory += area.size();
+      } else if (border == ColorBit(GoBoard::WHITE)) {
+        score->white_territory += area.size();
+      } else {
+        score->dame += area.size();
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void ScorePosition(const GoBoard& board, bool remove_dead_stones,
+                   Score* score) {
+  *score = Score();
+  score->captured_black = board.prisoners(GoMove::BLACK);
+  score->captured_white = board.prisoners(GoMove::WHITE);
+  Scorer scorer(board);
+  if (remove_dead_stones) scorer.RemoveDeadStones(score);
+  scorer.Count(score);
+}
+
+int ScoreRecord(const GameRecord& record, bool remove_dead_stones,
+                Score* score) {
+  const GoCoord size = GetBoardSize(record);
+  GoBoard board(size, size);
+  const int failures = ReplayRecord(record, &board);
+  ScorePosition(board, remove_dead_stones, score);
+  return failures;
+}
+
+float ScoredResult(const Score& score, float komi, ScoringRule rule) {
+  const int lead =
+      rule == ScoringRule::AREA ? score.AreaLead() : score.TerritoryLead();
+  return lead - komi;
+}
+
+const char* ResultCheckName(ResultCheck check) {
+  switch (check) {
+    case ResultCheck::MATCHES:
+      return "matches";
+    case ResultCheck::SAME_WINNER:
+      return "same_winner";
+    case ResultCheck::WRONG_WINNER:
+      return "wrong_winner";
+    case ResultCheck::MISSING:
+      return "missing";
+    case ResultCheck::RESIGNED:
+      return "resigned";
+  }
+  return "unknown";
+}
+
+ResultCheck CheckResult(const GameRecord& record, const Score& score,
+                        float tolerance) {
+  if (record.resigned) return ResultCheck::RESIGNED;
+  if (record.result == 0.0f) return ResultCheck::MISSING;
+  bool same_winner = false;
+  for (const ScoringRule rule : {ScoringRule::AREA, ScoringRule::TERRITORY}) {
+    const float scored = ScoredResult(score, record.komi, rule);
+    if (fabs(scored - record.result) <= tolerance) return ResultCheck::MATCHES;
+    same_winner = same_winner || scored * record.result > 0;
+  }
+  return same_winner ? ResultCheck::SAME_WINNER : ResultCheck::WRONG_WINNER;
+}
+
+string ResultString(float result, bool resigned) {
+  const char* winner = result > 0 ? "B+" : "W+";
+  if (resigned) return absl::StrCat(winner, "R");
+  if (result == 0.0f) return "0";
+  return absl::StrCat(winner, fabs(result));
+}
+
+}  // namespace sgf_parser
@@ -0,0 +1,83 @@
+#ifndef SGF_PARSER_SCORING_H_
+#define SGF_PARSER_SCORING_H_
+
+#include <string>
+
+#include "sgf_parser/board.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// Counts of a scored position.
+struct Score {
+  // Stones left on the board, after dead stones are removed.
+  int black_stones = 0;
+  int white_stones = 0;
+
+  // Empty points from which only stones of one color can be reached.
+  int black_territory = 0;
+  int white_territory = 0;
+  int dame = 0;
+
+  // Stones removed as dead before counting.
+  int dead_black = 0;
+  int dead_white = 0;
+
+  // Stones captured during the game.
+  int captured_black = 0;
+  int captured_white = 0;
+
+  // Black's lead before komi under area (Tromp-Taylor) and territory rules.
+  int AreaLead() const {
+    return black_stones + black_territory - white_stones - white_territory;
+  }
+  int TerritoryLead() const {
+    return black_territory + dead_white + captured_white -
+           white_territory - dead_black - captured_black;
+  }
+};
+
+// Scores the position on `board` by Tromp-Taylor rules. Captures are read from
+// GoBoard::prisoners().
+//
+// If `remove_dead_stones` is true, stones which look dead are removed first,
+// with a simple heuristic meant for finished games. Stones are joined into
+// chains of one color through empty points. A chain touching an empty region
+// bordered only by its own color, an eye, lives. A chain without one dies if a
+// single chain of the opponent encloses it, or if every chain around it lives;
+// but dying chains of both colors which share empty points, as in seki, both
+// live. It knows nothing of life and death beyond that, so games which were
+// not played out are often scored wrong.
+void ScorePosition(const GoBoard& board, bool remove_dead_stones, Score* score);
+
+// Replays `record` like ReplayRecord and scores the final position. Returns the
+// number of stones and moves which could not be placed.
+int ScoreRecord(const GameRecord& record, bool remove_dead_stones,
+                Score* score);
+
+enum class ScoringRule { AREA, TERRITORY };
+
+// The result of a scored game after komi, in GameRecord::result's convention.
+float ScoredResult(const Score& score, float komi, ScoringRule rule);
+
+// How GameRecord::result compares with the score of the final position.
+enum class ResultCheck {
+  MATCHES,        // Within the tolerance of the area or the territory result.
+  SAME_WINNER,    // The winner agrees with one of the rules, the margin not.
+  WRONG_WINNER,   // Neither rule has the recorded winner win.
+  MISSING,        // There is no result, i.e. it is 0.
+  RESIGNED,       // Won by resignation, time or forfeit; not checked.
+};
+
+const char* ResultCheckName(ResultCheck check);
+
+ResultCheck CheckResult(const GameRecord& record, const Score& score,
+                        float tolerance);
+
+// Formats a result as the RE property does, e.g. "B+3.5" or "W+R". A
+// non-resigned result of 0 is "0", a draw.
+std::string ResultString(float result, bool resigned);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_SCORING_H_
@@ -0,0 +1,158 @@
+#include "sgf_parser/scoring.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+// A board with the stones of rows of ".XO".
+GoBoard MakeBoard(const std::vector<std::string>& rows) {
+  GoBoard board(rows[0].size(), rows.size());
+  for (size_t y = 0; y < rows.size(); ++y) {
+    for (size_t x = 0; x < rows[y].size(); ++x) {
+      if (rows[y][x] == 'X') board.Setup(GoPos(x, y), GoBoard::BLACK);
+      if (rows[y][x] == 'O') board.Setup(GoPos(x, y), GoBoard::WHITE);
+    }
+  }
+  return board;
+}
+
+class ScoringTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(ScoringTest, EmptyBoard) {
+  Score score;
+  ScorePosition(GoBoard(5, 5), true, &score);
+  EXPECT_EQ(score.dame, 25);
+  EXPECT_EQ(score.AreaLead(), 0);
+  EXPECT_EQ(score.TerritoryLead(), 0);
+}
+
+TEST_F(ScoringTest, DeadStones) {
+  const GoBoard board = MakeBoard({
+      "..XO.",
+      "..XO.",
+      "O.XO.",
+      "..XO.",
+      "..XO.",
+  });
+  Score score;
+  ScorePosition(board, false, &score);
+  EXPECT_EQ(score.black_stones, 5);
+  EXPECT_EQ(score.white_stones, 6);
+  EXPECT_EQ(score.black_territory, 0);
+  EXPECT_EQ(score.white_territory, 5);
+  EXPECT_EQ(score.dame, 9);
+  EXPECT_EQ(score.AreaLead(), -6);
+
+  // The white stone on the left is enclosed by black.
+  ScorePosition(board, true, &score);
+  EXPECT_EQ(score.dead_white, 1);
+  EXPECT_EQ(score.dead_black, 0);
+  EXPECT_EQ(score.black_stones, 5);
+  EXPECT_EQ(score.white_stones, 5);
+  EXPECT_EQ(score.black_territory, 10);
+  EXPECT_EQ(score.white_territory, 5);
+  EXPECT_EQ(score.dame, 0);
+  EXPECT_EQ(score.AreaLead(), 5);
+  EXPECT_EQ(score.TerritoryLead(), 6);
+}
+
+TEST_F(ScoringTest, Seki) {
+  // Neither stone has an eye, and they share their only liberty.
+  Score score;
+  ScorePosition(MakeBoard({"X.O"}), true, &score);
+  EXPECT_EQ(score.dead_black + score.dead_white, 0);
+  EXPECT_EQ(score.dame, 1);
+  EXPECT_EQ(score.AreaLead(), 0);
+
+  // With an eye, white kills black.
+  ScorePosition(MakeBoard({"X.O.."}), true, &score);
+  EXPECT_EQ(score.dead_black, 1);
+  EXPECT_EQ(score.white_territory, 4);
+  EXPECT_EQ(score.AreaLead(), -5);
+}
+
+TEST_F(ScoringTest, Captures) {
+  // White's corner stone is captured.
+  GameRecord record;
+  record.board_width = record.board_height = 3;
+  record.moves.emplace_back(GoMove::WHITE, false, GoPos(0, 0));
+  record.moves.emplace_back(GoMove::BLACK, false, GoPos(1, 0));
+  record.moves.emplace_back(GoMove::BLACK, false, GoPos(0, 1));
+  record.moves.emplace_back(GoMove::WHITE, false, GoPos(0, 1));   // Occupied.
+  Score score;
+  EXPECT_EQ(ScoreRecord(record, true, &score), 1);
+  EXPECT_EQ(score.captured_white, 1);
+  EXPECT_EQ(score.captured_black, 0);
+  EXPECT_EQ(score.black_stones, 2);
+  EXPECT_EQ(score.black_territory, 7);
+  EXPECT_EQ(score.AreaLead(), 9);
+  EXPECT_EQ(score.TerritoryLead(), 8);
+  EXPECT_FLOAT_EQ(ScoredResult(score, 6.5, ScoringRule::AREA), 2.5);
+  EXPECT_FLOAT_EQ(ScoredResult(score, 6.5, ScoringRule::TERRITORY), 1.5);
+}
+
+TEST_F(ScoringTest, CheckResult) {
+  Score score;
+  ScorePosition(MakeBoard({
+      "..XO.",
+      "..XO.",
+      "O.XO.",
+      "..XO.",
+      "..XO.",
+  }), true, &score);
+  GameRecord record;
+  record.komi = 0.5;   // B+4.5 by area, B+5.5 by territory.
+  record.result = 4.5;
+  EXPECT_EQ(CheckResult(record, score, 0.0), ResultCheck::MATCHES);
+  record.result = 6;
+  EXPECT_EQ(CheckResult(record, score, 0.0), ResultCheck::SAME_WINNER);
+  EXPECT_EQ(CheckResult(record, score, 1.0), ResultCheck::MATCHES);
+  record.result = -0.5;
+  EXPECT_EQ(CheckResult(record, score, 1.0), ResultCheck::WRONG_WINNER);
+  record.result = 0;
+  EXPECT_EQ(CheckResult(record, score, 1.0), ResultCheck::MISSING);
+  record.result = -1.2;
+  record.resigned = true;
+  EXPECT_EQ(CheckResult(record, score, 1.0), ResultCheck::RESIGNED);
+  EXPECT_STREQ(ResultCheckName(ResultCheck::WRONG_WINNER), "wrong_winner");
+}
+
+TEST_F(ScoringTest, ResultString) {
+  EXPECT_EQ(ResultString(3.5, false), "B+3.5");
+  EXPECT_EQ(ResultString(-12, false), "W+12");
+  EXPECT_EQ(ResultString(0, false), "0");
+  EXPECT_EQ(ResultString(1.2, true), "B+R");
+  EXPECT_EQ(ResultString(-1.2, true), "W+R");
+}
+
+TEST_F(ScoringTest, TestData) {
+  // The handicapped game stops after 15 moves, far from its recorded B+8.5.
+  for (const auto& test : {
+           std::make_pair("testdata/handicapped.sgf", ResultCheck::WRONG_WINNER),
+           std::make_pair("testdata/resigned.sgf", ResultCheck::RESIGNED)}) {
+    const char* file = test.first;
+    GameRecord record;
+    ASSERT_TRUE(SimpleParseSgf(ReadFileToString(file), &record, nullptr,
+                               nullptr)) << file;
+    Score score;
+    EXPECT_EQ(ScoreRecord(record, true, &score), 0) << file;
+    const int size = GetBoardSize(record);
+    EXPECT_EQ(score.black_stones + score.white_stones + score.black_territory +
+              score.white_territory + score.dame, size * size) << file;
+    EXPECT_EQ(CheckResult(record, score, 1.0), test.second) << file;
+  }
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,67 @@
+// Parses a corpus of SGF files in crash isolated worker processes and writes
+// one line per file:
+//   <file> OK <board size> <moves> <result>
+//   <file> ERROR <first error>
+//
+// Usage:
+//   sharded_check --output=results.tsv [--workers=N] [--timeout=30]
+//       [--file_list=files.txt] [file ...]
+
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/file_tasks.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/sharded_runner.h"
+
+DEFINE_int32(workers, 0, "Worker processes, 0 for one per core.");
+DEFINE_double(timeout, 30, "Seconds a worker may spend on one file.");
+DEFINE_string(output, "", "Output file.");
+DEFINE_string(file_list, "", "A file with one SGF file name per line.");
+
+namespace sgf_parser {
+namespace {
+
+bool CheckFile(const std::string& filename, std::string* output) {
+  const std::string sgf = ReadFileToString(filename);
+  GameRecord record;
+  std::string errors;
+  if (!SimpleParseSgf(sgf, &record, nullptr, &errors)) {
+    absl::StrAppend(output, filename, "\tERROR\t",
+                    errors.substr(0, errors.find('\n')), "\n");
+    return false;
+  }
+  absl::StrAppend(output, filename, "\tOK\t", record.board_width, "\t",
+                  record.moves.size(), "\t", record.result, "\n");
+  return true;
+}
+
+}  // namespace
+}  // namespace sgf_parser
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  CHECK(!FLAGS_output.empty()) << "--output is required.";
+
+  const std::vector<std::string> files =
+      sgf_parser::ReadInputFiles(argc, argv, FLAGS_file_list);
+
+  sgf_parser::ShardedRunOptions options;
+  options.workers = FLAGS_workers;
+  options.file_timeout_seconds = FLAGS_timeout;
+  options.output = FLAGS_output;
+  const sgf_parser::ShardedRunStats stats =
+      sgf_parser::RunSharded(files, sgf_parser::CheckFile, options);
+  LOG(INFO) << "Processed " << stats.processed << " files, " << stats.failed
+            << " failed to parse, " << stats.quarantined.size()
+            << " quarantined, " << stats.restarts << " worker restarts.";
+  if (!stats.error.empty()) {
+    LOG(ERROR) << stats.error;
+    return 1;
+  }
+  return 0;
+}
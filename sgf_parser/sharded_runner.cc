@@ -0,0 +1,272 @@
+#include "sgf_parser/sharded_runner.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <new>
+#include <thread>
+
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+namespace {
+
+static_assert(std::atomic<int64_t>::is_always_lock_free,
+              "Shared memory atomics must be lock free.");
+
+// Exit status of a worker which can't write its shard. Not a crash: the parent
+// fails the run instead of restarting it.
+constexpr int kWorkerIoError = 2;
+
+// Published by a worker, read by the parent. Lives in shared memory.
+struct alignas(64) WorkerSlot {
+  std::atomic<int64_t> current{-1};     // Index of the file being processed.
+  std::atomic<int64_t> started_ns{0};   // When it started, CLOCK_MONOTONIC.
+  std::atomic<int64_t> processed{0};
+  std::atomic<int64_t> failed{0};
+};
+
+struct alignas(64) SharedQueue {
+  std::atomic<int64_t> next{0};   // Next file to hand out.
+};
+
+int64_t NowNanos() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+bool WriteAll(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    const ssize_t n = write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+std::string ShardName(const std::string& output, int worker) {
+  return absl::StrCat(output, ".shard-", worker);
+}
+
+// The body of a worker process. Never returns.
+void WorkerMain(const std::vector<std::string>& filenames,
+                const FileProcessor& process, const std::string& shard,
+                SharedQueue* queue, WorkerSlot* slot) {
+  const int fd = open(shard.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                      0644);
+  if (fd < 0) {
+    PLOG(ERROR) << "Cannot open " << shard;
+    _exit(kWorkerIoError);
+  }
+  const int64_t n = filenames.size();
+  std::string output;
+  while (true) {
+    const int64_t i = queue->next.fetch_add(1);
+    if (i >= n) break;
+    slot->started_ns = NowNanos();
+    slot->current = i;
+    output.clear();
+    const bool ok = process(filenames[i], &output);
+    // One write per file, so a later crash doesn't lose finished results.
+    if (!WriteAll(fd, output.data(), output.size())) {
+      PLOG(ERROR) << "Cannot write " << shard;
+      // The file isn't to blame; don't get it quarantined.
+      slot->current = -1;
+      _exit(kWorkerIoError);
+    }
+    slot->current = -1;
+    ++slot->processed;
+    if (!ok) ++slot->failed;
+  }
+  close(fd);
+  _exit(0);
+}
+
+bool AppendFile(const std::string& from, int to_fd) {
+  const int fd = open(from.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return errno == ENOENT;   // The worker never started.
+  char buffer[64 << 10];
+  bool ok = true;
+  while (true) {
+    const ssize_t n = read(fd, buffer, sizeof(buffer));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) {
+      ok = n == 0;
+      break;
+    }
+    if (!WriteAll(to_fd, buffer, n)) {
+      ok = false;
+      break;
+    }
+  }
+  close(fd);
+  return ok;
+}
+
+}  // namespace
+
+ShardedRunStats RunSharded(const std::vector<std::string>& filenames,
+                           const FileProcessor& process,
+                           const ShardedRunOptions& options) {
+  CHECK(!options.output.empty()) << "An output file name is required.";
+  int workers = options.workers;
+  if (workers <= 0) {
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  const int64_t timeout_ns = options.file_timeout_seconds * 1e9;
+  const int64_t n = filenames.size();
+
+  // The queue and the worker slots, shared with the children.
+  const size_t shared_size = sizeof(SharedQueue) + workers * sizeof(WorkerSlot);
+  void* shared = mmap(nullptr, shared_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  PCHECK(shared != MAP_FAILED) << "Cannot map shared memory";
+  SharedQueue* queue = new (shared) SharedQueue;
+  WorkerSlot* slots = new (static_cast<char*>(shared) + sizeof(SharedQueue))
+      WorkerSlot[workers];
+
+  for (int i = 0; i < workers; ++i) {
+    unlink(ShardName(options.output, i).c_str());
+  }
+
+  ShardedRunStats stats;
+  // Keeps the first error, which likely caused the others.
+  auto fail = [&stats](const std::string& error) {
+    LOG(ERROR) << error;
+    if (stats.error.empty()) stats.error = error;
+  };
+  std::vector<std::string> quarantine_lines;
+  std::vector<pid_t> pids(workers, -1);
+  std::vector<bool> timed_out(workers, false);
+  int alive = 0;
+
+  auto start_worker = [&](int i) {
+    // Don't let children flush a copy of our buffered output.
+    fflush(nullptr);
+    const pid_t pid = fork();
+    PCHECK(pid >= 0) << "fork() failed";
+    if (pid == 0) {
+      WorkerMain(filenames, process, ShardName(options.output, i), queue,
+                 &slots[i]);
+    }
+    pids[i] = pid;
+    timed_out[i] = false;
+    ++alive;
+  };
+  for (int i = 0; i < workers; ++i) {
+    start_worker(i);
+  }
+
+  while (alive > 0) {
+    int status;
+    pid_t pid;
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+      const int i = std::find(pids.begin(), pids.end(), pid) - pids.begin();
+      if (i == workers) continue;   // Not ours.
+      pids[i] = -1;
+      --alive;
+      const bool clean = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+      const int64_t current = slots[i].current.exchange(-1);
+      if (current >= 0) {
+        const std::string reason =
+            timed_out[i] ? "timeout"
+            : WIFSIGNALED(status) ? strsignal(WTERMSIG(status))
+            : absl::StrCat("exit status ", WEXITSTATUS(status));
+        LOG(WARNING) << "Quarantined " << filenames[current] << ": " << reason;
+        stats.quarantined.push_back(filenames[current]);
+        quarantine_lines.push_back(
+            absl::StrCat(filenames[current], "\t", reason, "\n"));
+      } else if (!clean) {
+        // Not caused by a file, so a new worker would likely die the same way.
+        fail(WIFEXITED(status) && WEXITSTATUS(status) == kWorkerIoError
+                 ? absl::StrCat("Worker ", i, " cannot write its shard.")
+                 : absl::StrCat("Worker ", i, " died between files."));
+      }
+      if (current >= 0 && queue->next.load() < n) {
+        ++stats.restarts;
+        start_worker(i);
+      }
+    }
+
+    const int64_t now = NowNanos();
+    for (int i = 0; i < workers; ++i) {
+      if (pids[i] < 0 || timed_out[i]) continue;
+      const int64_t current = slots[i].current.load();
+      if (current < 0) continue;
+      const int64_t started = slots[i].started_ns.load();
+      // Skip if the worker moved on while we were looking.
+      if (slots[i].current.load() != current) continue;
+      if (now - started > timeout_ns) {
+        kill(pids[i], SIGKILL);
+        timed_out[i] = true;
+      }
+    }
+
+    struct timespec pause = {0, 5 * 1000 * 1000};
+    nanosleep(&pause, nullptr);
+  }
+
+  for (int i = 0; i < workers; ++i) {
+    stats.processed += slots[i].processed.load();
+    stats.failed += slots[i].failed.load();
+  }
+
+  // Merge the shards.
+  const int out = open(options.output.c_str(),
+                       O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (out < 0) {
+    fail(absl::StrCat("Cannot open ", options.output, ": ", strerror(errno)));
+  }
+  for (int i = 0; i < workers && out >= 0; ++i) {
+    const std::string shard = ShardName(options.output, i);
+    if (!AppendFile(shard, out)) {
+      fail(absl::StrCat("Cannot merge ", shard, ": ", strerror(errno)));
+      break;
+    }
+  }
+  if (out >= 0 && close(out) != 0) {
+    fail(absl::StrCat("Cannot write ", options.output, ": ", strerror(errno)));
+  }
+  // After a failure the shards may hold results the output doesn't.
+  if (stats.error.empty()) {
+    for (int i = 0; i < workers; ++i) {
+      unlink(ShardName(options.output, i).c_str());
+    }
+  }
+
+  const std::string quarantine = options.output + ".quarantine";
+  unlink(quarantine.c_str());
+  if (!quarantine_lines.empty()) {
+    const int fd = open(quarantine.c_str(),
+                        O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0;
+    for (size_t i = 0; ok && i < quarantine_lines.size(); ++i) {
+      ok = WriteAll(fd, quarantine_lines[i].data(), quarantine_lines[i].size());
+    }
+    if (fd >= 0 && close(fd) != 0) ok = false;
+    if (!ok) {
+      fail(absl::StrCat("Cannot write ", quarantine, ": ", strerror(errno)));
+    }
+  }
+
+  munmap(shared, shared_size);
+  return stats;
+}
+
+}  // namespace sgf_parser
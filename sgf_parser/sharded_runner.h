@@ -0,0 +1,56 @@
+#ifndef SGF_PARSER_SHARDED_RUNNER_H_
+#define SGF_PARSER_SHARDED_RUNNER_H_
+
+#include <stdint.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace sgf_parser {
+
+// Processes one file in a worker process and appends its result to `output`.
+// Returning false counts the file as failed; its output is still written.
+typedef std::function<bool(const std::string& filename, std::string* output)>
+    FileProcessor;
+
+struct ShardedRunOptions {
+  // Worker processes. 0 means one per hardware thread.
+  int workers = 0;
+
+  // A worker which spends longer than this on one file is killed.
+  double file_timeout_seconds = 30;
+
+  // Worker i appends to "<output>.shard-<i>". At the end the shards are
+  // concatenated into `output` and removed, unless the run failed. Quarantined
+  // files are listed in "<output>.quarantine", one per line with the reason.
+  std::string output;
+};
+
+struct ShardedRunStats {
+  int64_t processed = 0;     // Files the processor returned for.
+  int64_t failed = 0;        // Of which the processor returned false.
+  int64_t restarts = 0;      // Workers restarted after a crash or timeout.
+  std::vector<std::string> quarantined;   // Files which crashed or hung.
+
+  // Why the run failed, e.g. a worker couldn't write its shard; empty if it
+  // didn't. A failed run may have left files unprocessed.
+  std::string error;
+};
+
+// Runs `process` over all files in `workers` forked processes, so a file which
+// crashes or hangs the parser only takes down one worker. Workers take files
+// from a work queue in shared memory and publish which file they are on and
+// since when. The parent watches them: a worker which dies, or exceeds the
+// timeout and gets killed, is restarted, and the file it was on is
+// quarantined instead of being retried. A worker which dies between files, e.g.
+// because its shard can't be written, isn't restarted, and fails the run.
+//
+// Must be called from a single threaded process, since it forks.
+ShardedRunStats RunSharded(const std::vector<std::string>& filenames,
+                           const FileProcessor& process,
+                           const ShardedRunOptions& options);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_SHARDED_RUNNER_H_
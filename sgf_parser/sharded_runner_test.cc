@@ -0,0 +1,134 @@
+#include "sgf_parser/sharded_runner.h"
+
+#include <signal.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+string ReadAll(const string& filename) {
+  std::ifstream in(filename);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+std::vector<string> SortedLines(const string& text) {
+  std::vector<string> lines;
+  std::stringstream ss(text);
+  string line;
+  while (std::getline(ss, line)) lines.push_back(line);
+  std::sort(lines.begin(), lines.end());
+  return lines;
+}
+
+TEST(ShardedRunnerTest, QuarantinesCrashesAndHangs) {
+  const char* tmp = getenv("TEST_TMPDIR");
+  ShardedRunOptions options;
+  options.workers = 2;
+  options.file_timeout_seconds = 0.5;
+  options.output = string(tmp != nullptr ? tmp : "/tmp") + "/sharded_out";
+
+  std::vector<string> files;
+  for (int i = 0; i < 20; ++i) files.push_back("f" + std::to_string(i));
+  files[3] = "crash";
+  files[7] = "hang";
+  files[11] = "fail";
+
+  const ShardedRunStats stats = RunSharded(
+      files,
+      [](const string& filename, string* output) {
+        if (filename == "crash") raise(SIGSEGV);
+        if (filename == "hang") sleep(100);
+        *output = filename + "\n";
+        return filename != "fail";
+      },
+      options);
+
+  EXPECT_EQ(stats.processed, 18);
+  EXPECT_EQ(stats.failed, 1);
+  // The worker which hung is only restarted if files are left by then.
+  EXPECT_GE(stats.restarts, 1);
+  EXPECT_LE(stats.restarts, 2);
+  std::vector<string> quarantined = stats.quarantined;
+  std::sort(quarantined.begin(), quarantined.end());
+  EXPECT_EQ(quarantined, std::vector<string>({"crash", "hang"}));
+
+  std::vector<string> expected;
+  for (const auto& f : files) {
+    if (f != "crash" && f != "hang") expected.push_back(f);
+  }
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(SortedLines(ReadAll(options.output)), expected);
+
+  const std::vector<string> reasons =
+      SortedLines(ReadAll(options.output + ".quarantine"));
+  ASSERT_EQ(reasons.size(), 2);
+  EXPECT_EQ(reasons[0].substr(0, 6), "crash\t");
+  EXPECT_EQ(reasons[1], "hang\ttimeout");
+  EXPECT_NE(access((options.output + ".shard-0").c_str(), F_OK), 0);
+}
+
+TEST(ShardedRunnerTest, FailsIfShardsCannotBeWritten) {
+  const char* tmp = getenv("TEST_TMPDIR");
+  ShardedRunOptions options;
+  options.workers = 2;
+  options.output =
+      string(tmp != nullptr ? tmp : "/tmp") + "/no_such_directory/out";
+
+  const ShardedRunStats stats = RunSharded(
+      {"f0", "f1", "f2"},
+      [](const string& filename, string* output) {
+        *output = filename + "\n";
+        return true;
+      },
+      options);
+
+  // Neither restarted forever nor blaming the files.
+  EXPECT_FALSE(stats.error.empty());
+  EXPECT_EQ(stats.processed, 0);
+  EXPECT_EQ(stats.restarts, 0);
+  EXPECT_TRUE(stats.quarantined.empty());
+}
+
+TEST(ShardedRunnerTest, KeepsShardsIfMergingFails) {
+  const char* tmp = getenv("TEST_TMPDIR");
+  ShardedRunOptions options;
+  options.workers = 1;
+  options.output = string(tmp != nullptr ? tmp : "/tmp") + "/sharded_merge";
+  const string shard = options.output + ".shard-0";
+
+  // The worker swaps its shard for a directory, which can't be merged.
+  const ShardedRunStats stats = RunSharded(
+      {"f0", "f1"},
+      [&shard](const string& filename, string* output) {
+        if (filename == "f0") {
+          unlink(shard.c_str());
+          mkdir(shard.c_str(), 0755);
+        }
+        *output = filename + "\n";
+        return true;
+      },
+      options);
+
+  EXPECT_EQ(stats.processed, 2);
+  EXPECT_NE(stats.error.find("Cannot merge"), string::npos) << stats.error;
+  EXPECT_EQ(access(shard.c_str(), F_OK), 0);
+  rmdir(shard.c_str());
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,175 @@
+// Aggregates statistics over a corpus in one parallel pass: win rates by komi,
+// handicap and rule, the distribution of game lengths, the frequency of first
+// moves and histograms of the margins. Every worker adds to its own
+// CorpusStats, and they are merged at the end. Games come from SGF files, the
+// trees under --roots, or a binary corpus written by an earlier run with
+// --write_corpus, which is much faster to read than SGF.
+//
+// Usage:
+//   sgf_stats [--output=stats.txt] [--threads=N] [--write_corpus=games.corpus]
+//       [--roots=dir,...] [--file_list=files.txt] [file ...]
+//   sgf_stats --corpus=games.corpus [--output=stats.txt] [--threads=N]
+
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_split.h"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+#include "sgf_parser/corpus.h"
+#include "sgf_parser/corpus_stats.h"
+#include "sgf_parser/dir_walker.h"
+#include "sgf_parser/file_tasks.h"
+#include "sgf_parser/parser.h"
+#include "sgf_parser/thread_pool.h"
+
+DEFINE_string(output, "", "Output file for the report; the log if empty.");
+DEFINE_int32(threads, 0, "Worker threads, 0 for one per core.");
+DEFINE_string(file_list, "", "A file with one SGF file name per line.");
+DEFINE_string(roots, "",
+              "Comma separated directories searched for .sgf files.");
+DEFINE_int32(walker_threads, 4, "Threads walking and loading --roots.");
+DEFINE_string(corpus, "", "Read games from this binary corpus instead of SGF.");
+DEFINE_string(write_corpus, "",
+              "Also write the parsed games to this binary corpus.");
+
+namespace sgf_parser {
+namespace {
+
+// What a worker keeps from game to game.
+struct WorkerState {
+  FileWorker file;
+  CorpusBlockBuilder block;
+};
+
+class StatsCollector {
+ public:
+  StatsCollector(int workers, CorpusWriter* writer)
+      : stats_(workers), writer_(writer) {
+    for (int i = 0; i < workers; ++i) states_.emplace_back(new WorkerState());
+  }
+
+  void AddSgf(int worker, const std::string& filename,
+              absl::string_view sgf) {
+    WorkerState* state = states_[worker].get();
+    if (!state->file.Parse(filename, sgf)) {
+      ++failed_;
+      return;
+    }
+    stats_.Add(worker, state->file.record);
+    if (writer_ == nullptr) return;
+    if (!state->block.Add(state->file.record)) {
+      LOG(ERROR) << filename << ": can't be written to the corpus.";
+      return;
+    }
+    if (state->block.bytes() >= kCorpusBlockBytes) Flush(state);
+  }
+
+  void Add(int worker, const GameRecord& record) { stats_.Add(worker, record); }
+
+  // Writes out the games the workers still hold.
+  void Finish() {
+    for (auto& state : states_) Flush(state.get());
+  }
+
+  int64_t failed() const { return failed_; }
+  CorpusStats Merged() const { return stats_.Merged(); }
+
+ private:
+  void Flush(WorkerState* state) {
+    if (writer_ != nullptr && !writer_->Write(&state->block)) {
+      LOG(FATAL) << "Failed to write " << FLAGS_write_corpus;
+    }
+  }
+
+  ShardedCorpusStats stats_;
+  std::vector<std::unique_ptr<WorkerState>> states_;
+  CorpusWriter* writer_;
+  std::atomic<int64_t> failed_{0};
+};
+
+}  // namespace
+}  // namespace sgf_parser
+
+int main(int argc, char* argv[]) {
+  google::InitGoogleLogging(argv[0]);
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  const std::vector<std::string> files =
+      sgf_parser::ReadInputFiles(argc, argv, FLAGS_file_list);
+  std::vector<std::string> roots;
+  if (!FLAGS_roots.empty()) roots = absl::StrSplit(FLAGS_roots, ',');
+  CHECK(FLAGS_corpus.empty() || (files.empty() && roots.empty()))
+      << "--corpus can't be combined with SGF input.";
+
+  sgf_parser::ThreadPool pool(FLAGS_threads);
+  std::unique_ptr<sgf_parser::CorpusWriter> writer;
+  if (!FLAGS_write_corpus.empty()) {
+    writer.reset(new sgf_parser::CorpusWriter());
+    CHECK(writer->Open(FLAGS_write_corpus))
+        << "Failed to open " << FLAGS_write_corpus;
+  }
+  // Workers of the pool and walker threads both index the states; the two
+  // never run at the same time.
+  sgf_parser::StatsCollector collector(
+      std::max(pool.num_threads(), FLAGS_walker_threads), writer.get());
+
+  if (!FLAGS_corpus.empty()) {
+    std::string error;
+    CHECK(sgf_parser::ReadCorpus(
+        FLAGS_corpus, &pool,
+        [&collector](int worker, const sgf_parser::GameRecord& record) {
+          collector.Add(worker, record);
+        },
+        &error)) << error;
+  }
+
+  for (const auto& file : files) {
+    pool.Schedule([&pool, &collector, &file]() {
+      collector.AddSgf(pool.CurrentWorker(), file,
+                       sgf_parser::ReadFileToString(file));
+    });
+  }
+  pool.Wait();
+
+  if (!roots.empty()) {
+    sgf_parser::DirWalkerOptions options;
+    options.threads = FLAGS_walker_threads;
+    if (!sgf_parser::WalkAndLoadFiles(
+            roots, options, sgf_parser::BatchLoaderOptions(),
+            [&collector](const sgf_parser::LoadedFile& file) {
+              if (file.error != 0) {
+                LOG(ERROR) << *file.filename << ": " << strerror(file.error);
+                return;
+              }
+              collector.AddSgf(file.worker, *file.filename, file.contents);
+            })) {
+      LOG(ERROR) << "Some directories could not be read.";
+    }
+  }
+
+  collector.Finish();
+  if (writer != nullptr) {
+    CHECK(writer->Close()) << "Failed to write " << FLAGS_write_corpus;
+  }
+
+  const sgf_parser::CorpusStats stats = collector.Merged();
+  LOG(INFO) << "Aggregated " << stats.games << " games; " << collector.failed()
+            << " files failed to parse.";
+  if (FLAGS_output.empty()) {
+    LOG(INFO) << "\n" << stats.DebugString();
+  } else {
+    std::ofstream out(FLAGS_output);
+    CHECK(out) << "Failed to open " << FLAGS_output;
+    out << stats.DebugString();
+    out.close();
+    CHECK(out) << "Failed to write " << FLAGS_output;
+  }
+  return 0;
+}
@@ -0,0 +1,145 @@
+#include "sgf_parser/superko.h"
+
+#include <algorithm>
+#include <string>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/match.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+namespace {
+
+// Initial number of slots, a power of 2. Enough for a 300 move game at the
+// maximum load.
+constexpr size_t kInitialSlots = 1024;
+
+// Added to a position's hash when white is to move.
+constexpr uint64_t kWhiteToMove = 0x5DEECE66D2545F49ULL;
+
+}  // namespace
+
+HashSet64::HashSet64() : slots_(kInitialSlots), mask_(kInitialSlots - 1) {}
+
+size_t HashSet64::Probe(uint64_t key) const {
+  // Zobrist hashes are uniform already; fold the high bits in anyway.
+  size_t i = (key ^ (key >> 32)) & mask_;
+  while (slots_[i].generation == generation_ && slots_[i].key != key) {
+    i = (i + 1) & mask_;
+  }
+  return i;
+}
+
+bool HashSet64::Contains(uint64_t key) const {
+  return slots_[Probe(key)].generation == generation_;
+}
+
+bool HashSet64::Insert(uint64_t key) {
+  Slot* slot = &slots_[Probe(key)];
+  if (slot->generation == generation_) return false;
+  // At most half full, so probes stay short.
+  if (2 * (size_ + 1) > slots_.size()) {
+    Grow();
+    slot = &slots_[Probe(key)];
+  }
+  slot->key = key;
+  slot->generation = generation_;
+  ++size_;
+  return true;
+}
+
+void HashSet64::Clear() {
+  size_ = 0;
+  if (++generation_ == 0) {
+    // Slots of the generations before the wrap around would look current.
+    std::fill(slots_.begin(), slots_.end(), Slot());
+    generation_ = 1;
+  }
+}
+
+void HashSet64::Grow() {
+  std::vector<Slot> old(slots_.size() * 2);
+  old.swap(slots_);
+  mask_ = slots_.size() - 1;
+  const uint32_t generation = generation_;
+  generation_ = 1;
+  for (const Slot& slot : old) {
+    if (slot.generation != generation) continue;
+    Slot& copy = slots_[Probe(slot.key)];
+    copy.key = slot.key;
+    copy.generation = generation_;
+  }
+}
+
+SuperkoRule SuperkoRuleOf(absl::string_view rule) {
+  const std::string lower = absl::AsciiStrToLower(rule);
+  for (const char* prefix : {"japan", "jp", "korea"}) {
+    if (absl::StartsWith(lower, prefix)) return SuperkoRule::NONE;
+  }
+  for (const char* prefix : {"aga", "nz", "new zealand", "ing", "goe"}) {
+    if (absl::StartsWith(lower, prefix)) return SuperkoRule::SITUATIONAL;
+  }
+  return SuperkoRule::POSITIONAL;
+}
+
+int FirstSuperkoViolation(const SuperkoReport& report, SuperkoRule rule) {
+  switch (rule) {
+    case SuperkoRule::NONE:
+      return -1;
+    case SuperkoRule::POSITIONAL:
+      return report.first_positional;
+    case SuperkoRule::SITUATIONAL:
+      return report.first_situational;
+  }
+  return -1;
+}
+
+void SuperkoChecker::Check(const GameRecord& record, SuperkoReport* report) {
+  *report = SuperkoReport();
+  const GoCoord size = GetBoardSize(record);
+  if (board_ == nullptr || board_->width() != size) {
+    board_.reset(new GoBoard(size, size));
+  } else {
+    board_->UndoTo(0);
+  }
+  positions_.Clear();
+  situations_.Clear();
+
+  for (const auto& pos : record.black_stones) {
+    if (!board_->Setup(pos, GoBoard::BLACK)) ++report->failures;
+  }
+  for (const auto& pos : record.white_stones) {
+    if (!board_->Setup(pos, GoBoard::WHITE)) ++report->failures;
+  }
+  const GoMove::Color first =
+      record.moves.empty() ? GoMove::BLACK : record.moves[0].player;
+  positions_.Insert(board_->hash());
+  situations_.Insert(board_->hash() ^ (first == GoMove::WHITE ? kWhiteToMove
+                                                              : 0));
+
+  for (size_t i = 0; i < record.moves.size(); ++i) {
+    const GoMove& move = record.moves[i];
+    // Off-board moves, e.g. "tt", are passes.
+    const bool pass = move.pass || !board_->OnBoard(move.move);
+    if (!pass && !board_->Play(move)) {
+      ++report->failures;
+      continue;
+    }
+    const uint64_t hash = board_->hash();
+    const bool new_position = positions_.Insert(hash);
+    const bool new_situation = situations_.Insert(
+        hash ^ (move.player == GoMove::BLACK ? kWhiteToMove : 0));
+    if (pass) continue;
+    if (!new_position) {
+      ++report->positional_repeats;
+      if (report->first_positional < 0) report->first_positional = i;
+    }
+    if (!new_situation) {
+      ++report->situational_repeats;
+      if (report->first_situational < 0) report->first_situational = i;
+    }
+  }
+}
+
+}  // namespace sgf_parser
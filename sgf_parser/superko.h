@@ -0,0 +1,96 @@
+#ifndef SGF_PARSER_SUPERKO_H_
+#define SGF_PARSER_SUPERKO_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "sgf_parser/board.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// A set of 64-bit hashes, open addressing with linear probing. Clear() is O(1):
+// every slot carries the generation it was written in, and clearing starts a
+// new generation. The table only grows, so a set reused across games stops
+// allocating once it has seen the longest one.
+class HashSet64 {
+ public:
+  HashSet64();
+
+  // Returns false if `key` was already in the set.
+  bool Insert(uint64_t key);
+
+  bool Contains(uint64_t key) const;
+
+  void Clear();
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  struct Slot {
+    uint64_t key = 0;
+    uint32_t generation = 0;   // The slot is empty unless it is generation_.
+  };
+
+  size_t Probe(uint64_t key) const;
+  void Grow();
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  size_t size_ = 0;
+  uint32_t generation_ = 1;
+};
+
+// How a rule set forbids repeating a whole-board position.
+enum class SuperkoRule {
+  NONE,          // Only the basic ko rule, e.g. Japanese rules.
+  POSITIONAL,    // No move may repeat a position, e.g. Chinese rules.
+  SITUATIONAL,   // No move may repeat a position with the same player to move,
+                 // e.g. AGA and New Zealand rules.
+};
+
+// The superko rule of a RU property value, case-insensitively. Unknown rules
+// are POSITIONAL, which is the strictest.
+SuperkoRule SuperkoRuleOf(absl::string_view rule);
+
+// Repetitions found in a game. Moves are indices into GameRecord::moves.
+struct SuperkoReport {
+  int failures = 0;             // Stones and moves which could not be placed.
+  int first_positional = -1;    // The first move repeating a position, or -1.
+  int first_situational = -1;   // The first move repeating a situation, or -1.
+  int positional_repeats = 0;
+  int situational_repeats = 0;
+};
+
+// The first move of a game which breaks `rule`, or -1 if there is none.
+int FirstSuperkoViolation(const SuperkoReport& report, SuperkoRule rule);
+
+// Replays games like ReplayRecord and checks every move against all earlier
+// positions by the board's Zobrist hash. A situation is the position together
+// with the player to move next. Passes repeat the position but are never
+// violations. The board and the hash sets are kept from game to game, so
+// checking a game costs O(moves) and doesn't allocate once the checker has
+// warmed up on a game as long and a board as large.
+class SuperkoChecker {
+ public:
+  SuperkoChecker() = default;
+
+  SuperkoChecker(const SuperkoChecker&) = delete;
+  SuperkoChecker& operator=(const SuperkoChecker&) = delete;
+
+  void Check(const GameRecord& record, SuperkoReport* report);
+
+ private:
+  std::unique_ptr<GoBoard> board_;
+  HashSet64 positions_;
+  HashSet64 situations_;
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_SUPERKO_H_
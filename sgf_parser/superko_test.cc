@@ -0,0 +1,217 @@
+#include "sgf_parser/superko.h"
+
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "glog/logging.h"
+#include "sgf_parser/alloc_counter.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+// The ko of a 4x4 board: black captures white's stone at (1, 1) by playing
+// (2, 1), and white can take back at (1, 1).
+GameRecord KoGame() {
+  GameRecord record;
+  record.board_width = record.board_height = 4;
+  record.black_stones = {{1, 0}, {0, 1}, {1, 2}};
+  record.white_stones = {{2, 0}, {3, 1}, {2, 2}, {1, 1}};
+  return record;
+}
+
+// The report of a fresh GoBoard and std::set.
+SuperkoReport ExpectedReport(const GameRecord& record) {
+  SuperkoReport report;
+  const GoCoord size = GetBoardSize(record);
+  GoBoard board(size, size);
+  for (const auto& pos : record.black_stones) board.Setup(pos, GoBoard::BLACK);
+  for (const auto& pos : record.white_stones) board.Setup(pos, GoBoard::WHITE);
+  std::set<uint64_t> positions = {board.hash()};
+  std::set<std::pair<uint64_t, int>> situations = {
+      {board.hash(), record.moves.empty() ? GoMove::BLACK
+                                          : record.moves[0].player}};
+  for (size_t i = 0; i < record.moves.size(); ++i) {
+    const GoMove& move = record.moves[i];
+    const bool pass = move.pass || !board.OnBoard(move.move);
+    if (!pass && !board.Play(move)) {
+      ++report.failures;
+      continue;
+    }
+    const bool new_position = positions.insert(board.hash()).second;
+    const bool new_situation =
+        situations.insert({board.hash(), 3 - move.player}).second;
+    if (pass) continue;
+    if (!new_position) {
+      ++report.positional_repeats;
+      if (report.first_positional < 0) report.first_positional = i;
+    }
+    if (!new_situation) {
+      ++report.situational_repeats;
+      if (report.first_situational < 0) report.first_situational = i;
+    }
+  }
+  return report;
+}
+
+void ExpectEqual(const SuperkoReport& actual, const SuperkoReport& expected) {
+  EXPECT_EQ(actual.failures, expected.failures);
+  EXPECT_EQ(actual.first_positional, expected.first_positional);
+  EXPECT_EQ(actual.first_situational, expected.first_situational);
+  EXPECT_EQ(actual.positional_repeats, expected.positional_repeats);
+  EXPECT_EQ(actual.situational_repeats, expected.situational_repeats);
+}
+
+class SuperkoTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(SuperkoTest, HashSet) {
+  HashSet64 set;
+  const size_t capacity = set.capacity();
+  EXPECT_TRUE(set.Insert(0));
+  EXPECT_TRUE(set.Insert(42));
+  EXPECT_FALSE(set.Insert(42));
+  EXPECT_TRUE(set.Contains(0));
+  EXPECT_FALSE(set.Contains(7));
+  EXPECT_EQ(set.size(), 2);
+  set.Clear();
+  EXPECT_EQ(set.size(), 0);
+  EXPECT_FALSE(set.Contains(42));
+  EXPECT_TRUE(set.Insert(42));
+
+  // Keys which collide in the low bits, past the initial capacity.
+  set.Clear();
+  for (uint64_t i = 0; i < 3 * capacity; ++i) {
+    EXPECT_TRUE(set.Insert(i << 40));
+  }
+  EXPECT_GT(set.capacity(), capacity);
+  for (uint64_t i = 0; i < 3 * capacity; ++i) {
+    EXPECT_TRUE(set.Contains(i << 40));
+    EXPECT_FALSE(set.Insert(i << 40));
+  }
+  EXPECT_FALSE(set.Contains(1));
+  EXPECT_EQ(set.size(), 3 * capacity);
+}
+
+TEST_F(SuperkoTest, Ko) {
+  SuperkoChecker checker;
+  SuperkoReport report;
+
+  // Taking back right away repeats the position and the situation.
+  GameRecord record = KoGame();
+  record.moves.emplace_back(GoMove::BLACK, false, GoPos(2, 1));
+  record.moves.emplace_back(GoMove::WHITE, false, GoPos(1, 1));
+  checker.Check(record, &report);
+  EXPECT_EQ(report.failures, 0);
+  EXPECT_EQ(report.first_positional, 1);
+  EXPECT_EQ(report.first_situational, 1);
+  EXPECT_EQ(FirstSuperkoViolation(report, SuperkoRule::NONE), -1);
+  EXPECT_EQ(FirstSuperkoViolation(report, SuperkoRule::POSITIONAL), 1);
+
+  // With white to move first, the position repeats with the other player to
+  // move. White's first move can't be played.
+  record = KoGame();
+  record.moves.emplace_back(GoMove::WHITE, false, GoPos(1, 1));
+  record.moves.emplace_back(GoMove::BLACK, false, GoPos(2, 1));
+  record.moves.emplace_back(GoMove::WHITE, false, GoPos(1, 1));
+  checker.Check(record, &report);
+  EXPECT_EQ(report.failures, 1);
+  EXPECT_EQ(report.first_positional, 2);
+  EXPECT_EQ(report.first_situational, -1);
+  EXPECT_EQ(FirstSuperkoViolation(report, SuperkoRule::SITUATIONAL), -1);
+
+  // But a pass puts the position with black to move on record.
+  record.moves[0] = GoMove(GoMove::WHITE, true, GoPos(-1, -1));
+  checker.Check(record, &report);
+  EXPECT_EQ(report.first_positional, 2);
+  EXPECT_EQ(report.first_situational, 2);
+
+  // Passes and moves which can't be played are not repeats.
+  record = KoGame();
+  record.moves.emplace_back(GoMove::BLACK, true, GoPos(-1, -1));
+  record.moves.emplace_back(GoMove::WHITE, true, GoPos(-1, -1));
+  record.moves.emplace_back(GoMove::BLACK, false, GoPos(1, 1));
+  record.moves.emplace_back(GoMove::WHITE, false, GoPos(9, 9));
+  checker.Check(record, &report);
+  EXPECT_EQ(report.failures, 1);
+  EXPECT_EQ(report.positional_repeats, 0);
+  EXPECT_EQ(report.situational_repeats, 0);
+}
+
+TEST_F(SuperkoTest, RandomGames) {
+  // Random moves on a small board capture a lot and so repeat positions.
+  std::mt19937 rng(5);
+  SuperkoChecker checker;
+  int repeats = 0;
+  int positional_only = 0;
+  for (const GoCoord size : {3, 4, 5, 19, 5}) {
+    for (int game = 0; game < 20; ++game) {
+      GameRecord record;
+      record.board_width = record.board_height = size;
+      std::uniform_int_distribution<int> coord(0, std::min<int>(size, 5) - 1);
+      std::uniform_int_distribution<int> percent(0, 99);
+      for (int i = 0; i < 400; ++i) {
+        const GoMove::Color color = i % 2 == 0 ? GoMove::BLACK : GoMove::WHITE;
+        record.moves.emplace_back(color, percent(rng) < 5,
+                                  GoPos(coord(rng), coord(rng)));
+      }
+      SuperkoReport report;
+      checker.Check(record, &report);
+      ExpectEqual(report, ExpectedReport(record));
+      repeats += report.positional_repeats;
+      positional_only += report.positional_repeats - report.situational_repeats;
+    }
+  }
+  EXPECT_GT(repeats, 100);
+  EXPECT_GT(positional_only, 0);
+}
+
+TEST_F(SuperkoTest, NoAllocations) {
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<int> coord(0, 18);
+  std::vector<GameRecord> games(3);
+  for (GameRecord& record : games) {
+    for (int i = 0; i < 300; ++i) {
+      record.moves.emplace_back(i % 2 == 0 ? GoMove::BLACK : GoMove::WHITE,
+                                false, GoPos(coord(rng), coord(rng)));
+    }
+  }
+  SuperkoChecker checker;
+  SuperkoReport report;
+  for (const GameRecord& record : games) checker.Check(record, &report);
+  AllocationCounter counter;
+  for (const GameRecord& record : games) checker.Check(record, &report);
+  EXPECT_EQ(counter.allocations(), 0);
+}
+
+TEST_F(SuperkoTest, TestData) {
+  SuperkoChecker checker;
+  for (const char* file : {"testdata/handicapped.sgf",
+                           "testdata/resigned.sgf"}) {
+    GameRecord record;
+    ASSERT_TRUE(SimpleParseSgf(ReadFileToString(file), &record, nullptr,
+                               nullptr)) << file;
+    SuperkoReport report;
+    checker.Check(record, &report);
+    EXPECT_EQ(report.failures, 0) << file;
+    EXPECT_EQ(report.positional_repeats, 0) << file;
+  }
+}
+
+TEST_F(SuperkoTest, RuleOf) {
+  EXPECT_EQ(SuperkoRuleOf("Japanese"), SuperkoRule::NONE);
+  EXPECT_EQ(SuperkoRuleOf("korean"), SuperkoRule::NONE);
+  EXPECT_EQ(SuperkoRuleOf("Chinese"), SuperkoRule::POSITIONAL);
+  EXPECT_EQ(SuperkoRuleOf(""), SuperkoRule::POSITIONAL);
+  EXPECT_EQ(SuperkoRuleOf("AGA"), SuperkoRule::SITUATIONAL);
+  EXPECT_EQ(SuperkoRuleOf("NZ"), SuperkoRule::SITUATIONAL);
+}
+
+}  // namespace
+}  // namespace sgf_parser
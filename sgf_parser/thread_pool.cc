@@ -0,0 +1,118 @@
+#include "sgf_parser/thread_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+namespace {
+
+// The pool and index of the worker running on this thread.
+thread_local const ThreadPool* current_pool = nullptr;
+thread_local int current_index = -1;
+
+}  // namespace
+
+ThreadPool::ThreadPool(int num_threads) {
+  if (num_threads <= 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    workers_.emplace_back(new Worker);
+  }
+  for (int i = 0; i < num_threads; ++i) {
+    workers_[i]->thread = std::thread([this, i] { Run(i); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+int ThreadPool::CurrentWorker() const {
+  return current_pool == this ? current_index : -1;
+}
+
+void ThreadPool::Schedule(std::function<void()> task) {
+  int index = CurrentWorker();
+  if (index < 0) {
+    index = next_victim_.fetch_add(1, std::memory_order_relaxed) %
+            workers_.size();
+  }
+  pending_.fetch_add(1);
+  {
+    std::lock_guard<std::mutex> lock(workers_[index]->mu);
+    workers_[index]->tasks.push_back(std::move(task));
+  }
+  queued_.fetch_add(1);
+  if (sleepers_.load() > 0) {
+    // Taking the lock orders this wake-up after a sleeper's last check.
+    std::lock_guard<std::mutex> lock(mu_);
+    work_available_.notify_one();
+  }
+}
+
+bool ThreadPool::PopOrSteal(int index, std::function<void()>* task) {
+  {
+    Worker* self = workers_[index].get();
+    std::lock_guard<std::mutex> lock(self->mu);
+    if (!self->tasks.empty()) {
+      *task = std::move(self->tasks.back());
+      self->tasks.pop_back();
+      return true;
+    }
+  }
+  const int n = workers_.size();
+  for (int i = 1; i < n; ++i) {
+    Worker* victim = workers_[(index + i) % n].get();
+    std::lock_guard<std::mutex> lock(victim->mu);
+    if (!victim->tasks.empty()) {
+      *task = std::move(victim->tasks.front());
+      victim->tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::Run(int index) {
+  current_pool = this;
+  current_index = index;
+  std::function<void()> task;
+  while (true) {
+    if (PopOrSteal(index, &task)) {
+      queued_.fetch_sub(1);
+      task();
+      task = nullptr;
+      if (pending_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(mu_);
+        all_done_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mu_);
+    sleepers_.fetch_add(1);
+    work_available_.wait(lock, [this] {
+      return stopping_ || queued_.load() > 0;
+    });
+    sleepers_.fetch_sub(1);
+    if (stopping_ && queued_.load() == 0) return;
+  }
+}
+
+void ThreadPool::Wait() {
+  CHECK_LT(CurrentWorker(), 0) << "Wait() called from a worker.";
+  std::unique_lock<std::mutex> lock(mu_);
+  all_done_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+}  // namespace sgf_parser
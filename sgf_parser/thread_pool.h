@@ -0,0 +1,70 @@
+#ifndef SGF_PARSER_THREAD_POOL_H_
+#define SGF_PARSER_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sgf_parser {
+
+// A work stealing thread pool. Every worker owns a deque of tasks. A task
+// scheduled from a worker goes to the back of that worker's deque and is run
+// LIFO, which keeps recursive work (e.g. the subtrees of a variation) local and
+// cache friendly. Idle workers steal from the front of the other deques.
+class ThreadPool {
+ public:
+  // num_threads <= 0 means one thread per hardware thread.
+  explicit ThreadPool(int num_threads);
+
+  // Runs all pending tasks, then joins the workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int num_threads() const { return workers_.size(); }
+
+  // Schedules a task. It is safe to call from any thread, including from tasks.
+  void Schedule(std::function<void()> task);
+
+  // Blocks until every task scheduled so far, and every task those schedule,
+  // has finished. Must not be called from a worker.
+  void Wait();
+
+  // Returns the index of the calling worker in [0, num_threads) if it belongs
+  // to this pool, or -1.
+  int CurrentWorker() const;
+
+ private:
+  struct Worker {
+    std::mutex mu;
+    std::deque<std::function<void()>> tasks;
+    std::thread thread;
+  };
+
+  void Run(int index);
+  bool PopOrSteal(int index, std::function<void()>* task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_victim_{0};
+
+  // Number of tasks in all deques, and number of tasks not finished yet.
+  std::atomic<int64_t> queued_{0};
+  std::atomic<int64_t> pending_{0};
+
+  // Guards sleeping and waking up.
+  std::mutex mu_;
+  std::condition_variable work_available_;
+  std::condition_variable all_done_;
+  std::atomic<int> sleepers_{0};
+  bool stopping_ = false;
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_THREAD_POOL_H_
@@ -0,0 +1,39 @@
+#include "sgf_parser/thread_pool.h"
+
+#include <atomic>
+#include <functional>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+TEST(ThreadPoolTest, RecursiveTasks) {
+  ThreadPool pool(3);
+  std::atomic<int> count{0};
+  std::function<void(int)> spawn = [&](int level) {
+    ++count;
+    if (level == 0) return;
+    for (int i = 0; i < 3; ++i) {
+      pool.Schedule([&spawn, level] { spawn(level - 1); });
+    }
+  };
+  pool.Schedule([&spawn] { spawn(5); });
+  pool.Wait();
+  // 1 + 3 + ... + 3^5.
+  EXPECT_EQ(count.load(), 364);
+}
+
+TEST(ThreadPoolTest, CurrentWorker) {
+  ThreadPool pool(2);
+  EXPECT_EQ(pool.CurrentWorker(), -1);
+  std::atomic<int> index{-1};
+  pool.Schedule([&] { index = pool.CurrentWorker(); });
+  pool.Wait();
+  EXPECT_GE(index.load(), 0);
+  EXPECT_LT(index.load(), 2);
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,134 @@
+#include "sgf_parser/tree_cursor.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using internal::GameTree;
+
+namespace {
+
+int NumChildren(const GameTree* tree, size_t index) {
+  if (index + 1 < tree->sequence.size()) return 1;
+  return tree->children.size();
+}
+
+}  // namespace
+
+TreeCursor::TreeCursor(const GameTree* game)
+    : game_(game),
+      board_([game] {
+        CHECK(game != nullptr && !game->sequence.empty()) << "Empty game.";
+        const GoCoord size = GetBoardSize(game->sequence[0]);
+        return GoBoard(size, size);
+      }()) {
+  Enter(game_, 0);
+}
+
+void TreeCursor::Enter(const GameTree* tree, size_t index) {
+  const int illegal = path_.empty() ? 0 : path_.back().illegal_moves;
+  const size_t mark = board_.Mark();
+  path_.push_back(Frame{tree, index, mark, illegal});
+  path_.back().illegal_moves += ApplyNode(tree->sequence[index], &board_);
+}
+
+int TreeCursor::num_children() const {
+  return NumChildren(tree(), index());
+}
+
+bool TreeCursor::Child(int i) {
+  const GameTree* t = tree();
+  const size_t idx = index();
+  if (i < 0 || i >= NumChildren(t, idx)) return false;
+  if (idx + 1 < t->sequence.size()) {
+    Enter(t, idx + 1);
+  } else {
+    Enter(t->children[i].get(), 0);
+  }
+  return true;
+}
+
+bool TreeCursor::Parent() {
+  if (path_.size() == 1) return false;
+  board_.UndoTo(path_.back().board_mark);
+  path_.pop_back();
+  return true;
+}
+
+int TreeCursor::SiblingIndex() const {
+  const GameTree* t = tree();
+  if (index() > 0 || t == game_) return 0;
+  const auto& siblings = t->parent->children;
+  for (size_t i = 0; i < siblings.size(); ++i) {
+    if (siblings[i].get() == t) return i;
+  }
+  LOG(FATAL) << "A tree is not a child of its parent.";
+  return 0;
+}
+
+bool TreeCursor::Next() {
+  if (path_.size() == 1) return false;
+  const Frame& parent = path_[path_.size() - 2];
+  const int sibling = SiblingIndex() + 1;
+  if (sibling >= NumChildren(parent.tree, parent.index)) return false;
+  Parent();
+  return Child(sibling);
+}
+
+bool TreeCursor::Prev() {
+  if (path_.size() == 1) return false;
+  const int sibling = SiblingIndex() - 1;
+  if (sibling < 0) return false;
+  Parent();
+  return Child(sibling);
+}
+
+bool TreeCursor::JumpTo(const GameTree* tree, size_t index) {
+  if (tree == nullptr || index >= tree->sequence.size()) return false;
+  // The trees from the first tree of the game down to the target tree.
+  chain_.clear();
+  for (const GameTree* t = tree; t != nullptr; t = t->parent) {
+    chain_.push_back(t);
+    if (t == game_) break;
+  }
+  if (chain_.back() != game_) return false;
+  std::reverse(chain_.begin(), chain_.end());
+
+  // Keep the longest prefix of the path which leads to the target.
+  size_t keep = 0;
+  size_t depth = 0;   // Position of path_[keep - 1].tree in chain_.
+  for (size_t j = 0; keep < path_.size(); ++keep) {
+    const Frame& frame = path_[keep];
+    if (frame.tree != chain_[j]) {
+      if (j + 1 < chain_.size() && frame.tree == chain_[j + 1]) {
+        ++j;
+      } else {
+        break;
+      }
+    }
+    if (frame.tree == tree && frame.index > index) break;
+    depth = j;
+  }
+  DCHECK_GE(keep, 1);
+  if (keep < path_.size()) {
+    board_.UndoTo(path_[keep].board_mark);
+    path_.resize(keep);
+  }
+
+  // Walk down to the target.
+  while (this->tree() != tree || this->index() != index) {
+    const GameTree* t = this->tree();
+    const size_t idx = this->index();
+    if (idx + 1 < t->sequence.size()) {
+      Enter(t, idx + 1);
+    } else {
+      Enter(chain_[++depth], 0);
+    }
+  }
+  return true;
+}
+
+}  // namespace sgf_parser
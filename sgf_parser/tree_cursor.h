@@ -0,0 +1,93 @@
+#ifndef SGF_PARSER_TREE_CURSOR_H_
+#define SGF_PARSER_TREE_CURSOR_H_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "sgf_parser/board.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+
+// A cursor over the variation tree of one game, as filled by
+// internal::ParseToRoot. A node is identified by a GameTree and an index into
+// its sequence. The cursor keeps the board position of the current node up to
+// date incrementally: moving to a child applies that node's B, W, AB, AW and
+// AE properties, and moving to the parent undoes them. So a depth first walk
+// over all variations costs O(1) amortized per step and never replays from the
+// first node.
+//
+// Example:
+//   internal::GameTree root(nullptr);
+//   CHECK(internal::ParseToRoot(sgf, &root, &errors));
+//   TreeCursor cursor(root.children[0].get());
+//   while (cursor.Child(0)) { ... cursor.board() ... }
+class TreeCursor {
+ public:
+  // `game` is a top level game tree, i.e. one of the children of the root
+  // filled by ParseToRoot. It must outlive the cursor. The board size is taken
+  // from the SZ property of the first node and defaults to 19.
+  explicit TreeCursor(const internal::GameTree* game);
+
+  const internal::GameTree* tree() const { return path_.back().tree; }
+  size_t index() const { return path_.back().index; }
+  const internal::GameNode& node() const {
+    return tree()->sequence[index()];
+  }
+
+  // The position after the current node has been applied.
+  const GoBoard& board() const { return board_; }
+
+  // Number of steps from the first node of the game.
+  int depth() const { return path_.size() - 1; }
+
+  // Number of moves which could not be played, e.g. onto occupied points,
+  // on the path to the current node. Such moves are skipped.
+  int illegal_moves() const { return path_.back().illegal_moves; }
+
+  int num_children() const;
+
+  // Moves to the i-th child. Returns false, leaving the cursor unchanged, if
+  // there is no such child.
+  bool Child(int i);
+
+  // Moves to the parent. Returns false at the first node of the game.
+  bool Parent();
+
+  // Moves to the next or previous sibling variation. Returns false if there is
+  // no such sibling.
+  bool Next();
+  bool Prev();
+
+  // Moves to the node `index` of `tree`, undoing up to the common ancestor of
+  // the current node and the target, then applying nodes down to the target.
+  // Returns false, leaving the cursor unchanged, if the node does not belong
+  // to this game.
+  bool JumpTo(const internal::GameTree* tree, size_t index);
+
+ private:
+  struct Frame {
+    const internal::GameTree* tree;
+    size_t index;
+    size_t board_mark;   // Board history before this node is applied.
+    int illegal_moves;   // Including this node.
+  };
+
+  // Index of the current node among the children of its parent.
+  int SiblingIndex() const;
+
+  // Pushes the node and applies its properties to the board.
+  void Enter(const internal::GameTree* tree, size_t index);
+
+  const internal::GameTree* const game_;
+  GoBoard board_;
+  std::vector<Frame> path_;
+
+  // Scratch space for JumpTo().
+  std::vector<const internal::GameTree*> chain_;
+};
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_TREE_CURSOR_H_
@@ -0,0 +1,131 @@
+#include "sgf_parser/tree_cursor.h"
+
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+// A game with a main line and two variations after the second move:
+//   B[aa] W[bb] -- B[cc] W[dd]
+//              \-- B[dd]
+//              \-- B[ee] W[ff]
+const char kGame[] =
+    "(;SZ[9];B[aa];W[bb](;B[cc];W[dd])(;B[dd])(;B[ee];W[ff]))";
+
+class TreeCursorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+    root_.reset(new internal::GameTree(nullptr));
+    ASSERT_TRUE(internal::ParseToRoot(kGame, root_.get(), nullptr));
+    game_ = root_->children[0].get();
+  }
+
+  // Returns the move of the current node as "B[aa]".
+  static string Move(const TreeCursor& cursor) {
+    const auto& node = cursor.node();
+    if (node.empty()) return "";
+    return string(node[0].id) + "[" + string(node[0].values[0]) + "]";
+  }
+
+  // Replays from scratch to the current node of the cursor.
+  static uint64_t ReplayHash(const TreeCursor& cursor) {
+    std::vector<const internal::GameNode*> nodes;
+    TreeCursor copy = cursor;
+    do {
+      nodes.push_back(&copy.node());
+    } while (copy.Parent());
+    GoBoard board(9, 9);
+    for (auto it = nodes.rbegin(); it != nodes.rend(); ++it) {
+      ApplyNode(**it, &board);
+    }
+    return board.hash();
+  }
+
+  std::unique_ptr<internal::GameTree> root_;
+  const internal::GameTree* game_ = nullptr;
+};
+
+TEST_F(TreeCursorTest, Navigate) {
+  TreeCursor cursor(game_);
+  EXPECT_EQ(cursor.depth(), 0);
+  EXPECT_EQ(cursor.board().width(), 9);
+  EXPECT_FALSE(cursor.Parent());
+  EXPECT_FALSE(cursor.Next());
+
+  ASSERT_TRUE(cursor.Child(0));
+  ASSERT_TRUE(cursor.Child(0));
+  EXPECT_EQ(Move(cursor), "W[bb]");
+  EXPECT_EQ(cursor.num_children(), 3);
+  EXPECT_FALSE(cursor.Child(3));
+
+  ASSERT_TRUE(cursor.Child(2));
+  EXPECT_EQ(Move(cursor), "B[ee]");
+  EXPECT_FALSE(cursor.Next());
+  ASSERT_TRUE(cursor.Prev());
+  EXPECT_EQ(Move(cursor), "B[dd]");
+  EXPECT_EQ(cursor.board().At({3, 3}), GoBoard::BLACK);
+  EXPECT_EQ(cursor.board().At({4, 4}), GoBoard::EMPTY);
+  ASSERT_TRUE(cursor.Prev());
+  EXPECT_EQ(Move(cursor), "B[cc]");
+  EXPECT_FALSE(cursor.Prev());
+  EXPECT_EQ(cursor.board().At({3, 3}), GoBoard::EMPTY);
+
+  ASSERT_TRUE(cursor.Parent());
+  ASSERT_TRUE(cursor.Parent());
+  ASSERT_TRUE(cursor.Parent());
+  EXPECT_EQ(cursor.depth(), 0);
+  EXPECT_EQ(cursor.board().hash(), GoBoard(9, 9).hash());
+}
+
+TEST_F(TreeCursorTest, DepthFirstWalkMatchesReplay) {
+  TreeCursor cursor(game_);
+  std::vector<string> leaves;
+  std::vector<int> next_child = {0};
+  while (!next_child.empty()) {
+    EXPECT_EQ(cursor.board().hash(), ReplayHash(cursor));
+    if (cursor.num_children() == 0) leaves.push_back(Move(cursor));
+    if (cursor.Child(next_child.back()++)) {
+      next_child.push_back(0);
+    } else {
+      next_child.pop_back();
+      cursor.Parent();
+    }
+  }
+  EXPECT_EQ(leaves, std::vector<string>({"W[dd]", "B[dd]", "W[ff]"}));
+  EXPECT_EQ(cursor.depth(), 0);
+}
+
+TEST_F(TreeCursorTest, JumpTo) {
+  TreeCursor cursor(game_);
+  const internal::GameTree* third = game_->children[2].get();
+  ASSERT_TRUE(cursor.JumpTo(third, 1));
+  EXPECT_EQ(Move(cursor), "W[ff]");
+  EXPECT_EQ(cursor.depth(), 4);
+  EXPECT_EQ(cursor.board().hash(), ReplayHash(cursor));
+
+  const internal::GameTree* first = game_->children[0].get();
+  ASSERT_TRUE(cursor.JumpTo(first, 0));
+  EXPECT_EQ(Move(cursor), "B[cc]");
+  EXPECT_EQ(cursor.board().At({4, 4}), GoBoard::EMPTY);
+  EXPECT_EQ(cursor.board().hash(), ReplayHash(cursor));
+
+  ASSERT_TRUE(cursor.JumpTo(game_, 1));
+  EXPECT_EQ(Move(cursor), "B[aa]");
+  EXPECT_EQ(cursor.board().hash(), ReplayHash(cursor));
+
+  EXPECT_FALSE(cursor.JumpTo(game_, 10));
+  internal::GameTree other(nullptr);
+  other.sequence.emplace_back();
+  EXPECT_FALSE(cursor.JumpTo(&other, 0));
+  EXPECT_EQ(Move(cursor), "B[aa]");
+}
+
+}  // namespace
+}  // namespace sgf_parser
@@ -0,0 +1,217 @@
+#include "sgf_parser/validator.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "glog/logging.h"
+
+namespace sgf_parser {
+
+using absl::string_view;
+using std::string;
+
+#define LOG_ERROR(msg) do {                                      \
+  if (errors != nullptr) absl::StrAppend(errors, (msg), "\n");   \
+  LOG(WARNING) << "SGF parser error: " << (msg);                 \
+} while (0)
+
+#define RETURN_IF(condition, msg, retval) do {                   \
+  if ((condition)) {                                             \
+    LOG_ERROR((msg));                                            \
+    return (retval);                                             \
+  }                                                              \
+} while (0)
+
+namespace {
+
+constexpr size_t kNotFound = string_view::npos;
+
+// A set of characters as a lookup table.
+class CharSet {
+ public:
+  constexpr explicit CharSet(const char* chars) : table_() {
+    for (; *chars != '\0'; ++chars) {
+      table_[static_cast<unsigned char>(*chars)] = true;
+    }
+  }
+
+  bool Contains(char c) const { return table_[static_cast<unsigned char>(c)]; }
+
+ private:
+  bool table_[256];
+};
+
+constexpr CharSet kTreeStart("(");
+constexpr CharSet kNodeStart(";");
+constexpr CharSet kValueStart("[");
+constexpr CharSet kAfterValue("[;()");
+constexpr CharSet kAfterTree("()");
+
+// Same as internal::FindFirst. If `blank` is not null, also tells whether
+// everything skipped was whitespace.
+inline size_t Find(string_view sgf, size_t i, const CharSet& targets,
+                   bool expect_contents, bool* blank = nullptr) {
+  const size_t n = sgf.size();
+  bool all_space = true;
+  while (i < n) {
+    const char c = sgf[i];
+    if (targets.Contains(c)) {
+      if (blank != nullptr) *blank = all_space;
+      return i;
+    }
+    if (c == '\\') {
+      all_space = false;
+      i += 2;
+    } else if (!absl::ascii_isspace(c)) {
+      if (!expect_contents) return kNotFound;
+      all_space = false;
+      ++i;
+    } else {
+      ++i;
+    }
+  }
+  return kNotFound;
+}
+
+// Same as Find(sgf, i, CharSet("]"), true). Values, comments in particular,
+// are most of a file, so this looks at 16 bytes at a time.
+size_t FindValueEnd(string_view sgf, size_t i) {
+  const char* data = sgf.data();
+  const size_t n = sgf.size();
+  while (i < n) {
+#ifdef __SSE2__
+    const __m128i close = _mm_set1_epi8(']');
+    const __m128i escape = _mm_set1_epi8('\\');
+    while (i + 16 <= n) {
+      const __m128i chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      const int mask = _mm_movemask_epi8(_mm_or_si128(
+          _mm_cmpeq_epi8(chunk, close), _mm_cmpeq_epi8(chunk, escape)));
+      if (mask != 0) {
+        i += __builtin_ctz(mask);
+        break;
+      }
+      i += 16;
+    }
+#endif
+    while (i < n && data[i] != ']' && data[i] != '\\') ++i;
+    if (i >= n) break;
+    if (data[i] == ']') return i;
+    i += 2;   // Skip the escaped character.
+  }
+  return kNotFound;
+}
+
+// Whether sgf[begin, end) is B or W, ignoring case and surrounding whitespace,
+// which is how the parser reads moves.
+bool IsMoveId(string_view sgf, size_t begin, size_t end) {
+  while (begin < end && absl::ascii_isspace(sgf[begin])) ++begin;
+  while (end > begin && absl::ascii_isspace(sgf[end - 1])) --end;
+  if (end - begin != 1) return false;
+  const char c = absl::ascii_toupper(sgf[begin]);
+  return c == 'B' || c == 'W';
+}
+
+// Same as internal::ConsumeNode, but only counts moves.
+size_t ConsumeNode(string_view sgf, size_t cursor, SgfCounts* counts,
+                   string* errors) {
+  size_t p = Find(sgf, cursor, kValueStart, true);
+  RETURN_IF(p == kNotFound, "Reach the end of of node.", kNotFound);
+  bool is_move = IsMoveId(sgf, cursor, p);
+  cursor = p + 1;
+  while (true) {
+    p = FindValueEnd(sgf, cursor);
+    RETURN_IF(p == kNotFound, "Missing the end of a property value.",
+              kNotFound);
+    if (is_move) ++counts->moves;
+    cursor = p + 1;
+
+    bool blank;
+    p = Find(sgf, cursor, kAfterValue, true, &blank);
+    RETURN_IF(p == kNotFound, "Missing the end of a node.", kNotFound);
+    if (sgf[p] == '[') {
+      // Either another value of the same property or a new property.
+      if (!blank) is_move = IsMoveId(sgf, cursor, p);
+      cursor = p + 1;
+      continue;
+    }
+    RETURN_IF(!blank, "Non-empty contents after the end of a value.",
+              kNotFound);
+    return p;
+  }
+}
+
+}  // namespace
+
+bool ValidateSgf(string_view sgf, SgfCounts* counts, string* errors) {
+  // The states of internal::ParseToRoot. Instead of a tree there is only the
+  // nesting depth, 0 being the collection.
+  enum State {
+    TREE_START,
+    NODE_START,
+    NEXT_TREE,
+    END,
+  };
+
+  SgfCounts unused;
+  if (counts == nullptr) counts = &unused;
+  *counts = SgfCounts();
+
+  auto enter_tree = [counts](int* depth) {
+    if (*depth == 0) ++counts->games;
+    ++*depth;
+    counts->max_depth = std::max(counts->max_depth, *depth);
+  };
+
+  size_t p = Find(sgf, 0, kTreeStart, false);
+  RETURN_IF(p == kNotFound, "Failed in finding a tree start.", false);
+  size_t cursor = p + 1;
+  int depth = 0;
+  enter_tree(&depth);
+  State state = TREE_START;
+
+  while (state != END) {
+    if (state == TREE_START) {
+      p = Find(sgf, cursor, kNodeStart, false);
+      RETURN_IF(p == kNotFound, "Failed in finding a node start.", false);
+      state = NODE_START;
+    } else if (state == NODE_START) {
+      ++counts->nodes;
+      p = ConsumeNode(sgf, cursor, counts, errors);
+      RETURN_IF(p == kNotFound, "Error in parsing a node.", false);
+      if (sgf[p] == ')') {
+        // A node is always inside a game, so this can't leave the collection.
+        --depth;
+        state = NEXT_TREE;
+      } else if (sgf[p] == '(') {
+        enter_tree(&depth);
+        state = TREE_START;
+      }
+    } else if (state == NEXT_TREE) {
+      p = Find(sgf, cursor, kAfterTree, false);
+      if (p == kNotFound) {
+        state = END;
+      } else if (sgf[p] == '(') {
+        enter_tree(&depth);
+        state = TREE_START;
+      } else {
+        RETURN_IF(depth == 0, "Trying to going up in the root tree.", false);
+        --depth;
+      }
+    }
+    cursor = p + 1;
+  }
+
+  RETURN_IF(depth != 0, "Parser ends with a bad state.", false);
+  return true;
+}
+
+#undef RETURN_IF
+#undef LOG_ERROR
+
+}  // namespace sgf_parser
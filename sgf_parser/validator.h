@@ -0,0 +1,30 @@
+#ifndef SGF_PARSER_VALIDATOR_H_
+#define SGF_PARSER_VALIDATOR_H_
+
+#include <stdint.h>
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace sgf_parser {
+
+// What ValidateSgf() found.
+struct SgfCounts {
+  int64_t games = 0;    // Game trees at the top level of the collection.
+  int64_t nodes = 0;    // Nodes in all variations.
+  int64_t moves = 0;    // Values of B and W properties in all variations.
+  int max_depth = 0;    // Deepest nesting of game trees; a game alone is 1.
+};
+
+// Checks that `sgf` is structurally valid, i.e. that internal::ParseToRoot
+// accepts it, without building anything. On failure the same errors as
+// ParseToRoot are appended to `errors` if it is not null. `counts` may be null;
+// on failure it holds the counts up to the error.
+//
+// Never allocates unless there is an error to report.
+bool ValidateSgf(absl::string_view sgf, SgfCounts* counts, std::string* errors);
+
+}  // namespace sgf_parser
+
+#endif  // SGF_PARSER_VALIDATOR_H_
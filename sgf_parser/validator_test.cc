@@ -0,0 +1,123 @@
+#include "sgf_parser/validator.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "glog/logging.h"
+#include "gtest/gtest.h"
+#include "sgf_parser/alloc_counter.h"
+#include "sgf_parser/parser.h"
+
+namespace sgf_parser {
+namespace {
+
+using ::std::string;
+
+// Counts the same things as ValidateSgf on a parsed tree.
+void CountTree(const internal::GameTree& tree, int depth, SgfCounts* counts) {
+  counts->max_depth = std::max(counts->max_depth, depth);
+  counts->nodes += tree.sequence.size();
+  for (const auto& node : tree.sequence) {
+    for (const auto& prop : node) {
+      if (prop.id == "B" || prop.id == "W" || prop.id == "b" ||
+          prop.id == "w") {
+        counts->moves += prop.values.size();
+      }
+    }
+  }
+  for (const auto& child : tree.children) {
+    CountTree(*child, depth + 1, counts);
+  }
+}
+
+// Validates `sgf` and checks that the parser agrees, errors included.
+void ExpectSameAsParser(const string& sgf) {
+  SCOPED_TRACE(sgf.substr(0, 80));
+  internal::GameTree root(nullptr);
+  string parse_errors;
+  const bool parsed = internal::ParseToRoot(sgf, &root, &parse_errors);
+
+  SgfCounts counts;
+  string errors;
+  EXPECT_EQ(ValidateSgf(sgf, &counts, &errors), parsed);
+  EXPECT_EQ(errors, parse_errors);
+  if (parsed) {
+    SgfCounts expected;
+    CountTree(root, 0, &expected);
+    expected.games = root.children.size();
+    EXPECT_EQ(counts.games, expected.games);
+    EXPECT_EQ(counts.nodes, expected.nodes);
+    EXPECT_EQ(counts.moves, expected.moves);
+    EXPECT_EQ(counts.max_depth, expected.max_depth);
+  }
+}
+
+class ValidatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    FLAGS_v = 0;
+  }
+};
+
+TEST_F(ValidatorTest, TestData) {
+  for (const char* file : {"testdata/handicapped.sgf", "testdata/resigned.sgf",
+                           "testdata/collection.sgf"}) {
+    const string sgf = ReadFileToString(file);
+    ASSERT_FALSE(sgf.empty()) << file;
+    ExpectSameAsParser(sgf);
+  }
+
+  SgfCounts counts;
+  ASSERT_TRUE(ValidateSgf(ReadFileToString("testdata/collection.sgf"), &counts,
+                          nullptr));
+  EXPECT_EQ(counts.games, 3);
+  EXPECT_EQ(counts.max_depth, 2);
+}
+
+TEST_F(ValidatorTest, SameErrorsAsParser) {
+  const std::vector<string> kInputs = {
+      "",
+      "\n\n;",
+      "(a;)",
+      "(;)",
+      "(;B[aa]",
+      "(;B[aa",
+      "(;B[aa] x ;W[bb])",
+      "(;B[aa]))",
+      "(;B[aa])(;W[bb])",
+      "(;B[aa](;W[bb])(;W[cc];B[dd]))",
+      "(;C[a \\] b]B[aa][bb]\nw [cc])",
+      "(;C[\\",
+      "(;FF[4]  AB[aa]\n[bb]\n\nAW [cc];b[dd];W[])",
+      "(;B[aa]) trailing garbage",
+      "(;B[aa]);",
+      "  (;B[aa]\n)\n",
+      "(;B[aa]((;W[bb])))",
+  };
+  for (const auto& input : kInputs) {
+    ExpectSameAsParser(input);
+  }
+  // Long values, to get past the 16 byte blocks.
+  string comment(100, 'x');
+  comment[37] = '\\';
+  ExpectSameAsParser("(;C[" + comment + "]B[aa])");
+  ExpectSameAsParser("(;C[" + comment);
+}
+
+TEST_F(ValidatorTest, NoAllocations) {
+  string sgf;
+  for (int i = 0; i < 1000; ++i) sgf += "(;B[aa]C[a comment](;W[bb])";
+  sgf.append(1000, ')');
+  AllocationCounter counter;
+  SgfCounts counts;
+  EXPECT_TRUE(ValidateSgf(sgf, &counts, nullptr));
+  EXPECT_EQ(counter.allocations(), 0);
+  EXPECT_EQ(counts.games, 1);
+  EXPECT_EQ(counts.nodes, 2000);
+  EXPECT_EQ(counts.moves, 2000);
+  EXPECT_EQ(counts.max_depth, 1001);
+}
+
+}  // namespace
+}  // namespace sgf_parser